@@ -5,7 +5,7 @@ import torch
 import torch.nn as nn
 from alias_free_activation.torch.resample import UpSample1d, DownSample1d
 
-# load fused CUDA kernel: this enables importing anti_alias_activation_cuda
+# load fused kernels (CUDA when nvcc is available, CPU always): this enables importing anti_alias_activation_cuda
 from alias_free_activation.cuda import load
 
 anti_alias_activation_cuda = load.load()
@@ -13,21 +13,36 @@ anti_alias_activation_cuda = load.load()
 
 class FusedAntiAliasActivation(torch.autograd.Function):
     """
-    Assumes filter size 12, replication padding on upsampling/downsampling, and logscale alpha/beta parameters as inputs.
-    The hyperparameters are hard-coded in the kernel to maximize speed.
-    NOTE: The fused kenrel is incorrect for Activation1d with different hyperparameters.
+    Assumes replication padding on upsampling/downsampling, and logscale alpha/beta parameters as inputs.
+    CUDA inputs run the CUDA kernel, which hard-codes filter size 12 and ratio 2 to maximize speed.
+    CPU inputs run the vectorized CPU kernel, templated on the filter sizes and ratios: the default
+    UpSample1d/DownSample1d shapes of ratios 2, 3 and 4 are compiled as specializations, other shapes run a generic kernel.
+    It reads and writes float32, bfloat16 or float16 (the input's dtype) and accumulates in float32.
+    The backward is fused on CPU: it recomputes the upsampled activations from the input instead of storing them,
+    and returns gradients for the input and the logscale alpha and beta.
+    Optional per-item lengths (CPU only) process each item of a padded batch as its own sequence.
     """
 
     @staticmethod
-    def forward(ctx, inputs, up_ftr, down_ftr, alpha, beta):
-        activation_results = anti_alias_activation_cuda.forward(inputs, up_ftr, down_ftr, alpha, beta)
+    def forward(ctx, inputs, up_ftr, down_ftr, alpha, beta, up_ratio, down_ratio, lengths):
+        activation_results = anti_alias_activation_cuda.forward(
+            inputs, up_ftr, down_ftr, alpha, beta, up_ratio, down_ratio, lengths
+        )
+        ctx.save_for_backward(inputs, up_ftr, down_ftr, alpha, beta)
+        ctx.ratios = (up_ratio, down_ratio)
+        ctx.lengths = lengths
 
         return activation_results
 
     @staticmethod
     def backward(ctx, output_grads):
-        raise NotImplementedError
-        return output_grads, None, None
+        inputs, up_ftr, down_ftr, alpha, beta = ctx.saved_tensors
+        if inputs.is_cuda:
+            raise NotImplementedError("The fused anti-alias activation backward is implemented on CPU only")
+        input_grads, alpha_grads, beta_grads = anti_alias_activation_cuda.backward(
+            output_grads, inputs, up_ftr, down_ftr, alpha, beta, *ctx.ratios, ctx.lengths
+        )
+        return input_grads, None, None, alpha_grads, beta_grads, None, None, None
 
 
 class Activation1d(nn.Module):
@@ -47,23 +62,95 @@ class Activation1d(nn.Module):
         self.upsample = UpSample1d(up_ratio, up_kernel_size)
         self.downsample = DownSample1d(down_ratio, down_kernel_size)
 
-        self.fused = fused  # Whether to use fused CUDA kernel or not
+        self.fused = fused  # Whether to use fused CUDA/CPU kernel or not
 
-    def forward(self, x):
-        if not self.fused:
+    def _fused_supported(self, x):
+        shape = (self.upsample.kernel_size, self.downsample.kernel_size, self.up_ratio, self.down_ratio)
+        if x.is_cuda:
+            return shape == (12, 12, 2, 2)
+        return anti_alias_activation_cuda.cpu_supports(*shape)
+
+    def _logscale_params(self):
+        # Pass the parameters themselves (not .data) so the fused backward can train them
+        if self.act.__class__.__name__ == "Snake":
+            beta = self.act.alpha  # Snake uses same params for alpha and beta
+        else:
+            beta = self.act.beta  # Snakebeta uses different params for alpha and beta
+        alpha = self.act.alpha
+        if not self.act.alpha_logscale:  # Exp baked into cuda kernel, cancel it out with a log
+            alpha = torch.log(alpha)
+            beta = torch.log(beta)
+        return alpha, beta
+
+    def forward(self, x, lengths=None):
+        """
+        x: [B, C, T]. lengths (optional, [B] integers <= T) gives the true length of each item of a padded batch:
+        item b is processed as a sequence of lengths[b] samples, replication-padded at its own end instead of at T,
+        and its outputs past ceil(lengths[b] * up_ratio / down_ratio) are zero. The fused CPU kernel skips the padded
+        frames entirely; other paths run the torch path item by item.
+        """
+        # Shapes the fused kernels do not handle fall back to the torch path
+        if not self.fused or not self._fused_supported(x) or (lengths is not None and x.is_cuda):
+            if lengths is not None:
+                return self._forward_items(x, lengths)
             x = self.upsample(x)
             x = self.act(x)
             x = self.downsample(x)
             return x
         else:
-            if self.act.__class__.__name__ == "Snake":
-                beta = self.act.alpha.data  # Snake uses same params for alpha and beta
-            else:
-                beta = self.act.beta.data  # Snakebeta uses different params for alpha and beta
-            alpha = self.act.alpha.data
-            if not self.act.alpha_logscale:  # Exp baked into cuda kernel, cancel it out with a log
-                alpha = torch.log(alpha)
-                beta = torch.log(beta)
-
-            x = FusedAntiAliasActivation.apply(x, self.upsample.filter, self.downsample.lowpass.filter, alpha, beta)
+            alpha, beta = self._logscale_params()
+            x = FusedAntiAliasActivation.apply(
+                x,
+                self.upsample.filter,
+                self.downsample.lowpass.filter,
+                alpha,
+                beta,
+                self.up_ratio,
+                self.down_ratio,
+                None if lengths is None else torch.as_tensor(lengths, dtype=torch.int64, device="cpu"),
+            )
             return x
+
+    def _forward_items(self, x, lengths):
+        out_len = -(-x.shape[-1] * self.up_ratio // self.down_ratio)
+        y = x.new_zeros(x.shape[0], x.shape[1], out_len)
+        for b, length in enumerate(torch.as_tensor(lengths).tolist()):
+            if length > 0:
+                item = self.downsample(self.act(self.upsample(x[b : b + 1, :, :length])))
+                y[b : b + 1, :, : item.shape[-1]] = item
+        return y
+
+    def stream_context(self):
+        """(history, lookahead) in samples: output n of a stream reads inputs n - history ... n + lookahead."""
+        return tuple(
+            anti_alias_activation_cuda.stream_context(
+                self.upsample.kernel_size, self.downsample.kernel_size, self.up_ratio, self.down_ratio
+            )
+        )
+
+    @torch.no_grad()
+    def stream(self, x, state=None, last=False):
+        """
+        Streaming inference on CPU with the fused kernel: feed consecutive [B, C, chunk_len] chunks of a sequence.
+        Returns (output, state). Pass the returned state with the next chunk (None starts a new stream) and last=True
+        with the final chunk (it may be empty). Outputs trail the inputs by the lookahead of stream_context(), and their
+        concatenation is bit-exact with forward() on the whole sequence, including its replication padding at both ends.
+        The state only holds the last history + lookahead input samples of each channel.
+        """
+        if x.is_cuda or self.up_ratio != self.down_ratio or not self._fused_supported(x):
+            raise ValueError("Streaming needs CPU inputs and a shape the fused CPU kernel supports, with equal ratios")
+        if state is None:
+            state = x.new_empty(x.shape[0], x.shape[1], 0)
+        alpha, beta = self._logscale_params()
+        output, state = anti_alias_activation_cuda.stream_forward(
+            x,
+            state,
+            self.upsample.filter,
+            self.downsample.lowpass.filter,
+            alpha,
+            beta,
+            self.up_ratio,
+            self.down_ratio,
+            last,
+        )
+        return output, state
@@ -16,8 +16,36 @@
 
  #include <torch/extension.h>
 
+#ifdef WITH_CUDA
 extern "C" torch::Tensor fwd_cuda(torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta);
+#endif
+torch::Tensor fwd_cpu(torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, c10::optional<torch::Tensor> const &lengths);
+std::vector<torch::Tensor> bwd_cpu(torch::Tensor const &output_grads, torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, c10::optional<torch::Tensor> const &lengths);
+std::vector<torch::Tensor> stream_fwd_cpu(torch::Tensor const &input, torch::Tensor const &state, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, bool last);
+std::vector<int64_t> cpu_stream_context(int64_t up_filter_size, int64_t down_filter_size, int64_t up_ratio, int64_t down_ratio);
+bool cpu_supports(int64_t up_filter_size, int64_t down_filter_size, int64_t up_ratio, int64_t down_ratio);
+std::string cpu_capability();
+
+torch::Tensor fwd(torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, c10::optional<torch::Tensor> const &lengths) {
+    if (input.is_cuda()) {
+#ifdef WITH_CUDA
+        // The CUDA kernel hard-codes filter size 12 and ratio 2, and one length for the whole batch
+        TORCH_CHECK(up_filter.numel() == 12 && down_filter.numel() == 12 && up_ratio == 2 && down_ratio == 2,
+                    "anti alias activation (CUDA) supports filter size 12 with ratio 2 only");
+        TORCH_CHECK(!lengths.has_value(), "anti alias activation (CUDA) does not support per-item lengths");
+        return fwd_cuda(input, up_filter, down_filter, alpha, beta);
+#else
+        TORCH_CHECK(false, "anti alias activation was built without CUDA");
+#endif
+    }
+    return fwd_cpu(input, up_filter, down_filter, alpha, beta, up_ratio, down_ratio, lengths);
+}
 
 PYBIND11_MODULE(TORCH_EXTENSION_NAME, m) {
-    m.def("forward", &fwd_cuda, "Anti-Alias Activation forward (CUDA)");
+    m.def("forward", &fwd, "Anti-Alias Activation forward (CUDA or CPU, by input device)");
+    m.def("backward", &bwd_cpu, "Anti-Alias Activation backward (CPU)");
+    m.def("stream_forward", &stream_fwd_cpu, "Anti-Alias Activation streaming forward over one chunk (CPU)");
+    m.def("stream_context", &cpu_stream_context, "History and lookahead in samples of the streaming forward (CPU)");
+    m.def("cpu_supports", &cpu_supports, "Whether the CPU kernel handles these filter sizes and ratios");
+    m.def("cpu_capability", &cpu_capability, "Vector instruction set the CPU kernel was built for");
 }
\ No newline at end of file
@@ -0,0 +1,423 @@
+/* coding=utf-8
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <ATen/ATen.h>
+#include <ATen/Parallel.h>
+#include <torch/extension.h>
+#include <cmath>
+#include <string>
+#include <vector>
+#include "anti_alias_activation_cpu.h"
+#include "type_shim.h"
+
+namespace
+{
+    using namespace anti_alias_activation_cpu;
+
+    void check_inputs(torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio)
+    {
+        TORCH_CHECK(input.dim() == 3, "anti alias activation expects a [batch, channels, seq_len] input");
+        TORCH_CHECK(input.scalar_type() == at::ScalarType::Float || input.scalar_type() == at::ScalarType::BFloat16 || input.scalar_type() == at::ScalarType::Half,
+                    "anti alias activation (CPU) is implemented for float32, bfloat16 and float16");
+        TORCH_CHECK(supported(up_filter.numel(), down_filter.numel(), up_ratio, down_ratio),
+                    "anti alias activation (CPU) does not support filter sizes ", up_filter.numel(), "/", down_filter.numel(), " with ratios ", up_ratio, "/", down_ratio);
+        TORCH_CHECK(alpha.numel() == input.size(1) && beta.numel() == input.size(1), "anti alias activation expects one alpha and beta per channel");
+    }
+
+    // Runs f with the shape as a compile-time FixedShape for the default UpSample1d/DownSample1d kernel sizes
+    // (6 * ratio taps) of ratios 2, 3 and 4, and as a DynamicShape otherwise
+    template <class F>
+    void dispatch_shape(int up_filter, int down_filter, int up_ratio, int down_ratio, F &&f)
+    {
+        if (up_filter == 12 && down_filter == 12 && up_ratio == 2 && down_ratio == 2)
+        {
+            f(FixedShape<12, 12, 2, 2>());
+        }
+        else if (up_filter == 18 && down_filter == 18 && up_ratio == 3 && down_ratio == 3)
+        {
+            f(FixedShape<18, 18, 3, 3>());
+        }
+        else if (up_filter == 24 && down_filter == 24 && up_ratio == 4 && down_ratio == 4)
+        {
+            f(FixedShape<24, 24, 4, 4>());
+        }
+        else
+        {
+            f(DynamicShape(up_filter, down_filter, up_ratio, down_ratio));
+        }
+    }
+
+    // Sequence length of every batch item: lengths[b] (0 <= lengths[b] <= seq_len) for a variable-length batch padded
+    // to seq_len, or seq_len for all items
+    std::vector<int> item_lengths(c10::optional<torch::Tensor> const &lengths, int64_t batches, int seq_len)
+    {
+        std::vector<int> result(batches, seq_len);
+        if (!lengths.has_value())
+        {
+            return result;
+        }
+        TORCH_CHECK(lengths->dim() == 1 && lengths->numel() == batches, "anti alias activation expects one length per batch item");
+        auto lengths_l = lengths->to(at::kLong).contiguous();
+        const int64_t *l = lengths_l.data_ptr<int64_t>();
+        for (int64_t b = 0; b < batches; b++)
+        {
+            TORCH_CHECK(l[b] >= 0 && l[b] <= seq_len, "anti alias activation lengths must be within [0, seq_len]");
+            result[b] = l[b];
+        }
+        return result;
+    }
+
+    // Work items of a batch: tiles[b] tiles for each channel of item b, numbered item by item. Only tiles before an
+    // item's end are listed, so padded frames cost nothing and at::parallel_for balances the real work.
+    struct WorkItems
+    {
+        std::vector<int> tiles;
+        std::vector<int64_t> first; // first work item of each batch item, then the total
+        int64_t channels;
+
+        WorkItems(std::vector<int> tiles_, int64_t channels_) : tiles(std::move(tiles_)), first(tiles.size() + 1, 0), channels(channels_)
+        {
+            for (size_t b = 0; b < tiles.size(); b++)
+            {
+                first[b + 1] = first[b] + channels * tiles[b];
+            }
+        }
+
+        int64_t total() const { return first.back(); }
+
+        // Batch item, channel and tile of a work item
+        void locate(int64_t item, int64_t &batch, int64_t &channel, int &tile) const
+        {
+            batch = std::upper_bound(first.begin(), first.end(), item) - first.begin() - 1;
+            const int64_t local = item - first[batch];
+            channel = local / tiles[batch];
+            tile = local % tiles[batch];
+        }
+    };
+
+    // Zeroes values [lengths[b], size) of every item b along the last dimension
+    void zero_tails(torch::Tensor &tensor, std::vector<int> const &lengths)
+    {
+        const int64_t size = tensor.size(2);
+        for (size_t b = 0; b < lengths.size(); b++)
+        {
+            if (lengths[b] < size)
+            {
+                tensor.select(0, b).narrow(1, lengths[b], size - lengths[b]).zero_();
+            }
+        }
+    }
+
+    // Storage type of the kernel for a tensor scalar type (same bits, torch-free)
+    template <class T>
+    struct storage
+    {
+        using type = T;
+    };
+
+    template <>
+    struct storage<at::BFloat16>
+    {
+        using type = bfloat16;
+    };
+
+    template <>
+    struct storage<at::Half>
+    {
+        using type = float16;
+    };
+
+    template <class T>
+    typename storage<T>::type *storage_ptr(torch::Tensor const &tensor)
+    {
+        return reinterpret_cast<typename storage<T>::type *>(tensor.data_ptr<T>());
+    }
+
+    // Snake parameters of one channel. alpha and beta are log-scale: exp is baked into the kernel, as in the CUDA kernel
+    struct SnakeParams
+    {
+        float alpha;        // exp(alpha)
+        float inv_beta;     // 1 / (exp(beta) + eps)
+        double d_inv_beta;  // d inv_beta / d beta, for the backward
+    };
+
+    std::vector<SnakeParams> snake_params(torch::Tensor const &alpha, torch::Tensor const &beta)
+    {
+        const double no_div_by_zero = 0.000000001;
+        auto alpha_f = alpha.to(at::kFloat).contiguous();
+        auto beta_f = beta.to(at::kFloat).contiguous();
+        const float *a = alpha_f.data_ptr<float>();
+        const float *b = beta_f.data_ptr<float>();
+        std::vector<SnakeParams> params(alpha_f.numel());
+        for (int64_t c = 0; c < alpha_f.numel(); c++)
+        {
+            const double exp_beta = std::exp(static_cast<double>(b[c]));
+            params[c].alpha = std::exp(a[c]);
+            params[c].inv_beta = static_cast<float>(1.0 / (exp_beta + no_div_by_zero));
+            params[c].d_inv_beta = -exp_beta / ((exp_beta + no_div_by_zero) * (exp_beta + no_div_by_zero));
+        }
+        return params;
+    }
+
+    template <class Shape>
+    Filters filters_of(const Shape &shape, torch::Tensor const &up_filter, torch::Tensor const &down_filter)
+    {
+        auto up_f = up_filter.to(at::kFloat).contiguous();
+        auto down_f = down_filter.to(at::kFloat).contiguous();
+        return prepare_filters(shape, up_f.data_ptr<float>(), down_f.data_ptr<float>());
+    }
+}
+
+// With lengths, item b of a batch padded to seq_len is lengths[b] samples long: it is replication-padded at its own end,
+// tiles past that end are skipped, and its outputs from output_length(lengths[b]) on are zero.
+torch::Tensor fwd_cpu(torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, c10::optional<torch::Tensor> const &lengths)
+{
+    check_inputs(input, up_filter, down_filter, alpha, beta, up_ratio, down_ratio);
+
+    // Input is a 3d tensor with dimensions [batches, channels, seq_len]
+    auto src = input.contiguous();
+    const int64_t batches = src.size(0);
+    const int64_t channels = src.size(1);
+    const int seq_len = src.size(2);
+    const std::vector<int> item_len = item_lengths(lengths, batches, seq_len);
+
+    auto act_options = src.options().requires_grad(false);
+    torch::Tensor anti_alias_activation_results;
+    dispatch_shape(up_filter.numel(), down_filter.numel(), up_ratio, down_ratio, [&](const auto &shape)
+                   {
+        const int out_len = output_length(shape, seq_len);
+        anti_alias_activation_results = torch::empty({batches, channels, out_len}, act_options);
+        if (seq_len == 0)
+        {
+            return;
+        }
+
+        const Filters filters = filters_of(shape, up_filter, down_filter);
+        const std::vector<SnakeParams> params = snake_params(alpha, beta);
+        std::vector<int> tiles(batches), item_out_len(batches);
+        for (int64_t b = 0; b < batches; b++)
+        {
+            tiles[b] = forward_tiles(shape, item_len[b]);
+            item_out_len[b] = output_length(shape, item_len[b]);
+        }
+        const WorkItems work(tiles, channels);
+
+        // Reads and writes the input's dtype; bfloat16 and float16 halve the bytes moved, the math stays float32
+        DISPATCH_FLOAT_HALF_AND_BFLOAT(
+            src.scalar_type(),
+            "anti alias activation (CPU)",
+            const auto *src_ptr = storage_ptr<scalar_t>(src);
+            auto *dst_ptr = storage_ptr<scalar_t>(anti_alias_activation_results);
+
+            // One work item per tile of a (batch, channel) row, so long sequences with few channels still spread over threads
+            at::parallel_for(0, work.total(), 1, [&](int64_t begin, int64_t end)
+                             {
+                for (int64_t item = begin; item < end; item++)
+                {
+                    int64_t batch, channel;
+                    int tile;
+                    work.locate(item, batch, channel, tile);
+                    const int64_t row = batch * channels + channel;
+                    forward_tile(
+                        dst_ptr + row * out_len,
+                        src_ptr + row * seq_len,
+                        item_len[batch],
+                        tile,
+                        shape,
+                        filters,
+                        params[channel].alpha,
+                        params[channel].inv_beta);
+                } }););
+        zero_tails(anti_alias_activation_results, item_out_len); });
+    return anti_alias_activation_results;
+}
+
+// Fused backward: returns the gradients of input and of the log-scale alpha and beta. The upsampled intermediate is
+// recomputed tile by tile from the input, so nothing beyond the input is kept between forward and backward.
+// bfloat16 and float16 inputs are computed on float32 copies; the gradients come back in the dtypes of their inputs.
+// With lengths, as in fwd_cpu, the input gradient past each item's end is zero and its padded frames are not visited.
+std::vector<torch::Tensor> bwd_cpu(torch::Tensor const &output_grads, torch::Tensor const &input, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, c10::optional<torch::Tensor> const &lengths)
+{
+    check_inputs(input, up_filter, down_filter, alpha, beta, up_ratio, down_ratio);
+    TORCH_CHECK(!input.is_cuda(), "anti alias activation backward is implemented on CPU only");
+
+    auto src = input.to(at::kFloat).contiguous();
+    auto grad_output = output_grads.to(at::kFloat).contiguous();
+    const int64_t batches = src.size(0);
+    const int64_t channels = src.size(1);
+    const int seq_len = src.size(2);
+    const std::vector<int> item_len = item_lengths(lengths, batches, seq_len);
+
+    torch::Tensor grad_input = torch::empty({batches, channels, seq_len}, src.options().requires_grad(false));
+    torch::Tensor grad_alpha = torch::zeros({channels}, src.options().requires_grad(false));
+    torch::Tensor grad_beta = torch::zeros({channels}, src.options().requires_grad(false));
+    dispatch_shape(up_filter.numel(), down_filter.numel(), up_ratio, down_ratio, [&](const auto &shape)
+                   {
+        const int out_len = output_length(shape, seq_len);
+        TORCH_CHECK(grad_output.dim() == 3 && grad_output.size(0) == batches && grad_output.size(1) == channels && grad_output.size(2) == out_len,
+                    "anti alias activation expects output gradients shaped like its output");
+        if (seq_len == 0)
+        {
+            return;
+        }
+
+        const Filters filters = filters_of(shape, up_filter, down_filter);
+        const std::vector<SnakeParams> params = snake_params(alpha, beta);
+
+        const float *src_ptr = src.data_ptr<float>();
+        const float *grad_output_ptr = grad_output.data_ptr<float>();
+        float *grad_input_ptr = grad_input.data_ptr<float>();
+        std::vector<int> tiles(batches);
+        for (int64_t b = 0; b < batches; b++)
+        {
+            tiles[b] = backward_tiles(item_len[b]);
+        }
+        const WorkItems work(tiles, channels);
+
+        // Per-tile partial sums for alpha and beta, reduced in a fixed order below so results do not depend on threading
+        std::vector<double> sum_alpha(work.total(), 0.0);
+        std::vector<double> sum_beta(work.total(), 0.0);
+        at::parallel_for(0, work.total(), 1, [&](int64_t begin, int64_t end)
+                         {
+            for (int64_t item = begin; item < end; item++)
+            {
+                int64_t batch, channel;
+                int tile;
+                work.locate(item, batch, channel, tile);
+                const int64_t row = batch * channels + channel;
+                backward_tile(
+                    grad_input_ptr + row * seq_len,
+                    grad_output_ptr + row * out_len,
+                    src_ptr + row * seq_len,
+                    item_len[batch],
+                    tile,
+                    shape,
+                    filters,
+                    params[channel].alpha,
+                    params[channel].inv_beta,
+                    sum_alpha[item],
+                    sum_beta[item]);
+            } });
+
+        float *grad_alpha_ptr = grad_alpha.data_ptr<float>();
+        float *grad_beta_ptr = grad_beta.data_ptr<float>();
+        for (int64_t c = 0; c < channels; c++)
+        {
+            double total_alpha = 0.0, total_beta = 0.0;
+            for (int64_t b = 0; b < batches; b++)
+            {
+                for (int t = 0; t < tiles[b]; t++)
+                {
+                    total_alpha += sum_alpha[work.first[b] + c * tiles[b] + t];
+                    total_beta += sum_beta[work.first[b] + c * tiles[b] + t];
+                }
+            }
+            // d/dlog(alpha) of sin(alpha u)^2 / beta is alpha / beta * u * sin(2 alpha u)
+            grad_alpha_ptr[c] = static_cast<float>(params[c].alpha * params[c].inv_beta * total_alpha);
+            grad_beta_ptr[c] = static_cast<float>(params[c].d_inv_beta * total_beta);
+        }
+        zero_tails(grad_input, item_len); });
+    return {grad_input.to(input.scalar_type()), grad_alpha.view(alpha.sizes()).to(alpha.scalar_type()), grad_beta.view(beta.sizes()).to(beta.scalar_type())};
+}
+
+// Streaming forward: processes the next chunk [batches, channels, chunk_len] of a sequence and returns the outputs
+// that became computable plus the new state. The state holds the last stream_history + stream_lookahead input samples
+// of each row (fewer right after the stream starts, which is how the start is recognized); pass an empty
+// [batches, channels, 0] tensor for the first chunk. With last set the sequence ends after this chunk and the remaining
+// outputs are flushed with the usual replication padding, so the concatenated outputs equal fwd_cpu of the whole
+// sequence bit for bit.
+std::vector<torch::Tensor> stream_fwd_cpu(torch::Tensor const &input, torch::Tensor const &state, torch::Tensor const &up_filter, torch::Tensor const &down_filter, torch::Tensor const &alpha, torch::Tensor const &beta, int64_t up_ratio, int64_t down_ratio, bool last)
+{
+    check_inputs(input, up_filter, down_filter, alpha, beta, up_ratio, down_ratio);
+    TORCH_CHECK(up_ratio == down_ratio, "anti alias activation streaming needs equal up and down ratios");
+    TORCH_CHECK(state.dim() == 3 && state.size(0) == input.size(0) && state.size(1) == input.size(1),
+                "anti alias activation streaming expects a [batch, channels, context] state");
+
+    const int64_t batches = input.size(0);
+    const int64_t channels = input.size(1);
+    torch::Tensor anti_alias_activation_results;
+    torch::Tensor next_state;
+    dispatch_shape(up_filter.numel(), down_filter.numel(), up_ratio, down_ratio, [&](const auto &shape)
+                   {
+        const int context = stream_history(shape) + stream_lookahead(shape);
+        const int carried = state.size(2);
+        TORCH_CHECK(carried <= context, "anti alias activation streaming state is longer than the filter context");
+
+        // The carried context followed by the chunk, indexed as a sequence that starts at the state
+        auto src = torch::cat({state.to(input.scalar_type()), input}, 2).contiguous();
+        const int seq_len = src.size(2);
+        const int begin = std::max(carried - stream_lookahead(shape), 0);
+        const int end = last ? seq_len : std::max(seq_len - stream_lookahead(shape), begin);
+        const int out_len = end - begin;
+        anti_alias_activation_results = torch::empty({batches, channels, out_len}, src.options().requires_grad(false));
+        next_state = last ? src.narrow(2, seq_len, 0).clone() : src.narrow(2, seq_len - std::min(seq_len, context), std::min(seq_len, context)).clone();
+        if (out_len == 0)
+        {
+            return;
+        }
+
+        const Filters filters = filters_of(shape, up_filter, down_filter);
+        const std::vector<SnakeParams> params = snake_params(alpha, beta);
+        const int per_tile = outputs_per_tile(shape);
+        const int tiles = (out_len + per_tile - 1) / per_tile;
+
+        DISPATCH_FLOAT_HALF_AND_BFLOAT(
+            src.scalar_type(),
+            "anti alias activation streaming (CPU)",
+            const auto *src_ptr = storage_ptr<scalar_t>(src);
+            auto *dst_ptr = storage_ptr<scalar_t>(anti_alias_activation_results);
+
+            at::parallel_for(0, batches * channels * tiles, 1, [&](int64_t begin_item, int64_t end_item)
+                             {
+                for (int64_t item = begin_item; item < end_item; item++)
+                {
+                    const int64_t row = item / tiles;
+                    const int64_t channel = row % channels;
+                    const int n0 = (item % tiles) * per_tile;
+                    forward_outputs(
+                        dst_ptr + row * out_len + n0,
+                        src_ptr + row * seq_len,
+                        seq_len,
+                        begin + n0,
+                        std::min(per_tile, out_len - n0),
+                        shape,
+                        filters,
+                        params[channel].alpha,
+                        params[channel].inv_beta);
+                } });); });
+    return {anti_alias_activation_results, next_state};
+}
+
+// History and lookahead (in input samples) of the streaming forward
+std::vector<int64_t> cpu_stream_context(int64_t up_filter_size, int64_t down_filter_size, int64_t up_ratio, int64_t down_ratio)
+{
+    TORCH_CHECK(up_ratio == down_ratio && supported(up_filter_size, down_filter_size, up_ratio, down_ratio),
+                "anti alias activation streaming does not support filter sizes ", up_filter_size, "/", down_filter_size, " with ratios ", up_ratio, "/", down_ratio);
+    std::vector<int64_t> context;
+    dispatch_shape(up_filter_size, down_filter_size, up_ratio, down_ratio, [&](const auto &shape)
+                   { context = {stream_history(shape), stream_lookahead(shape)}; });
+    return context;
+}
+
+bool cpu_supports(int64_t up_filter_size, int64_t down_filter_size, int64_t up_ratio, int64_t down_ratio)
+{
+    return supported(up_filter_size, down_filter_size, up_ratio, down_ratio);
+}
+
+std::string cpu_capability()
+{
+    return Vec::name;
+}
@@ -0,0 +1,869 @@
+/* coding=utf-8
+ * Copyright (c) 2024, NVIDIA CORPORATION.  All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/* CPU kernel of the fused anti-alias activation (upsample -> Snake/SnakeBeta -> downsample).
+ * Kept free of torch headers: anti_alias_activation_cpu.cpp binds it to tensors.
+ *
+ * The tile functions are templated on a shape (filter sizes and ratios). FixedShape makes them compile-time
+ * constants so the tap loops unroll and the coefficients stay in registers; DynamicShape runs the same code
+ * with runtime values for every other shape.
+ *
+ * The vector width is picked at compile time (the extension is JIT-built on the host with -march=native):
+ * AVX-512, AVX2+FMA, or a portable 4-lane fallback that the compiler auto-vectorizes.
+ *
+ * The forward reads and writes float32, bfloat16 or float16 rows; everything in between is float32. */
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX512F__) || (defined(__AVX2__) && defined(__FMA__)) || defined(__F16C__)
+#include <immintrin.h>
+#endif
+
+namespace anti_alias_activation_cpu
+{
+    // Largest filter and ratio the generic kernel accepts
+    constexpr int MAX_FILTER_SIZE = 64;
+    constexpr int MAX_RATIO = 8;
+
+    // Input positions per tile. The upsampled intermediate of a tile (up_ratio polyphase buffers of about TILE
+    // floats) plus its input window stay within L1/L2 while being produced and consumed.
+    constexpr int TILE = 1024;
+
+#if defined(__AVX512F__)
+    struct Vec
+    {
+        static constexpr int width = 16;
+        static constexpr const char *name = "avx512";
+        __m512 v;
+
+        static Vec load(const float *p) { return {_mm512_loadu_ps(p)}; }
+        static Vec broadcast(float x) { return {_mm512_set1_ps(x)}; }
+        void store(float *p) const { _mm512_storeu_ps(p, v); }
+        friend Vec operator+(Vec a, Vec b) { return {_mm512_add_ps(a.v, b.v)}; }
+        friend Vec operator-(Vec a, Vec b) { return {_mm512_sub_ps(a.v, b.v)}; }
+        friend Vec operator*(Vec a, Vec b) { return {_mm512_mul_ps(a.v, b.v)}; }
+        friend Vec fma(Vec a, Vec b, Vec c) { return {_mm512_fmadd_ps(a.v, b.v, c.v)}; }
+        friend Vec round(Vec a) { return {_mm512_roundscale_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+    };
+#elif defined(__AVX2__) && defined(__FMA__)
+    struct Vec
+    {
+        static constexpr int width = 8;
+        static constexpr const char *name = "avx2";
+        __m256 v;
+
+        static Vec load(const float *p) { return {_mm256_loadu_ps(p)}; }
+        static Vec broadcast(float x) { return {_mm256_set1_ps(x)}; }
+        void store(float *p) const { _mm256_storeu_ps(p, v); }
+        friend Vec operator+(Vec a, Vec b) { return {_mm256_add_ps(a.v, b.v)}; }
+        friend Vec operator-(Vec a, Vec b) { return {_mm256_sub_ps(a.v, b.v)}; }
+        friend Vec operator*(Vec a, Vec b) { return {_mm256_mul_ps(a.v, b.v)}; }
+        friend Vec fma(Vec a, Vec b, Vec c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+        friend Vec round(Vec a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+    };
+#else
+    struct Vec
+    {
+        static constexpr int width = 4;
+        static constexpr const char *name = "scalar";
+        float v[4];
+
+        static Vec load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+        static Vec broadcast(float x) { return {{x, x, x, x}}; }
+        void store(float *p) const
+        {
+            for (int i = 0; i < 4; i++)
+                p[i] = v[i];
+        }
+        friend Vec operator+(Vec a, Vec b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+        friend Vec operator-(Vec a, Vec b) { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+        friend Vec operator*(Vec a, Vec b) { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+        friend Vec fma(Vec a, Vec b, Vec c) { return a * b + c; }
+        friend Vec round(Vec a)
+        {
+            // Round to nearest for |x| < 2^22 without a libm call
+            const Vec magic = broadcast(12582912.0f);
+            return (a + magic) - magic;
+        }
+    };
+#endif
+
+    // sin(r) with x = r + q * pi and r in [-pi/2, pi/2]. Reduces x with a four-part Cody-Waite split of pi, then
+    // evaluates the odd Taylor polynomial up to x^11 (absolute error below 6e-8).
+    inline Vec reduced_sin(Vec x, Vec &q)
+    {
+        q = round(x * Vec::broadcast(0.318309886183790671538f));
+        Vec r = fma(q, Vec::broadcast(-3.140625f), x);
+        r = fma(q, Vec::broadcast(-0.0009670257568359375f), r);
+        r = fma(q, Vec::broadcast(-6.2771141529083251953e-7f), r);
+        r = fma(q, Vec::broadcast(-1.2154201256553420762e-10f), r);
+        const Vec s = r * r;
+        Vec p = Vec::broadcast(-2.5052108385441718775e-8f);
+        p = fma(p, s, Vec::broadcast(2.7557319223985890653e-6f));
+        p = fma(p, s, Vec::broadcast(-1.9841269841269841270e-4f));
+        p = fma(p, s, Vec::broadcast(8.3333333333333333333e-3f));
+        p = fma(p, s, Vec::broadcast(-1.6666666666666666667e-1f));
+        return fma(p * s, r, r);
+    }
+
+    // sin(x)^2 for the Snake term (the square drops the sign flip of the reduction)
+    inline Vec sin_squared(Vec x)
+    {
+        Vec q;
+        const Vec value = reduced_sin(x, q);
+        return value * value;
+    }
+
+    // sin(x) = (-1)^q * sin(r). The parity of q is q - 2 * round(q / 2), one of -1, 0 or 1.
+    inline Vec sin(Vec x)
+    {
+        Vec q;
+        const Vec value = reduced_sin(x, q);
+        const Vec parity = fma(round(q * Vec::broadcast(0.5f)), Vec::broadcast(-2.0f), q);
+        return value * fma(parity * parity, Vec::broadcast(-2.0f), Vec::broadcast(1.0f));
+    }
+
+    // Snake/SnakeBeta on the upsampled signal: u + 1/beta * sin(alpha * u)^2
+    inline Vec snake(Vec u, Vec alpha, Vec inv_beta)
+    {
+        return fma(inv_beta, sin_squared(u * alpha), u);
+    }
+
+    constexpr int floor_div(int a, int b)
+    {
+        return a >= 0 ? a / b : -((b - 1 - a) / b);
+    }
+
+    constexpr int floor_mod(int a, int b)
+    {
+        return a - floor_div(a, b) * b;
+    }
+
+    // Geometry of UpSample1d(up_ratio, up_filter) and DownSample1d(down_ratio, down_filter), as in the torch code.
+    //
+    // Intermediate sample m = up_ratio * p + phase, with p an input position, is the sum of up[k] * x[clamp(p + offset)]
+    // over the taps k of that phase: the transposed convolution pairs tap k with phase floor_mod(phase + up_pad_left - k,
+    // up_ratio) == 0, at offset (phase + up_pad_left - k) / up_ratio - up_pad. Output n is the sum of
+    // down[k] * intermediate[clamp(n * down_ratio + k - down_pad_left)].
+    constexpr int up_pad(int filter, int ratio)
+    {
+        return filter / ratio - 1;
+    }
+
+    constexpr int up_pad_left(int filter, int ratio)
+    {
+        return up_pad(filter, ratio) * ratio + (filter - ratio) / 2;
+    }
+
+    constexpr bool is_up_tap(int filter, int ratio, int phase, int k)
+    {
+        return floor_mod(phase + up_pad_left(filter, ratio) - k, ratio) == 0;
+    }
+
+    constexpr int up_offset(int filter, int ratio, int phase, int k)
+    {
+        return floor_div(phase + up_pad_left(filter, ratio) - k, ratio) - up_pad(filter, ratio);
+    }
+
+    // Smallest and largest input offset read by any tap
+    constexpr int up_offset_min(int filter, int ratio)
+    {
+        int lowest = filter;
+        for (int phase = 0; phase < ratio; phase++)
+            for (int k = 0; k < filter; k++)
+                if (is_up_tap(filter, ratio, phase, k))
+                    lowest = std::min(lowest, up_offset(filter, ratio, phase, k));
+        return lowest;
+    }
+
+    constexpr int up_offset_max(int filter, int ratio)
+    {
+        int highest = -filter;
+        for (int phase = 0; phase < ratio; phase++)
+            for (int k = 0; k < filter; k++)
+                if (is_up_tap(filter, ratio, phase, k))
+                    highest = std::max(highest, up_offset(filter, ratio, phase, k));
+        return highest;
+    }
+
+    constexpr int down_pad_left(int filter)
+    {
+        return filter / 2 - (filter % 2 == 0 ? 1 : 0);
+    }
+
+    // Downsample tap k reads phase floor_mod(k - down_pad_left, ratio) of position n + floor_div(k - down_pad_left, ratio)
+    // when the ratios are equal; the shift is returned relative to tap 0's so it is never negative.
+    constexpr int down_phase(int filter, int ratio, int k)
+    {
+        return floor_mod(k - down_pad_left(filter), ratio);
+    }
+
+    constexpr int down_shift(int filter, int ratio, int k)
+    {
+        return floor_div(k - down_pad_left(filter), ratio) - floor_div(-down_pad_left(filter), ratio);
+    }
+
+    // Shapes the kernel reproduces exactly. The taps must stay within UpSample1d's replication padding: with fewer than
+    // 2 * up_ratio taps there is none, and the transposed convolution drops edge taps instead of clamping them.
+    // (up_filter == up_ratio leaves UpSample1d with an empty output.)
+    inline bool supported(int up_filter, int down_filter, int up_ratio, int down_ratio)
+    {
+        return up_ratio >= 1 && up_ratio <= MAX_RATIO && down_ratio >= 1 && down_ratio <= MAX_RATIO &&
+               up_filter > up_ratio && up_filter <= MAX_FILTER_SIZE && down_filter >= 1 && down_filter <= MAX_FILTER_SIZE &&
+               up_offset_min(up_filter, up_ratio) >= -up_pad(up_filter, up_ratio) &&
+               up_offset_max(up_filter, up_ratio) <= up_pad(up_filter, up_ratio);
+    }
+
+    // Shape known at compile time: the phase and tap loops below expand into straight-line code
+    template <int UP_FILTER, int DOWN_FILTER, int UP_RATIO, int DOWN_RATIO>
+    struct FixedShape
+    {
+        static constexpr int up_filter = UP_FILTER;
+        static constexpr int down_filter = DOWN_FILTER;
+        static constexpr int up_ratio = UP_RATIO;
+        static constexpr int down_ratio = DOWN_RATIO;
+        static constexpr int offset_min = up_offset_min(UP_FILTER, UP_RATIO);
+        static constexpr int offset_max = up_offset_max(UP_FILTER, UP_RATIO);
+        static constexpr int down_span = down_shift(DOWN_FILTER, UP_RATIO, DOWN_FILTER - 1);
+
+        template <class F>
+        static void for_each_phase(F &&f)
+        {
+            expand_phases(f, std::make_integer_sequence<int, UP_RATIO>());
+        }
+
+        // f(k, offset) for the upsample taps of one phase
+        template <int PHASE, class F>
+        static void for_each_up_tap(std::integral_constant<int, PHASE>, F &&f)
+        {
+            expand_up_taps<PHASE>(f, std::make_integer_sequence<int, UP_FILTER>());
+        }
+
+        // f(k, phase, shift) for the downsample taps
+        template <class F>
+        static void for_each_down_tap(F &&f)
+        {
+            expand_down_taps(f, std::make_integer_sequence<int, DOWN_FILTER>());
+        }
+
+    private:
+        template <class F, int... PHASES>
+        static void expand_phases(F &f, std::integer_sequence<int, PHASES...>)
+        {
+            (f(std::integral_constant<int, PHASES>()), ...);
+        }
+
+        template <int PHASE, int K, class F>
+        static void up_tap(F &f)
+        {
+            if constexpr (is_up_tap(UP_FILTER, UP_RATIO, PHASE, K))
+                f(K, up_offset(UP_FILTER, UP_RATIO, PHASE, K));
+        }
+
+        template <int PHASE, class F, int... KS>
+        static void expand_up_taps(F &f, std::integer_sequence<int, KS...>)
+        {
+            (up_tap<PHASE, KS>(f), ...);
+        }
+
+        template <class F, int... KS>
+        static void expand_down_taps(F &f, std::integer_sequence<int, KS...>)
+        {
+            (f(KS, down_phase(DOWN_FILTER, UP_RATIO, KS), down_shift(DOWN_FILTER, UP_RATIO, KS)), ...);
+        }
+    };
+
+    // Any other supported shape, with the same interface as FixedShape. The taps of each phase are listed up front so
+    // the inner loops do not test every filter index.
+    struct DynamicShape
+    {
+        int up_filter;
+        int down_filter;
+        int up_ratio;
+        int down_ratio;
+        int offset_min;
+        int offset_max;
+        int down_span;
+        int up_taps[MAX_RATIO];
+        int up_tap_index[MAX_RATIO][MAX_FILTER_SIZE];
+        int up_tap_offset[MAX_RATIO][MAX_FILTER_SIZE];
+
+        DynamicShape(int up_filter_, int down_filter_, int up_ratio_, int down_ratio_)
+            : up_filter(up_filter_),
+              down_filter(down_filter_),
+              up_ratio(up_ratio_),
+              down_ratio(down_ratio_),
+              offset_min(up_offset_min(up_filter_, up_ratio_)),
+              offset_max(up_offset_max(up_filter_, up_ratio_)),
+              down_span(down_shift(down_filter_, up_ratio_, down_filter_ - 1))
+        {
+            for (int phase = 0; phase < up_ratio; phase++)
+            {
+                up_taps[phase] = 0;
+                for (int k = 0; k < up_filter; k++)
+                {
+                    if (is_up_tap(up_filter, up_ratio, phase, k))
+                    {
+                        up_tap_index[phase][up_taps[phase]] = k;
+                        up_tap_offset[phase][up_taps[phase]] = up_offset(up_filter, up_ratio, phase, k);
+                        up_taps[phase]++;
+                    }
+                }
+            }
+        }
+
+        template <class F>
+        void for_each_phase(F &&f) const
+        {
+            for (int phase = 0; phase < up_ratio; phase++)
+                f(phase);
+        }
+
+        template <class F>
+        void for_each_up_tap(int phase, F &&f) const
+        {
+            for (int q = 0; q < up_taps[phase]; q++)
+                f(up_tap_index[phase][q], up_tap_offset[phase][q]);
+        }
+
+        template <class F>
+        void for_each_down_tap(F &&f) const
+        {
+            for (int k = 0; k < down_filter; k++)
+                f(k, down_phase(down_filter, up_ratio, k), down_shift(down_filter, up_ratio, k));
+        }
+    };
+
+    // Filter taps with the UpSample1d ratio gain folded into the upsample filter
+    struct Filters
+    {
+        float up[MAX_FILTER_SIZE];
+        float down[MAX_FILTER_SIZE];
+    };
+
+    template <class Shape>
+    inline Filters prepare_filters(const Shape &shape, const float *up_ftr, const float *down_ftr)
+    {
+        Filters f;
+        for (int k = 0; k < shape.up_filter; k++)
+        {
+            f.up[k] = shape.up_ratio * up_ftr[k];
+        }
+        for (int k = 0; k < shape.down_filter; k++)
+        {
+            f.down[k] = down_ftr[k];
+        }
+        return f;
+    }
+
+    inline int round_up(int n, int multiple)
+    {
+        return (n + multiple - 1) / multiple * multiple;
+    }
+
+    // Output length of DownSample1d(UpSample1d(x)): ceil(up_ratio * seq_len / down_ratio)
+    template <class Shape>
+    inline int output_length(const Shape &shape, int seq_len)
+    {
+        return (shape.up_ratio * seq_len + shape.down_ratio - 1) / shape.down_ratio;
+    }
+
+    // Forward tiles cover about TILE input positions worth of outputs
+    template <class Shape>
+    inline int outputs_per_tile(const Shape &shape)
+    {
+        return std::max(Vec::width, TILE * shape.up_ratio / shape.down_ratio / Vec::width * Vec::width);
+    }
+
+    template <class Shape>
+    inline int forward_tiles(const Shape &shape, int seq_len)
+    {
+        const int per_tile = outputs_per_tile(shape);
+        return (output_length(shape, seq_len) + per_tile - 1) / per_tile;
+    }
+
+    // Backward tiles cover TILE input positions (of grad_input)
+    inline int backward_tiles(int seq_len)
+    {
+        return (seq_len + TILE - 1) / TILE;
+    }
+
+    // Per-thread scratch for the tile buffers, grown on first use and reused by every later tile of the thread
+    inline float *scratch(size_t floats)
+    {
+        thread_local std::vector<float> buffer;
+        if (buffer.size() < floats)
+        {
+            buffer.resize(floats);
+        }
+        return buffer.data();
+    }
+
+    // 16-bit storage formats, bit-compatible with c10::BFloat16 and c10::Half. Rows in these formats are widened to
+    // float32 when a tile's window is filled and rounded back (to nearest even) when its outputs are stored, so only
+    // the bytes moved to and from memory shrink: accumulation stays float32.
+    struct bfloat16
+    {
+        uint16_t bits;
+    };
+
+    struct float16
+    {
+        uint16_t bits;
+    };
+
+    inline uint32_t bits_of(float x)
+    {
+        uint32_t u;
+        std::memcpy(&u, &x, sizeof(u));
+        return u;
+    }
+
+    inline float float_of(uint32_t u)
+    {
+        float x;
+        std::memcpy(&x, &u, sizeof(x));
+        return x;
+    }
+
+    inline float to_float(float x) { return x; }
+
+    inline float to_float(bfloat16 x) { return float_of(static_cast<uint32_t>(x.bits) << 16); }
+
+    inline float to_float(float16 x)
+    {
+#if defined(__F16C__)
+        return _cvtsh_ss(x.bits);
+#else
+        // Branch-free IEEE half to float (normals are rescaled by 2^-112, subnormals rebuilt with a magic bias)
+        const uint32_t w = static_cast<uint32_t>(x.bits) << 16;
+        const uint32_t sign = w & 0x80000000u;
+        const uint32_t two_w = w + w;
+        const float normalized = float_of((two_w >> 4) + (0xE0u << 23)) * 0x1.0p-112f;
+        const float denormalized = float_of((two_w >> 17) | (126u << 23)) - 0.5f;
+        return float_of(sign | (two_w < (1u << 27) ? bits_of(denormalized) : bits_of(normalized)));
+#endif
+    }
+
+    template <class T>
+    inline T from_float(float x);
+
+    template <>
+    inline float from_float<float>(float x) { return x; }
+
+    template <>
+    inline bfloat16 from_float<bfloat16>(float x)
+    {
+        // Same rounding as c10::BFloat16: to nearest even, NaN stays a quiet NaN
+        const uint32_t u = bits_of(x);
+        const uint32_t rounded = (u + 0x7FFFu + ((u >> 16) & 1u)) >> 16;
+        return {static_cast<uint16_t>(std::isnan(x) ? 0x7FC0u : rounded)};
+    }
+
+    template <>
+    inline float16 from_float<float16>(float x)
+    {
+#if defined(__F16C__)
+        return {_cvtss_sh(x, _MM_FROUND_TO_NEAREST_INT)};
+#else
+        // Branch-free float to IEEE half, rounding to nearest even through float addition
+        float base = (std::fabs(x) * 0x1.0p+112f) * 0x1.0p-110f;
+        const uint32_t w = bits_of(x);
+        const uint32_t shl1_w = w + w;
+        const uint32_t sign = w & 0x80000000u;
+        const uint32_t bias = std::max(shl1_w & 0xFF000000u, 0x71000000u);
+        base = float_of((bias >> 1) + 0x07800000u) + base;
+        const uint32_t bits = bits_of(base);
+        const uint32_t nonsign = ((bits >> 13) & 0x00007C00u) + (bits & 0x00000FFFu);
+        return {static_cast<uint16_t>((sign >> 16) | (shl1_w > 0xFF000000u ? 0x7E00u : nonsign))};
+#endif
+    }
+
+    // dst[i] = float(src[i]) for i in [0, n)
+    inline void widen(float *dst, const float *src, int n)
+    {
+        std::copy(src, src + n, dst);
+    }
+
+    template <class T>
+    inline void widen(float *dst, const T *src, int n)
+    {
+        int i = 0;
+#if defined(__F16C__)
+        if constexpr (std::is_same<T, float16>::value)
+        {
+            for (; i + 8 <= n; i += 8)
+                _mm256_storeu_ps(dst + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i))));
+        }
+#endif
+        for (; i < n; i++)
+            dst[i] = to_float(src[i]);
+    }
+
+    // dst[i] = T(src[i]) for i in [0, n)
+    inline void narrow(float *dst, const float *src, int n)
+    {
+        std::copy(src, src + n, dst);
+    }
+
+    template <class T>
+    inline void narrow(T *dst, const float *src, int n)
+    {
+        int i = 0;
+#if defined(__F16C__)
+        if constexpr (std::is_same<T, float16>::value)
+        {
+            for (; i + 8 <= n; i += 8)
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i), _mm256_cvtps_ph(_mm256_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT));
+        }
+#endif
+        for (; i < n; i++)
+            dst[i] = from_float<T>(src[i]);
+    }
+
+    // dst[i] = src[first + i] for i in [0, count), with `before` and `after` standing in for indices outside [0, len)
+    template <class T>
+    inline void copy_padded(float *dst, const T *src, int first, int count, int len, float before, float after)
+    {
+        const int head = std::min(std::max(-first, 0), count);
+        const int tail = std::max(std::min(len - first, count), head);
+        std::fill(dst, dst + head, before);
+        widen(dst + head, src + first + head, tail - head);
+        std::fill(dst + tail, dst + count, after);
+    }
+
+    // Upsampled and activated phase `phase` of input positions p0 + i, i in [0, positions), into v.
+    // window[i] holds x[clamp(p0 + offset_min + i)].
+    template <class Shape, class Phase>
+    inline void upsample_phase(
+        float *v,
+        const float *window,
+        int positions,
+        const Shape &shape,
+        Phase phase,
+        const Filters &filters,
+        Vec alpha,
+        Vec inv_beta)
+    {
+        for (int i = 0; i < positions; i += Vec::width)
+        {
+            Vec acc = Vec::broadcast(0.0f);
+            shape.for_each_up_tap(phase, [&](int k, int offset)
+                                  { acc = fma(Vec::broadcast(filters.up[k]), Vec::load(window + i + offset - shape.offset_min), acc); });
+            snake(acc, alpha, inv_beta).store(v + i);
+        }
+    }
+
+    // Computes outputs [n0, n0 + count) of one (batch, channel) row into dst[0, count), count <= outputs_per_tile.
+    //
+    // The outputs read intermediate samples [n0 * down_ratio - down_pad_left, ...], which are produced phase by
+    // phase into one buffer per phase (clamped to the sequence as DownSample1d's replication padding does).
+    // With equal ratios every downsample tap reads one phase buffer contiguously; otherwise the taps are gathered.
+    // Every value is computed in full vectors (buffers are padded) with the same operations wherever it falls in
+    // the range, so results do not depend on n0: tiles and streamed chunks reproduce the whole-sequence output bit
+    // for bit. T is the storage type of src and dst (float, bfloat16 or float16).
+    template <class Shape, class T>
+    inline void forward_outputs(
+        T *dst,
+        const T *src,
+        int seq_len,
+        int n0,
+        int count,
+        const Shape &shape,
+        const Filters &filters,
+        float alpha,
+        float inv_beta)
+    {
+        constexpr int W = Vec::width;
+        const int up_ratio = shape.up_ratio;
+        const int down_ratio = shape.down_ratio;
+        const int pad_left = down_pad_left(shape.down_filter);
+        const int padded_count = round_up(count, W);
+
+        // Intermediate samples [m_first, m_last] at input positions p0 + i
+        const int m_first = n0 * down_ratio - pad_left;
+        const int m_last = (n0 + padded_count - 1) * down_ratio + shape.down_filter - 1 - pad_left;
+        const int p0 = floor_div(m_first, up_ratio);
+        const int positions = round_up(floor_div(m_last, up_ratio) - p0 + 1, W);
+        const int span = shape.offset_max - shape.offset_min;
+
+        float *window = scratch(positions + span + up_ratio * positions + padded_count);
+        float *phases = window + positions + span; // phase r of position p0 + i at phases[r * positions + i]
+        float *out = phases + up_ratio * positions;
+
+        copy_padded(window, src, p0 + shape.offset_min, positions + span, seq_len, to_float(src[0]), to_float(src[seq_len - 1]));
+
+        const Vec alpha_v = Vec::broadcast(alpha);
+        const Vec inv_beta_v = Vec::broadcast(inv_beta);
+        shape.for_each_phase([&](auto phase)
+                             { upsample_phase(phases + phase * positions, window, positions, shape, phase, filters, alpha_v, inv_beta_v); });
+
+        // Replication padding of the intermediate at the sequence ends
+        const int first = -p0;          // index of p = 0
+        const int end = seq_len - p0;   // first index past p = seq_len - 1
+        if (first > 0)
+        {
+            const float value = phases[first];
+            for (int r = 0; r < up_ratio; r++)
+                std::fill(phases + r * positions, phases + r * positions + first, value);
+        }
+        if (end < positions)
+        {
+            const float value = phases[(up_ratio - 1) * positions + end - 1];
+            for (int r = 0; r < up_ratio; r++)
+                std::fill(phases + r * positions + end, phases + (r + 1) * positions, value);
+        }
+
+        if (up_ratio == down_ratio)
+        {
+            for (int t = 0; t < padded_count; t += W)
+            {
+                Vec acc = Vec::broadcast(0.0f);
+                shape.for_each_down_tap([&](int k, int phase, int shift)
+                                        { acc = fma(Vec::broadcast(filters.down[k]), Vec::load(phases + phase * positions + t + shift), acc); });
+                acc.store(out + t);
+            }
+        }
+        else
+        {
+            for (int t = 0; t < count; t++)
+            {
+                float acc = 0.0f;
+                for (int k = 0; k < shape.down_filter; k++)
+                {
+                    const int m = (n0 + t) * down_ratio + k - pad_left;
+                    acc += filters.down[k] * phases[floor_mod(m, up_ratio) * positions + floor_div(m, up_ratio) - p0];
+                }
+                out[t] = acc;
+            }
+        }
+        narrow(dst, out, count);
+    }
+
+    // Computes outputs [tile * N, min((tile + 1) * N, output_length)) of one row, N = outputs_per_tile
+    template <class Shape, class T>
+    inline void forward_tile(
+        T *dst,
+        const T *src,
+        int seq_len,
+        int tile,
+        const Shape &shape,
+        const Filters &filters,
+        float alpha,
+        float inv_beta)
+    {
+        const int per_tile = outputs_per_tile(shape);
+        const int n0 = tile * per_tile;
+        const int count = std::min(per_tile, output_length(shape, seq_len) - n0);
+        forward_outputs(dst + n0, src, seq_len, n0, count, shape, filters, alpha, inv_beta);
+    }
+
+    // Streaming context with equal ratios, where output n lines up with input n: output n reads inputs
+    // [n - stream_history, n + stream_lookahead], so a stream can emit it once input n + stream_lookahead has arrived.
+    template <class Shape>
+    inline int stream_history(const Shape &shape)
+    {
+        return -(floor_div(-down_pad_left(shape.down_filter), shape.up_ratio) + shape.offset_min);
+    }
+
+    template <class Shape>
+    inline int stream_lookahead(const Shape &shape)
+    {
+        return floor_div(shape.down_filter - 1 - down_pad_left(shape.down_filter), shape.up_ratio) + shape.offset_max;
+    }
+
+    // Computes grad_input [tile * TILE, min((tile + 1) * TILE, seq_len)) of one row, recomputing the upsampled
+    // intermediate of the tile instead of reading it from memory.
+    //
+    // The backward runs the forward's two linear stages transposed. With equal ratios the downsample transpose has the
+    // same polyphase structure as the upsample: the gradient of phase r at position p gathers grad_output[p - shift]
+    // over the downsample taps of that phase; otherwise it is gathered tap by tap. grad_input[j] gathers every phase at
+    // positions j - offset. Replication padding becomes folding: gradient that the forward read from a clamped index
+    // is added to the first or last element.
+    //
+    // sum_alpha and sum_beta receive this tile's sum of grad_v * u * sin(2 alpha u) and grad_v * sin(alpha u)^2 over
+    // the positions the tile owns; the caller scales them into the log-scale alpha and beta gradients.
+    template <class Shape>
+    inline void backward_tile(
+        float *grad_input,
+        const float *grad_output,
+        const float *src,
+        int seq_len,
+        int tile,
+        const Shape &shape,
+        const Filters &filters,
+        float alpha,
+        float inv_beta,
+        double &sum_alpha,
+        double &sum_beta)
+    {
+        constexpr int W = Vec::width;
+        const int up_ratio = shape.up_ratio;
+        const int down_ratio = shape.down_ratio;
+        const int pad_left = down_pad_left(shape.down_filter);
+        const int out_len = output_length(shape, seq_len);
+        const int j0 = tile * TILE;
+        const int count = std::min(TILE, seq_len - j0);
+        const int padded_count = round_up(count, W);
+        const int span = shape.offset_max - shape.offset_min;
+
+        // Positions p0 + i of the intermediate that grad_input [j0, j0 + padded_count) gathers
+        const int p0 = j0 - shape.offset_max;
+        const int positions = round_up(padded_count + span, W);
+
+        float *window = scratch((positions + span) * 2 + shape.down_span + (up_ratio + 2) * positions + padded_count);
+        float *grad_window = window + positions + span; // grad_output window of the downsample transpose
+        float *grads = grad_window + positions + span + shape.down_span; // phase r of position p0 + i at grads[r * positions + i]
+        float *term_alpha = grads + up_ratio * positions;
+        float *term_beta = term_alpha + positions;
+        float *out = term_beta + positions;
+
+        copy_padded(window, src, p0 + shape.offset_min, positions + span, seq_len, src[0], src[seq_len - 1]);
+
+        // Downsample transpose
+        if (up_ratio == down_ratio)
+        {
+            // Phase r of position p gets down[k] * grad_output[p - floor_div(k - pad_left, up_ratio)] for its taps k
+            const int n_first = p0 - shape.down_span - floor_div(-pad_left, up_ratio);
+            copy_padded(grad_window, grad_output, n_first, positions + shape.down_span, out_len, 0.0f, 0.0f);
+            shape.for_each_phase([&](auto phase)
+                                 {
+                for (int i = 0; i < positions; i += W)
+                {
+                    Vec acc = Vec::broadcast(0.0f);
+                    shape.for_each_down_tap([&](int k, int tap_phase, int shift)
+                                            {
+                        if (tap_phase == phase)
+                            acc = fma(Vec::broadcast(filters.down[k]), Vec::load(grad_window + i + shape.down_span - shift), acc); });
+                    acc.store(grads + phase * positions + i);
+                } });
+        }
+        else
+        {
+            for (int r = 0; r < up_ratio; r++)
+            {
+                for (int i = 0; i < positions; i++)
+                {
+                    const int m = (p0 + i) * up_ratio + r;
+                    float acc = 0.0f;
+                    for (int k = 0; k < shape.down_filter; k++)
+                    {
+                        const int shifted = m + pad_left - k;
+                        if (floor_mod(shifted, down_ratio) == 0)
+                        {
+                            const int n = shifted / down_ratio;
+                            if (n >= 0 && n < out_len)
+                                acc += filters.down[k] * grad_output[n];
+                        }
+                    }
+                    grads[r * positions + i] = acc;
+                }
+            }
+        }
+
+        // Fold the downsample's replication padding: output n read intermediate clamp(n * down_ratio + k - pad_left)
+        const int first = -p0;             // index of p = 0
+        const int last = seq_len - 1 - p0; // index of p = seq_len - 1
+        const int intermediate_len = up_ratio * seq_len;
+        if (first >= 0 && first < positions)
+        {
+            float fold = 0.0f;
+            for (int n = 0; n < out_len && n * down_ratio - pad_left < 0; n++)
+                for (int k = 0; n * down_ratio + k - pad_left < 0; k++)
+                    fold += filters.down[k] * grad_output[n];
+            grads[first] += fold;
+        }
+        if (last >= 0 && last < positions)
+        {
+            float fold = 0.0f;
+            for (int n = out_len - 1; n >= 0 && n * down_ratio + shape.down_filter - 1 - pad_left > intermediate_len - 1; n--)
+                for (int k = shape.down_filter - 1; n * down_ratio + k - pad_left > intermediate_len - 1; k--)
+                    fold += filters.down[k] * grad_output[n];
+            grads[(up_ratio - 1) * positions + last] += fold;
+        }
+
+        // Recompute the upsampled intermediate and go back through the activation
+        const Vec alpha_v = Vec::broadcast(alpha);
+        const Vec slope_v = Vec::broadcast(alpha * inv_beta); // d/du of sin(alpha u)^2 / beta is alpha / beta * sin(2 alpha u)
+        std::fill(term_alpha, term_alpha + 2 * positions, 0.0f);
+        shape.for_each_phase([&](auto phase)
+                             {
+            float *g_phase = grads + phase * positions;
+            for (int i = 0; i < positions; i += W)
+            {
+                Vec u = Vec::broadcast(0.0f);
+                shape.for_each_up_tap(phase, [&](int k, int offset)
+                                      { u = fma(Vec::broadcast(filters.up[k]), Vec::load(window + i + offset - shape.offset_min), u); });
+                const Vec au = u * alpha_v;
+                const Vec sin2 = sin(au + au);
+                const Vec g = Vec::load(g_phase + i);
+                fma(g * slope_v, sin2, g).store(g_phase + i);
+                fma(g * u, sin2, Vec::load(term_alpha + i)).store(term_alpha + i);
+                fma(g, sin_squared(au), Vec::load(term_beta + i)).store(term_beta + i);
+            } });
+        for (int i = shape.offset_max; i < shape.offset_max + count; i++)
+        {
+            sum_alpha += term_alpha[i];
+            sum_beta += term_beta[i];
+        }
+        // The intermediate only exists for p in [0, seq_len)
+        for (int r = 0; r < up_ratio; r++)
+        {
+            std::fill(grads + r * positions, grads + r * positions + std::min(std::max(first, 0), positions), 0.0f);
+            std::fill(grads + r * positions + std::min(std::max(last + 1, 0), positions), grads + (r + 1) * positions, 0.0f);
+        }
+
+        // Upsample transpose: grad_input[j0 + t] reads phase r at index t + offset_max - offset of each of its taps
+        for (int t = 0; t < padded_count; t += W)
+        {
+            Vec acc = Vec::broadcast(0.0f);
+            shape.for_each_phase([&](auto phase)
+                                 { shape.for_each_up_tap(phase, [&](int k, int offset)
+                                                         { acc = fma(Vec::broadcast(filters.up[k]), Vec::load(grads + phase * positions + t + shape.offset_max - offset), acc); }); });
+            acc.store(out + t);
+        }
+
+        // Fold the upsample's replication padding: phase r of position p read x[clamp(p + offset)]
+        if (j0 == 0)
+        {
+            for (int p = 0; p < std::min(-shape.offset_min, seq_len); p++)
+                shape.for_each_phase([&](auto phase)
+                                     { shape.for_each_up_tap(phase, [&](int k, int offset)
+                                                             {
+                    if (p + offset < 0)
+                        out[0] += filters.up[k] * grads[phase * positions + first + p]; }); });
+        }
+        if (j0 + count == seq_len)
+        {
+            for (int p = std::max(0, seq_len - shape.offset_max); p < seq_len; p++)
+                shape.for_each_phase([&](auto phase)
+                                     { shape.for_each_up_tap(phase, [&](int k, int offset)
+                                                             {
+                    if (p + offset > seq_len - 1)
+                        out[count - 1] += filters.up[k] * grads[phase * positions + first + p]; }); });
+        }
+        std::copy(out, out + count, grad_input + j0);
+    }
+}
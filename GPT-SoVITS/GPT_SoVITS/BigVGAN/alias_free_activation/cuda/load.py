@@ -15,12 +15,16 @@ os.environ["TORCH_CUDA_ARCH_LIST"] = ""
 
 
 def load():
+    # Without nvcc, build only the CPU kernel (CPU-only inference hosts)
+    with_cuda = cpp_extension.CUDA_HOME is not None
+
     # Check if cuda 11 is installed for compute capability 8.0
     cc_flag = []
-    _, bare_metal_major, _ = _get_cuda_bare_metal_version(cpp_extension.CUDA_HOME)
-    if int(bare_metal_major) >= 11:
-        cc_flag.append("-gencode")
-        cc_flag.append("arch=compute_80,code=sm_80")
+    if with_cuda:
+        _, bare_metal_major, _ = _get_cuda_bare_metal_version(cpp_extension.CUDA_HOME)
+        if int(bare_metal_major) >= 11:
+            cc_flag.append("-gencode")
+            cc_flag.append("arch=compute_80,code=sm_80")
 
     # Build path
     srcpath = pathlib.Path(__file__).parent.absolute()
@@ -35,7 +39,11 @@ def load():
             build_directory=buildpath,
             extra_cflags=[
                 "-O3",
-            ],
+                "-march=native",  # the CPU kernel picks AVX-512, AVX2 or its scalar fallback from the build host
+                "-fopenmp",  # at::parallel_for runs serially without it
+            ]
+            + (["-DWITH_CUDA"] if with_cuda else []),
+            extra_ldflags=["-fopenmp"],
             extra_cuda_cflags=[
                 "-O3",
                 "-gencode",
@@ -56,9 +64,12 @@ def load():
 
     sources = [
         srcpath / "anti_alias_activation.cpp",
-        srcpath / "anti_alias_activation_cuda.cu",
+        srcpath / "anti_alias_activation_cpu.cpp",
     ]
-    anti_alias_activation_cuda = _cpp_extention_load_helper("anti_alias_activation_cuda", sources, extra_cuda_flags)
+    if with_cuda:
+        sources.append(srcpath / "anti_alias_activation_cuda.cu")
+    name = "anti_alias_activation_cuda" if with_cuda else "anti_alias_activation_cpu"
+    anti_alias_activation_cuda = _cpp_extention_load_helper(name, sources, extra_cuda_flags)
 
     return anti_alias_activation_cuda
 
@@ -0,0 +1,264 @@
+# Copyright (c) 2024 NVIDIA CORPORATION.
+#   Licensed under the MIT license.
+
+# Standalone benchmark of the anti-alias activation extension: sweeps batch, channels, sequence length and thread
+# count, and compares the fused kernel against the unfused UpSample1d -> Snake/SnakeBeta -> DownSample1d torch path.
+# Runs on CPU-only hosts (default) or CUDA. Every measurement runs in a fresh process so peak memory is not hidden by
+# an earlier configuration. Reports per configuration:
+#   - time per call (median over repeats),
+#   - throughput in samples/s (batch * channels * seq_len input samples per second),
+#   - effective bandwidth: the compulsory bytes of the call over its time (forward: read input, write output;
+#     train adds reading grad_output and the input again and writing grad_input), counted in the storage dtype
+#     (--dtype). Intermediates are not counted, so the unfused path's extra traffic shows up as a lower figure,
+#   - peak memory: growth of the resident set size during the calls (CPU) or peak allocated memory (CUDA),
+#   - train only: bytes autograd saves between forward and backward (the activation memory of the step).
+# With --lengths each batch holds items of random lengths padded to seq_len (the first one full length), and the
+# paths compare one call over the padded batch (fused), one call with per-item lengths (lengths), one call per
+# unpadded item (per_item) and the torch path over the padded batch (unfused). Useful throughput counts only the real
+# samples (sum of lengths * channels).
+# Results go to stdout as a table and, with --output, as JSON lines (one record per measurement, host info included)
+# or CSV, so runs can be compared across commits and hosts.
+#
+#   python tests/benchmark_activation.py --threads 1 2 4 8 --output results.jsonl
+#   python tests/benchmark_activation.py --path fused --dtype float32 bfloat16 float16 --seq_len 1048576
+#   python tests/benchmark_activation.py --lengths --batch 8 --channels 512 --seq_len 65536
+
+import os
+import sys
+
+# to import modules from parent_dir
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.append(parent_dir)
+
+import argparse
+import csv
+import json
+import multiprocessing
+import platform
+import resource
+import statistics
+import time
+
+import torch
+
+
+def _host_info(device):
+    from alias_free_activation.cuda import activation1d
+
+    info = {
+        "host": platform.node(),
+        "machine": platform.machine(),
+        "cpu_count": os.cpu_count(),
+        "torch": torch.__version__,
+        "cpu_kernel": activation1d.anti_alias_activation_cuda.cpu_capability(),
+    }
+    try:
+        with open("/proc/cpuinfo") as f:
+            info["cpu"] = next(line.split(":", 1)[1].strip() for line in f if line.startswith("model name"))
+    except (OSError, StopIteration):
+        info["cpu"] = platform.processor()
+    if device == "cuda":
+        info["gpu"] = torch.cuda.get_device_name()
+    return info
+
+
+def _saved_bytes(module, data):
+    """Bytes autograd keeps between forward and backward (activation memory of the training step)."""
+    total = 0
+
+    def pack(tensor):
+        nonlocal total
+        total += tensor.numel() * tensor.element_size()
+        return tensor
+
+    with torch.autograd.graph.saved_tensors_hooks(pack, lambda tensor: tensor):
+        module(data).sum()
+    return total
+
+
+def _run(config, result):
+    from alias_free_activation.cuda import activation1d
+    from activations import Snake, SnakeBeta
+
+    device, mode, dtype = config["device"], config["mode"], getattr(torch, config["dtype"])
+    torch.set_num_threads(config["threads"])
+    torch.manual_seed(0)
+    activation_cls = {"snake": Snake, "snakebeta": SnakeBeta}[config["activation"]]
+    module = activation1d.Activation1d(
+        activation=activation_cls(config["channels"], alpha_logscale=True), fused=config["path"] != "unfused"
+    ).to(device=device, dtype=dtype)
+    shape = (config["batch"], config["channels"], config["seq_len"])
+    data = torch.randn(shape, device=device, dtype=dtype, requires_grad=mode == "train")
+    routed = module.fused and module._fused_supported(data)
+    useful = data.numel()
+    if config["min_fraction"] is not None:
+        lengths = torch.randint(int(config["min_fraction"] * shape[2]), shape[2] + 1, (shape[0],))
+        lengths[0] = shape[2]
+        items = [data[b : b + 1, :, :length] for b, length in enumerate(lengths.tolist())]
+        useful = lengths.sum().item() * shape[1]
+        lengths = lengths.to(device)
+
+    def call():
+        if mode == "train":
+            data.grad = None
+            module.zero_grad()
+            module(data).backward(grad_output)
+        else:
+            with torch.no_grad():
+                if config["path"] == "lengths":
+                    return module(data, lengths=lengths)
+                if config["path"] == "per_item":
+                    return [module(item) for item in items]
+                return module(data)
+
+    out_len = -(-config["seq_len"] * module.up_ratio // module.down_ratio)
+    grad_output = torch.randn(shape[0], shape[1], out_len, device=device, dtype=dtype) if mode == "train" else None
+
+    # ru_maxrss is a high-water mark, so the baseline is taken before the first call
+    if device == "cuda":
+        torch.cuda.synchronize()
+        torch.cuda.reset_peak_memory_stats()
+        baseline = torch.cuda.memory_allocated()
+    else:
+        baseline = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+    call()  # warm up
+
+    times = []
+    deadline = time.perf_counter() + config["min_time"]
+    while len(times) < config["repeats"] or time.perf_counter() < deadline:
+        start = time.perf_counter()
+        call()
+        if device == "cuda":
+            torch.cuda.synchronize()
+        times.append(time.perf_counter() - start)
+
+    if device == "cuda":
+        peak = torch.cuda.max_memory_allocated() - baseline
+    else:
+        peak = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024 - baseline
+    # Measured after reading the peak so its extra forward pass does not count towards it
+    saved = _saved_bytes(module, data) if mode == "train" else None
+
+    element = data.element_size()
+    in_bytes = data.numel() * element
+    out_bytes = shape[0] * shape[1] * out_len * element
+    compulsory = in_bytes + out_bytes
+    if mode == "train":
+        compulsory += out_bytes + 2 * in_bytes
+    seconds = statistics.median(times)
+    result.put(
+        dict(
+            config,
+            fused_kernel=routed,
+            calls=len(times),
+            seconds=seconds,
+            seconds_min=min(times),
+            samples_per_s=data.numel() / seconds,
+            useful_samples_per_s=useful / seconds,
+            bandwidth_gb_s=compulsory / seconds / 1e9,
+            peak_memory_bytes=max(peak, 0),
+            saved_for_backward_bytes=saved,
+        )
+    )
+
+
+def measure(config):
+    """Runs one configuration in a fresh process and returns its result record."""
+    ctx = multiprocessing.get_context("spawn")
+    result = ctx.Queue()
+    process = ctx.Process(target=_run, args=(config, result))
+    process.start()
+    record = result.get()
+    process.join()
+    return record
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(
+        description="Anti-alias activation benchmark: fused kernel vs. unfused torch path."
+    )
+    parser.add_argument("--device", choices=["cpu", "cuda"], default="cpu")
+    parser.add_argument("--mode", choices=["forward", "train"], default="forward")
+    parser.add_argument("--activation", choices=["snake", "snakebeta"], default="snakebeta")
+    parser.add_argument("--path", choices=["fused", "unfused", "lengths", "per_item"], nargs="+")
+    parser.add_argument("--dtype", choices=["float32", "bfloat16", "float16"], nargs="+", default=["float32"])
+    parser.add_argument("--batch", type=int, nargs="+", default=[1, 4])
+    parser.add_argument("--channels", type=int, nargs="+", default=[64, 512])
+    parser.add_argument("--seq_len", type=int, nargs="+", default=[8192, 65536])
+    parser.add_argument("--threads", type=int, nargs="+", default=[torch.get_num_threads()])
+    parser.add_argument("--repeats", type=int, default=5, help="minimum number of timed calls")
+    parser.add_argument("--min_time", type=float, default=0.5, help="minimum seconds of timed calls")
+    parser.add_argument("--output", help="write results to this file: JSON lines, or CSV if it ends in .csv")
+    parser.add_argument("--lengths", action="store_true", help="mixed-length batches padded to seq_len")
+    parser.add_argument("--min_fraction", type=float, default=0.1, help="with --lengths: shortest item / seq_len")
+    args = parser.parse_args()
+    if args.path is None:
+        args.path = ["fused", "lengths", "per_item", "unfused"] if args.lengths else ["fused", "unfused"]
+    if not args.lengths and ("lengths" in args.path or "per_item" in args.path):
+        parser.error("--path lengths and per_item need --lengths")
+    if args.lengths and args.mode == "train":
+        parser.error("--lengths benchmarks inference only; use --mode forward")
+    if args.device == "cuda" and args.mode == "train" and "fused" in args.path:
+        parser.error("the fused CUDA kernel is inference only; use --mode forward or --path unfused")
+
+    from alias_free_activation.cuda import load
+
+    load.load()  # build once in the parent so the worker processes only load it
+    host = _host_info(args.device)
+    print(", ".join(f"{key}={value}" for key, value in host.items()))
+
+    records = []
+    for threads in args.threads:
+        for batch in args.batch:
+            for channels in args.channels:
+                for seq_len in args.seq_len:
+                    for dtype in args.dtype:
+                        for path in args.path:
+                            config = dict(
+                                device=args.device,
+                                mode=args.mode,
+                                activation=args.activation,
+                                path=path,
+                                dtype=dtype,
+                                threads=threads,
+                                batch=batch,
+                                channels=channels,
+                                seq_len=seq_len,
+                                repeats=args.repeats,
+                                min_time=args.min_time,
+                                min_fraction=args.min_fraction if args.lengths else None,
+                            )
+                            record = measure(config)
+                            records.append(record)
+                            label = path if path == "unfused" or record["fused_kernel"] else f"{path} (torch fallback)"
+                            throughput = record["useful_samples_per_s" if args.lengths else "samples_per_s"]
+                            saved = record["saved_for_backward_bytes"]
+                            print(
+                                f"{label:8s} {dtype:8s} threads={threads:3d} shape=({batch}, {channels}, {seq_len}): "
+                                f"{record['seconds'] * 1000:9.3f} ms, {throughput / 1e6:9.1f} "
+                                f"{'useful ' if args.lengths else ''}Msamples/s, "
+                                f"{record['bandwidth_gb_s']:7.2f} GB/s, "
+                                f"peak {record['peak_memory_bytes'] / 2**20:8.1f} MiB"
+                                + (f", saved for backward {saved / 2**20:8.1f} MiB" if saved is not None else "")
+                            )
+
+    # Thread count with the highest throughput per path and shape
+    if len(args.threads) > 1:
+        best = {}
+        for record in records:
+            key = (record["path"], record["dtype"], record["batch"], record["channels"], record["seq_len"])
+            if key not in best or record["samples_per_s"] > best[key]["samples_per_s"]:
+                best[key] = record
+        for (path, dtype, batch, channels, seq_len), record in best.items():
+            print(f"best {path:8s} {dtype:8s} shape=({batch}, {channels}, {seq_len}): threads={record['threads']}")
+
+    if args.output:
+        with open(args.output, "w", newline="") as f:
+            if args.output.endswith(".csv"):
+                writer = csv.DictWriter(f, fieldnames=list(host) + list(records[0]))
+                writer.writeheader()
+                for record in records:
+                    writer.writerow(dict(host, **record))
+            else:
+                for record in records:
+                    f.write(json.dumps(dict(host, **record)) + "\n")
@@ -0,0 +1,82 @@
+# Copyright (c) 2024 NVIDIA CORPORATION.
+#   Licensed under the MIT license.
+
+# Per-chunk latency of the streaming anti-alias activation on CPU (Activation1d.stream) for several chunk sizes,
+# against the fused forward over the whole sequence. The real-time factor is the processing time over the audio
+# duration of a chunk at --sample_rate (the rate of the signal entering the activation).
+
+import os
+import sys
+
+# to import modules from parent_dir
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.append(parent_dir)
+
+import argparse
+import statistics
+import time
+
+import torch
+
+
+def _percentile(values, fraction):
+    ordered = sorted(values)
+    return ordered[min(len(ordered) - 1, int(fraction * len(ordered)))]
+
+
+def stream_latencies(module, data, chunk):
+    """Seconds spent on each chunk when streaming data through module in chunks of the given length."""
+    latencies, state = [], None
+    for position in range(0, data.shape[-1], chunk):
+        piece = data[..., position : position + chunk]
+        start = time.perf_counter()
+        _, state = module.stream(piece, state)
+        latencies.append(time.perf_counter() - start)
+    module.stream(data[..., :0], state, last=True)
+    return latencies
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description="Streaming anti-alias activation on CPU: per-chunk latency.")
+    parser.add_argument("--batch", type=int, default=1)
+    parser.add_argument("--channels", type=int, default=512)
+    parser.add_argument("--seq_len", type=int, default=65536)
+    parser.add_argument("--chunk", type=int, nargs="+", default=[64, 256, 1024, 4096])
+    parser.add_argument("--sample_rate", type=int, default=24000)
+    parser.add_argument("--repeats", type=int, default=3)
+    args = parser.parse_args()
+
+    from alias_free_activation.cuda import load
+
+    load.load()
+    from alias_free_activation.cuda import activation1d
+    from activations import SnakeBeta
+
+    torch.manual_seed(0)
+    module = activation1d.Activation1d(activation=SnakeBeta(args.channels, alpha_logscale=True), fused=True)
+    data = torch.randn(args.batch, args.channels, args.seq_len)
+    history, lookahead = module.stream_context()
+    print(f"threads={torch.get_num_threads()} history={history} lookahead={lookahead} samples")
+
+    with torch.no_grad():
+        module(data)  # warm up
+        start = time.perf_counter()
+        for _ in range(args.repeats):
+            module(data)
+        full = (time.perf_counter() - start) / args.repeats
+    print(f"full sequence shape={tuple(data.shape)}: {full * 1000:.2f} ms ({full / args.seq_len * 1e6:.3f} us/sample)")
+
+    for chunk in args.chunk:
+        stream_latencies(module, data[..., : 4 * chunk], chunk)  # warm up
+        latencies = []
+        for _ in range(args.repeats):
+            latencies += stream_latencies(module, data, chunk)
+        median = statistics.median(latencies)
+        p99 = _percentile(latencies, 0.99)
+        total = sum(latencies) / args.repeats
+        print(
+            f"chunk={chunk:6d}: median {median * 1e6:8.1f} us, p99 {p99 * 1e6:8.1f} us, "
+            f"real-time factor {median * args.sample_rate / chunk:.4f}, "
+            f"total {total * 1000:.2f} ms ({total / full:.2f}x full sequence), "
+            f"algorithmic delay {lookahead / args.sample_rate * 1000:.2f} ms"
+        )
@@ -0,0 +1,286 @@
+# Copyright (c) 2024 NVIDIA CORPORATION.
+#   Licensed under the MIT license.
+
+import os
+import sys
+
+# to import modules from parent_dir
+parent_dir = os.path.abspath(os.path.join(os.path.dirname(__file__), ".."))
+sys.path.append(parent_dir)
+
+import torch
+from alias_free_activation.cuda import activation1d
+from activations import Snake, SnakeBeta
+
+
+def test_load_fused_kernels():
+    try:
+        print(f"[Success] load_fused_kernels (CPU kernel: {activation1d.anti_alias_activation_cuda.cpu_capability()})")
+    except ImportError as e:
+        print("[Fail] load_fused_kernels")
+        raise e
+
+
+def test_anti_alias_activation_cpu(activation_cls, shape):
+    torch.manual_seed(0)
+    channels = shape[1]
+    data = torch.randn(shape)
+    activation = activation_cls(channels, alpha_logscale=True)
+    with torch.no_grad():
+        # Non-trivial per-channel parameters so every channel exercises its own alpha/beta
+        activation.alpha.uniform_(-1.0, 1.0)
+        if hasattr(activation, "beta"):
+            activation.beta.uniform_(-1.0, 1.0)
+
+    fused_anti_alias_activation = activation1d.Activation1d(activation=activation, fused=True)
+    torch_anti_alias_activation = activation1d.Activation1d(activation=activation, fused=False)
+    with torch.no_grad():
+        fused_activation_output = fused_anti_alias_activation(data)
+        torch_activation_output = torch_anti_alias_activation(data)
+
+    diff = (fused_activation_output - torch_activation_output).abs().max().item()
+    name = f"test_anti_alias_activation_cpu[{activation_cls.__name__}, {tuple(shape)}]"
+    if diff <= 1e-4:
+        print(f"[Success] {name} > max_difference={diff}")
+    else:
+        print(
+            f"\n[Fail] {name}"
+            f"\n > max_difference={diff}"
+            f"\n > fused_values={fused_activation_output[-1][-1][:8].tolist()}"
+            f"\n > torch_values={torch_activation_output[-1][-1][:8].tolist()}"
+        )
+        raise AssertionError(name)
+
+
+def _activation_pair(activation_cls, channels, alpha_logscale, **hyperparameters):
+    torch.manual_seed(0)
+    activation = activation_cls(channels, alpha_logscale=alpha_logscale)
+    with torch.no_grad():
+        if alpha_logscale:
+            activation.alpha.uniform_(-1.0, 1.0)
+        else:
+            activation.alpha.uniform_(0.5, 2.0)
+        if hasattr(activation, "beta"):
+            activation.beta.copy_(activation.alpha.flip(0))
+    fused = activation1d.Activation1d(activation=activation, fused=True, **hyperparameters)
+    unfused = activation1d.Activation1d(activation=activation, fused=False, **hyperparameters)
+    return activation, fused, unfused
+
+
+def test_anti_alias_activation_cpu_gradcheck(shape):
+    # Checks the fused backward against finite differences of the fused forward, for input, alpha and beta.
+    # The CPU kernel has no float64 path (storage is float32, bfloat16 or float16, accumulation float32), so gradcheck
+    # runs in float32 and finite differences use a large eps and loose tolerances.
+    torch.manual_seed(0)
+    module = activation1d.Activation1d(activation=SnakeBeta(shape[1], alpha_logscale=True), fused=True)
+    data = torch.randn(shape, requires_grad=True)
+    alpha = torch.empty(shape[1]).uniform_(-1.0, 1.0).requires_grad_(True)
+    beta = torch.empty(shape[1]).uniform_(-1.0, 1.0).requires_grad_(True)
+
+    def fused(x, a, b):
+        return activation1d.FusedAntiAliasActivation.apply(
+            x, module.upsample.filter, module.downsample.lowpass.filter, a, b, 2, 2, None
+        )
+
+    name = f"test_anti_alias_activation_cpu_gradcheck[{tuple(shape)}]"
+    ok = torch.autograd.gradcheck(fused, (data, alpha, beta), eps=1e-2, atol=5e-2, rtol=5e-2, raise_exception=False)
+    print(f"[{'Success' if ok else 'Fail'}] {name}")
+    if not ok:
+        raise AssertionError(name)
+
+
+def test_anti_alias_activation_cpu_backward(activation_cls, shape, alpha_logscale=True):
+    # Fused gradients against autograd through the unfused torch path
+    activation, fused, unfused = _activation_pair(activation_cls, shape[1], alpha_logscale)
+    data = torch.randn(shape)
+    grad_output = torch.randn(shape)
+    results = []
+    for module in (fused, unfused):
+        x = data.clone().requires_grad_(True)
+        activation.zero_grad()
+        module(x).backward(grad_output)
+        results.append([x.grad.clone()] + [p.grad.clone() for p in activation.parameters()])
+
+    name = f"test_anti_alias_activation_cpu_backward[{activation_cls.__name__}, {tuple(shape)}, logscale={alpha_logscale}]"
+    diffs = [((a - b).abs().max() / b.abs().max().clamp(min=1.0)).item() for a, b in zip(*results)]
+    if max(diffs) <= 1e-4:
+        print(f"[Success] {name} > relative_max_difference={diffs}")
+    else:
+        print(f"[Fail] {name} > relative_max_difference={diffs}")
+        raise AssertionError(name)
+
+
+def test_anti_alias_activation_cpu_hyperparameters(up_ratio, down_ratio, up_kernel_size, down_kernel_size, shape):
+    # Other filter sizes and ratios: forward and gradients of the fused kernel against the torch path
+    hyperparameters = dict(
+        up_ratio=up_ratio, down_ratio=down_ratio, up_kernel_size=up_kernel_size, down_kernel_size=down_kernel_size
+    )
+    activation, fused, unfused = _activation_pair(SnakeBeta, shape[1], alpha_logscale=True, **hyperparameters)
+    data = torch.randn(shape)
+    name = f"test_anti_alias_activation_cpu_hyperparameters[{hyperparameters}, {tuple(shape)}]"
+    if not fused._fused_supported(data):
+        print(f"[Fail] {name} > not routed to the fused kernel")
+        raise AssertionError(name)
+
+    results = []
+    for module in (fused, unfused):
+        x = data.clone().requires_grad_(True)
+        activation.zero_grad()
+        y = module(x)
+        y.backward(torch.linspace(-1.0, 1.0, y.numel()).view(y.shape))
+        results.append([y.detach(), x.grad.clone()] + [p.grad.clone() for p in activation.parameters()])
+
+    diffs = [((a - b).abs().max() / b.abs().max().clamp(min=1.0)).item() for a, b in zip(*results)]
+    if results[0][0].shape == results[1][0].shape and max(diffs) <= 1e-4:
+        print(f"[Success] {name} > relative_max_difference={diffs}")
+    else:
+        print(f"[Fail] {name} > shapes={results[0][0].shape}/{results[1][0].shape} relative_max_difference={diffs}")
+        raise AssertionError(name)
+
+
+def test_anti_alias_activation_cpu_reduced_precision(activation_cls, dtype, shape):
+    # bfloat16/float16 storage with float32 accumulation: the output must be the float32 kernel's output on the same
+    # (rounded) input, rounded once; against the full float32 path only the input and output rounding show
+    activation, fused, _ = _activation_pair(activation_cls, shape[1], alpha_logscale=True)
+    data = torch.randn(shape)
+    rounded = data.to(dtype)
+    with torch.no_grad():
+        output = fused(rounded)
+        rounded_reference = fused(rounded.float())
+        reference = fused(data)
+
+    x = rounded.clone().requires_grad_(True)
+    fused(x).backward(torch.ones(shape, dtype=dtype))
+    x_reference = rounded.float().requires_grad_(True)
+    fused(x_reference).backward(torch.ones(shape))
+
+    tolerance = {torch.bfloat16: 2e-2, torch.float16: 2e-3}[dtype]
+    diff = ((output.float() - reference).abs().max() / reference.abs().max()).item()
+    grad_diff = ((x.grad.float() - x_reference.grad).abs().max() / x_reference.grad.abs().max()).item()
+    exact = torch.equal(output, rounded_reference.to(dtype))
+    name = f"test_anti_alias_activation_cpu_reduced_precision[{activation_cls.__name__}, {dtype}, {tuple(shape)}]"
+    if output.dtype == dtype and x.grad.dtype == dtype and exact and diff <= tolerance and grad_diff <= tolerance:
+        print(f"[Success] {name} > relative_max_difference_to_fp32={diff} grad={grad_diff}")
+    else:
+        print(
+            f"[Fail] {name} > dtype={output.dtype} rounded_fp32_equal={exact} "
+            f"relative_max_difference={diff} grad={grad_diff}"
+        )
+        raise AssertionError(name)
+
+
+def test_anti_alias_activation_cpu_stream(
+    up_ratio, up_kernel_size, down_kernel_size, shape, max_chunk, dtype=torch.float32
+):
+    # Chunks of random length (empty ones included) streamed through the carried state must reproduce the
+    # full-sequence fused forward bit for bit, including the replication padding at both ends
+    _, module, _ = _activation_pair(
+        SnakeBeta,
+        shape[1],
+        alpha_logscale=True,
+        up_ratio=up_ratio,
+        down_ratio=up_ratio,
+        up_kernel_size=up_kernel_size,
+        down_kernel_size=down_kernel_size,
+    )
+    data = torch.randn(shape).to(dtype)
+    with torch.no_grad():
+        reference = module(data)
+
+    outputs, state, position = [], None, 0
+    while position < shape[2]:
+        chunk = int(torch.randint(0, max_chunk + 1, ()).item())
+        output, state = module.stream(data[..., position : position + chunk], state)
+        outputs.append(output)
+        position += chunk
+    output, state = module.stream(data[..., :0], state, last=True)
+    outputs.append(output)
+    streamed = torch.cat(outputs, dim=-1)
+
+    kernel_sizes = f"{up_kernel_size}/{down_kernel_size}"
+    name = f"test_anti_alias_activation_cpu_stream[{up_ratio}, {kernel_sizes}, {tuple(shape)}, {max_chunk=}, {dtype}]"
+    if streamed.shape == reference.shape and torch.equal(streamed, reference) and state.shape[-1] == 0:
+        print(f"[Success] {name} > chunks={len(outputs)} context={module.stream_context()}")
+    else:
+        print(f"[Fail] {name} > shapes={streamed.shape}/{reference.shape}")
+        raise AssertionError(name)
+
+
+def test_anti_alias_activation_cpu_lengths(up_ratio, down_ratio, up_kernel_size, down_kernel_size, shape, lengths):
+    # Variable-length batch padded with large values: every item must match the torch path on that item alone (forward
+    # and gradients), be bit-exact with the fused kernel on the unpadded item, and be zero past its end
+    hyperparameters = dict(
+        up_ratio=up_ratio, down_ratio=down_ratio, up_kernel_size=up_kernel_size, down_kernel_size=down_kernel_size
+    )
+    activation, fused, unfused = _activation_pair(SnakeBeta, shape[1], alpha_logscale=True, **hyperparameters)
+    data = torch.randn(shape)
+    for b, length in enumerate(lengths):
+        data[b, :, length:] = 100.0
+
+    results = []
+    for module in (fused, unfused):
+        x = data.clone().requires_grad_(True)
+        activation.zero_grad()
+        y = module(x, lengths=torch.tensor(lengths))
+        y.backward(torch.linspace(-1.0, 1.0, y.numel()).view(y.shape))
+        results.append([y.detach(), x.grad.clone()] + [p.grad.clone() for p in activation.parameters()])
+    diffs = [((a - b).abs().max() / b.abs().max().clamp(min=1.0)).item() for a, b in zip(*results)]
+
+    output, grad_input = results[0][0], results[0][1]
+    exact = True
+    with torch.no_grad():
+        for b, length in enumerate(lengths):
+            out_length = -(-length * up_ratio // down_ratio)
+            item = fused(data[b : b + 1, :, :length])
+            exact &= torch.equal(output[b : b + 1, :, :out_length], item)
+            exact &= bool((output[b, :, out_length:] == 0).all() and (grad_input[b, :, length:] == 0).all())
+
+    name = f"test_anti_alias_activation_cpu_lengths[{hyperparameters}, {tuple(shape)}, {lengths}]"
+    if exact and max(diffs) <= 1e-4:
+        print(f"[Success] {name} > relative_max_difference={diffs}")
+    else:
+        print(f"[Fail] {name} > per_item_exact={exact} relative_max_difference={diffs}")
+        raise AssertionError(name)
+
+
+if __name__ == "__main__":
+    from alias_free_activation.cuda import load
+
+    load.load()
+    test_load_fused_kernels()
+    # Short sequences, lengths that are not a multiple of the vector width, and several 1024-sample tiles
+    for shape in [(2, 3, 1), (2, 3, 7), (4, 16, 200), (1, 8, 1023), (2, 4, 4101)]:
+        test_anti_alias_activation_cpu(Snake, shape)
+        test_anti_alias_activation_cpu(SnakeBeta, shape)
+    test_anti_alias_activation_cpu_gradcheck((1, 2, 9))
+    test_anti_alias_activation_cpu_gradcheck((1, 1, 1030))
+    for activation_cls in (Snake, SnakeBeta):
+        for shape in [(2, 3, 5), (2, 4, 300), (1, 2, 2050)]:
+            test_anti_alias_activation_cpu_backward(activation_cls, shape)
+        test_anti_alias_activation_cpu_backward(activation_cls, (2, 4, 300), alpha_logscale=False)
+    # Compile-time specializations (default kernel sizes of ratios 2, 3, 4) and the generic kernel
+    for up_ratio, down_ratio, up_kernel_size, down_kernel_size in [
+        (2, 2, 12, 12),
+        (3, 3, 18, 18),
+        (4, 4, 24, 24),
+        (2, 2, 10, 14),
+        (2, 2, 11, 13),
+        (3, 2, 12, 7),
+        (2, 1, 12, 6),
+    ]:
+        for shape in [(2, 3, 5), (1, 4, 1500)]:
+            test_anti_alias_activation_cpu_hyperparameters(up_ratio, down_ratio, up_kernel_size, down_kernel_size, shape)
+    # Streaming: specialized and generic kernels, chunks shorter than the filter halo and longer than a tile
+    for up_ratio, up_kernel_size, down_kernel_size in [(2, 12, 12), (3, 18, 18), (2, 11, 13)]:
+        for shape, max_chunk in [((2, 3, 50), 4), ((1, 4, 3000), 1500)]:
+            test_anti_alias_activation_cpu_stream(up_ratio, up_kernel_size, down_kernel_size, shape, max_chunk)
+    test_anti_alias_activation_cpu_stream(2, 12, 12, (1, 4, 3000), 700, dtype=torch.bfloat16)
+    # bfloat16/float16 inputs and outputs with float32 accumulation
+    for dtype in (torch.bfloat16, torch.float16):
+        for shape in [(2, 3, 7), (2, 8, 4101)]:
+            test_anti_alias_activation_cpu_reduced_precision(SnakeBeta, dtype, shape)
+        test_anti_alias_activation_cpu_reduced_precision(Snake, dtype, (1, 4, 1030))
+    # Variable-length batches: items shorter than a tile, empty items, and items ending inside a tile
+    for hyperparameters in [(2, 2, 12, 12), (3, 2, 12, 7)]:
+        test_anti_alias_activation_cpu_lengths(*hyperparameters, (4, 3, 2500), [2500, 0, 7, 1100])
+        test_anti_alias_activation_cpu_lengths(*hyperparameters, (3, 2, 40), [1, 40, 23])
@@ -7,15 +7,23 @@ import json
 import requests
 import subprocess
 import serial
+import struct
+import threading
 import time
-from collections import deque
+from collections import Counter, deque
 
 # 加载配置文件
 config = json.load(open(os.path.join(os.path.dirname(os.path.abspath(__file__)), "config.json"), encoding='utf-8'))
 
+# 音频采样率 (与 ESP32 端 config.h 的 AUDIO_PROFILE 一致)，上行录音和下行语音都使用此采样率
+SAMPLE_RATE = config.get("audio", {}).get("sample_rate", 16000)
+
 # 初始化历史记录队列，用于存储对话历史
 history = deque(maxlen=config["general"]["history_maxlen"])
 
+# 输入过短时的预设回复 (固定文本，适合缓存在 ESP32 上)
+FALLBACK_REPLY = "请说完整的句子，我才能理解你的意思。"
+
 class DeepSeekChatClient:
     """
     DeepSeek 大语言模型客户端，用于与 DeepSeek API 交互。
@@ -60,7 +68,7 @@ class DeepSeekChatClient:
         # 如果用户输入过短，则返回预设回复
         if len(user_message) < 2:
             reply = {
-                "reply": "请说完整的句子，我才能理解你的意思。",
+                "reply": FALLBACK_REPLY,
                 "emotion": "neutral",
                 "language": "中文",
             }
@@ -235,6 +243,7 @@ def arduino_connect(
 def receive_sample(
     client_socket,
     voice_path=os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "data", "voice.wav"),
+    udp_receiver=None,
 ):
     """
     从 ESP32 接收音频采样数据。
@@ -242,6 +251,7 @@ def receive_sample(
     Args:
         client_socket (socket.socket): 与 ESP32 客户端的 socket 连接。
         voice_path (str): 保存接收到的音频文件的路径。
+        udp_receiver (UdpAudioReceiver): 启用 UDP 音频时，语音从这里取出 (TCP 只收到开始/结束信号)。
     """
     received_sample = bytearray()
     while True:
@@ -266,6 +276,14 @@ def receive_sample(
             instruct = int.from_bytes(instruct_bytes, byteorder="little")
             if instruct == 0x0002:  # 音频结束指令
                 break
+        if type == 0x03:  # 间隙通知: ESP32 上行队列满时丢弃的样本数，以静音补齐保持时间轴对齐
+            gap_bytes = client_socket.recv(length)
+            if not gap_bytes or len(gap_bytes) < length: # 检查连接是否已关闭或数据不完整
+                print("ESP32 connection closed or incomplete gap received.")
+                break
+            gap_samples = int.from_bytes(gap_bytes, byteorder="little")
+            print(f"上行丢帧，补齐静音 {gap_samples} 个样本")
+            received_sample.extend(bytes(gap_samples * 2))
         if type == 0x02:  # 音频数据类型
             sample_chunk = client_socket.recv(length)
             if not sample_chunk: # 检查连接是否已关闭
@@ -282,6 +300,8 @@ def receive_sample(
                     return # 或者 raise ConnectionError("Connection closed prematurely")
                 sample_chunk += remaining_data
             received_sample.extend(sample_chunk)
+    if udp_receiver is not None and not received_sample:
+        received_sample = udp_receiver.take_utterance()
     print(f"接收音频数据长度: {len(received_sample)}")
     # 将接收到的字节数据转换为 NumPy 数组
     voice_sample = np.frombuffer(received_sample, dtype=np.int16)
@@ -289,7 +309,12 @@ def receive_sample(
     if os.path.exists(voice_path):
         os.remove(voice_path)
     # 将音频数据写入 WAV 文件
-    sf.write(voice_path, voice_sample, samplerate=16000)
+    sf.write(voice_path, voice_sample, samplerate=SAMPLE_RATE)
+    # 可选: 保留每轮录音，作为端点检测回放测试 (test_endpoint) 的语料
+    utterance_dir = config["general"].get("utterance_dir")
+    if utterance_dir:
+        os.makedirs(utterance_dir, exist_ok=True)
+        sf.write(os.path.join(utterance_dir, time.strftime("%Y%m%d-%H%M%S.wav")), voice_sample, samplerate=SAMPLE_RATE)
 
 
 def llm_process(text):
@@ -351,13 +376,13 @@ def tts_process(text, language, url="http://127.0.0.1:9880/"):
     # 发送 POST 请求到 TTS 服务
     response = requests.post(url, json=params)
     reply_voice = response.content
-    # 使用 ffmpeg 将 TTS 输出转换为 16kHz 单声道 PCM S16LE 格式
+    # 使用 ffmpeg 将 TTS 输出转换为设备采样率的单声道 PCM S16LE 格式
     ffmpeg_cmd = [
         "ffmpeg",
         "-i",
         "pipe:0",  # 从 stdin 读取输入
         "-ar",
-        "16000",  # 采样率 16kHz
+        str(SAMPLE_RATE),  # 采样率 (16kHz 或 8kHz)
         "-ac",
         "1",  # 单声道
         "-c:a",
@@ -376,7 +401,106 @@ def tts_process(text, language, url="http://127.0.0.1:9880/"):
     return reply_voice_pcm
 
 
-def send_reply(client_socket, reply_voice, reply):
+# 下行语音头部的特殊长度值 (与 ESP32 端 reply_cache.h 一致)
+REPLY_PLAY_CACHED = 0xFFFFFFFF  # 后跟8字节哈希: 播放 ESP32 缓存中的语音
+REPLY_STORE_CLIP = 0xFFFFFFFE  # 后跟8字节哈希 + 正常语音: 播放后存入 ESP32 缓存
+CACHE_HIT = 0x0003  # ESP32 应答: 缓存命中
+CACHE_MISS = 0x0004  # ESP32 应答: 缓存未命中
+
+REPLY_CACHE_DIR = os.path.join(os.path.dirname(os.path.abspath(__file__)), "reply_cache")
+reply_seen = Counter()  # 每段回复出现的次数
+reply_cache_stats = {"lookups": 0, "hits": 0, "bytes_saved": 0}
+
+
+def reply_cache_key(text, language):
+    """
+    计算回复语音的内容哈希 (64位 FNV-1a)。相同的参考音色、语言、文本和采样率会得到相同的语音。
+
+    Returns:
+        int: 64位哈希值。
+    """
+    key = f'{config["tts_service"]["ref_voice_name"]}|{language}|{SAMPLE_RATE}|{text}'.encode("utf-8")
+    h = 0xCBF29CE484222325
+    for byte in key:
+        h = ((h ^ byte) * 0x100000001B3) & 0xFFFFFFFFFFFFFFFF
+    return h
+
+
+def reply_cache_eligible(text, key):
+    """
+    判断回复是否值得缓存: 预设回复，或同一回复已出现多次。
+    """
+    reply_seen[key] += 1
+    return text == FALLBACK_REPLY or reply_seen[key] >= config["reply_cache"]["min_repeats"]
+
+
+def load_cached_pcm(key):
+    """
+    从服务器端磁盘缓存读取回复语音，并更新访问时间用于 LRU 淘汰。
+
+    Returns:
+        bytes or None: PCM 数据，不存在时返回 None。
+    """
+    path = os.path.join(REPLY_CACHE_DIR, f"{key:016x}.pcm")
+    if not os.path.exists(path):
+        return None
+    os.utime(path)
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def save_cached_pcm(key, pcm):
+    """
+    把回复语音写入服务器端磁盘缓存，超出容量时按访问时间淘汰最旧的语音。
+    """
+    os.makedirs(REPLY_CACHE_DIR, exist_ok=True)
+    with open(os.path.join(REPLY_CACHE_DIR, f"{key:016x}.pcm"), "wb") as f:
+        f.write(pcm)
+    files = [os.path.join(REPLY_CACHE_DIR, name) for name in os.listdir(REPLY_CACHE_DIR)]
+    files.sort(key=os.path.getmtime)
+    total = sum(os.path.getsize(path) for path in files)
+    while files and total > config["reply_cache"]["server_max_bytes"]:
+        path = files.pop(0)
+        total -= os.path.getsize(path)
+        os.remove(path)
+
+
+def send_cached_reply(client_socket, key, reply_voice, reply):
+    """
+    请求 ESP32 播放缓存中的回复语音。命中时接着发送文本；未命中时由调用者重新发送语音。
+
+    Args:
+        client_socket (socket.socket): 与 ESP32 客户端的 socket 连接。
+        key (int): 回复语音的内容哈希。
+        reply_voice (bytes): 服务器端缓存的 PCM 数据，用于统计节省的字节数。
+        reply (str): 回复的文本内容。
+
+    Returns:
+        bool: ESP32 缓存是否命中。
+    """
+    client_socket.sendall(REPLY_PLAY_CACHED.to_bytes(4, byteorder="little"))
+    client_socket.sendall(key.to_bytes(8, byteorder="little"))
+    reply_cache_stats["lookups"] += 1
+    # 等待 ESP32 以信号帧应答 (类型1字节 + 长度4字节 + 信号2字节)
+    while True:
+        header = recv_exact(client_socket, 5)
+        payload = recv_exact(client_socket, int.from_bytes(header[1:5], byteorder="little"))
+        if header[0] != 0x01:
+            continue
+        signal = int.from_bytes(payload, byteorder="little")
+        if signal in (CACHE_HIT, CACHE_MISS):
+            break
+    if signal == CACHE_MISS:
+        return False
+    reply_cache_stats["hits"] += 1
+    reply_cache_stats["bytes_saved"] += len(reply_voice)
+    reply_bytes = reply.encode("utf-8")
+    client_socket.sendall(len(reply_bytes).to_bytes(4, byteorder="little"))
+    client_socket.sendall(reply_bytes)
+    return True
+
+
+def send_reply(client_socket, reply_voice, reply, cache_key=None):
     """
     向 ESP32 发送回复语音和文本。
 
@@ -384,7 +508,11 @@ def send_reply(client_socket, reply_voice, reply):
         client_socket (socket.socket): 与 ESP32 客户端的 socket 连接。
         reply_voice (bytes): PCM 格式的回复语音数据。
         reply (str): 回复的文本内容。
+        cache_key (int): 不为 None 时要求 ESP32 以该哈希缓存这段语音。
     """
+    if cache_key is not None:
+        client_socket.sendall(REPLY_STORE_CLIP.to_bytes(4, byteorder="little"))
+        client_socket.sendall(cache_key.to_bytes(8, byteorder="little"))
     # 发送语音数据长度
     length = len(reply_voice)
     client_socket.sendall(length.to_bytes(4, byteorder="little"))
@@ -400,15 +528,148 @@ def send_reply(client_socket, reply_voice, reply):
     print(f"发送回复长度: {len(reply_bytes)}") # 注意：这里打印的是文本长度，不是语音长度
 
 
+# UDP 音频包格式 (与 ESP32 端 lib/AudioDatagram/udp_audio.h 一致，小端):
+# magic(2) + version(1) + stream(1) + seq(2) + samples(2) + timestamp(4) + PCM
+UDP_AUDIO_HEADER = struct.Struct("<HBBHHI")
+UDP_AUDIO_MAGIC = 0x4155
+UDP_AUDIO_VERSION = 1
+UDP_AUDIO_FRAME_SAMPLES = SAMPLE_RATE * 16 // 1000  # 每包样本数 (16ms)
+UDP_REPLY_PREBUFFER = 4  # 下行语音开头连续发送的包数，其余按实时速率发送
+REPLY_UDP_STREAM = 0xFFFFFFFD  # 下行语音头部: 后跟4字节总字节数，语音在文本之后通过 UDP 发送
+
+
+class UdpAudioReceiver:
+    """
+    在后台线程中接收 ESP32 通过 UDP 上传的语音包，按语音段编号分组。
+    一段语音结束 (TCP 收到结束信号) 后按时间戳重排，丢失的部分用前一包逐包衰减重复隐藏。
+    """
+
+    def __init__(self, port, grace=0.15):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("0.0.0.0", port))
+        self.grace = grace  # 结束信号之后继续等待迟到包的时间 (秒)
+        self.lock = threading.Lock()
+        self.stream = None  # 当前语音段编号
+        self.packets = {}  # 时间戳 -> PCM 字节
+        self.last_seq = None
+        self.reordered = 0
+        self.duplicates = 0
+        threading.Thread(target=self._run, daemon=True).start()
+        print(f"UDP audio receiver on port {port}")
+
+    def _run(self):
+        while True:
+            packet, _ = self.sock.recvfrom(2048)
+            if len(packet) < UDP_AUDIO_HEADER.size:
+                continue
+            magic, version, stream, seq, samples, timestamp = UDP_AUDIO_HEADER.unpack_from(packet)
+            pcm = packet[UDP_AUDIO_HEADER.size:]
+            if magic != UDP_AUDIO_MAGIC or version != UDP_AUDIO_VERSION or len(pcm) != samples * 2:
+                continue
+            with self.lock:
+                if stream != self.stream:
+                    # 新的一段语音，丢弃上一段未取走的包
+                    self.stream = stream
+                    self.packets = {}
+                    self.last_seq = None
+                    self.reordered = 0
+                    self.duplicates = 0
+                if timestamp in self.packets:
+                    self.duplicates += 1
+                    continue
+                if self.last_seq is not None and (seq - self.last_seq) & 0xFFFF > 0x8000:
+                    self.reordered += 1
+                else:
+                    self.last_seq = seq
+                self.packets[timestamp] = pcm
+
+    def take_utterance(self):
+        """
+        取出当前语音段并组装为连续的 PCM 数据。
+
+        Returns:
+            bytearray: 按时间戳还原的 PCM 数据，丢包处已隐藏。
+        """
+        time.sleep(self.grace)
+        with self.lock:
+            packets, self.packets = self.packets, {}
+            reordered, duplicates = self.reordered, self.duplicates
+        pcm = bytearray()
+        last = None
+        run = 0
+        concealed = 0
+        for timestamp in sorted(packets):
+            missing = timestamp - len(pcm) // 2
+            while missing > 0:
+                # 丢失的部分: 重复上一包并逐包减半，连续4包后为静音
+                run += 1
+                count = min(missing, UDP_AUDIO_FRAME_SAMPLES)
+                if last is not None and run <= 4:
+                    fill = (np.frombuffer(last, dtype=np.int16)[:count] >> run).astype(np.int16)
+                    fill = np.pad(fill, (0, count - len(fill)))
+                    pcm.extend(fill.tobytes())
+                else:
+                    pcm.extend(bytes(count * 2))
+                missing -= count
+                concealed += count
+            pcm.extend(packets[timestamp])
+            last = packets[timestamp]
+            run = 0
+        print(
+            f"UDP 上行: {len(packets)} 包, 乱序 {reordered}, 重复 {duplicates}, "
+            f"隐藏 {concealed * 1000 / SAMPLE_RATE:.0f} ms / {len(pcm) / 2 * 1000 / SAMPLE_RATE:.0f} ms"
+        )
+        return pcm
+
+
+def send_reply_udp(client_socket, udp_socket, reply_voice, reply):
+    """
+    通过 TCP 发送语音长度和文本，语音随后以 UDP 包按实时速率发送给 ESP32 (由其抖动缓冲播放)。
+
+    Args:
+        client_socket (socket.socket): 与 ESP32 客户端的 socket 连接。
+        udp_socket (socket.socket): 发送语音包的 UDP socket。
+        reply_voice (bytes): PCM 格式的回复语音数据。
+        reply (str): 回复的文本内容。
+    """
+    client_socket.sendall(REPLY_UDP_STREAM.to_bytes(4, byteorder="little"))
+    client_socket.sendall(len(reply_voice).to_bytes(4, byteorder="little"))
+    reply_bytes = reply.encode("utf-8")
+    client_socket.sendall(len(reply_bytes).to_bytes(4, byteorder="little"))
+    client_socket.sendall(reply_bytes)
+
+    global udp_reply_stream
+    udp_reply_stream = (udp_reply_stream + 1) & 0xFF
+    address = (client_socket.getpeername()[0], config["udp_audio"]["port"])
+    frame_bytes = UDP_AUDIO_FRAME_SAMPLES * 2
+    frame_seconds = UDP_AUDIO_FRAME_SAMPLES / SAMPLE_RATE
+    start = time.monotonic()
+    for seq, offset in enumerate(range(0, len(reply_voice), frame_bytes)):
+        # 最后一包补齐到整包，ESP32 的抖动缓冲只接受固定长度的包
+        pcm = reply_voice[offset:offset + frame_bytes].ljust(frame_bytes, b"\0")
+        header = UDP_AUDIO_HEADER.pack(
+            UDP_AUDIO_MAGIC, UDP_AUDIO_VERSION, udp_reply_stream, seq & 0xFFFF, UDP_AUDIO_FRAME_SAMPLES, offset // 2
+        )
+        udp_socket.sendto(header + pcm, address)
+        # ESP32 的 UDP 接收队列很短，开头几包之后按播放速率发送
+        delay = start + (seq + 1 - UDP_REPLY_PREBUFFER) * frame_seconds - time.monotonic()
+        if delay > 0:
+            time.sleep(delay)
+    print(f"UDP 下行: {(len(reply_voice) + frame_bytes - 1) // frame_bytes} 包")
+
+
+udp_reply_stream = 0  # 下行语音段编号
+
+
 # 情绪到 Arduino 控制指令的映射
 emotion_dir = {
+    "neutral": 0x10,
     "happiness": 0x11,
     "sadness": 0x12,
-    "anger": 0x12,  # 注意：anger 和 sadness 映射到相同的值
-    "fear": 0x13,
-    "disgust": 0x10,
-    "surprise": 0x13, # 注意：surprise 和 fear 映射到相同的值
-    "neutral": 0x10,  # 注意：neutral 和 disgust 映射到相同的值
+    "surprise": 0x13,
+    "anger": 0x14,
+    "fear": 0x15,
+    "disgust": 0x16,
 }
 
 
@@ -431,6 +692,238 @@ def map_value(value, from_min, from_max, to_min, to_max):
     return int(val)
 
 
+MOTION_ACK_FLAG = 0x80  # Arduino 执行完指令后回传的确认帧中，指令字节 | 0x80
+MOTION_SYNC = 0xA5  # 串口协议v2的帧头: SYNC | LEN | SEQ | OPCODE | PAYLOAD[LEN] | CRC8
+MOTION_STATUS = {0: "done", 1: "superseded", 2: "rejected"}  # 确认帧负载的第一个字节
+
+
+def crc8(data, crc=0):
+    """串口协议v2的校验 (CRC-8，多项式 0x07)，与 Servo Control/lib/SerialLink 相同。"""
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x07) & 0xFF if crc & 0x80 else (crc << 1) & 0xFF
+    return crc
+
+
+# 关键帧轨道 (与 Servo Control/lib/Timeline 对应): 回复语音的口型预先按轨道时间发给 Arduino，由 Arduino 按同步的时钟播放
+TL_SYNC = 0x40
+TL_KEYFRAME = 0x41
+TL_END = 0x42
+TIMELINE_SLOTS = 16  # Arduino 的关键帧缓冲区大小
+STATS_QUERY = 0x50  # 查询 Arduino 的运行时统计，负载为 1 时读取后清零
+# 回复负载 (状态字节之后) 的字段，与 serial_link.h 中的 LinkStats 相同
+STATS_FORMAT = "<IIHHHHHHBHHHHH"
+STATS_FIELDS = (
+    "uptime_ms", "loops", "loop_min_us", "loop_mean_us", "loop_max_us", "commands", "cmd_lat_mean_us",
+    "cmd_lat_max_us", "rx_high_water", "rx_errors", "i2c_frames", "i2c_bytes_mean", "i2c_us_mean", "i2c_us_max",
+)
+LIP_SYNC_FRAME_MS = 80  # 口型关键帧的间隔
+JAW_SERVO = 17  # 嘴部舵机序号 (face_pose.h 中的 SERVO_JAW)
+JAW_CLOSED = 80
+JAW_OPEN = 120
+JAW_SPEED = 150  # 嘴部角速度，单位 4 度/秒
+
+
+def lip_sync_track(pcm):
+    """
+    按回复语音每帧的能量生成嘴部关键帧。
+
+    Args:
+        pcm (bytes): PCM S16LE 回复语音。
+
+    Returns:
+        list: [(轨道时间 ms, 嘴部角度)]，角度变化很小的帧被省略，最后一帧闭嘴。
+    """
+    samples = np.frombuffer(pcm, dtype=np.int16).astype(np.float32)
+    frame = SAMPLE_RATE * LIP_SYNC_FRAME_MS // 1000
+    count = len(samples) // frame
+    if count == 0:
+        return []
+    rms = np.sqrt(np.mean(samples[:count * frame].reshape(count, frame) ** 2, axis=1))
+    level = np.clip(rms / (np.percentile(rms, 95) + 1e-6), 0, 1)  # 按本句的响度归一化
+    track = []
+    last = JAW_CLOSED
+    for i, value in enumerate(level):
+        angle = int(JAW_CLOSED + value * (JAW_OPEN - JAW_CLOSED))
+        if abs(angle - last) >= 4:
+            track.append((i * LIP_SYNC_FRAME_MS, angle))
+            last = angle
+    track.append((count * LIP_SYNC_FRAME_MS, JAW_CLOSED))
+    return track
+
+
+def encode_frame(seq, opcode, payload=b""):
+    """编码一帧串口指令，seq 为 0 表示不需要确认。"""
+    body = bytes([len(payload), seq, opcode]) + payload
+    return bytes([MOTION_SYNC]) + body + bytes([crc8(body)])
+
+REPLY_MOTION = 0xFFFFFFFC  # 下行头部: 后跟1字节长度和一条舵机指令 (ESP32 直接驱动舵机时)
+
+
+class SerialMotion:
+    """
+    通过串口 (协议v2的帧) 把表情指令发给 Arduino。
+    每条指令带一个序号，后台线程解析 Arduino 的确认帧并按序号匹配，统计写入到确认的延迟
+    (包含串口传输和 Arduino 把所有舵机移动到位的时间)。
+    启用口型同步时，回复语音的嘴部动作作为关键帧轨道流式发送，代替固定节奏的说话动画。
+    """
+
+    def __init__(self, serial_connection, lip_sync=False, lip_sync_delay_ms=0):
+        self.serial = serial_connection
+        self.lip_sync = lip_sync
+        self.lip_sync_delay_ms = lip_sync_delay_ms  # 发送回复到 ESP32 开始播放的估计延迟
+        self.track_thread = None
+        self.track_start = 0
+        self.lock = threading.Lock()
+        self.seq = 0
+        self.pending = {}  # 序号 -> 写入时间 (序号循环使用，最多255条)
+        self.latencies = []
+        self.rejected = 0
+        self.device_stats = None  # 最近一次查询到的 Arduino 统计
+        threading.Thread(target=self._run, daemon=True).start()
+
+    def _read_frame(self):
+        """读取一个确认帧，返回 (序号, 指令, 负载)；超时或校验失败返回 None。"""
+        data = self.serial.read(1)
+        if not data or data[0] != MOTION_SYNC:
+            return None  # 读取超时或 Arduino 的启动文本、统计行
+        header = self.serial.read(3)
+        if len(header) < 3:
+            return None
+        length, seq, opcode = header
+        rest = self.serial.read(length + 1)
+        if len(rest) < length + 1 or crc8(header + rest[:length]) != rest[length]:
+            return None
+        return seq, opcode, rest[:length]
+
+    def _run(self):
+        while True:
+            try:
+                frame = self._read_frame()
+            except Exception:
+                return  # 串口已关闭
+            if frame is None:
+                continue
+            seq, opcode, payload = frame
+            if not opcode & MOTION_ACK_FLAG:
+                continue
+            now = time.monotonic()
+            status = MOTION_STATUS.get(payload[0] if payload else 0, "done")
+            with self.lock:
+                start = self.pending.pop(seq, None)
+                if opcode == STATS_QUERY | MOTION_ACK_FLAG:
+                    # 统计查询不计入指令延迟
+                    if len(payload) == 1 + struct.calcsize(STATS_FORMAT):
+                        self.device_stats = dict(zip(STATS_FIELDS, struct.unpack(STATS_FORMAT, payload[1:])))
+                    continue
+                if start is None:
+                    continue
+                if status == "rejected":
+                    self.rejected += 1
+                else:
+                    self.latencies.append(now - start)
+
+    def send(self, command, ack=True):
+        """发送一条指令 (首字节为指令，其余为负载)，ack 为 True 时请求确认并统计延迟。"""
+        seq = 0
+        if ack:
+            with self.lock:
+                self.seq = self.seq % 255 + 1  # 序号 1~255，0 表示不需要确认
+                self.pending[self.seq] = time.monotonic()
+                seq = self.seq
+        self.serial.write(encode_frame(seq, command[0], command[1:]))
+
+    def _track_ms(self):
+        return int((time.monotonic() - self.track_start) * 1000) & 0xFFFFFFFF  # 开始播放前为负数，按模 2^32 发送
+
+    def _play_track(self, track):
+        """同步轨道时钟，然后按轨道进度补充关键帧，Arduino 缓冲区中最多 TIMELINE_SLOTS 个。"""
+        self.send(bytes([TL_SYNC]) + struct.pack("<I", self._track_ms()), ack=False)
+        last_sync = time.monotonic()
+        for i, (t, angle) in enumerate(track):
+            if i >= TIMELINE_SLOTS:
+                # 等第 i - TIMELINE_SLOTS 个关键帧播放后 (留出两个节拍的余量) 再发送，避免缓冲区溢出
+                wait = self.track_start + (track[i - TIMELINE_SLOTS][0] + 40) / 1000 - time.monotonic()
+                if wait > 0:
+                    time.sleep(wait)
+            if time.monotonic() - last_sync >= 1:
+                # 定期重新同步，校正 Arduino 时钟的漂移
+                self.send(bytes([TL_SYNC]) + struct.pack("<I", self._track_ms()), ack=False)
+                last_sync = time.monotonic()
+            self.send(bytes([TL_KEYFRAME]) + struct.pack("<IB", t, JAW_SPEED) + bytes([JAW_SERVO, angle]), ack=False)
+        self.send(bytes([TL_END, 0]), ack=False)  # 播放完已缓冲的关键帧后结束
+
+    def before_reply(self, reply_voice=None):
+        """启用口型同步时，在发送回复语音的同时开始流式发送嘴部关键帧。"""
+        if not self.lip_sync or not reply_voice:
+            return
+        self.track_start = time.monotonic() + self.lip_sync_delay_ms / 1000
+        self.track_thread = threading.Thread(target=self._play_track, args=(lip_sync_track(reply_voice),), daemon=True)
+        self.track_thread.start()
+
+    def after_reply(self, duration_ms):
+        """回复发送完后开始说话，按估计的语音时长等待，然后闭嘴并恢复默认表情。"""
+        if self.track_thread is not None:
+            # 口型由关键帧轨道驱动: 等轨道发送完、语音播放结束后恢复默认表情
+            self.track_thread.join()
+            self.track_thread = None
+            time.sleep(max(0, self.track_start + duration_ms / 1000 - time.monotonic()))
+            self.send(bytes([0x10]))  # 默认表情指令
+            return
+        self.send(bytes([0x21]))  # 开始说话指令
+        time.sleep(duration_ms / 1000)  # 等待语音播放
+        self.send(bytes([0x22]))  # 结束说话指令
+        print("说话完成")
+        self.send(bytes([0x10]))  # 默认表情指令
+
+    def summary(self):
+        """返回并清空本轮的指令延迟统计，附上一轮结束时查询到的 Arduino 统计，并为本轮查询一次 (读取后清零)。"""
+        with self.lock:
+            latencies, self.latencies = self.latencies, []
+            rejected, self.rejected = self.rejected, 0
+            stats, self.device_stats = self.device_stats, None
+        self.send(bytes([STATS_QUERY, 1]))
+        if not latencies:
+            text = f"表情指令: 无确认, 拒绝 {rejected} 条"
+        else:
+            text = (
+                f"表情指令: {len(latencies)} 条确认, 写入到确认平均 {sum(latencies) / len(latencies) * 1000:.0f} ms, "
+                f"最大 {max(latencies) * 1000:.0f} ms, 拒绝 {rejected} 条"
+            )
+        if stats:
+            text += (
+                f"\nArduino: loop {stats['loop_min_us']}/{stats['loop_mean_us']}/{stats['loop_max_us']} us, "
+                f"指令到舵机平均 {stats['cmd_lat_mean_us'] / 1000:.1f} ms 最大 {stats['cmd_lat_max_us'] / 1000:.1f} ms "
+                f"({stats['commands']} 条), 接收缓冲区最高 {stats['rx_high_water']} 字节, 错误帧 {stats['rx_errors']}, "
+                f"I2C 每帧 {stats['i2c_bytes_mean']} 字节 {stats['i2c_us_mean']}/{stats['i2c_us_max']} us"
+            )
+        return text
+
+
+class InbandMotion:
+    """
+    ESP32 直接驱动舵机时，表情指令通过 TCP 在回复语音头部之前发送。
+    嘴部动画在 ESP32 实际开始播放时启动，播放结束时由 ESP32 闭嘴并恢复自然表情；
+    指令到动作的延迟由 ESP32 测量并输出到串口。
+    """
+
+    def __init__(self, client_socket):
+        self.client_socket = client_socket
+
+    def send(self, command):
+        self.client_socket.sendall(REPLY_MOTION.to_bytes(4, byteorder="little") + bytes([len(command)]) + command)
+
+    def before_reply(self, reply_voice=None):
+        self.send(bytes([0x21]))  # 开始说话指令，ESP32 在播放开始时执行
+
+    def after_reply(self, duration_ms):
+        pass
+
+    def summary(self):
+        return None
+
+
 def main():
     """
     主函数，运行整个交互流程。
@@ -440,13 +933,23 @@ def main():
     if client_socket is None:
         print("Failed to connect to ESP32. Exiting.")
         return
-    # 连接 Arduino
-    arduino_serial = arduino_connect()
-    if arduino_serial is None:
-        print("Failed to connect to Arduino. Exiting.")
-        if client_socket:
-            client_socket.close()
-        return
+    # 连接 Arduino (ESP32 直接驱动舵机时不需要)
+    arduino_serial = None
+    if not config["motion"]["direct"]:
+        arduino_serial = arduino_connect()
+        if arduino_serial is None:
+            print("Failed to connect to Arduino. Exiting.")
+            if client_socket:
+                client_socket.close()
+            return
+    if arduino_serial is not None:
+        motion = SerialMotion(
+            arduino_serial,
+            lip_sync=config["motion"].get("lip_sync", False),
+            lip_sync_delay_ms=config["motion"].get("lip_sync_delay_ms", 0),
+        )
+    else:
+        motion = InbandMotion(client_socket)
     # 连接 SenseVoice ASR 服务器
     client_socket_sensevoice = connect_sensevoice()
     if client_socket_sensevoice is None:
@@ -457,18 +960,25 @@ def main():
             arduino_serial.close()
         return
 
+    # 可选的 UDP 音频传输: 语音走 UDP，控制信号和文本仍走 TCP
+    udp_receiver = None
+    udp_socket = None
+    if config["udp_audio"]["enabled"]:
+        udp_receiver = UdpAudioReceiver(config["udp_audio"]["port"])
+        udp_socket = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+
     try:
         while True:
             # 1. 从 ESP32 接收音频样本
-            receive_sample(client_socket)
-
-            # 2. 控制 Arduino 进入聆听状态 (示例性控制，具体含义需参考 Arduino 代码)
-            arduino_serial.write(0x02.to_bytes(1, byteorder="little")) # 指令头
-            arduino_serial.write(
-                map_value(1, -1, 1, 80, 120).to_bytes(1, byteorder="little") # 舵机1角度
-            )
-            arduino_serial.write(
-                map_value(0, -1, 1, 160, 180).to_bytes(1, byteorder="little") # 舵机2角度
+            receive_sample(client_socket, udp_receiver=udp_receiver)
+
+            # 2. 控制表情进入聆听状态 (示例性控制，具体含义需参考 Arduino 代码)
+            motion.send(
+                bytes([
+                    0x02,  # 指令头
+                    map_value(1, -1, 1, 80, 120),  # 舵机1角度
+                    map_value(0, -1, 1, 160, 180),  # 舵机2角度
+                ])
             )
 
             # 3. 语音转文本
@@ -478,38 +988,58 @@ def main():
             # 4. LLM 处理文本，生成回复和情绪
             reply, emotion, language = llm_process(text)
 
-            # 5. 根据情绪控制 Arduino 表情 (示例性控制)
+            # 5. 根据情绪控制表情 (示例性控制)
             emotion_value = emotion_dir.get(emotion, emotion_dir["neutral"]) # 如果情绪不存在，默认为 neutral
-            arduino_serial.write(0x02.to_bytes(1, byteorder="little")) # 指令头
-            arduino_serial.write(
-                map_value(0, -1, 1, 60, 100).to_bytes(1, byteorder="little") # 舵机1角度
-            )
-            arduino_serial.write(
-                map_value(0, -1, 1, 160, 180).to_bytes(1, byteorder="little") # 舵机2角度
+            motion.send(
+                bytes([
+                    0x02,  # 指令头
+                    map_value(0, -1, 1, 60, 100),  # 舵机1角度
+                    map_value(0, -1, 1, 160, 180),  # 舵机2角度
+                ])
             )
-            arduino_serial.write(emotion_value.to_bytes(1, byteorder="little")) # 情绪指令
-
-            # 6. 文本转语音
-            reply_voice = tts_process(text=reply, language=language)
+            motion.send(bytes([emotion_value]))  # 情绪指令
+
+            # 6. 文本转语音 (优先使用服务器端缓存，跳过 TTS 和 ffmpeg)
+            cache_key = None
+            reply_voice = None
+            if config["reply_cache"]["enabled"]:
+                cache_key = reply_cache_key(reply, language)
+                reply_voice = load_cached_pcm(cache_key)
+            cached_on_server = reply_voice is not None  # 之前的轮次已发送过, ESP32 可能已缓存
+            device_cache_key = cache_key if cached_on_server else None
+            if reply_voice is None:
+                reply_voice = tts_process(text=reply, language=language)
+                if cache_key is not None and reply_cache_eligible(reply, cache_key):
+                    save_cached_pcm(cache_key, reply_voice)
+                    device_cache_key = cache_key  # 新缓存的语音随本次回复发给 ESP32 保存
             print(f"回复语音长度: {len(reply_voice)}")
 
             # 7. 计算语音时长
-            duration_ms = len(reply_voice) / 2 / 16000 * 1000 # PCM S16LE 每个采样点2字节，采样率16000Hz
-
-            # 8. 向 ESP32 发送回复语音和文本
-            send_reply(client_socket, reply_voice, reply)
+            duration_ms = len(reply_voice) / 2 / SAMPLE_RATE * 1000 # PCM S16LE 每个采样点2字节
+
+            # 8. 向 ESP32 发送回复语音和文本 (可缓存的回复先尝试让 ESP32 从 Flash 播放)
+            motion.before_reply(reply_voice)
+            if cached_on_server and send_cached_reply(client_socket, cache_key, reply_voice, reply):
+                print("ESP32 缓存命中")
+            elif udp_socket is not None and device_cache_key is None:
+                send_reply_udp(client_socket, udp_socket, reply_voice, reply)
+            else:
+                send_reply(client_socket, reply_voice, reply, device_cache_key)
+            if cache_key is not None and reply_cache_stats["lookups"] > 0:
+                print(
+                    f"回复缓存: 命中率 {reply_cache_stats['hits'] / reply_cache_stats['lookups']:.0%}, "
+                    f"节省 {reply_cache_stats['bytes_saved'] / 1024:.0f} KB"
+                )
             print("回复语音发送完成")
 
-            # 9. 控制 Arduino 进入说话状态并等待语音播放完毕
-            arduino_serial.write(0x21.to_bytes(1, byteorder="little")) # 开始说话指令
-            time.sleep(duration_ms / 1000) # 等待语音播放
-            arduino_serial.write(0x22.to_bytes(1, byteorder="little")) # 结束说话指令
-            print("说话完成")
-
-            # 10. 控制 Arduino 恢复默认表情
-            arduino_serial.write(0x10.to_bytes(1, byteorder="little")) # 默认表情指令
+            # 9. 进入说话状态，播放完毕后恢复默认表情 (直接驱动时由 ESP32 按实际播放进度执行)
+            motion.after_reply(duration_ms)
 
+            # 10. 输出表情指令延迟
             print(f"发送情绪: {emotion_value}")
+            motion_summary = motion.summary()
+            if motion_summary:
+                print(motion_summary)
 
     except KeyboardInterrupt:
         print("Server shutting down...")
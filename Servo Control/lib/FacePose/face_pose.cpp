@@ -0,0 +1,106 @@
+#include "face_pose.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+// 主机端测试: 数据直接放在内存中
+#include <string.h>
+#define PROGMEM
+#define memcpy_P memcpy
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+// 角度到tick的查找表，编译期生成并放在Flash中 (382字节)
+struct TickTable
+{
+  uint16_t ticks[SERVO_ANGLE_MAX + 1];
+};
+
+static constexpr TickTable make_tick_table()
+{
+  TickTable table = {};
+  for (uint16_t angle = 0; angle <= SERVO_ANGLE_MAX; angle++)
+  {
+    table.ticks[angle] = sg90_ticks(angle);
+  }
+  return table;
+}
+
+static_assert(make_tick_table().ticks[0] == 102, "0度对应500微秒");
+static_assert(make_tick_table().ticks[180] == 512, "180度对应2500微秒");
+
+static const TickTable tick_table PROGMEM = make_tick_table();
+
+// 舵机安装位置和行程 (行程和方向来自原各表情函数中的注释)
+static const ServoConfig servo_configs[SERVO_COUNT] PROGMEM = {
+    // --- PCA1 (0x40) 控制的舵机: 眼部和眉毛 ---
+    {0, 4, 60, 100, 0},  // 眼球左右, 60: 向左, 100: 向右
+    {0, 5, 160, 180, 0}, // 眼球上下, 160: 向下, 180: 向上
+    {0, 6, 95, 170, 0},  // 左上眼皮, 95: 向下(闭合), 170: 向上(张开)
+    {0, 7, 55, 95, 0},   // 左下眼皮, 55: 向下(张开), 95: 向上(闭合)
+    {0, 8, 0, 70, 0},    // 右上眼皮, 0: 向上(张开), 70: 向下(闭合)
+    {0, 9, 90, 130, 0},  // 右下眼皮, 90: 向上(闭合), 130: 向下(张开)
+    {0, 12, 0, 50, 0},   // 左侧正眉毛, 0: 向上, 50: 向下
+    {0, 13, 0, 60, 0},   // 左侧斜眉毛, 0: 向下, 60: 向上
+    {0, 14, 0, 30, 0},   // 右侧正眉毛, 0: 向下, 30: 向上
+    {0, 15, 0, 60, 0},   // 右侧斜眉毛, 0: 向上, 60: 向下
+    // --- PCA2 (0x41) 控制的舵机: 嘴部 ---
+    {1, 6, 70, 140, 0},  // 左下嘴, 70: 向下, 140: 向上
+    {1, 7, 0, 70, 0},    // 右下嘴, 0: 向上, 70: 向下
+    {1, 9, 150, 190, 0}, // 左上嘴, 150: 向下, 190: 向上
+    {1, 10, 150, 180, 0}, // 右中嘴(upper), 150: 向上, 180: 向下
+    {1, 11, 150, 190, 0}, // 左中嘴(upper), 150: 向下, 190: 向上
+    {1, 12, 0, 40, 0},   // 右上嘴, 0: 向上, 40: 向下
+    {1, 13, 60, 100, 0}, // 右中嘴(low), 60: 向上, 100: 向下
+    {1, 14, 80, 130, 0}, // 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
+    {1, 15, 140, 180, 0}, // 左中嘴(low), 140: 向下, 180: 向上
+};
+
+// 表情表: 每行一个表情，列顺序同 servo_configs
+static const uint8_t face_poses[POSE_COUNT][SERVO_COUNT] PROGMEM = {
+    //  眼球     眼皮               眉毛              嘴部
+    {80, 170, 120, 60, 30, 125, 25, 30, 15, 30, 110, 35, 180, 150, 180, 20, 90, 80, 140},   // 自然
+    {80, 180, 150, 55, 20, 130, 0, 60, 30, 0, 140, 0, 190, 150, 190, 0, 60, 120, 180},      // 开心: 眼睛向上看，眉毛上扬，嘴角上扬
+    {80, 160, 100, 90, 60, 95, 50, 10, 0, 50, 70, 70, 150, 180, 150, 40, 100, 90, 140},     // 伤心: 眼睛向下看，眼皮下垂，眉毛呈八字，嘴角向下
+    {80, 180, 170, 55, 0, 130, 0, 60, 30, 0, 100, 40, 170, 165, 170, 20, 80, 130, 160},     // 惊讶: 眼皮完全张开，眉毛高扬，嘴巴O型张开
+    {80, 170, 110, 75, 50, 110, 50, 0, 0, 60, 80, 60, 165, 170, 165, 35, 95, 80, 145},      // 愤怒: 眯眼，眉毛内侧压低，嘴角向下，咬紧
+    {65, 175, 165, 55, 5, 128, 10, 45, 25, 15, 85, 55, 165, 160, 165, 30, 85, 95, 150},     // 害怕: 眼睛睁大并看向一侧，眉毛内侧上扬，嘴巴微张
+    {80, 165, 130, 75, 40, 115, 40, 20, 5, 40, 90, 50, 190, 175, 185, 0, 95, 85, 145},      // 厌恶: 眯眼，眉毛压低，上唇一侧上提
+};
+
+// 闭眼: 左上眼皮向下、左下眼皮向上、右上眼皮向下、右下眼皮向上
+static const uint8_t lids_closed[SERVO_LID_COUNT] PROGMEM = {95, 95, 70, 90};
+
+ServoConfig servo_config(uint8_t servo)
+{
+  ServoConfig config;
+  memcpy_P(&config, &servo_configs[servo], sizeof(config));
+  return config;
+}
+
+uint8_t pose_angle(uint8_t pose, uint8_t servo)
+{
+  return pgm_read_byte(&face_poses[pose][servo]);
+}
+
+uint8_t lid_closed_angle(uint8_t lid)
+{
+  return pgm_read_byte(&lids_closed[lid]);
+}
+
+uint16_t servo_ticks(uint8_t servo, uint8_t angle)
+{
+  uint8_t min = pgm_read_byte(&servo_configs[servo].min);
+  uint8_t max = pgm_read_byte(&servo_configs[servo].max);
+  int8_t trim = (int8_t)pgm_read_byte(&servo_configs[servo].trim);
+  if (angle < min)
+  {
+    angle = min;
+  }
+  if (angle > max)
+  {
+    angle = max;
+  }
+  return (uint16_t)((int16_t)pgm_read_word(&tick_table.ticks[angle]) + trim);
+}
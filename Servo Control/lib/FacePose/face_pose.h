@@ -0,0 +1,55 @@
+#ifndef FACE_POSE_H
+#define FACE_POSE_H
+
+#include <stdint.h>
+
+#define SG90_MIN 500  // SG90舵机最小脉冲宽度 (微秒)
+#define SG90_MAX 2500 // SG90舵机最大脉冲宽度 (微秒)
+#define SG90_FREQ 50  // SG90舵机PWM频率 (Hz)
+#define SERVO_ANGLE_MAX 190 // 查找表覆盖的最大角度 (部分嘴部舵机的行程超过180度)
+
+// 舵机序号 (表情表中的列)，板号和通道见 face_pose.cpp 中的 servo_configs
+#define SERVO_EYE_X 0     // 眼球左右
+#define SERVO_EYE_Y 1     // 眼球上下
+#define SERVO_LID_FIRST 2 // 四个眼皮舵机的第一个 (左上、左下、右上、右下)
+#define SERVO_LID_COUNT 4
+#define SERVO_JAW 17      // 嘴张闭
+#define SERVO_COUNT 19
+
+// 表情 (串口指令 0x10 + 表情序号)
+enum FacePose
+{
+  POSE_NEUTRAL,
+  POSE_HAPPINESS,
+  POSE_SADNESS,
+  POSE_SURPRISE,
+  POSE_ANGER,
+  POSE_FEAR,
+  POSE_DISGUST,
+  POSE_COUNT,
+};
+
+// 单个舵机的安装位置和校准: 角度先限制在[min, max]内，换算为tick后再加上trim
+struct ServoConfig
+{
+  uint8_t board;   // 0: PCA9685 0x40, 1: PCA9685 0x41
+  uint8_t channel; // 通道 (0-15)
+  uint8_t min;     // 机械行程下限 (度)
+  uint8_t max;     // 机械行程上限 (度)
+  int8_t trim;     // 零点微调 (tick，1 tick约4.9微秒)
+};
+
+// 以下数据都在PROGMEM中，通过这些函数读取
+ServoConfig servo_config(uint8_t servo);
+uint8_t pose_angle(uint8_t pose, uint8_t servo);
+uint8_t lid_closed_angle(uint8_t lid); // 闭眼时眼皮的角度 (lid: 0~3)
+// 角度换算为PCA9685的OFF tick: 校准限位、整数查找表、trim，没有浮点运算
+uint16_t servo_ticks(uint8_t servo, uint8_t angle);
+
+// 与原 setSG90Angle 相同的换算 (map()后乘以 SG90_FREQ * 4096 / 1000000)，但全部为整数运算
+constexpr uint16_t sg90_ticks(uint16_t angle)
+{
+  return (uint16_t)(((uint32_t)angle * (SG90_MAX - SG90_MIN) / 180 + SG90_MIN) * SG90_FREQ * 4096UL / 1000000UL);
+}
+
+#endif // FACE_POSE_H
@@ -0,0 +1,34 @@
+#include "gaze_filter.h"
+
+// 半隐式欧拉: v += (w^2 * (target - x) - 2w * v) * dt; x += v * dt，系数在编译期换算为定点
+static constexpr float GAZE_DT = GAZE_FILTER_DT_MS / 1000.0f;
+static constexpr int32_t GAZE_K_POS = (int32_t)(GAZE_OMEGA * GAZE_OMEGA * GAZE_DT * 256 + 0.5f); // Q8
+static constexpr int32_t GAZE_K_VEL = (int32_t)(2 * GAZE_OMEGA * GAZE_DT * 256 + 0.5f);          // Q8
+static constexpr int32_t GAZE_DT_Q16 = (int32_t)(GAZE_DT * 65536 + 0.5f);
+static_assert(GAZE_OMEGA * GAZE_DT < 0.5f, "GAZE_OMEGA too high for the step size");
+
+void GazeFilter::reset(uint8_t angle)
+{
+  pos_ = target_ = (int32_t)angle << 8;
+  vel_ = 0;
+}
+
+// 带四舍五入的算术右移 (负数也向最近的整数舍入，避免在目标附近留下固定偏差)
+static int32_t round_shift(int32_t value, uint8_t shift)
+{
+  return (value + ((int32_t)1 << (shift - 1))) >> shift;
+}
+
+uint8_t GazeFilter::step()
+{
+  vel_ += round_shift(GAZE_K_POS * (target_ - pos_) - GAZE_K_VEL * vel_, 8);
+  pos_ += round_shift(vel_ * GAZE_DT_Q16, 16);
+  int32_t angle = round_shift(pos_, 8);
+  return angle < 0 ? 0 : angle > 255 ? 255 : (uint8_t)angle;
+}
+
+bool GazeFilter::settled() const
+{
+  int32_t error = target_ - pos_;
+  return error > -64 && error < 64 && vel_ > -256 && vel_ < 256; // 0.25度、1度/秒
+}
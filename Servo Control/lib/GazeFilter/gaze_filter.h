@@ -0,0 +1,28 @@
+#ifndef GAZE_FILTER_H
+#define GAZE_FILTER_H
+
+#include <stdint.h>
+
+#define GAZE_OMEGA 15.0f    // 滤波器的自然角频率 (rad/s)，阶跃输入约0.3秒到位
+#define GAZE_FILTER_DT_MS 20 // 每次step()的时间步长 (毫秒)，与运动引擎的节拍相同
+
+// 临界阻尼二阶滤波 (定点Q8，无浮点运算): 目标突变时平滑加速、无过冲地收敛，
+// 高频的注视更新之间眼球连续运动，不会每来一个目标就急停急起
+class GazeFilter
+{
+public:
+  // 从angle静止开始
+  void reset(uint8_t angle);
+  void setTarget(uint8_t angle) { target_ = (int32_t)angle << 8; }
+  // 推进一个时间步长，返回四舍五入后的角度
+  uint8_t step();
+  // 是否已停在目标 (误差和速度都小于阈值)
+  bool settled() const;
+
+private:
+  int32_t pos_ = 0;    // 角度，Q8
+  int32_t vel_ = 0;    // 角速度 (度/秒)，Q8
+  int32_t target_ = 0; // Q8
+};
+
+#endif // GAZE_FILTER_H
@@ -0,0 +1,28 @@
+#ifndef HOST_SIM_ADAFRUIT_PWM_SERVO_DRIVER_H
+#define HOST_SIM_ADAFRUIT_PWM_SERVO_DRIVER_H
+
+#include "Wire.h"
+
+#define PCA9685_MODE1 0x00
+#define PCA9685_PRESCALE 0xFE
+#define PCA9685_LED0_ON_L 0x06
+#define MODE1_SLEEP 0x10
+#define MODE1_AI 0x20
+#define MODE1_RESTART 0x80
+
+// 主机端模拟的Adafruit驱动: 与真实库相同的寄存器写入 (经过模拟的Wire)，因此也出现在I2C记录中
+class Adafruit_PWMServoDriver
+{
+public:
+  Adafruit_PWMServoDriver(uint8_t address = 0x40) : address_(address) {}
+  bool begin();
+  void setPWMFreq(float freq);
+  void setPWM(uint8_t num, uint16_t on, uint16_t off);
+
+private:
+  void write8(uint8_t reg, uint8_t value);
+
+  uint8_t address_;
+};
+
+#endif // HOST_SIM_ADAFRUIT_PWM_SERVO_DRIVER_H
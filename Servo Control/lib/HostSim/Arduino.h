@@ -0,0 +1,55 @@
+#ifndef HOST_SIM_ARDUINO_H
+#define HOST_SIM_ARDUINO_H
+
+// 主机端模拟用的Arduino核心子集 (只在native环境中使用，uno环境通过lib_ignore排除)
+// 时间由虚拟时钟提供，串口的收发按波特率计时，见 host_sim.h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#define memcpy_P memcpy
+
+#define SERIAL_TX_BUFFER_SIZE 64
+#define SERIAL_RX_BUFFER_SIZE 64
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+
+// 串口: 接收的字节由 sim_serial_script() 按时间安排，发送的字节记录下来；
+// 与AVR相同，接收和发送缓冲区各64字节，发送缓冲区满时write()等待 (推进虚拟时钟)
+class HardwareSerial
+{
+public:
+  void begin(unsigned long baud);
+  int available();
+  int read();
+  int availableForWrite();
+  size_t write(uint8_t byte);
+  size_t write(const uint8_t *buffer, size_t size);
+  size_t print(const char *text);
+  size_t print(const __FlashStringHelper *text) { return print(reinterpret_cast<const char *>(text)); }
+  size_t print(int value);
+  size_t print(unsigned int value);
+  size_t print(long value);
+  size_t print(unsigned long value);
+  size_t print(double value, int digits = 2);
+  template <class T>
+  size_t println(T value)
+  {
+    return print(value) + println();
+  }
+  size_t println() { return print("\r\n"); }
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_SIM_ARDUINO_H
@@ -0,0 +1,27 @@
+#ifndef HOST_SIM_WIRE_H
+#define HOST_SIM_WIRE_H
+
+#include "Arduino.h"
+
+#define BUFFER_LENGTH 32 // 与AVR的Wire相同，超出的字节被丢弃
+
+// 主机端模拟的I2C主机: 每次传输连同虚拟时间戳记录下来，并写入模拟的PCA9685寄存器；
+// endTransmission()按总线时钟推进虚拟时钟
+class TwoWire
+{
+public:
+  void begin() {}
+  void setClock(uint32_t clock);
+  void beginTransmission(uint8_t address);
+  size_t write(uint8_t byte);
+  uint8_t endTransmission(bool stop = true);
+
+private:
+  uint8_t address_ = 0;
+  uint8_t buffer_[BUFFER_LENGTH];
+  uint8_t length_ = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_SIM_WIRE_H
@@ -0,0 +1,380 @@
+#include "host_sim.h"
+
+#include <stdio.h>
+
+#include <deque>
+#include <map>
+
+#include "Adafruit_PWMServoDriver.h"
+#include "Arduino.h"
+#include "Wire.h"
+
+#define PCA9685_OSC_HZ 25000000
+
+HardwareSerial Serial;
+TwoWire Wire;
+
+static uint64_t now_us = 0;
+static uint32_t loop_us = 20;
+static uint64_t loop_max_us = 0;
+
+// 串口
+struct SerialChunk
+{
+  uint64_t at_us;
+  std::vector<uint8_t> bytes;
+  size_t index;
+};
+static uint32_t baud = 9600;
+static std::deque<SerialChunk> rx_script;
+static std::deque<uint8_t> rx_buffer;
+static uint64_t rx_line_free_us = 0; // 上一个字节在线路上传输完的时间
+static uint32_t rx_overruns = 0;
+static std::vector<SimSerialByte> tx_log;
+static uint64_t tx_done_us = 0; // 发送缓冲区中的字节全部发出的时间
+
+// I2C
+static uint32_t i2c_clock = 100000; // Wire的默认时钟
+static uint32_t i2c_overflows = 0;
+static std::vector<SimI2cWrite> i2c_log;
+struct PcaModel
+{
+  uint8_t regs[256];
+  PcaModel()
+  {
+    memset(regs, 0, sizeof(regs));
+    regs[PCA9685_MODE1] = 0x11; // 上电时: SLEEP | ALLCALL
+  }
+};
+static std::map<uint8_t, PcaModel> pca;
+
+static uint64_t byte_us()
+{
+  return 10000000ULL / baud; // 8N1: 每字节10位
+}
+
+uint64_t sim_now_us()
+{
+  return now_us;
+}
+
+void sim_advance_us(uint64_t us)
+{
+  now_us += us;
+}
+
+void sim_set_loop_us(uint32_t us)
+{
+  loop_us = us;
+}
+
+void sim_run_until(uint64_t end_us, void (*loop_fn)())
+{
+  loop_max_us = 0;
+  uint64_t last_start = now_us;
+  bool first = true;
+  while (now_us < end_us)
+  {
+    if (!first && now_us - last_start > loop_max_us)
+    {
+      loop_max_us = now_us - last_start;
+    }
+    first = false;
+    last_start = now_us;
+    loop_fn();
+    now_us += loop_us;
+  }
+}
+
+uint64_t sim_loop_max_us()
+{
+  return loop_max_us;
+}
+
+unsigned long millis()
+{
+  return (unsigned long)(now_us / 1000);
+}
+
+unsigned long micros()
+{
+  return (unsigned long)now_us;
+}
+
+void delay(unsigned long ms)
+{
+  now_us += (uint64_t)ms * 1000;
+}
+
+// 把到达时间已过的字节移入接收缓冲区
+static void serial_pump()
+{
+  while (!rx_script.empty())
+  {
+    SerialChunk &chunk = rx_script.front();
+    if (chunk.index == 0 && chunk.at_us > rx_line_free_us)
+    {
+      rx_line_free_us = chunk.at_us;
+    }
+    while (chunk.index < chunk.bytes.size() && rx_line_free_us + byte_us() <= now_us)
+    {
+      rx_line_free_us += byte_us();
+      if (rx_buffer.size() < SERIAL_RX_BUFFER_SIZE - 1) // 环形缓冲区留一个空位
+      {
+        rx_buffer.push_back(chunk.bytes[chunk.index]);
+      }
+      else
+      {
+        rx_overruns++;
+      }
+      chunk.index++;
+    }
+    if (chunk.index < chunk.bytes.size())
+    {
+      return;
+    }
+    rx_script.pop_front();
+  }
+}
+
+void sim_serial_script(uint64_t at_us, const uint8_t *bytes, size_t len)
+{
+  // 按开始时间排序 (同一时间按加入顺序)，还没开始发送的片段可以被更早的片段插队
+  auto it = rx_script.end();
+  while (it != rx_script.begin() && (it - 1)->at_us > at_us && (it - 1)->index == 0)
+  {
+    --it;
+  }
+  rx_script.insert(it, {at_us, std::vector<uint8_t>(bytes, bytes + len), 0});
+}
+
+uint32_t sim_serial_overruns()
+{
+  return rx_overruns;
+}
+
+uint32_t sim_serial_baud()
+{
+  return baud;
+}
+
+const std::vector<SimSerialByte> &sim_serial_tx()
+{
+  return tx_log;
+}
+
+void sim_serial_clear_tx()
+{
+  tx_log.clear();
+}
+
+void HardwareSerial::begin(unsigned long rate)
+{
+  baud = (uint32_t)rate;
+}
+
+int HardwareSerial::available()
+{
+  serial_pump();
+  return (int)rx_buffer.size();
+}
+
+int HardwareSerial::read()
+{
+  serial_pump();
+  if (rx_buffer.empty())
+  {
+    return -1;
+  }
+  uint8_t byte = rx_buffer.front();
+  rx_buffer.pop_front();
+  return byte;
+}
+
+int HardwareSerial::availableForWrite()
+{
+  uint64_t queued = tx_done_us > now_us ? (tx_done_us - now_us + byte_us() - 1) / byte_us() : 0;
+  return SERIAL_TX_BUFFER_SIZE - 1 - (int)queued;
+}
+
+size_t HardwareSerial::write(uint8_t byte)
+{
+  // 发送缓冲区满时等待 (与AVR的HardwareSerial相同，会阻塞loop())
+  uint64_t limit = (SERIAL_TX_BUFFER_SIZE - 1) * byte_us();
+  if (tx_done_us > now_us + limit)
+  {
+    now_us = tx_done_us - limit;
+  }
+  tx_done_us = (tx_done_us > now_us ? tx_done_us : now_us) + byte_us();
+  tx_log.push_back({now_us, byte});
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+  for (size_t i = 0; i < size; i++)
+  {
+    write(buffer[i]);
+  }
+  return size;
+}
+
+size_t HardwareSerial::print(const char *text)
+{
+  return write((const uint8_t *)text, strlen(text));
+}
+
+size_t HardwareSerial::print(int value)
+{
+  return print((long)value);
+}
+
+size_t HardwareSerial::print(unsigned int value)
+{
+  return print((unsigned long)value);
+}
+
+size_t HardwareSerial::print(long value)
+{
+  char text[24];
+  snprintf(text, sizeof(text), "%ld", value);
+  return print(text);
+}
+
+size_t HardwareSerial::print(unsigned long value)
+{
+  char text[24];
+  snprintf(text, sizeof(text), "%lu", value);
+  return print(text);
+}
+
+size_t HardwareSerial::print(double value, int digits)
+{
+  char text[32];
+  snprintf(text, sizeof(text), "%.*f", digits, value);
+  return print(text);
+}
+
+// I2C
+const std::vector<SimI2cWrite> &sim_i2c_writes()
+{
+  return i2c_log;
+}
+
+void sim_i2c_clear()
+{
+  i2c_log.clear();
+}
+
+uint32_t sim_i2c_clock()
+{
+  return i2c_clock;
+}
+
+uint32_t sim_i2c_overflows()
+{
+  return i2c_overflows;
+}
+
+uint8_t sim_pca_register(uint8_t address, uint8_t reg)
+{
+  return pca[address].regs[reg];
+}
+
+uint16_t sim_pca_off_ticks(uint8_t address, uint8_t channel)
+{
+  uint8_t reg = PCA9685_LED0_ON_L + 4 * channel + 2;
+  return sim_pca_register(address, reg) | (sim_pca_register(address, reg + 1) << 8);
+}
+
+void TwoWire::setClock(uint32_t clock)
+{
+  i2c_clock = clock;
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+  address_ = address;
+  length_ = 0;
+}
+
+size_t TwoWire::write(uint8_t byte)
+{
+  if (length_ == BUFFER_LENGTH)
+  {
+    i2c_overflows++;
+    return 0;
+  }
+  buffer_[length_++] = byte;
+  return 1;
+}
+
+uint8_t TwoWire::endTransmission(bool /* stop */) // 模拟中每次传输都以STOP结束
+{
+  i2c_log.push_back({now_us, address_, std::vector<uint8_t>(buffer_, buffer_ + length_)});
+  if (length_ > 0)
+  {
+    // 寄存器模型: MODE1.AI置位时寄存器地址自动递增
+    PcaModel &model = pca[address_];
+    uint8_t reg = buffer_[0];
+    for (uint8_t i = 1; i < length_; i++)
+    {
+      model.regs[reg] = buffer_[i];
+      if (model.regs[PCA9685_MODE1] & MODE1_AI)
+      {
+        reg++;
+      }
+    }
+  }
+  // 总线时间: 地址和数据每字节9位，加上起始和停止条件
+  now_us += ((uint64_t)(1 + length_) * 9 + 2) * 1000000ULL / i2c_clock;
+  return 0;
+}
+
+// 与Adafruit库相同的寄存器序列
+bool Adafruit_PWMServoDriver::begin()
+{
+  Wire.begin();
+  write8(PCA9685_MODE1, MODE1_RESTART);
+  delay(10);
+  setPWMFreq(1000);
+  return true;
+}
+
+void Adafruit_PWMServoDriver::setPWMFreq(float freq)
+{
+  float prescale = PCA9685_OSC_HZ / (freq * 4096.0f) + 0.5f - 1;
+  if (prescale < 3)
+  {
+    prescale = 3;
+  }
+  if (prescale > 255)
+  {
+    prescale = 255;
+  }
+  uint8_t old_mode = sim_pca_register(address_, PCA9685_MODE1);
+  write8(PCA9685_MODE1, (old_mode & ~MODE1_RESTART) | MODE1_SLEEP);
+  write8(PCA9685_PRESCALE, (uint8_t)prescale);
+  write8(PCA9685_MODE1, old_mode);
+  delay(5);
+  write8(PCA9685_MODE1, old_mode | MODE1_RESTART | MODE1_AI);
+}
+
+void Adafruit_PWMServoDriver::setPWM(uint8_t num, uint16_t on, uint16_t off)
+{
+  Wire.beginTransmission(address_);
+  Wire.write(PCA9685_LED0_ON_L + 4 * num);
+  Wire.write(on);
+  Wire.write(on >> 8);
+  Wire.write(off);
+  Wire.write(off >> 8);
+  Wire.endTransmission();
+}
+
+void Adafruit_PWMServoDriver::write8(uint8_t reg, uint8_t value)
+{
+  Wire.beginTransmission(address_);
+  Wire.write(reg);
+  Wire.write(value);
+  Wire.endTransmission();
+}
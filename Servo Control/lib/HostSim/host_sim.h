@@ -0,0 +1,50 @@
+#ifndef HOST_SIM_H
+#define HOST_SIM_H
+
+// 主机端模拟: 虚拟时钟、按时间安排的串口输入、带时间戳的串口输出和I2C写入记录，
+// 以及两块PCA9685的寄存器模型。测试调用固件的setup()/loop()，在虚拟时间中运行
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+struct SimI2cWrite
+{
+  uint64_t t_us;              // 传输开始时间
+  uint8_t address;            // 7位器件地址
+  std::vector<uint8_t> bytes; // 第一个字节为寄存器地址
+};
+
+struct SimSerialByte
+{
+  uint64_t t_us; // 写入发送缓冲区的时间
+  uint8_t byte;
+};
+
+// 虚拟时钟 (微秒)
+uint64_t sim_now_us();
+void sim_advance_us(uint64_t us);
+// 每次loop()消耗的虚拟时间 (默认20微秒，约为Uno上一次空循环的耗时)；I2C和串口等待另外计时
+void sim_set_loop_us(uint32_t us);
+// 运行loop_fn直到虚拟时间到达end_us
+void sim_run_until(uint64_t end_us, void (*loop_fn)());
+// 最近一次sim_run_until()中两次loop()开始之间的最长间隔 (微秒)
+uint64_t sim_loop_max_us();
+
+// 串口输入: 从at_us开始按波特率逐字节到达，接收缓冲区满时丢弃 (计入溢出)
+void sim_serial_script(uint64_t at_us, const uint8_t *bytes, size_t len);
+uint32_t sim_serial_overruns();
+uint32_t sim_serial_baud();
+const std::vector<SimSerialByte> &sim_serial_tx();
+void sim_serial_clear_tx();
+
+// I2C记录
+const std::vector<SimI2cWrite> &sim_i2c_writes();
+void sim_i2c_clear();
+uint32_t sim_i2c_clock();
+uint32_t sim_i2c_overflows(); // 超过BUFFER_LENGTH被丢弃的字节数
+// 模拟的PCA9685寄存器 (每次传输按MODE1.AI自动递增写入)
+uint8_t sim_pca_register(uint8_t address, uint8_t reg);
+uint16_t sim_pca_off_ticks(uint8_t address, uint8_t channel);
+
+#endif // HOST_SIM_H
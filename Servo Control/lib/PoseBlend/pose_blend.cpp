@@ -0,0 +1,60 @@
+#include "pose_blend.h"
+
+void PoseBlend::begin()
+{
+  clear();
+  blink_ = 0;
+  jaw_ = 0;
+  speaking_ = false;
+}
+
+void PoseBlend::clear()
+{
+  for (uint8_t pose = 0; pose < POSE_COUNT; pose++)
+  {
+    weights_[pose] = 0;
+  }
+}
+
+// 8位小数 (Q8) 四舍五入为整数角度并限制在0~255
+static uint8_t round_angle(int32_t angle_q8)
+{
+  int32_t angle = (angle_q8 + 128) >> 8;
+  return angle < 0 ? 0 : angle > 255 ? 255 : (uint8_t)angle;
+}
+
+uint8_t PoseBlend::target(uint8_t servo) const
+{
+  int16_t base = pose_angle(POSE_NEUTRAL, servo);
+  int32_t angle = (int32_t)base << 8; // Q8
+  for (uint8_t pose = POSE_NEUTRAL + 1; pose < POSE_COUNT; pose++)
+  {
+    if (weights_[pose] != 0) // 通常只有一两个表情的权重非0
+    {
+      int16_t delta = (int16_t)pose_angle(pose, servo) - base;
+      angle += (int32_t)delta * blend_scale(weights_[pose]);
+    }
+  }
+
+  uint8_t blended = round_angle(angle); // 多个表情叠加可能超出角度范围
+
+  // 叠加层: 眨眼把眼皮从混合结果向闭合角度插值，说话时口型取代表情的嘴部角度
+  if (blink_ != 0 && servo >= SERVO_LID_FIRST && servo < SERVO_LID_FIRST + SERVO_LID_COUNT)
+  {
+    int16_t delta = (int16_t)lid_closed_angle(servo - SERVO_LID_FIRST) - blended;
+    return round_angle(((int32_t)blended << 8) + (int32_t)delta * blend_scale(blink_));
+  }
+  if (speaking_ && servo == SERVO_JAW)
+  {
+    return round_angle(((int32_t)BLEND_JAW_CLOSED << 8) + (int32_t)BLEND_JAW_RANGE * blend_scale(jaw_));
+  }
+  return blended;
+}
+
+void PoseBlend::compute(uint8_t *targets) const
+{
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+  {
+    targets[servo] = target(servo);
+  }
+}
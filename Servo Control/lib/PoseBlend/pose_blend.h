@@ -0,0 +1,49 @@
+#ifndef POSE_BLEND_H
+#define POSE_BLEND_H
+
+#include <stdint.h>
+
+#include "face_pose.h"
+
+#define BLEND_FULL 255     // 权重上限 (表情的完整强度)
+#define BLEND_JAW_CLOSED 80 // 说话时嘴部闭合的角度 (与原说话动画和ESP32端FaceMotion相同)
+#define BLEND_JAW_RANGE 40  // 说话时嘴部完全张开增加的角度 (80 -> 120度，在舵机行程80~130度之内)
+
+// 8位权重换算为0~256，使255正好对应完整强度，之后只需右移8位 (ATmega328P没有除法指令)
+inline uint16_t blend_scale(uint8_t weight)
+{
+  return weight + (weight >> 7);
+}
+
+// 表情混合: 每个舵机的目标 = 自然表情 + Σ 权重 × (表情 - 自然表情)，全部为整数运算
+// 单个表情的权重表示强度 (如"有点开心")，多个表情的权重叠加表示混合；
+// 眨眼和口型作为叠加层在混合结果之上修改眼皮和嘴部，不改变表情权重
+class PoseBlend
+{
+public:
+  // 回到自然表情，清除叠加层
+  void begin();
+  // 所有表情权重清零 (自然表情)
+  void clear();
+  void setWeight(uint8_t pose, uint8_t weight) { weights_[pose] = weight; }
+  uint8_t weight(uint8_t pose) const { return weights_[pose]; }
+  // 眨眼叠加层: 0为不眨眼，255为眼皮完全闭合
+  void setBlink(uint8_t amount) { blink_ = amount; }
+  // 口型叠加层: 说话期间嘴部在固定的 BLEND_JAW_CLOSED ~ BLEND_JAW_CLOSED + BLEND_JAW_RANGE 度之间摆动，
+  // 不叠加在表情的嘴部角度上 (开心120度、惊讶130度时再张开会超出舵机行程而被限位)
+  void setSpeaking(bool speaking) { speaking_ = speaking; }
+  // 说话时的张嘴程度: 0为闭合，255为完全张开；不说话时不起作用
+  void setJaw(uint8_t open) { jaw_ = open; }
+  // 计算一个舵机的目标角度
+  uint8_t target(uint8_t servo) const;
+  // 计算所有舵机的目标角度 (targets至少SERVO_COUNT个)
+  void compute(uint8_t *targets) const;
+
+private:
+  uint8_t weights_[POSE_COUNT]; // 自然表情是基准，权重不参与计算
+  uint8_t blink_;
+  uint8_t jaw_;
+  bool speaking_;
+};
+
+#endif // POSE_BLEND_H
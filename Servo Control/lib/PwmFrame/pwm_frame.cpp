@@ -0,0 +1,72 @@
+#include "pwm_frame.h"
+
+#define PWM_FRAME_UNKNOWN 0xFFFF // 上电后寄存器内容未知，第一次set()总是写出
+
+void PwmFrame::begin(TwoWire &wire, uint8_t address)
+{
+  wire_ = &wire;
+  address_ = address;
+  dirty_ = 0;
+  for (uint8_t i = 0; i < PWM_FRAME_CHANNELS; i++)
+  {
+    shadow_[i] = PWM_FRAME_UNKNOWN;
+  }
+}
+
+void PwmFrame::set(uint8_t channel, uint16_t ticks)
+{
+  if (shadow_[channel] != ticks)
+  {
+    shadow_[channel] = ticks;
+    dirty_ |= 1U << channel;
+  }
+}
+
+uint16_t PwmFrame::writeRun(uint8_t first, uint8_t count)
+{
+  wire_->beginTransmission(address_);
+  if (count == 1)
+  {
+    // 单个通道只写OFF_L/OFF_H (ON已经是0)
+    wire_->write(PCA9685_LED0_OFF_L + 4 * first);
+    wire_->write((uint8_t)shadow_[first]);
+    wire_->write((uint8_t)(shadow_[first] >> 8));
+    wire_->endTransmission();
+    return 4;
+  }
+  wire_->write(PCA9685_LED0_ON_L + 4 * first);
+  for (uint8_t ch = first; ch < first + count; ch++)
+  {
+    wire_->write(0);
+    wire_->write(0);
+    wire_->write((uint8_t)shadow_[ch]);
+    wire_->write((uint8_t)(shadow_[ch] >> 8));
+  }
+  wire_->endTransmission();
+  return 2 + 4 * count;
+}
+
+uint16_t PwmFrame::flush()
+{
+  uint16_t bytes = 0;
+  bursts_ = 0;
+  uint8_t ch = 0;
+  while (dirty_ != 0)
+  {
+    // 找到下一段连续变化的通道 (中间隔一个未变化的通道时，单独开始一次传输比多写4字节更省)
+    while (!(dirty_ & (1U << ch)))
+    {
+      ch++;
+    }
+    uint8_t count = 0;
+    while (ch + count < PWM_FRAME_CHANNELS && (dirty_ & (1U << (ch + count))) && count < PWM_FRAME_BURST_CHANNELS)
+    {
+      dirty_ &= ~(1U << (ch + count));
+      count++;
+    }
+    bytes += writeRun(ch, count);
+    bursts_++;
+    ch += count;
+  }
+  return bytes;
+}
@@ -0,0 +1,35 @@
+#ifndef PWM_FRAME_H
+#define PWM_FRAME_H
+
+#include <Wire.h>
+
+#define PCA9685_LED0_ON_L 0x06  // 通道0的第一个寄存器，每个通道4个: ON_L, ON_H, OFF_L, OFF_H
+#define PCA9685_LED0_OFF_L 0x08
+#define PWM_FRAME_CHANNELS 16
+// AVR的Wire发送缓冲区为32字节: 1字节寄存器地址 + 最多7个通道 (28字节)
+#define PWM_FRAME_BURST_CHANNELS 7
+
+// 一块PCA9685的影子寄存器: set()只修改影子并标记变化，flush()把变化的连续通道区间
+// 各用一次自动递增 (MODE1.AI) 的I2C传输写出，未变化的通道不占总线时间
+class PwmFrame
+{
+public:
+  void begin(TwoWire &wire, uint8_t address);
+  // 设置通道的OFF tick (ON固定为0)；与影子相同时不产生写入
+  void set(uint8_t channel, uint16_t ticks);
+  // 写出所有变化的通道，返回总线上的字节数 (包括器件地址字节)
+  uint16_t flush();
+  // 本块板上一次flush()使用的I2C传输次数
+  uint8_t bursts() const { return bursts_; }
+
+private:
+  uint16_t writeRun(uint8_t first, uint8_t count);
+
+  TwoWire *wire_ = 0;
+  uint8_t address_ = 0;
+  uint16_t shadow_[PWM_FRAME_CHANNELS];
+  uint16_t dirty_ = 0; // 每个通道一位
+  uint8_t bursts_ = 0;
+};
+
+#endif // PWM_FRAME_H
@@ -0,0 +1,113 @@
+#include "serial_link.h"
+
+#include <string.h>
+
+uint8_t link_crc8(uint8_t crc, uint8_t byte)
+{
+  crc ^= byte;
+  for (uint8_t bit = 0; bit < 8; bit++)
+  {
+    crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+  }
+  return crc;
+}
+
+uint8_t link_encode(uint8_t *buf, uint8_t seq, uint8_t opcode, const uint8_t *payload, uint8_t len)
+{
+  buf[0] = LINK_SYNC;
+  buf[1] = len;
+  buf[2] = seq;
+  buf[3] = opcode;
+  memcpy(buf + 4, payload, len);
+  uint8_t crc = 0;
+  for (uint8_t i = 1; i < len + 4; i++)
+  {
+    crc = link_crc8(crc, buf[i]);
+  }
+  buf[len + 4] = crc;
+  return len + LINK_FRAME_OVERHEAD;
+}
+
+// 旧协议中指令后跟的数据字节数
+static uint8_t legacy_args(uint8_t opcode)
+{
+  return opcode == LINK_OP_GAZE ? 2 : 0;
+}
+
+bool LinkParser::feed(uint8_t byte, uint16_t now_ms)
+{
+  if (state_ != IDLE && (uint16_t)(now_ms - last_ms_) > LINK_TIMEOUT_MS)
+  {
+    errors_++; // 帧没有收完 (发送端中断或丢字节)，从这个字节重新开始
+    state_ = IDLE;
+  }
+  last_ms_ = now_ms;
+
+  switch (state_)
+  {
+  case IDLE:
+    if (byte != LINK_SYNC)
+    {
+      cmd_.opcode = byte;
+      cmd_.seq = 0;
+      cmd_.len = 0;
+      cmd_.framed = false;
+      if (legacy_args(byte) == 0)
+      {
+        return true;
+      }
+      state_ = LEGACY_ARGS;
+      return false;
+    }
+    state_ = LEN;
+    return false;
+  case LEN:
+    if (byte > LINK_MAX_PAYLOAD)
+    {
+      errors_++;
+      state_ = IDLE;
+      return false;
+    }
+    cmd_.len = byte;
+    cmd_.framed = true;
+    crc_ = link_crc8(0, byte);
+    state_ = SEQ;
+    return false;
+  case SEQ:
+    cmd_.seq = byte;
+    crc_ = link_crc8(crc_, byte);
+    state_ = OPCODE;
+    return false;
+  case OPCODE:
+    cmd_.opcode = byte;
+    crc_ = link_crc8(crc_, byte);
+    index_ = 0;
+    state_ = cmd_.len > 0 ? PAYLOAD : CRC;
+    return false;
+  case PAYLOAD:
+    cmd_.payload[index_++] = byte;
+    crc_ = link_crc8(crc_, byte);
+    if (index_ == cmd_.len)
+    {
+      state_ = CRC;
+    }
+    return false;
+  case CRC:
+    state_ = IDLE;
+    if (byte != crc_)
+    {
+      errors_++;
+      return false;
+    }
+    return true;
+  case LEGACY_ARGS:
+    cmd_.payload[cmd_.len++] = byte;
+    if (cmd_.len == legacy_args(cmd_.opcode))
+    {
+      state_ = IDLE;
+      return true;
+    }
+    return false;
+  }
+  return false;
+}
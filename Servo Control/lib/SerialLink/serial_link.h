@@ -0,0 +1,101 @@
+#ifndef SERIAL_LINK_H
+#define SERIAL_LINK_H
+
+#include <stdint.h>
+
+// 串口协议v2的帧格式: SYNC | LEN | SEQ | OPCODE | PAYLOAD[LEN] | CRC8
+// LEN为负载字节数，CRC8 (多项式0x07) 覆盖LEN到负载末尾；SEQ为0表示不需要确认
+// 不以SYNC开头的字节按旧协议的单字节指令解析 (0x02后跟2字节角度)，旧的服务器无需修改
+#define LINK_SYNC 0xA5
+#define LINK_VERSION 2
+#define LINK_MAX_PAYLOAD 40   // 最长的负载: 批量设置全部19个舵机 (1 + 19 * 2)
+#define LINK_FRAME_OVERHEAD 5 // SYNC、LEN、SEQ、OPCODE、CRC8
+#define LINK_TIMEOUT_MS 50    // 帧内相邻字节的最长间隔，超时丢弃未收完的帧 (115200波特率下一帧不到5ms)
+
+// 指令 (帧内的指令与旧协议的单字节指令相同)
+#define LINK_OP_PING 0x01        // 无负载，确认帧的负载中附带协议版本
+#define LINK_OP_GAZE 0x02        // 负载: 眼球左右角度、上下角度
+#define LINK_OP_GAZE_STREAM 0x03 // 负载同上，注视流 (如人脸跟踪): 只保留最新的目标，经滤波平滑后跟随
+#define LINK_OP_POSE 0x10        // 0x10 ~ 0x1F: 表情 (FacePose)
+#define LINK_OP_SPEAK_START 0x21 // 开始说话 (嘴部动画)
+#define LINK_OP_SPEAK_STOP 0x22  // 停止说话
+#define LINK_OP_SET_SERVOS 0x30  // 负载: 角速度 (单位4度/秒，0为直接到位) + N组 (舵机序号, 角度)
+#define LINK_OP_BLEND 0x31       // 负载: 角速度 + N组 (表情序号, 权重0~255)，表情按权重混合
+#define LINK_OP_TL_SYNC 0x40     // 负载: 当前轨道时间 (uint32小端，毫秒)，开始新轨道或校正时钟
+#define LINK_OP_TL_KEYFRAME 0x41 // 负载: 轨道时间 (uint32小端) + 角速度 + 最多4组 (舵机序号, 角度)
+#define LINK_OP_TL_END 0x42      // 负载: 1字节，0为播放完已缓冲的关键帧后结束，1为立即清空
+#define LINK_OP_STATS 0x50       // 负载: 空或1字节 (1为读取后清零)，回复帧的负载为状态 + LinkStats
+#define LINK_ACK_FLAG 0x80       // 确认: 指令 | LINK_ACK_FLAG (旧协议为单字节，v2为确认帧)
+
+// 查询指令0x50的回复 (紧跟在状态字节之后，多字节字段为小端，超出范围的16位字段饱和为0xFFFF)
+// 统计区间从上电或上一次清零开始
+#define LINK_STATS_BYTES 31
+// uint32 uptime_ms        上电以来的时间
+// uint32 loops            loop()次数
+// uint16 loop_min_us      两次loop()之间的最短、平均、最长间隔
+// uint16 loop_mean_us
+// uint16 loop_max_us
+// uint16 commands         移动了舵机的指令数
+// uint16 cmd_lat_mean_us  指令的第一个字节在接收缓冲区中可读 -> 第一次I2C写入舵机 (平均、最长)
+// uint16 cmd_lat_max_us
+// uint8  rx_high_water    串口接收缓冲区的最高占用 (字节)
+// uint16 rx_errors        丢弃的错误帧数
+// uint16 i2c_frames       有写入的节拍数
+// uint16 i2c_bytes_mean   每个节拍的I2C字节数
+// uint16 i2c_us_mean      每个节拍的I2C耗时 (平均、最长)
+// uint16 i2c_us_max
+
+// 确认帧负载的第一个字节
+enum LinkStatus
+{
+  LINK_DONE,       // 动作完成
+  LINK_SUPERSEDED, // 动作还没完成就被新指令取代
+  LINK_REJECTED,   // 未知指令或负载长度错误
+};
+
+struct LinkCommand
+{
+  uint8_t opcode;
+  uint8_t seq;    // 旧协议的指令为0
+  uint8_t len;    // 负载字节数
+  bool framed;    // 是否来自v2帧 (决定确认的格式)
+  uint8_t payload[LINK_MAX_PAYLOAD];
+};
+
+// 非阻塞的逐字节解析器: loop()把串口收到的字节逐个送入，不等待后续字节
+class LinkParser
+{
+public:
+  // 送入一个字节，收到完整指令时返回true，指令由command()取得 (到下一次feed()之前有效)
+  bool feed(uint8_t byte, uint16_t now_ms);
+  const LinkCommand &command() const { return cmd_; }
+  // 累计的校验错误、长度错误和超时丢弃的帧数 (16位回绕，使用者按差值统计各自的区间)
+  uint16_t errors() const { return errors_; }
+  // 当前是否在两条指令之间 (下一个字节是新指令的第一个字节)
+  bool idle() const { return state_ == IDLE; }
+
+private:
+  enum State
+  {
+    IDLE,
+    LEN,
+    SEQ,
+    OPCODE,
+    PAYLOAD,
+    CRC,
+    LEGACY_ARGS,
+  };
+
+  uint8_t state_ = IDLE;
+  uint8_t index_ = 0;
+  uint8_t crc_ = 0;
+  uint16_t last_ms_ = 0;
+  uint16_t errors_ = 0;
+  LinkCommand cmd_;
+};
+
+uint8_t link_crc8(uint8_t crc, uint8_t byte);
+// 把一帧编码到buf (至少 len + LINK_FRAME_OVERHEAD 字节)，返回帧长度
+uint8_t link_encode(uint8_t *buf, uint8_t seq, uint8_t opcode, const uint8_t *payload, uint8_t len);
+
+#endif // SERIAL_LINK_H
@@ -0,0 +1,92 @@
+#include "servo_motion.h"
+
+uint16_t servo_ease(uint8_t easing, uint16_t u)
+{
+  switch (easing)
+  {
+  case EASE_IN_OUT:
+    return (uint16_t)((uint32_t)u * u * (768 - 2 * u) >> 16); // 3u^2 - 2u^3
+  case EASE_OUT:
+    return 256 - (uint16_t)((uint32_t)(256 - u) * (256 - u) >> 8); // 1 - (1-u)^2
+  default:
+    return u;
+  }
+}
+
+void ServoMotion::begin(ServoMove *moves, uint8_t count, ServoWriter writer)
+{
+  moves_ = moves;
+  count_ = count;
+  writer_ = writer;
+  pending_ = 0;
+  known_ = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    moves_[i].from = moves_[i].to = moves_[i].current = 0;
+    moves_[i].easing = EASE_LINEAR;
+    moves_[i].start_ms = 0;
+    moves_[i].duration_ms = 0;
+  }
+}
+
+void ServoMotion::moveTo(uint8_t servo, uint8_t angle, uint16_t speed_dps, uint8_t easing, uint32_t now_ms)
+{
+  uint32_t bit = 1UL << servo;
+  ServoMove &m = moves_[servo];
+  m.to = angle;
+  if ((known_ & bit) && angle == m.current)
+  {
+    pending_ &= ~bit; // 已在目标位置 (运动中途改回当前角度时就地停止)
+    return;
+  }
+  // 从当前输出的角度出发，运动中途改变目标时不会跳变
+  m.from = m.current;
+  m.easing = easing;
+  m.start_ms = (uint16_t)now_ms;
+  m.duration_ms = 0;
+  if (speed_dps > 0 && (known_ & bit))
+  {
+    uint16_t distance = angle > m.current ? angle - m.current : m.current - angle;
+    m.duration_ms = (uint16_t)((uint32_t)distance * 1000 / speed_dps);
+  }
+  pending_ |= bit;
+}
+
+uint8_t ServoMotion::update(uint32_t now_ms)
+{
+  uint8_t written = 0;
+  for (uint8_t i = 0; i < count_ && pending_ != 0; i++)
+  {
+    uint32_t bit = 1UL << i;
+    if (!(pending_ & bit))
+    {
+      continue;
+    }
+    ServoMove &m = moves_[i];
+    uint16_t elapsed = (uint16_t)now_ms - m.start_ms;
+    uint8_t angle = m.to;
+    if (elapsed >= m.duration_ms)
+    {
+      pending_ &= ~bit; // 到位
+    }
+    else
+    {
+      uint16_t u = (uint16_t)((uint32_t)elapsed * 256 / m.duration_ms);
+      int16_t delta = (int16_t)m.to - (int16_t)m.from;
+      angle = (uint8_t)(m.from + (int16_t)((int32_t)delta * servo_ease(m.easing, u) / 256));
+    }
+    if (angle != m.current || !(known_ & bit))
+    {
+      writer_(i, angle);
+      m.current = angle;
+      known_ |= bit;
+      written++;
+    }
+  }
+  return written;
+}
+
+bool ServoMotion::busy() const
+{
+  return pending_ != 0;
+}
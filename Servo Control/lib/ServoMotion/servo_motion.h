@@ -0,0 +1,57 @@
+#ifndef SERVO_MOTION_H
+#define SERVO_MOTION_H
+
+#include <stdint.h>
+
+// 插值曲线
+enum ServoEasing
+{
+  EASE_LINEAR,  // 匀速
+  EASE_IN_OUT,  // 两端缓动 (smoothstep)，起停时电流冲击最小
+  EASE_OUT,     // 快速出发、缓慢到位 (眨眼、说话等需要立即响应的动作)
+};
+
+// 舵机输出回调: servo为舵机序号，angle为本次插值后的整数角度
+typedef void (*ServoWriter)(uint8_t servo, uint8_t angle);
+
+// 单个舵机的运动状态 (每个舵机8字节，19个舵机共152字节，Uno的SRAM只有2KB)
+struct ServoMove
+{
+  uint8_t from;         // 本段运动的起点角度
+  uint8_t to;           // 目标角度
+  uint8_t current;      // 最近一次输出的角度
+  uint8_t easing;       // ServoEasing
+  uint16_t start_ms;    // 开始时间 (millis()的低16位，单段运动不超过65秒)
+  uint16_t duration_ms; // 0表示已到位
+};
+
+static_assert(sizeof(ServoMove) == 8, "ServoMove没有填充字节");
+
+// 非阻塞运动引擎: 每个舵机独立的目标、速度和插值曲线，所有舵机并行运动
+// 由loop()每个节拍调用update()，角度变化时才调用输出回调
+class ServoMotion
+{
+public:
+  // moves: 调用者提供的状态数组；count: 舵机数量 (不超过32)
+  void begin(ServoMove *moves, uint8_t count, ServoWriter writer);
+  // 设定目标: speed_dps为角速度 (度/秒)，0表示下一次update()时直接到位
+  void moveTo(uint8_t servo, uint8_t angle, uint16_t speed_dps, uint8_t easing, uint32_t now_ms);
+  // 推进所有舵机，返回本次输出的舵机数
+  uint8_t update(uint32_t now_ms);
+  // 是否还有舵机在运动 (包括尚未输出的直接到位目标)
+  bool busy() const;
+  uint8_t target(uint8_t servo) const { return moves_[servo].to; }
+  uint8_t angle(uint8_t servo) const { return moves_[servo].current; }
+
+private:
+  ServoMove *moves_ = 0;
+  uint8_t count_ = 0;
+  ServoWriter writer_ = 0;
+  uint32_t pending_ = 0; // 每个舵机一位: 目标已设定但还没输出到位
+  uint32_t known_ = 0;   // 每个舵机一位: 已输出过角度 (上电后第一次设定直接到位，不从未知位置插值)
+};
+
+// 插值: u为0~256的进度，返回0~256的位置比例
+uint16_t servo_ease(uint8_t easing, uint16_t u);
+
+#endif // SERVO_MOTION_H
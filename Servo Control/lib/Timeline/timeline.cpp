@@ -0,0 +1,90 @@
+#include "timeline.h"
+
+#include <string.h>
+
+void Timeline::begin(KeyframeApply apply)
+{
+  apply_ = apply;
+  head_ = 0;
+  count_ = 0;
+  active_ = false;
+  resetStats();
+}
+
+void Timeline::resetStats()
+{
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void Timeline::sync(uint32_t track_ms, uint32_t now_ms)
+{
+  if (!active_)
+  {
+    head_ = 0;
+    count_ = 0;
+    active_ = true;
+    ending_ = false;
+    starved_ = true; // 第一个关键帧到达之前不计欠载
+  }
+  offset_ = track_ms - now_ms;
+}
+
+bool Timeline::push(const Keyframe &kf, uint32_t now_ms)
+{
+  if (!active_ || count_ == TIMELINE_SLOTS)
+  {
+    stats_.overflows++;
+    return false;
+  }
+  if ((int32_t)(trackMs(now_ms) - kf.t_ms) > TIMELINE_LATE_MS)
+  {
+    stats_.late++;
+  }
+  frames_[(head_ + count_) % TIMELINE_SLOTS] = kf;
+  count_++;
+  starved_ = false;
+  return true;
+}
+
+void Timeline::end(bool clear)
+{
+  if (clear || count_ == 0)
+  {
+    head_ = 0;
+    count_ = 0;
+    active_ = false;
+  }
+  ending_ = true;
+}
+
+uint8_t Timeline::update(uint32_t now_ms)
+{
+  if (!active_)
+  {
+    return 0;
+  }
+  uint32_t track = trackMs(now_ms);
+  uint8_t played = 0;
+  // 轨道时间按有符号差比较，轨道时钟回绕或同步时小幅回退都不影响顺序
+  while (count_ > 0 && (int32_t)(track - frames_[head_].t_ms) >= 0)
+  {
+    apply_(frames_[head_]);
+    head_ = (head_ + 1) % TIMELINE_SLOTS;
+    count_--;
+    played++;
+  }
+  stats_.played += played;
+  if (count_ == 0)
+  {
+    if (ending_)
+    {
+      active_ = false;
+    }
+    else if (!starved_)
+    {
+      starved_ = true;
+      stats_.underruns++;
+    }
+  }
+  return played;
+}
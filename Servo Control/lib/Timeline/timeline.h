@@ -0,0 +1,65 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+
+#define TIMELINE_SLOTS 16      // 环形缓冲区的关键帧数 (每帧14字节)
+#define KEYFRAME_MAX_TARGETS 4 // 每个关键帧最多的舵机数，整个表情可以拆成多个同一时间戳的关键帧
+#define TIMELINE_LATE_MS 20    // 到达时已过期超过此时间的关键帧计为迟到 (一个运动节拍)
+
+// 关键帧: 时间戳 (轨道时间，毫秒) 和一组稀疏的舵机目标
+struct Keyframe
+{
+  uint32_t t_ms;
+  uint8_t speed; // 角速度，单位4度/秒，0为直接到位
+  uint8_t count;
+  uint8_t servo[KEYFRAME_MAX_TARGETS];
+  uint8_t angle[KEYFRAME_MAX_TARGETS];
+};
+
+// 关键帧到期时的回调
+typedef void (*KeyframeApply)(const Keyframe &kf);
+
+// 统计 (自上次resetStats()起)
+struct TimelineStats
+{
+  uint16_t played;
+  uint16_t late;      // 到达时已经过期的关键帧 (仍然立即播放)
+  uint16_t underruns; // 轨道还没结束缓冲区就空了的次数
+  uint16_t overflows; // 缓冲区满 (或轨道未开始) 被丢弃的关键帧
+};
+
+// 关键帧时间轴: 上位机按轨道时间预先发送关键帧，存入固定大小的环形缓冲区，
+// 由loop()每个节拍按同步后的轨道时钟播放到期的关键帧，不需要每帧往返确认
+class Timeline
+{
+public:
+  void begin(KeyframeApply apply);
+  // 同步轨道时钟: 此刻的轨道时间为track_ms；轨道未开始时清空缓冲区并开始新轨道，开始后可重复发送以校正时钟漂移
+  void sync(uint32_t track_ms, uint32_t now_ms);
+  // 加入一个关键帧 (按时间顺序)，缓冲区满或轨道未开始时返回false
+  bool push(const Keyframe &kf, uint32_t now_ms);
+  // 结束轨道: clear为false时播放完已缓冲的关键帧后结束 (不计欠载)，为true时立即丢弃
+  void end(bool clear);
+  // 播放所有到期的关键帧，返回播放的数量
+  uint8_t update(uint32_t now_ms);
+
+  bool active() const { return active_; }
+  uint8_t queued() const { return count_; }
+  uint32_t trackMs(uint32_t now_ms) const { return now_ms + offset_; }
+  const TimelineStats &stats() const { return stats_; }
+  void resetStats();
+
+private:
+  KeyframeApply apply_ = 0;
+  Keyframe frames_[TIMELINE_SLOTS];
+  uint8_t head_ = 0;  // 最早的关键帧
+  uint8_t count_ = 0;
+  uint32_t offset_ = 0; // 轨道时间 - millis() (按模2^32计算)
+  bool active_ = false;
+  bool ending_ = false;
+  bool starved_ = false; // 当前处于欠载状态 (每次欠载只计一次)
+  TimelineStats stats_ = {};
+};
+
+#endif // TIMELINE_H
@@ -1,424 +1,618 @@
 #include <Wire.h>
 #include <Adafruit_PWMServoDriver.h>
+#include "servo_motion.h" // 非阻塞舵机运动引擎
+#include "pwm_frame.h"    // PCA9685影子寄存器和批量写入
+#include "face_pose.h"    // 表情表、舵机校准和tick查找表 (PROGMEM)
+#include "serial_link.h"  // 串口协议v2的帧解析 (兼容旧的单字节指令)
+#include "timeline.h"     // 带时间戳的关键帧缓冲和播放
+#include "gaze_filter.h"  // 注视流的临界阻尼平滑 (定点)
+#include "pose_blend.h"   // 表情混合 (8位权重) 和眨眼、口型叠加层
 
 // 创建两个 PCA9685 对象
 Adafruit_PWMServoDriver pwm1 = Adafruit_PWMServoDriver(0x40); // PCA9685板1，地址0x40
 Adafruit_PWMServoDriver pwm2 = Adafruit_PWMServoDriver(0x41); // PCA9685板2，地址0x41
+PwmFrame frames[2]; // 两块板的影子寄存器
+#define I2C_CLOCK 400000 // I2C时钟 (Hz)，PCA9685支持400kHz Fast-mode
 
-// SG90舵机特定的脉冲宽度范围 (单位: 微秒)
-#define SG90_MIN 500  // SG90舵机最小脉冲宽度
-#define SG90_MAX 2500 // SG90舵机最大脉冲宽度
-#define SG90_FREQ 50  // SG90舵机PWM频率 (Hz)
+#define MOTION_TICK_MS 20    // 运动引擎的更新周期 (毫秒)，与舵机50Hz的PWM周期相同，更快的更新不会被舵机看到
+#define EXPRESSION_SPEED 240 // 表情切换时的舵机角速度 (度/秒)，所有舵机并行运动
+#define MOUTH_SPEED 400      // 说话时嘴部开合的角速度 (度/秒)
+#define BLINK_CLOSED_MS 200  // 闭眼持续时间 (毫秒)
+#define STATS_INTERVAL 5000  // 循环耗时和表情完成时间的报告周期 (毫秒)
+#define SERIAL_BAUD 115200 // 串口波特率 (一帧批量设置全部舵机的指令约4ms)
 
-#define DELAY_TIME 50 // 舵机动作之间的延迟时间 (毫秒)
-
-uint8_t state = 0; // 当前表情状态: 0:netural, 1:happiness, 2:sadness, 3:surprise
+PoseBlend blend; // 当前表情: 各表情的权重，加上眨眼和口型叠加层
 #define BLINK_INTERVAL 3000 // 自动眨眼间隔时间 (毫秒)
 unsigned long previousBlinkMillis = 0; // 上一次眨眼的时间戳
+bool blinkClosed = false;              // 是否处于闭眼阶段
+unsigned long blinkOpenMillis = 0;     // 闭眼阶段结束的时间戳
 
-// 设置SG90舵机角度
-// servoNum: 舵机编号 (0-15)
-// angle: 目标角度 (0-180)
-// pca_board: PCA9685板编号 (1 或 2)
-void setSG90Angle(uint8_t servoNum, uint16_t angle, uint8_t pca_board) {
-  uint16_t pulse = map(angle, 0, 180, SG90_MIN, SG90_MAX);
-  uint16_t ticks = pulse * (SG90_FREQ * 4096.0 / 1000000.0); // 将脉冲宽度转换为PCA9685的tick值
-  if (pca_board == 1) {
-    pwm1.setPWM(servoNum, 0, ticks);
-  } else {
-    pwm2.setPWM(servoNum, 0, ticks);
+bool speaking = false;                 // 是否在播放说话动画
+int mouth_flag = 1;                    // 用于切换嘴部开合状态
+unsigned long lastMouthMoveTime = 0;   // 上一次嘴部开合的时间戳
+#define MOUTH_MOVE_INTERVAL 250        // 嘴部开合动画的间隔时间 (毫秒)
+
+// 运动引擎: 舵机序号即表情表中的列 (见 face_pose.h)
+ServoMove servoMoves[SERVO_COUNT];
+ServoMotion motion;
+unsigned long lastMotionTick = 0; // 上一次运动引擎更新的时间戳
+Timeline timeline; // 上位机预先发送的关键帧轨道 (口型和表情)，按同步的轨道时钟播放
+
+// 注视流: 更新只覆盖一个待处理的目标，不排队；每个节拍取走最新目标，经滤波后输出到眼球舵机
+#define GAZE_STREAM_TIMEOUT 500 // 超过此时间 (毫秒) 没有更新且眼球到位后退出注视流，表情重新接管眼球
+GazeFilter gazeX, gazeY;
+bool gazeStreaming = false;        // 注视流期间表情不改变眼球位置
+bool gazePending = false;          // 有还没被节拍取走的目标
+uint8_t gazeTargetX = 0, gazeTargetY = 0;
+unsigned long gazeArrivalMillis = 0; // 待处理目标的到达时间
+unsigned long gazeLastMillis = 0;    // 最近一次更新的到达时间
+unsigned int gazeUpdates = 0;        // 被节拍取走的更新数 (自上次报告起)
+unsigned int gazeCoalesced = 0;      // 被后来的更新覆盖而丢弃的更新数
+unsigned long gazeLatencySum = 0;    // 更新到达 -> 开始运动 (毫秒)
+unsigned long gazeLatencyMax = 0;
+
+// 串口指令和确认: 动作完成后回传确认，服务器据此测量指令到动作的延迟
+LinkParser link;
+struct PendingAck
+{
+  int16_t opcode; // -1表示没有等待确认的指令
+  uint8_t seq;
+  bool framed;
+};
+PendingAck ackPending = {-1, 0, false};
+
+// 性能统计: 两次loop()之间的最长间隔 (反映串口指令的最长等待时间) 和表情从收到指令到全部舵机到位的时间
+unsigned long lastLoopMicros = 0;
+unsigned long loopMaxMicros = 0;
+unsigned long exprStartMillis = 0;
+bool exprRunning = false;
+unsigned long exprMaxMs = 0;
+unsigned long lastStatsMillis = 0;
+uint8_t statsLine = 0; // 下一行要输出的统计 (0表示没有)，每次loop()最多输出一行
+uint16_t reportedRxErrors = 0; // 上次统计行输出时的累计错误帧数
+
+// 查询指令0x50读取的运行时统计 (固定大小，AVR上共35字节)，与每5秒的统计行分别计算区间
+struct LoopStats
+{
+  uint32_t loops;
+  uint32_t loopSumUs;
+  uint16_t loopMinUs;
+  uint16_t loopMaxUs;
+  uint16_t commands;      // 移动了舵机的指令数
+  uint32_t cmdLatSumUs;   // 读出指令的第一个字节 -> 第一次I2C写入舵机
+  uint16_t cmdLatMaxUs;
+  uint8_t rxHighWater;    // 串口接收缓冲区的最高占用
+  uint16_t rxErrorsStart; // 区间开始时的累计错误帧数
+  uint16_t i2cFrames;
+  uint32_t i2cBytes;
+  uint32_t i2cSumUs;
+  uint16_t i2cMaxUs;
+};
+LoopStats loopStats;
+// 正在解析的指令的第一个字节被发现可读的时间 (循环开始时已在接收缓冲区中的字节按循环开始的时间计，
+// 所以延迟包含在缓冲区中的等待；字节到达与循环检查之间最多一个loop()周期无法测量)
+unsigned long commandRxMicros = 0;
+bool commandArmed = false;         // 有指令在等待第一次I2C写入
+unsigned long commandArmedMicros = 0;
+uint16_t moveCount = 0;            // 设定舵机目标的次数，用于判断指令是否移动了舵机
+
+// 16位统计字段饱和而不是回绕
+uint16_t sat16(uint32_t value) {
+  return value > 0xFFFF ? 0xFFFF : (uint16_t)value;
+}
+
+void keepMax(uint16_t &slot, uint32_t value) {
+  if (sat16(value) > slot) {
+    slot = sat16(value);
+  }
+}
+
+void resetLoopStats() {
+  memset(&loopStats, 0, sizeof(loopStats));
+  loopStats.loopMinUs = 0xFFFF;
+  loopStats.rxErrorsStart = link.errors();
+}
+
+// 设置SG90舵机角度 (写入影子寄存器，由flushFrame()在本节拍末尾统一写出)
+// servo: 舵机序号 (0 ~ SERVO_COUNT-1)，角度按该舵机的校准限位和trim换算
+void setSG90Angle(uint8_t servo, uint8_t angle) {
+  ServoConfig config = servo_config(servo);
+  frames[config.board].set(config.channel, servo_ticks(servo, angle));
+}
+
+// 每帧的I2C统计 (自上次报告起，只统计有写入的帧)
+unsigned int frameCount = 0;
+unsigned long frameBytes = 0;
+unsigned long frameMicros = 0;
+unsigned long frameMaxMicros = 0;
+unsigned int frameBursts = 0;
+
+// 把两块板上变化的通道写出，每段连续变化的通道一次I2C传输
+void flushFrame() {
+  unsigned long start = micros();
+  uint16_t bytes = frames[0].flush();
+  bytes += frames[1].flush();
+  if (bytes == 0) {
+    return;
+  }
+  unsigned long elapsed = micros() - start;
+  if (commandArmed) {
+    // 指令到第一次舵机写入: 包括等待下一个节拍和本帧之前的I2C传输
+    commandArmed = false;
+    uint32_t latency = start - commandArmedMicros;
+    loopStats.commands++;
+    loopStats.cmdLatSumUs += latency;
+    keepMax(loopStats.cmdLatMaxUs, latency);
   }
+  loopStats.i2cFrames++;
+  loopStats.i2cBytes += bytes;
+  loopStats.i2cSumUs += elapsed;
+  keepMax(loopStats.i2cMaxUs, elapsed);
+  frameCount++;
+  frameBytes += bytes;
+  frameMicros += elapsed;
+  frameBursts += frames[0].bursts() + frames[1].bursts();
+  if (elapsed > frameMaxMicros) {
+    frameMaxMicros = elapsed;
+  }
+}
+
+// 设定舵机的目标角度，由运动引擎按指定角速度和插值曲线逐步移动
+void moveServo(uint8_t servo, uint8_t angle, uint16_t speed = EXPRESSION_SPEED, uint8_t easing = EASE_IN_OUT) {
+  motion.moveTo(servo, angle, speed, easing, millis());
+  moveCount++;
+}
+
+// 播放一个到期的关键帧
+void applyKeyframe(const Keyframe &kf) {
+  for (uint8_t i = 0; i < kf.count; i++) {
+    moveServo(kf.servo[i], kf.angle[i], kf.speed * 4);
+  }
+}
+
+// 读取负载中的uint32 (小端)
+uint32_t readU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 写入回复负载中的uint16、uint32 (小端)，p移到下一个字段
+void putU16(uint8_t *&p, uint16_t value) {
+  *p++ = value & 0xFF;
+  *p++ = value >> 8;
+}
+
+void putU32(uint8_t *&p, uint32_t value) {
+  putU16(p, value & 0xFFFF);
+  putU16(p, value >> 16);
 }
 
 void setup() {
-  Serial.begin(9600);
+  Serial.begin(SERIAL_BAUD);
   Serial.println("21 SG90 Servo Control with 2x PCA9685 Initialized");
   pwm1.begin();
   pwm2.begin();
   pwm1.setPWMFreq(SG90_FREQ); // 设置PWM频率
-  pwm2.setPWMFreq(SG90_FREQ); // 设置PWM频率
+  pwm2.setPWMFreq(SG90_FREQ); // 设置PWM频率 (同时打开MODE1的寄存器自动递增)
   delay(10); // 等待PCA9685稳定
+  Wire.setClock(I2C_CLOCK);
+  frames[0].begin(Wire, 0x40);
+  frames[1].begin(Wire, 0x41);
+  motion.begin(servoMoves, SERVO_COUNT, setSG90Angle);
+  resetLoopStats();
+  timeline.begin(applyKeyframe);
+  blend.begin();
 }
 
-// 自然表情
-void netural()
-{
-  // --- PCA1 控制的舵机 ---
-  // 4 (PCA1): 60 - 100 degrees, 眼球左右, 60: 向左, 100: 向右
-  setSG90Angle(4, 80, 1); // 眼球居中或微向右
-  delay(DELAY_TIME);
-  // 5 (PCA1): 160 - 180 degrees, 眼球上下, 160: 向下, 180: 向上
-  setSG90Angle(5, 170, 1); // 眼球居中或微向上
-  delay(DELAY_TIME);
-  // 6 (PCA1): 95 - 170 degrees, 左上眼皮, 95: 向下(闭合), 170: 向上(张开)
-  setSG90Angle(6, 120, 1);
-  delay(DELAY_TIME);
-  // 7 (PCA1): 55 - 95 degrees, 左下眼皮, 55: 向下(张开), 95: 向上(闭合)
-  setSG90Angle(7, 60, 1);
-  delay(DELAY_TIME);
-  // 8 (PCA1): 0 - 70 degrees, 右上眼皮, 0: 向上(张开), 70: 向下(闭合)
-  setSG90Angle(8, 30, 1);
-  delay(DELAY_TIME);
-  // 9 (PCA1): 90 - 130 degrees, 右下眼皮, 90: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(9, 125, 1);
-  delay(DELAY_TIME);
-  
-  // 12 (PCA1): 0 - 50 degrees, 左侧正眉毛, 0: 向上, 50: 向下
-  setSG90Angle(12, 25, 1);
-  delay(DELAY_TIME);
-  // 13 (PCA1): 0 - 60 degrees, 左侧斜眉毛, 0: 向下, 60: 向上
-  setSG90Angle(13, 30, 1); 
-  delay(DELAY_TIME);
-  // 14 (PCA1): 0 - 30 degrees, 右侧正眉毛, 0: 向下, 30: 向上
-  setSG90Angle(14, 15, 1);
-  delay(DELAY_TIME);
-  // 15 (PCA1): 0 - 60 degrees, 右侧斜眉毛, 0: 向上, 60: 向下
-  setSG90Angle(15, 30, 1);
-  delay(DELAY_TIME);
-  
-  // --- PCA2 控制的舵机 ---
-  // 6 (PCA2): 70 - 140 degrees, 左下嘴, 70: 向下, 140: 向上
-  setSG90Angle(6, 110, 2);
-  delay(DELAY_TIME);
-  // 7 (PCA2): 0 - 70 degrees, 右下嘴, 0: 向上, 70: 向下
-  setSG90Angle(7, 35, 2);
-  delay(DELAY_TIME);
-  // 9 (PCA2): 150 - 190 degrees, 左上嘴, 150: 向下, 190: 向上
-  setSG90Angle(9, 180, 2);
-  delay(DELAY_TIME);
-  // 10 (PCA2):150 - 180 degrees, 右中嘴(upper), 150: 向上, 180: 向下
-  setSG90Angle(10, 150, 2);
-  delay(DELAY_TIME);
-  // 11 (PCA2): 150-190 degrees, 左中嘴(upper), 150: 向下, 190: 向上
-  setSG90Angle(11, 180, 2);
-  delay(DELAY_TIME);
-  // 12 (PCA2): 0 - 40 degrees, 右上嘴, 0: 向上, 40: 向下
-  setSG90Angle(12, 20, 2);
-  delay(DELAY_TIME);
-  // 13 (PCA2): 60 - 100 degrees, 右中嘴(low), 60: 向上, 100: 向下
-  setSG90Angle(13, 90, 2);
-  delay(DELAY_TIME);
-  // 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(14, 80, 2); // 嘴巴闭合
-  delay(DELAY_TIME);
-  // 15 (PCA2): 140-180 degrees, 左中嘴(low), 140: 向下, 180: 向上
-  setSG90Angle(15, 140, 2);
-  delay(DELAY_TIME);
+// 所有舵机并行移动到混合后的目标角度
+void applyBlend(uint16_t speed = EXPRESSION_SPEED) {
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++) {
+    if (gazeStreaming && (servo == SERVO_EYE_X || servo == SERVO_EYE_Y)) {
+      continue; // 眼球由注视流控制
+    }
+    moveServo(servo, blend.target(servo), speed);
+  }
 }
 
-// 开心表情
-void happiness()
-{
-  // --- PCA1 控制的舵机 (眼部和眉毛) ---
-  // 4 (PCA1): 60 - 100 degrees, 眼球左右, 60: 向左, 100: 向右
-  setSG90Angle(4, 80, 1); 
-  delay(DELAY_TIME);
-  // 5 (PCA1): 160 - 180 degrees, 眼球上下, 160: 向下, 180: 向上
-  setSG90Angle(5, 180, 1); // 眼睛向上看
-  delay(DELAY_TIME);
-  // 6 (PCA1): 95 - 170 degrees, 左上眼皮, 95: 向下(闭合), 170: 向上(张开)
-  setSG90Angle(6, 150, 1); // 眼皮张开
-  delay(DELAY_TIME);
-  // 7 (PCA1): 55 - 95 degrees, 左下眼皮, 55: 向下(张开), 95: 向上(闭合)
-  setSG90Angle(7, 55, 1); // 眼皮张开
-  delay(DELAY_TIME);
-  // 8 (PCA1): 0 - 70 degrees, 右上眼皮, 0: 向上(张开), 70: 向下(闭合)
-  setSG90Angle(8, 20, 1);  // 眼皮张开
-  delay(DELAY_TIME);
-  // 9 (PCA1): 90 - 130 degrees, 右下眼皮, 90: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(9, 130, 1); // 眼皮张开
-  delay(DELAY_TIME);
-  
-  // 12 (PCA1): 0 - 50 degrees, 左侧正眉毛, 0: 向上, 50: 向下
-  setSG90Angle(12, 0, 1);  // 眉毛上扬
-  delay(DELAY_TIME);
-  // 13 (PCA1): 0 - 60 degrees, 左侧斜眉毛, 0: 向下, 60: 向上
-  setSG90Angle(13, 60, 1); // 眉毛上扬
-  delay(DELAY_TIME);
-  // 14 (PCA1): 0 - 30 degrees, 右侧正眉毛, 0: 向下, 30: 向上
-  setSG90Angle(14, 30, 1); // 眉毛上扬
-  delay(DELAY_TIME);
-  // 15 (PCA1): 0 - 60 degrees, 右侧斜眉毛, 0: 向上, 60: 向下
-  setSG90Angle(15, 0, 1);  // 眉毛上扬
-  delay(DELAY_TIME);
-  
-  // --- PCA2 控制的舵机 (嘴部) ---
-  // 6 (PCA2): 70 - 140 degrees, 左下嘴, 70: 向下, 140: 向上
-  setSG90Angle(6, 140, 2); //嘴角上扬
-  delay(DELAY_TIME);
-  // 7 (PCA2): 0 - 70 degrees, 右下嘴, 0: 向上, 70: 向下
-  setSG90Angle(7, 0, 2);   //嘴角上扬
-  delay(DELAY_TIME);
-  // 9 (PCA2): 150 - 190 degrees, 左上嘴, 150: 向下, 190: 向上
-  setSG90Angle(9, 190, 2);
-  delay(DELAY_TIME);
-  // 10 (PCA2):150 - 180 degrees, 右中嘴(upper), 150: 向上, 180: 向下
-  setSG90Angle(10, 150, 2);
-  delay(DELAY_TIME);
-  // 11 (PCA2): 150-190 degrees, 左中嘴(upper), 150: 向下, 190: 向上
-  setSG90Angle(11, 190, 2);
-  delay(DELAY_TIME);
-  // 12 (PCA2): 0 - 40 degrees, 右上嘴, 0: 向上, 40: 向下
-  setSG90Angle(12, 0, 2);
-  delay(DELAY_TIME);
-  // 13 (PCA2): 60 - 100 degrees, 右中嘴(low), 60: 向上, 100: 向下
-  setSG90Angle(13, 60, 2);
-  delay(DELAY_TIME);
-  // 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(14, 120, 2); // 嘴巴微笑张开
-  delay(DELAY_TIME);
-  // 15 (PCA2): 140-180 degrees, 左中嘴(low), 140: 向下, 180: 向上
-  setSG90Angle(15, 180, 2);
-  delay(DELAY_TIME);
+// 设置表情: 单个表情的完整强度，目标角度与表情表相同
+void setPose(uint8_t pose) {
+  blend.clear();
+  blend.setWeight(pose, BLEND_FULL);
+  applyBlend();
 }
 
-// 伤心表情
-void sadness()
-{
-  // --- PCA1 控制的舵机 (眼部和眉毛) ---
-  // 4 (PCA1): 60 - 100 degrees, 眼球左右, 60: 向左, 100: 向右
-  setSG90Angle(4, 80, 1);
-  delay(DELAY_TIME);
-  // 5 (PCA1): 160 - 180 degrees, 眼球上下, 160: 向下, 180: 向上
-  setSG90Angle(5, 160, 1); // 眼睛向下看
-  delay(DELAY_TIME);
-  // 6 (PCA1): 95 - 170 degrees, 左上眼皮, 95: 向下(闭合), 170: 向上(张开)
-  setSG90Angle(6, 100, 1); // 眼皮下垂
-  delay(DELAY_TIME);
-  // 7 (PCA1): 55 - 95 degrees, 左下眼皮, 55: 向下(张开), 95: 向上(闭合)
-  setSG90Angle(7, 90, 1); 
-  delay(DELAY_TIME);
-  // 8 (PCA1): 0 - 70 degrees, 右上眼皮, 0: 向上(张开), 70: 向下(闭合)
-  setSG90Angle(8, 60, 1);  // 眼皮下垂
-  delay(DELAY_TIME);
-  // 9 (PCA1): 90 - 130 degrees, 右下眼皮, 90: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(9, 95, 1);
-  delay(DELAY_TIME);
-  
-  // 12 (PCA1): 0 - 50 degrees, 左侧正眉毛, 0: 向上, 50: 向下
-  setSG90Angle(12, 50, 1); // 眉毛向下
-  delay(DELAY_TIME);
-  // 13 (PCA1): 0 - 60 degrees, 左侧斜眉毛, 0: 向下, 60: 向上
-  setSG90Angle(13, 10, 1); // 眉毛呈八字
-  delay(DELAY_TIME);
-  // 14 (PCA1): 0 - 30 degrees, 右侧正眉毛, 0: 向下, 30: 向上
-  setSG90Angle(14, 0, 1);  // 眉毛向下
-  delay(DELAY_TIME);
-  // 15 (PCA1): 0 - 60 degrees, 右侧斜眉毛, 0: 向上, 60: 向下
-  setSG90Angle(15, 50, 1); // 眉毛呈八字
-  delay(DELAY_TIME);
-  
-  // --- PCA2 控制的舵机 (嘴部) ---
-  // 6 (PCA2): 70 - 140 degrees, 左下嘴, 70: 向下, 140: 向上
-  setSG90Angle(6, 70, 2);  // 嘴角向下
-  delay(DELAY_TIME);
-  // 7 (PCA2): 0 - 70 degrees, 右下嘴, 0: 向上, 70: 向下
-  setSG90Angle(7, 70, 2);  // 嘴角向下
-  delay(DELAY_TIME);
-  // 9 (PCA2): 150 - 190 degrees, 左上嘴, 150: 向下, 190: 向上
-  setSG90Angle(9, 150, 2);
-  delay(DELAY_TIME);
-  // 10 (PCA2):150 - 180 degrees, 右中嘴(upper), 150: 向上, 180: 向下
-  setSG90Angle(10, 180, 2);
-  delay(DELAY_TIME);
-  // 11 (PCA2): 150-190 degrees, 左中嘴(upper), 150: 向下, 190: 向上
-  setSG90Angle(11, 150, 2);
-  delay(DELAY_TIME);
-  // 12 (PCA2): 0 - 40 degrees, 右上嘴, 0: 向上, 40: 向下
-  setSG90Angle(12, 40, 2);
-  delay(DELAY_TIME);
-  // 13 (PCA2): 60 - 100 degrees, 右中嘴(low), 60: 向上, 100: 向下
-  setSG90Angle(13, 100, 2);
-  delay(DELAY_TIME);
-  // 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(14, 90, 2); // 嘴巴微张向下
-  delay(DELAY_TIME);
-  // 15 (PCA2): 140-180 degrees, 左中嘴(low), 140: 向下, 180: 向上
-  setSG90Angle(15, 140, 2);
-  delay(DELAY_TIME);
+// 收到注视流更新: 覆盖待处理的目标 (上一个目标还没被节拍取走时计为合并)
+void gazeStream(uint8_t x, uint8_t y) {
+  unsigned long now = millis();
+  if (!gazeStreaming) {
+    // 从眼球当前位置开始平滑
+    gazeX.reset(motion.angle(SERVO_EYE_X));
+    gazeY.reset(motion.angle(SERVO_EYE_Y));
+    gazeStreaming = true;
+  }
+  if (gazePending) {
+    gazeCoalesced++;
+  } else {
+    gazeArrivalMillis = now;
+    moveCount++; // 眼球在下一个节拍移动，与直接移动舵机的指令一样统计延迟
+  }
+  gazePending = true;
+  gazeTargetX = x;
+  gazeTargetY = y;
+  gazeLastMillis = now;
 }
 
-// 惊讶表情
-void surprise()
-{
-  // --- PCA1 控制的舵机 (眼部和眉毛) ---
-  // 4 (PCA1): 60 - 100 degrees, 眼球左右, 60: 向左, 100: 向右
-  setSG90Angle(4, 80, 1);
-  delay(DELAY_TIME);
-  // 5 (PCA1): 160 - 180 degrees, 眼球上下, 160: 向下, 180: 向上
-  setSG90Angle(5, 180, 1); // 眼睛向上看
-  delay(DELAY_TIME);
-  // 6 (PCA1): 95 - 170 degrees, 左上眼皮, 95: 向下(闭合), 170: 向上(张开)
-  setSG90Angle(6, 170, 1); // 眼皮完全张开
-  delay(DELAY_TIME);
-  // 7 (PCA1): 55 - 95 degrees, 左下眼皮, 55: 向下(张开), 95: 向上(闭合)
-  setSG90Angle(7, 55, 1);  // 眼皮完全张开
-  delay(DELAY_TIME);
-  // 8 (PCA1): 0 - 70 degrees, 右上眼皮, 0: 向上(张开), 70: 向下(闭合)
-  setSG90Angle(8, 0, 1);   // 眼皮完全张开
-  delay(DELAY_TIME);
-  // 9 (PCA1): 90 - 130 degrees, 右下眼皮, 90: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(9, 130, 1); // 眼皮完全张开
-  delay(DELAY_TIME);
-  
-  // 12 (PCA1): 0 - 50 degrees, 左侧正眉毛, 0: 向上, 50: 向下
-  setSG90Angle(12, 0, 1);  // 眉毛高扬
-  delay(DELAY_TIME);
-  // 13 (PCA1): 0 - 60 degrees, 左侧斜眉毛, 0: 向下, 60: 向上
-  setSG90Angle(13, 60, 1); // 眉毛高扬
-  delay(DELAY_TIME);
-  // 14 (PCA1): 0 - 30 degrees, 右侧正眉毛, 0: 向下, 30: 向上
-  setSG90Angle(14, 30, 1); // 眉毛高扬
-  delay(DELAY_TIME);
-  // 15 (PCA1): 0 - 60 degrees, 右侧斜眉毛, 0: 向上, 60: 向下
-  setSG90Angle(15, 0, 1);  // 眉毛高扬
-  delay(DELAY_TIME);
-  
-  // --- PCA2 控制的舵机 (嘴部) ---
-  // 6 (PCA2): 70 - 140 degrees, 左下嘴, 70: 向下, 140: 向上
-  setSG90Angle(6, 100, 2); 
-  delay(DELAY_TIME);
-  // 7 (PCA2): 0 - 70 degrees, 右下嘴, 0: 向上, 70: 向下
-  setSG90Angle(7, 40, 2);
-  delay(DELAY_TIME);
-  // 9 (PCA2): 150 - 190 degrees, 左上嘴, 150: 向下, 190: 向上
-  setSG90Angle(9, 170, 2);
-  delay(DELAY_TIME);
-  // 10 (PCA2):150 - 180 degrees, 右中嘴(upper), 150: 向上, 180: 向下
-  setSG90Angle(10, 165, 2);
-  delay(DELAY_TIME);
-  // 11 (PCA2): 150-190 degrees, 左中嘴(upper), 150: 向下, 190: 向上
-  setSG90Angle(11, 170, 2);
-  delay(DELAY_TIME);
-  // 12 (PCA2): 0 - 40 degrees, 右上嘴, 0: 向上, 40: 向下
-  setSG90Angle(12, 20, 2);
-  delay(DELAY_TIME);
-  // 13 (PCA2): 60 - 100 degrees, 右中嘴(low), 60: 向上, 100: 向下
-  setSG90Angle(13, 80, 2);
-  delay(DELAY_TIME);
-  // 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
-  setSG90Angle(14, 130, 2); // 嘴巴O型张开
-  delay(DELAY_TIME);
-  // 15 (PCA2): 140-180 degrees, 左中嘴(low), 140: 向下, 180: 向上
-  setSG90Angle(15, 160, 2);
-  delay(DELAY_TIME);
+// 每个节拍: 取走最新的目标，推进滤波器并设定眼球角度
+void gazeTick(unsigned long now) {
+  if (!gazeStreaming) {
+    return;
+  }
+  if (gazePending) {
+    gazePending = false;
+    gazeX.setTarget(gazeTargetX);
+    gazeY.setTarget(gazeTargetY);
+    unsigned long latency = now - gazeArrivalMillis;
+    gazeUpdates++;
+    gazeLatencySum += latency;
+    if (latency > gazeLatencyMax) {
+      gazeLatencyMax = latency;
+    }
+  }
+  moveServo(SERVO_EYE_X, gazeX.step(), 0);
+  moveServo(SERVO_EYE_Y, gazeY.step(), 0);
+  if (now - gazeLastMillis >= GAZE_STREAM_TIMEOUT && gazeX.settled() && gazeY.settled()) {
+    gazeStreaming = false;
+  }
+}
+
+// 眼皮直接到位 (眨眼叠加层改变后)
+void applyLids() {
+  for (uint8_t lid = SERVO_LID_FIRST; lid < SERVO_LID_FIRST + SERVO_LID_COUNT; lid++) {
+    moveServo(lid, blend.target(lid), 0);
+  }
 }
 
-// 眨眼动作
+// 眨眼动作: 闭眼，BLINK_CLOSED_MS后由loop()调用blinkRestore()睁眼
 void blink()
 {
-  // 闭眼动作
-  // 6 (PCA1) 左上眼皮: 95 向下(闭合)
-  // 7 (PCA1) 左下眼皮: 95 向上(闭合)
-  // 8 (PCA1) 右上眼皮: 70 向下(闭合)
-  // 9 (PCA1) 右下眼皮: 90 向上(闭合)
-  setSG90Angle(6, 95, 1);    // 左上眼皮向下闭合
-  setSG90Angle(7, 95, 1);    // 左下眼皮向上闭合
-  setSG90Angle(8, 70, 1);    // 右上眼皮向下闭合
-  setSG90Angle(9, 90, 1);    // 右下眼皮向上闭合
-  delay(200); // 闭眼持续时间
-
-  // 根据当前表情状态恢复眼皮位置
-  if(state == 0) { // 自然
-    setSG90Angle(6, 120, 1);
-    setSG90Angle(7, 60, 1);
-    setSG90Angle(8, 30, 1);
-    setSG90Angle(9, 125, 1);
-  } else if (state == 1) { // 开心
-    setSG90Angle(6, 150, 1);
-    setSG90Angle(7, 55, 1);
-    setSG90Angle(8, 20, 1);
-    setSG90Angle(9, 130, 1);
-  } else if (state == 2) { // 伤心
-    setSG90Angle(6, 100, 1);
-    setSG90Angle(7, 90, 1);
-    setSG90Angle(8, 60, 1);
-    setSG90Angle(9, 95, 1);
-  } else if (state == 3) { // 惊讶
-    setSG90Angle(6, 170, 1);
-    setSG90Angle(7, 55, 1);
-    setSG90Angle(8, 0, 1);
-    setSG90Angle(9, 130, 1);
-  }
+  blend.setBlink(BLEND_FULL);
+  applyLids();
+  blinkClosed = true;
+  blinkOpenMillis = millis() + BLINK_CLOSED_MS;
 }
 
-void loop() {
-  unsigned long currentMillis = millis(); // 获取当前时间
+// 睁眼: 去掉眨眼叠加层，眼皮回到当前混合表情的位置
+void blinkRestore()
+{
+  blinkClosed = false;
+  blend.setBlink(0);
+  applyLids();
+}
 
-  // --- 定时眨眼逻辑 ---
-  if (currentMillis - previousBlinkMillis >= BLINK_INTERVAL) {
-    previousBlinkMillis = currentMillis;
-    blink(); 
+// 回传确认: 旧协议为单字节 (指令 | LINK_ACK_FLAG)，v2为确认帧 (SEQ为0的帧不确认)
+void sendAck(uint8_t opcode, uint8_t seq, bool framed, uint8_t status) {
+  if (!framed) {
+    Serial.write(opcode | LINK_ACK_FLAG);
+    return;
   }
+  if (seq == 0) {
+    return;
+  }
+  uint8_t payload[2] = {status, LINK_VERSION};
+  uint8_t frame[sizeof(payload) + LINK_FRAME_OVERHEAD];
+  uint8_t len = opcode == LINK_OP_PING ? 2 : 1;
+  Serial.write(frame, link_encode(frame, seq, opcode | LINK_ACK_FLAG, payload, len));
+}
 
-  // --- 串口指令处理 ---
-  if(Serial.available()) {
-    int incomingByte = Serial.read(); // 读取指令字节
+// 回复查询指令: 状态 + LinkStats (见 serial_link.h)
+void sendStats(uint8_t seq) {
+  uint8_t payload[1 + LINK_STATS_BYTES];
+  uint8_t *p = payload;
+  const LoopStats &s = loopStats;
+  *p++ = LINK_DONE;
+  putU32(p, millis());
+  putU32(p, s.loops);
+  putU16(p, s.loops > 0 ? s.loopMinUs : 0);
+  putU16(p, s.loops > 0 ? sat16(s.loopSumUs / s.loops) : 0);
+  putU16(p, s.loopMaxUs);
+  putU16(p, s.commands);
+  putU16(p, s.commands > 0 ? sat16(s.cmdLatSumUs / s.commands) : 0);
+  putU16(p, s.cmdLatMaxUs);
+  *p++ = s.rxHighWater;
+  putU16(p, link.errors() - s.rxErrorsStart);
+  putU16(p, s.i2cFrames);
+  putU16(p, s.i2cFrames > 0 ? sat16(s.i2cBytes / s.i2cFrames) : 0);
+  putU16(p, s.i2cFrames > 0 ? sat16(s.i2cSumUs / s.i2cFrames) : 0);
+  putU16(p, s.i2cMaxUs);
+  uint8_t frame[sizeof(payload) + LINK_FRAME_OVERHEAD];
+  Serial.write(frame, link_encode(frame, seq, LINK_OP_STATS | LINK_ACK_FLAG, payload, sizeof(payload)));
+}
 
-    // 指令 0x02: 控制眼球运动 (需要额外两个字节数据 x, y)
-    if(incomingByte == 0x02) {
-      while(Serial.available() < 2) { // 等待接收完 x 和 y 坐标
-        delay(10); 
+// 表情、眼球和批量设置指令在所有舵机到位后确认，期间被新指令取代时立即确认
+void ackLater(const LinkCommand &cmd) {
+  if (ackPending.opcode >= 0) {
+    sendAck(ackPending.opcode, ackPending.seq, ackPending.framed, LINK_SUPERSEDED);
+  }
+  ackPending.opcode = cmd.opcode;
+  ackPending.seq = cmd.seq;
+  ackPending.framed = cmd.framed;
+  exprStartMillis = millis();
+  exprRunning = true;
+}
+
+// 处理一条串口指令 (每次loop()都会检查串口，动作由运动引擎在后续节拍中完成)
+void handleCommand(const LinkCommand &cmd) {
+  uint8_t opcode = cmd.opcode;
+  // 指令 0x01: 检查连接，确认中附带协议版本
+  if(opcode == LINK_OP_PING && cmd.len == 0) {
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE);
+    return;
+  }
+  // 指令 0x02: 控制眼球运动 (负载为 x, y 两个角度)
+  if(opcode == LINK_OP_GAZE && cmd.len == 2) {
+    gazeStreaming = false; // 单次设置结束注视流
+    gazePending = false;
+    moveServo(SERVO_EYE_X, cmd.payload[0]); // 控制眼球左右 (PCA1, Servo 4)
+    moveServo(SERVO_EYE_Y, cmd.payload[1]); // 控制眼球上下 (PCA1, Servo 5)
+    ackLater(cmd);
+    return;
+  }
+  // 指令 0x03: 注视流更新，不等待动作完成 (请求确认时立即确认)
+  if(opcode == LINK_OP_GAZE_STREAM && cmd.len == 2) {
+    gazeStream(cmd.payload[0], cmd.payload[1]);
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE);
+    return;
+  }
+  // 指令 0x10 ~ 0x16: 表情 (自然、开心、伤心、惊讶、愤怒、害怕、厌恶)
+  if(opcode >= LINK_OP_POSE && opcode < LINK_OP_POSE + POSE_COUNT && cmd.len == 0) {
+    setPose(opcode - LINK_OP_POSE);
+    ackLater(cmd);
+    return;
+  }
+  // 指令 0x21: 开始说话 (嘴部动画)，说话期间其他指令照常处理
+  if(opcode == LINK_OP_SPEAK_START && cmd.len == 0) {
+    speaking = true;
+    blend.setSpeaking(true);
+    mouth_flag = 1;
+    lastMouthMoveTime = millis();
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE); // 已进入说话动画
+    return;
+  }
+  // 指令 0x22: 停止说话
+  if(opcode == LINK_OP_SPEAK_STOP && cmd.len == 0) {
+    if (!speaking) {
+      sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE); // 没有在说话，无需动作
+      return;
+    }
+    speaking = false;
+    blend.setSpeaking(false);
+    blend.setJaw(0);
+    setPose(POSE_NEUTRAL); // 恢复到自然表情 (嘴巴同时闭合)
+    ackLater(cmd);
+    return;
+  }
+  // 指令 0x30: 批量设置舵机，一帧内的所有舵机同时开始运动 (只有v2帧支持)
+  if(opcode == LINK_OP_SET_SERVOS && cmd.len % 2 == 1) {
+    uint16_t speed = cmd.payload[0] * 4;
+    for (uint8_t i = 1; i < cmd.len; i += 2) {
+      if (cmd.payload[i] >= SERVO_COUNT) {
+        sendAck(opcode, cmd.seq, cmd.framed, LINK_REJECTED);
+        return;
       }
-      int x_angle = Serial.read(); // 读取眼球左右角度
-      int y_angle = Serial.read(); // 读取眼球上下角度
-      setSG90Angle(4, x_angle, 1); // 控制眼球左右 (PCA1, Servo 4)
-      setSG90Angle(5, y_angle, 1); // 控制眼球上下 (PCA1, Servo 5)
     }
-    // 指令 0x10: 自然表情
-    if(incomingByte == 0x10) {
-      state = 0;
-      netural();
+    for (uint8_t i = 1; i < cmd.len; i += 2) {
+      moveServo(cmd.payload[i], cmd.payload[i + 1], speed);
+    }
+    ackLater(cmd);
+    return;
+  }
+  // 指令 0x31: 表情混合，负载为角速度 + N组 (表情序号, 权重)，未列出的表情权重为0
+  if(opcode == LINK_OP_BLEND && cmd.len % 2 == 1) {
+    for (uint8_t i = 1; i < cmd.len; i += 2) {
+      if (cmd.payload[i] >= POSE_COUNT) {
+        sendAck(opcode, cmd.seq, cmd.framed, LINK_REJECTED);
+        return;
+      }
     }
-    // 指令 0x11: 开心表情
-    if(incomingByte == 0x11) {
-      state = 1;
-      happiness();
+    blend.clear();
+    for (uint8_t i = 1; i < cmd.len; i += 2) {
+      blend.setWeight(cmd.payload[i], cmd.payload[i + 1]);
     }
-    // 指令 0x12: 伤心表情
-    if(incomingByte == 0x12) {
-      state = 2;
-      sadness();
+    applyBlend(cmd.payload[0] * 4);
+    ackLater(cmd);
+    return;
+  }
+  // 指令 0x40: 同步轨道时钟 (轨道未开始时开始新轨道)
+  if(opcode == LINK_OP_TL_SYNC && cmd.len == 4) {
+    timeline.sync(readU32(cmd.payload), millis());
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE);
+    return;
+  }
+  // 指令 0x41: 关键帧，存入缓冲区后立即确认，到期时由loop()播放
+  if(opcode == LINK_OP_TL_KEYFRAME && cmd.len >= 5 && cmd.len % 2 == 1 &&
+     (cmd.len - 5) / 2 <= KEYFRAME_MAX_TARGETS) {
+    Keyframe kf;
+    kf.t_ms = readU32(cmd.payload);
+    kf.speed = cmd.payload[4];
+    kf.count = (cmd.len - 5) / 2;
+    for (uint8_t i = 0; i < kf.count; i++) {
+      kf.servo[i] = cmd.payload[5 + 2 * i];
+      kf.angle[i] = cmd.payload[6 + 2 * i];
+      if (kf.servo[i] >= SERVO_COUNT) {
+        sendAck(opcode, cmd.seq, cmd.framed, LINK_REJECTED);
+        return;
+      }
     }
-    // 指令 0x13: 惊讶表情
-    if(incomingByte == 0x13) {
-      state = 3;
-      surprise();
+    bool queued = timeline.push(kf, millis());
+    sendAck(opcode, cmd.seq, cmd.framed, queued ? LINK_DONE : LINK_REJECTED);
+    return;
+  }
+  // 指令 0x42: 结束轨道
+  if(opcode == LINK_OP_TL_END && cmd.len == 1) {
+    timeline.end(cmd.payload[0] != 0);
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_DONE);
+    return;
+  }
+  // 指令 0x50: 查询运行时统计，负载为1时读取后清零
+  if(opcode == LINK_OP_STATS && cmd.len <= 1) {
+    sendStats(cmd.seq);
+    if (cmd.len == 1 && cmd.payload[0] == 1) {
+      resetLoopStats();
     }
-    // 指令 0x21: 开始说话 (嘴部动画)
-    if(incomingByte == 0x21) {
-      int mouth_flag = 1; // 用于切换嘴部开合状态
-      unsigned long lastMouthMoveTime = millis();
-      unsigned long mouthMoveInterval = 250; // 嘴部开合动画的间隔时间
-
-      while(true){ // 循环播放说话动画直到接收到停止指令
-        unsigned long now = millis(); 
-
-        // 非阻塞嘴部动作: 在80度(闭合)和120度(张开)之间交替
-        if (now - lastMouthMoveTime >= mouthMoveInterval) {
-          lastMouthMoveTime = now;
-          // Servo 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
-          // 此处使用 80 和 120 进行动画
-          setSG90Angle(14, 100 + mouth_flag * 20, 2); // 切换到 80 或 120 度
-          mouth_flag = -mouth_flag; // 反转状态
-        }
-
-        // 检查停止说话指令 (0x22)
-        if(Serial.available()) {
-          int stopByte = Serial.read();
-          if(stopByte == 0x22) {
-            setSG90Angle(14, 80, 2); // 说话结束，嘴巴闭合
-            netural(); // 恢复到自然表情
-            break; // 退出说话动画循环
-          }
-        }
-        // 在说话时也保持眨眼
-        if (now - previousBlinkMillis >= BLINK_INTERVAL) {
-           previousBlinkMillis = now;
-           blink();
-        }
-        delay(5); // 短暂延迟，避免CPU占用过高
+    return;
+  }
+  // 未知指令或负载长度不对: v2帧回传拒绝，旧协议与原来一样忽略
+  if (cmd.framed) {
+    sendAck(opcode, cmd.seq, cmd.framed, LINK_REJECTED);
+  }
+}
+
+// 以JSON行输出区间内的最长loop()间隔、最长表情完成时间和丢弃的帧数 (JSON文本不含SYNC字节，不影响服务器解析确认)
+// 每行在发送缓冲区空出后才输出，115200波特率下一次输出全部统计行会让loop()等待十几毫秒
+void reportStats(uint8_t line) {
+  if (line == 1) {
+    Serial.print(F("{\"type\":\"servo_loop\",\"loop_us_max\":"));
+    Serial.print(loopMaxMicros);
+    Serial.print(F(",\"expr_ms_max\":"));
+    Serial.print(exprMaxMs);
+    Serial.print(F(",\"rx_err\":"));
+    Serial.print((uint16_t)(link.errors() - reportedRxErrors));
+    Serial.println(F("}"));
+    loopMaxMicros = 0;
+    exprMaxMs = 0;
+    reportedRxErrors = link.errors();
+  }
+  if (line == 2 && frameCount > 0) {
+    // 每帧的I2C字节数、传输次数和耗时
+    Serial.print(F("{\"type\":\"servo_frame\",\"frames\":"));
+    Serial.print(frameCount);
+    Serial.print(F(",\"bytes\":"));
+    Serial.print(frameBytes / frameCount);
+    Serial.print(F(",\"bursts\":"));
+    Serial.print((float)frameBursts / frameCount, 1);
+    Serial.print(F(",\"us\":"));
+    Serial.print(frameMicros / frameCount);
+    Serial.print(F(",\"us_max\":"));
+    Serial.print(frameMaxMicros);
+    Serial.println(F("}"));
+    frameCount = 0;
+    frameBytes = 0;
+    frameMicros = 0;
+    frameMaxMicros = 0;
+    frameBursts = 0;
+  }
+  if (line == 3 && (gazeUpdates > 0 || gazeCoalesced > 0)) {
+    // 注视流: 取走和被合并的更新数，更新到达到开始运动的平均和最长延迟
+    Serial.print(F("{\"type\":\"servo_gaze\",\"updates\":"));
+    Serial.print(gazeUpdates);
+    Serial.print(F(",\"coalesced\":"));
+    Serial.print(gazeCoalesced);
+    Serial.print(F(",\"lat_ms\":"));
+    Serial.print(gazeUpdates > 0 ? gazeLatencySum / gazeUpdates : 0);
+    Serial.print(F(",\"lat_ms_max\":"));
+    Serial.print(gazeLatencyMax);
+    Serial.println(F("}"));
+    gazeUpdates = 0;
+    gazeCoalesced = 0;
+    gazeLatencySum = 0;
+    gazeLatencyMax = 0;
+  }
+  const TimelineStats &tl = timeline.stats();
+  if (line == 4 && (tl.played > 0 || tl.overflows > 0)) {
+    // 关键帧轨道: 播放、迟到、欠载和溢出的关键帧数
+    Serial.print(F("{\"type\":\"servo_timeline\",\"played\":"));
+    Serial.print(tl.played);
+    Serial.print(F(",\"late\":"));
+    Serial.print(tl.late);
+    Serial.print(F(",\"underruns\":"));
+    Serial.print(tl.underruns);
+    Serial.print(F(",\"overflows\":"));
+    Serial.print(tl.overflows);
+    Serial.println(F("}"));
+    timeline.resetStats();
+  }
+}
+
+void loop() {
+  unsigned long nowMicros = micros();
+  if (lastLoopMicros != 0) {
+    unsigned long period = nowMicros - lastLoopMicros;
+    if (period > loopMaxMicros) {
+      loopMaxMicros = period;
+    }
+    loopStats.loops++;
+    loopStats.loopSumUs += period;
+    if (period < loopStats.loopMinUs) {
+      loopStats.loopMinUs = period;
+    }
+    keepMax(loopStats.loopMaxUs, period);
+  }
+  lastLoopMicros = nowMicros;
+  unsigned long currentMillis = millis(); // 获取当前时间
+
+  // --- 串口指令处理 (每次循环都检查) ---
+  int available = Serial.available();
+  if (available > loopStats.rxHighWater) {
+    loopStats.rxHighWater = available;
+  }
+  int waiting = available; // 循环开始时已在缓冲区中、尚未读出的字节数
+  while(Serial.available()) {
+    if (link.idle()) {
+      commandRxMicros = waiting > 0 ? nowMicros : micros();
+    }
+    waiting--;
+    if (link.feed(Serial.read(), currentMillis)) {
+      uint16_t moves = moveCount;
+      handleCommand(link.command());
+      if (moveCount != moves && !commandArmed) {
+        commandArmed = true; // 已有指令在等待时保留更早的那条，统计的是最长的等待
+        commandArmedMicros = commandRxMicros;
       }
     }
   }
-}
\ No newline at end of file
+
+  // --- 定时眨眼逻辑 ---
+  if (!blinkClosed && currentMillis - previousBlinkMillis >= BLINK_INTERVAL) {
+    previousBlinkMillis = currentMillis;
+    blink();
+  }
+  if (blinkClosed && (long)(currentMillis - blinkOpenMillis) >= 0) {
+    blinkRestore();
+  }
+
+  // --- 说话动画: 嘴部在80度(闭合)和120度(张开)之间交替 ---
+  if (speaking && currentMillis - lastMouthMoveTime >= MOUTH_MOVE_INTERVAL) {
+    lastMouthMoveTime = currentMillis;
+    // Servo 14 (PCA2): 80 - 130 degrees, 嘴张闭, 80: 向上(闭合), 130: 向下(张开)
+    blend.setJaw(mouth_flag > 0 ? BLEND_FULL : 0); // 任何表情下都在80度(闭合)和120度(张开)之间摆动
+    moveServo(SERVO_JAW, blend.target(SERVO_JAW), MOUTH_SPEED, EASE_OUT);
+    mouth_flag = -mouth_flag; // 反转状态
+  }
+
+  // --- 运动引擎: 每个节拍推进所有舵机 ---
+  if (currentMillis - lastMotionTick >= MOTION_TICK_MS) {
+    lastMotionTick = currentMillis;
+    timeline.update(currentMillis); // 到期的关键帧先设定目标，同一节拍内开始运动
+    gazeTick(currentMillis);
+    motion.update(currentMillis);
+    flushFrame();
+    if (exprRunning && !motion.busy()) {
+      exprRunning = false;
+      if (currentMillis - exprStartMillis > exprMaxMs) {
+        exprMaxMs = currentMillis - exprStartMillis;
+      }
+      if (ackPending.opcode >= 0) {
+        sendAck(ackPending.opcode, ackPending.seq, ackPending.framed, LINK_DONE);
+        ackPending.opcode = -1;
+      }
+    }
+  }
+
+  if (currentMillis - lastStatsMillis >= STATS_INTERVAL) {
+    lastStatsMillis = currentMillis;
+    statsLine = 1;
+  }
+  if (statsLine > 0 && Serial.availableForWrite() >= SERIAL_TX_BUFFER_SIZE - 1) {
+    reportStats(statsLine);
+    statsLine = statsLine < 4 ? statsLine + 1 : 0;
+  }
+}
@@ -0,0 +1,325 @@
+// 固件的主机端模拟测试: 在虚拟时间中运行 src/main.cpp 的 setup()/loop()，
+// 串口指令按时间安排输入，检查I2C写入的时序和PCA9685寄存器内容，并测量指令到舵机的延迟、
+// loop()周期和I2C流量
+// 运行: pio test -e native -f test_firmware_sim -v
+// 测试按顺序共享同一份固件状态 (全局变量)，每个测试从上一个测试结束的虚拟时间继续
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <vector>
+
+#include <Adafruit_PWMServoDriver.h>
+
+#include "face_pose.h"
+#include "host_sim.h"
+#include "pose_blend.h"
+#include "serial_link.h"
+
+// src/main.cpp
+void setup();
+void loop();
+
+void setUp() {}
+void tearDown() {}
+
+static const uint64_t MS = 1000;
+
+struct AckFrame
+{
+  uint64_t t_us;
+  uint8_t seq;
+  uint8_t opcode;
+  uint8_t status;
+};
+
+// 从串口输出中解析确认帧 (统计行的JSON文本不含SYNC字节)
+static std::vector<AckFrame> ack_frames(uint64_t since_us)
+{
+  std::vector<AckFrame> acks;
+  const std::vector<SimSerialByte> &tx = sim_serial_tx();
+  for (size_t i = 0; i + LINK_FRAME_OVERHEAD <= tx.size(); i++)
+  {
+    if (tx[i].byte != LINK_SYNC || tx[i].t_us < since_us)
+    {
+      continue;
+    }
+    uint8_t len = tx[i + 1].byte;
+    if (i + len + LINK_FRAME_OVERHEAD > tx.size())
+    {
+      break;
+    }
+    uint8_t crc = 0;
+    for (size_t j = 1; j < len + 4u; j++)
+    {
+      crc = link_crc8(crc, tx[i + j].byte);
+    }
+    if (crc == tx[i + len + 4].byte)
+    {
+      acks.push_back({tx[i].t_us, tx[i + 2].byte, tx[i + 3].byte, len > 0 ? tx[i + 4].byte : (uint8_t)0});
+      i += len + LINK_FRAME_OVERHEAD - 1;
+    }
+  }
+  return acks;
+}
+
+static void send_frame(uint64_t at_us, uint8_t seq, uint8_t opcode, const uint8_t *payload = nullptr, uint8_t len = 0)
+{
+  uint8_t frame[LINK_MAX_PAYLOAD + LINK_FRAME_OVERHEAD];
+  sim_serial_script(at_us, frame, link_encode(frame, seq, opcode, payload, len));
+}
+
+static uint16_t servo_register(uint8_t servo)
+{
+  ServoConfig config = servo_config(servo);
+  return sim_pca_off_ticks(0x40 + config.board, config.channel);
+}
+
+// 指令时间之后第一次写入舵机通道的时间 (跳过PCA9685的配置寄存器)
+static uint64_t first_servo_write(uint64_t since_us)
+{
+  for (const SimI2cWrite &w : sim_i2c_writes())
+  {
+    if (w.t_us >= since_us && w.bytes.size() > 1 && w.bytes[0] >= 0x06 && w.bytes[0] < 0x46)
+    {
+      return w.t_us;
+    }
+  }
+  return 0;
+}
+
+void test_setup_configures_boards()
+{
+  setup();
+  TEST_ASSERT_EQUAL(115200, sim_serial_baud());
+  TEST_ASSERT_EQUAL(400000, sim_i2c_clock());
+  for (uint8_t address = 0x40; address <= 0x41; address++)
+  {
+    // 25MHz / (4096 * 50Hz) - 1，四舍五入
+    TEST_ASSERT_EQUAL(121, sim_pca_register(address, PCA9685_PRESCALE));
+    TEST_ASSERT_TRUE(sim_pca_register(address, PCA9685_MODE1) & MODE1_AI);
+  }
+  // 上电后舵机位置未知，第一个表情直接到位 (与服务器启动后先发送自然表情相同)
+  send_frame(100 * MS, 0, LINK_OP_POSE + POSE_NEUTRAL);
+  sim_run_until(500 * MS, loop);
+  // 最长的一次loop()是写出全部19个舵机的一帧 (400kHz下约2ms)
+  TEST_ASSERT_TRUE(sim_loop_max_us() < 3000);
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+  {
+    TEST_ASSERT_EQUAL(servo_ticks(servo, pose_angle(POSE_NEUTRAL, servo)), servo_register(servo));
+  }
+}
+
+void test_pose_command_latency()
+{
+  const uint64_t t0 = 1000 * MS; // 避开3秒一次的眨眼
+  sim_i2c_clear();
+  send_frame(t0, 1, LINK_OP_POSE + POSE_HAPPINESS);
+  sim_run_until(t0 + 400 * MS, loop);
+
+  // 下一个运动节拍 (20ms) 内开始输出
+  uint64_t first = first_servo_write(t0);
+  TEST_ASSERT_TRUE(first > t0);
+  TEST_ASSERT_TRUE(first - t0 <= 21 * MS);
+  // 所有舵机并行运动，最远的40度在240度/秒下约167ms到位，之后确认
+  std::vector<AckFrame> acks = ack_frames(t0);
+  TEST_ASSERT_EQUAL(1, acks.size());
+  TEST_ASSERT_EQUAL(1, acks[0].seq);
+  TEST_ASSERT_EQUAL((LINK_OP_POSE + POSE_HAPPINESS) | LINK_ACK_FLAG, acks[0].opcode);
+  TEST_ASSERT_EQUAL(LINK_DONE, acks[0].status);
+  TEST_ASSERT_TRUE(acks[0].t_us - t0 <= 210 * MS);
+  printf("[sim] pose: first write %.1f ms, ack %.1f ms after command\n", (first - t0) / 1000.0,
+         (acks[0].t_us - t0) / 1000.0);
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+  {
+    TEST_ASSERT_EQUAL(servo_ticks(servo, pose_angle(POSE_HAPPINESS, servo)), servo_register(servo));
+  }
+}
+
+void test_split_legacy_gaze_does_not_block()
+{
+  // 旧协议的0x02，两个角度字节晚40ms才到: loop()不等待
+  const uint64_t t0 = 1500 * MS;
+  const uint8_t opcode[] = {LINK_OP_GAZE};
+  const uint8_t angles[] = {70, 170};
+  sim_serial_script(t0, opcode, 1);
+  sim_serial_script(t0 + 40 * MS, angles, 2);
+  sim_run_until(t0 + 400 * MS, loop);
+  TEST_ASSERT_TRUE(sim_loop_max_us() < 1000);
+  TEST_ASSERT_EQUAL(servo_ticks(SERVO_EYE_X, 70), servo_register(SERVO_EYE_X));
+  TEST_ASSERT_EQUAL(servo_ticks(SERVO_EYE_Y, 170), servo_register(SERVO_EYE_Y));
+  // 旧协议的确认为单字节
+  bool acked = false;
+  for (const SimSerialByte &b : sim_serial_tx())
+  {
+    acked |= b.t_us >= t0 && b.byte == (LINK_OP_GAZE | LINK_ACK_FLAG);
+  }
+  TEST_ASSERT_TRUE(acked);
+}
+
+void test_speaking_keeps_handling_commands()
+{
+  const uint64_t t0 = 2000 * MS;
+  send_frame(t0, 2, LINK_OP_SPEAK_START);
+  send_frame(t0 + 300 * MS, 3, LINK_OP_POSE + POSE_SADNESS);
+  // 每10ms采样嘴部寄存器，统计在闭合和张开两端之间往返的次数
+  // 任何表情下嘴部都在同样的两个角度之间摆动 (说话前的表情为开心，中途切换为伤心)
+  uint16_t closed = servo_ticks(SERVO_JAW, BLEND_JAW_CLOSED);
+  uint16_t open = servo_ticks(SERVO_JAW, BLEND_JAW_CLOSED + BLEND_JAW_RANGE);
+  int transitions = 0;
+  uint16_t last = 0;
+  for (uint64_t t = t0; t < t0 + 1000 * MS; t += 10 * MS)
+  {
+    sim_run_until(t + 10 * MS, loop);
+    uint16_t jaw = servo_register(SERVO_JAW);
+    if (jaw == closed || jaw == open)
+    {
+      transitions += last != 0 && jaw != last;
+      last = jaw;
+    }
+  }
+  // 250ms一次开合 (开心表情的嘴部已在张开的角度，第一次张开不产生运动)
+  TEST_ASSERT_TRUE(transitions >= 2);
+  std::vector<AckFrame> acks = ack_frames(t0);
+  TEST_ASSERT_EQUAL(2, acks.size());
+  TEST_ASSERT_EQUAL(2, acks[0].seq);
+  TEST_ASSERT_EQUAL(3, acks[1].seq);
+  TEST_ASSERT_EQUAL(LINK_DONE, acks[1].status);
+  send_frame(sim_now_us(), 4, LINK_OP_SPEAK_STOP);
+  sim_run_until(sim_now_us() + 400 * MS, loop);
+  TEST_ASSERT_EQUAL(servo_ticks(SERVO_JAW, pose_angle(POSE_NEUTRAL, SERVO_JAW)), servo_register(SERVO_JAW));
+}
+
+void test_i2c_transfers_fit_wire_buffer()
+{
+  TEST_ASSERT_EQUAL(0, sim_i2c_overflows());
+  for (const SimI2cWrite &w : sim_i2c_writes())
+  {
+    TEST_ASSERT_TRUE(w.bytes.size() <= BUFFER_LENGTH);
+  }
+  TEST_ASSERT_EQUAL(0, sim_serial_overruns());
+}
+
+void test_gaze_stream_benchmark()
+{
+  // 30Hz注视流5秒，期间每秒切换一次表情，统计loop()周期、I2C流量和指令延迟
+  const uint64_t t0 = sim_now_us() + 10 * MS;
+  const uint64_t duration = 5000 * MS;
+  for (uint64_t t = t0; t < t0 + duration; t += 33 * MS)
+  {
+    uint8_t gaze[] = {(uint8_t)(60 + (t / (33 * MS)) % 40), 170};
+    send_frame(t, 0, LINK_OP_GAZE_STREAM, gaze, 2);
+  }
+  for (int i = 0; i < 5; i++)
+  {
+    send_frame(t0 + i * 1000 * MS + 500 * MS, (uint8_t)(10 + i), LINK_OP_POSE + (i % POSE_COUNT));
+  }
+  sim_i2c_clear();
+  sim_serial_clear_tx();
+  sim_run_until(t0 + duration, loop);
+  uint64_t loop_max = sim_loop_max_us();
+
+  size_t bytes = 0;
+  for (const SimI2cWrite &w : sim_i2c_writes())
+  {
+    bytes += w.bytes.size() + 1;
+  }
+  std::vector<AckFrame> acks = ack_frames(t0);
+  TEST_ASSERT_EQUAL(5, acks.size());
+  double ack_sum = 0;
+  for (size_t i = 0; i < acks.size(); i++)
+  {
+    ack_sum += (acks[i].t_us - (t0 + i * 1000 * MS + 500 * MS)) / 1000.0;
+  }
+  printf("[sim] gaze stream 30Hz + pose/s: loop max %llu us, I2C %zu transfers, %.0f B/s, pose ack %.1f ms avg\n",
+         (unsigned long long)loop_max, sim_i2c_writes().size(), bytes * 1e6 / duration, ack_sum / acks.size());
+  // 统计行逐行在发送缓冲区空出后输出，loop()最长间隔不超过一帧完整的I2C传输
+  TEST_ASSERT_TRUE(loop_max < 3000);
+  TEST_ASSERT_EQUAL(0, sim_serial_overruns());
+  TEST_ASSERT_EQUAL(0, sim_i2c_overflows());
+}
+
+// 查询统计并解析回复帧的负载 (状态 + LinkStats)
+static std::vector<uint8_t> query_stats(uint8_t seq, bool reset)
+{
+  const uint8_t payload[] = {(uint8_t)(reset ? 1 : 0)};
+  uint64_t t0 = sim_now_us() + MS;
+  send_frame(t0, seq, LINK_OP_STATS, payload, 1);
+  sim_run_until(t0 + 20 * MS, loop);
+  const std::vector<SimSerialByte> &tx = sim_serial_tx();
+  for (size_t i = 0; i + LINK_FRAME_OVERHEAD <= tx.size(); i++)
+  {
+    if (tx[i].t_us >= t0 && tx[i].byte == LINK_SYNC && tx[i + 2].byte == seq &&
+        tx[i + 3].byte == (LINK_OP_STATS | LINK_ACK_FLAG))
+    {
+      std::vector<uint8_t> reply;
+      for (size_t j = 0; j < tx[i + 1].byte; j++)
+      {
+        reply.push_back(tx[i + 4 + j].byte);
+      }
+      return reply;
+    }
+  }
+  return {};
+}
+
+static uint32_t le(const std::vector<uint8_t> &p, size_t offset, size_t bytes)
+{
+  uint32_t value = 0;
+  for (size_t i = 0; i < bytes; i++)
+  {
+    value |= (uint32_t)p[offset + i] << (8 * i);
+  }
+  return value;
+}
+
+void test_stats_query()
+{
+  // 紧接注视流测试: 区间从上电开始，包含了前面所有测试的指令
+  std::vector<uint8_t> p = query_stats(20, true);
+  TEST_ASSERT_EQUAL(1 + LINK_STATS_BYTES, p.size());
+  TEST_ASSERT_EQUAL(LINK_DONE, p[0]);
+  uint32_t uptime = le(p, 1, 4);
+  uint32_t loops = le(p, 5, 4);
+  uint16_t loop_min = le(p, 9, 2), loop_mean = le(p, 11, 2), loop_max = le(p, 13, 2);
+  uint16_t commands = le(p, 15, 2), lat_mean = le(p, 17, 2), lat_max = le(p, 19, 2);
+  uint8_t rx_high = p[21];
+  uint16_t rx_errors = le(p, 22, 2);
+  uint16_t i2c_frames = le(p, 24, 2), i2c_bytes = le(p, 26, 2), i2c_mean = le(p, 28, 2), i2c_max = le(p, 30, 2);
+  printf("[sim] stats: %u loops, period %u/%u/%u us, %u commands, latency %u/%u us, rx high %u, "
+         "i2c %u frames %u B %u/%u us\n",
+         loops, loop_min, loop_mean, loop_max, commands, lat_mean, lat_max, rx_high, i2c_frames, i2c_bytes,
+         i2c_mean, i2c_max);
+  TEST_ASSERT_TRUE(uptime <= sim_now_us() / 1000 && uptime + 20 >= sim_now_us() / 1000);
+  TEST_ASSERT_TRUE(loops > 1000);
+  TEST_ASSERT_TRUE(loop_min <= loop_mean && loop_mean <= loop_max);
+  TEST_ASSERT_TRUE(loop_max < 3000);
+  // 包括表情、说话和注视流中没有被合并的帧
+  TEST_ASSERT_TRUE(commands > 100);
+  // 运动节拍为20ms: 平均不超过一个节拍；最长的是分两次到达的旧协议0x02 (从第一个字节算起，晚40ms)
+  TEST_ASSERT_TRUE(lat_mean <= 21000);
+  TEST_ASSERT_TRUE(lat_max >= 40000 && lat_max <= 61000);
+  TEST_ASSERT_TRUE(rx_high > 0 && rx_high <= SERIAL_RX_BUFFER_SIZE);
+  TEST_ASSERT_EQUAL(0, rx_errors);
+  TEST_ASSERT_TRUE(i2c_frames > 0 && i2c_bytes > 0);
+  TEST_ASSERT_TRUE(i2c_mean <= i2c_max && i2c_max < 3000);
+
+  // 上一次查询后清零: 新区间只包含这一次查询的20ms
+  p = query_stats(21, false);
+  TEST_ASSERT_EQUAL(1 + LINK_STATS_BYTES, p.size());
+  TEST_ASSERT_TRUE(le(p, 5, 4) < loops / 10);
+  TEST_ASSERT_EQUAL(0, le(p, 15, 2));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_setup_configures_boards);
+  RUN_TEST(test_pose_command_latency);
+  RUN_TEST(test_split_legacy_gaze_does_not_block);
+  RUN_TEST(test_speaking_keeps_handling_commands);
+  RUN_TEST(test_i2c_transfers_fit_wire_buffer);
+  RUN_TEST(test_gaze_stream_benchmark);
+  RUN_TEST(test_stats_query);
+  return UNITY_END();
+}
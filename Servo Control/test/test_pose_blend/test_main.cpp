@@ -0,0 +1,194 @@
+// 表情混合引擎的主机端测试: 与浮点参考实现比较混合结果，检查完整强度与表情表一致、
+// 眨眼和口型叠加层，并测量一次计算全部舵机目标的耗时
+// 运行: pio test -e native -f test_pose_blend -v
+
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "pose_blend.h"
+
+void setUp() {}
+void tearDown() {}
+
+// 浮点参考: 自然表情 + Σ (w / 255) × (表情 - 自然表情)，叠加层同样按比例插值
+static float reference(const uint8_t *weights, uint8_t blink, bool speaking, uint8_t jaw, uint8_t servo)
+{
+  float base = pose_angle(POSE_NEUTRAL, servo);
+  float angle = base;
+  for (uint8_t pose = POSE_NEUTRAL + 1; pose < POSE_COUNT; pose++)
+  {
+    angle += weights[pose] / 255.0f * ((float)pose_angle(pose, servo) - base);
+  }
+  angle = angle < 0 ? 0 : angle > 255 ? 255 : angle;
+  if (servo >= SERVO_LID_FIRST && servo < SERVO_LID_FIRST + SERVO_LID_COUNT)
+  {
+    angle += blink / 255.0f * (lid_closed_angle(servo - SERVO_LID_FIRST) - angle);
+  }
+  if (speaking && servo == SERVO_JAW)
+  {
+    angle = BLEND_JAW_CLOSED + jaw / 255.0f * BLEND_JAW_RANGE;
+  }
+  return angle < 0 ? 0 : angle > 255 ? 255 : angle;
+}
+
+void test_full_weight_matches_pose_table()
+{
+  PoseBlend blend;
+  blend.begin();
+  for (uint8_t pose = 0; pose < POSE_COUNT; pose++)
+  {
+    blend.clear();
+    blend.setWeight(pose, BLEND_FULL);
+    for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+    {
+      TEST_ASSERT_EQUAL(pose_angle(pose, servo), blend.target(servo));
+    }
+  }
+  // 没有权重时为自然表情
+  blend.clear();
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+  {
+    TEST_ASSERT_EQUAL(pose_angle(POSE_NEUTRAL, servo), blend.target(servo));
+  }
+}
+
+void test_intensity_is_halfway()
+{
+  PoseBlend blend;
+  blend.begin();
+  blend.setWeight(POSE_HAPPINESS, 128);
+  for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+  {
+    float half = (pose_angle(POSE_NEUTRAL, servo) + pose_angle(POSE_HAPPINESS, servo)) / 2.0f;
+    TEST_ASSERT_TRUE(fabsf(blend.target(servo) - half) <= 1.0f);
+  }
+}
+
+void test_matches_float_reference()
+{
+  PoseBlend blend;
+  blend.begin();
+  srand(1);
+  float max_error = 0;
+  double sum_error = 0;
+  int samples = 0;
+  for (int round = 0; round < 2000; round++)
+  {
+    uint8_t weights[POSE_COUNT] = {};
+    blend.clear();
+    // 一到三个表情混合，权重随机
+    int mixed = 1 + rand() % 3;
+    for (int i = 0; i < mixed; i++)
+    {
+      uint8_t pose = 1 + rand() % (POSE_COUNT - 1);
+      weights[pose] = (uint8_t)(rand() % 256);
+      blend.setWeight(pose, weights[pose]);
+    }
+    uint8_t blink = round % 4 == 0 ? (uint8_t)(rand() % 256) : 0;
+    bool speaking = round % 3 == 0;
+    uint8_t jaw = (uint8_t)(rand() % 256);
+    blend.setBlink(blink);
+    blend.setSpeaking(speaking);
+    blend.setJaw(jaw);
+    uint8_t targets[SERVO_COUNT];
+    blend.compute(targets);
+    for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+    {
+      float error = fabsf(targets[servo] - reference(weights, blink, speaking, jaw, servo));
+      max_error = error > max_error ? error : max_error;
+      sum_error += error;
+      samples++;
+    }
+  }
+  printf("[blend] vs float: max error=%.2f deg, mean=%.3f deg (%d targets)\n", max_error, sum_error / samples,
+         samples);
+  // 8位权重的量化误差加上整数舍入，不超过1.5度 (小于舵机的死区)
+  TEST_ASSERT_TRUE(max_error <= 1.5f);
+}
+
+void test_blink_overrides_lids()
+{
+  PoseBlend blend;
+  blend.begin();
+  blend.setWeight(POSE_SADNESS, BLEND_FULL);
+  blend.setBlink(BLEND_FULL);
+  for (uint8_t lid = 0; lid < SERVO_LID_COUNT; lid++)
+  {
+    TEST_ASSERT_EQUAL(lid_closed_angle(lid), blend.target(SERVO_LID_FIRST + lid));
+  }
+  // 其他舵机不受影响，睁眼后回到表情的位置
+  TEST_ASSERT_EQUAL(pose_angle(POSE_SADNESS, SERVO_EYE_X), blend.target(SERVO_EYE_X));
+  blend.setBlink(0);
+  for (uint8_t lid = 0; lid < SERVO_LID_COUNT; lid++)
+  {
+    TEST_ASSERT_EQUAL(pose_angle(POSE_SADNESS, SERVO_LID_FIRST + lid), blend.target(SERVO_LID_FIRST + lid));
+  }
+}
+
+void test_jaw_swings_within_travel()
+{
+  PoseBlend blend;
+  blend.begin();
+  // 不说话时嘴部为表情的角度，张嘴程度不起作用
+  blend.setJaw(BLEND_FULL);
+  TEST_ASSERT_EQUAL(80, blend.target(SERVO_JAW));
+  // 每个表情下都与原说话动画相同: 经过舵机行程限位后仍为80度闭合、120度张开
+  blend.setSpeaking(true);
+  const uint8_t poses[] = {POSE_NEUTRAL, POSE_HAPPINESS, POSE_SADNESS, POSE_SURPRISE, POSE_FEAR};
+  for (uint8_t pose : poses)
+  {
+    blend.clear();
+    blend.setWeight(pose, BLEND_FULL);
+    blend.setJaw(0);
+    TEST_ASSERT_EQUAL(servo_ticks(SERVO_JAW, 80), servo_ticks(SERVO_JAW, blend.target(SERVO_JAW)));
+    blend.setJaw(BLEND_FULL);
+    TEST_ASSERT_EQUAL(servo_ticks(SERVO_JAW, 120), servo_ticks(SERVO_JAW, blend.target(SERVO_JAW)));
+    // 其他舵机保持表情的角度
+    TEST_ASSERT_EQUAL(pose_angle(pose, SERVO_JAW - 1), blend.target(SERVO_JAW - 1));
+  }
+  // 停止说话后回到表情的嘴部角度
+  blend.setSpeaking(false);
+  TEST_ASSERT_EQUAL(pose_angle(POSE_FEAR, SERVO_JAW), blend.target(SERVO_JAW));
+}
+
+void test_blend_benchmark()
+{
+  PoseBlend blend;
+  blend.begin();
+  blend.setWeight(POSE_HAPPINESS, 180);
+  blend.setWeight(POSE_SURPRISE, 60);
+  blend.setBlink(100);
+  blend.setSpeaking(true);
+  blend.setJaw(200);
+  uint8_t targets[SERVO_COUNT];
+  const int runs = 100000;
+  unsigned checksum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; i++)
+  {
+    blend.setJaw((uint8_t)i);
+    blend.compute(targets);
+    checksum += targets[SERVO_JAW];
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / runs;
+  // ATmega328P上每个舵机约为 (1 + 活动表情数) 次PROGMEM读取和16x16位乘法，没有除法
+  printf("[blend] compute %d servos, 2 poses + overlays: %.1f ns (host), checksum=%u\n", SERVO_COUNT, ns,
+         checksum);
+  TEST_ASSERT_TRUE(checksum > 0);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_full_weight_matches_pose_table);
+  RUN_TEST(test_intensity_is_halfway);
+  RUN_TEST(test_matches_float_reference);
+  RUN_TEST(test_blink_overrides_lids);
+  RUN_TEST(test_jaw_swings_within_travel);
+  RUN_TEST(test_blend_benchmark);
+  return UNITY_END();
+}
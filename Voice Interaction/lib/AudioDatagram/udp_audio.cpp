@@ -0,0 +1,281 @@
+#include "udp_audio.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+  put_u16(p, (uint16_t)v);
+  put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static uint16_t get_u16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const uint8_t *p)
+{
+  return get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+size_t udp_audio_encode(uint8_t *out, size_t capacity, const UdpAudioHeader &header, const int16_t *pcm)
+{
+  size_t length = UDP_AUDIO_HEADER_BYTES + header.samples * sizeof(int16_t);
+  if (length > capacity)
+  {
+    return 0;
+  }
+  put_u16(out, UDP_AUDIO_MAGIC);
+  out[2] = UDP_AUDIO_VERSION;
+  out[3] = header.stream;
+  put_u16(out + 4, header.seq);
+  put_u16(out + 6, header.samples);
+  put_u32(out + 8, header.timestamp);
+  memcpy(out + UDP_AUDIO_HEADER_BYTES, pcm, header.samples * sizeof(int16_t));
+  return length;
+}
+
+bool udp_audio_decode(const uint8_t *packet, size_t length, UdpAudioHeader &header, const uint8_t **pcm)
+{
+  if (length < UDP_AUDIO_HEADER_BYTES || get_u16(packet) != UDP_AUDIO_MAGIC || packet[2] != UDP_AUDIO_VERSION)
+  {
+    return false;
+  }
+  header.stream = packet[3];
+  header.seq = get_u16(packet + 4);
+  header.samples = get_u16(packet + 6);
+  header.timestamp = get_u32(packet + 8);
+  if (length != UDP_AUDIO_HEADER_BYTES + header.samples * sizeof(int16_t))
+  {
+    return false;
+  }
+  *pcm = packet + UDP_AUDIO_HEADER_BYTES;
+  return true;
+}
+
+JitterBuffer::~JitterBuffer()
+{
+  free(pcm_);
+  free(frame_no_);
+  free(arrival_us_);
+  free(last_);
+}
+
+bool JitterBuffer::begin(uint16_t frame_samples, uint16_t slots, uint16_t min_frames, uint16_t max_frames,
+                         uint32_t sample_rate)
+{
+  if (frame_samples == 0 || slots == 0 || min_frames == 0 || min_frames > max_frames || max_frames + SKIP_MARGIN >= slots)
+  {
+    return false;
+  }
+  free(pcm_);
+  free(frame_no_);
+  free(arrival_us_);
+  free(last_);
+  frame_samples_ = frame_samples;
+  slots_ = slots;
+  min_frames_ = min_frames;
+  max_frames_ = max_frames;
+  sample_rate_ = sample_rate;
+  pcm_ = (int16_t *)malloc((size_t)slots * frame_samples * sizeof(int16_t));
+  frame_no_ = (uint32_t *)malloc(slots * sizeof(uint32_t));
+  arrival_us_ = (int64_t *)malloc(slots * sizeof(int64_t));
+  last_ = (int16_t *)malloc(frame_samples * sizeof(int16_t));
+  if (pcm_ == nullptr || frame_no_ == nullptr || arrival_us_ == nullptr || last_ == nullptr)
+  {
+    return false;
+  }
+  memset(&stats_, 0, sizeof(stats_));
+  stats_.target_frames = min_frames;
+  jitter_us_ = 0;
+  reset();
+  return true;
+}
+
+void JitterBuffer::reset()
+{
+  for (uint16_t i = 0; i < slots_; i++)
+  {
+    frame_no_[i] = EMPTY;
+  }
+  memset(last_, 0, frame_samples_ * sizeof(int16_t));
+  conceal_run_ = 0;
+  have_stream_ = false;
+  started_ = false;
+  next_frame_ = 0;
+  highest_frame_ = 0;
+  have_transit_ = false;
+}
+
+uint32_t JitterBuffer::depth() const
+{
+  return highest_frame_ >= next_frame_ ? highest_frame_ + 1 - next_frame_ : 0;
+}
+
+void JitterBuffer::updateTarget()
+{
+  // 目标深度覆盖约3倍抖动估计，外加正在播放的一帧
+  uint32_t frame_us = (uint32_t)((uint64_t)frame_samples_ * 1000000 / sample_rate_);
+  uint32_t frames = (3 * (uint32_t)jitter_us_ + frame_us - 1) / frame_us + 1;
+  if (frames < min_frames_)
+  {
+    frames = min_frames_;
+  }
+  if (frames > max_frames_)
+  {
+    frames = max_frames_;
+  }
+  stats_.target_frames = (uint16_t)frames;
+  stats_.jitter_us = (uint32_t)jitter_us_;
+}
+
+bool JitterBuffer::push(const uint8_t *packet, size_t length, int64_t now_us)
+{
+  UdpAudioHeader header;
+  const uint8_t *pcm;
+  if (!udp_audio_decode(packet, length, header, &pcm) || header.samples != frame_samples_ ||
+      header.timestamp % frame_samples_ != 0)
+  {
+    return false;
+  }
+  uint32_t frame = header.timestamp / frame_samples_;
+  if (!have_stream_ || header.stream != stream_)
+  {
+    // 新的一段音频: 丢弃上一段残留的数据
+    reset();
+    have_stream_ = true;
+    stream_ = header.stream;
+    first_arrival_us_ = now_us;
+    next_frame_ = frame;
+    highest_frame_ = frame;
+  }
+  if (frame < next_frame_)
+  {
+    if (started_)
+    {
+      stats_.late++;
+      return false;
+    }
+    next_frame_ = frame; // 预缓冲期间更早的包后到，向前扩展播放起点
+  }
+  if (frame >= next_frame_ + slots_ || (frame < highest_frame_ && highest_frame_ - frame >= slots_))
+  {
+    stats_.overflow++;
+    return false;
+  }
+  uint16_t slot = frame % slots_;
+  if (frame_no_[slot] == frame)
+  {
+    stats_.duplicates++;
+    return false;
+  }
+  frame_no_[slot] = frame;
+  arrival_us_[slot] = now_us;
+  memcpy(pcm_ + (size_t)slot * frame_samples_, pcm, frame_samples_ * sizeof(int16_t));
+  if (frame > highest_frame_)
+  {
+    highest_frame_ = frame;
+  }
+  stats_.received++;
+
+  // RFC 3550 到达抖动估计: J += (|D| - J) / 16
+  int64_t transit = now_us - (int64_t)header.timestamp * 1000000 / sample_rate_;
+  if (have_transit_)
+  {
+    int64_t d = transit - prev_transit_us_;
+    if (d < 0)
+    {
+      d = -d;
+    }
+    jitter_us_ += (int32_t)((d - jitter_us_) / 16);
+  }
+  prev_transit_us_ = transit;
+  have_transit_ = true;
+  updateTarget();
+  return true;
+}
+
+bool JitterBuffer::isSilent(const int16_t *frame) const
+{
+  uint32_t sum = 0;
+  for (uint16_t i = 0; i < frame_samples_; i++)
+  {
+    sum += frame[i] < 0 ? -frame[i] : frame[i];
+  }
+  return sum < (uint32_t)SILENCE_LEVEL * frame_samples_;
+}
+
+void JitterBuffer::conceal(int16_t *out)
+{
+  // 重复上一帧并每帧减半，连续4帧后输出静音
+  conceal_run_++;
+  int shift = conceal_run_ < 5 ? conceal_run_ : 15;
+  for (uint16_t i = 0; i < frame_samples_; i++)
+  {
+    out[i] = (int16_t)(last_[i] >> shift);
+  }
+}
+
+JitterResult JitterBuffer::pop(int16_t *out, int64_t now_us)
+{
+  if (!have_stream_)
+  {
+    return JITTER_WAITING;
+  }
+  uint32_t frame_us = (uint32_t)((uint64_t)frame_samples_ * 1000000 / sample_rate_);
+  if (!started_)
+  {
+    // 预缓冲: 等到缓冲深度或等待时间达到目标
+    if (depth() < stats_.target_frames && now_us - first_arrival_us_ < (int64_t)stats_.target_frames * frame_us)
+    {
+      return JITTER_WAITING;
+    }
+    started_ = true;
+  }
+
+  // 缓冲过深 (抖动减小或突发到达) 时丢弃静音帧，把延迟降回目标而不丢语音
+  while (depth() > (uint32_t)stats_.target_frames + SKIP_MARGIN && frame_no_[next_frame_ % slots_] == next_frame_ &&
+         isSilent(pcm_ + (size_t)(next_frame_ % slots_) * frame_samples_))
+  {
+    frame_no_[next_frame_ % slots_] = EMPTY;
+    stats_.skipped++;
+    next_frame_++;
+  }
+
+  uint16_t slot = next_frame_ % slots_;
+  if (frame_no_[slot] == next_frame_)
+  {
+    memcpy(out, pcm_ + (size_t)slot * frame_samples_, frame_samples_ * sizeof(int16_t));
+    memcpy(last_, out, frame_samples_ * sizeof(int16_t));
+    conceal_run_ = 0;
+    frame_no_[slot] = EMPTY;
+    uint32_t latency = (uint32_t)(now_us - arrival_us_[slot]);
+    stats_.latency_us_sum += latency;
+    if (latency > stats_.latency_us_max)
+    {
+      stats_.latency_us_max = latency;
+    }
+    stats_.played++;
+    next_frame_++;
+    return JITTER_PLAYED;
+  }
+
+  conceal(out);
+  stats_.concealed++;
+  if (depth() == 0)
+  {
+    stats_.underruns++; // 后续数据还没到: 原地等待，相当于增加一帧延迟
+  }
+  else
+  {
+    next_frame_++; // 后续数据已到，本帧视为丢失
+  }
+  return JITTER_CONCEALED;
+}
@@ -0,0 +1,110 @@
+#ifndef UDP_AUDIO_H
+#define UDP_AUDIO_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// UDP音频包格式 (小端):
+// magic(2) + version(1) + stream(1) + seq(2) + samples(2) + timestamp(4) + PCM
+// timestamp 为该包第一个样本在本段音频中的样本序号，丢包和乱序都按 timestamp 还原时间轴
+#define UDP_AUDIO_MAGIC 0x4155 // "UA"
+#define UDP_AUDIO_VERSION 1
+#define UDP_AUDIO_HEADER_BYTES 12
+#define UDP_AUDIO_FRAME_SAMPLES 256 // 每包最大样本数 (16ms @ 16kHz)，一个I2S缓冲区拆成4包
+
+// 下行语音头部的特殊长度值: 后跟4字节PCM总字节数，语音随后通过UDP流式发送 (文本仍走TCP)
+#define REPLY_UDP_STREAM 0xFFFFFFFDu
+
+struct UdpAudioHeader
+{
+  uint8_t stream;     // 音频段编号，每段语音递增，用于丢弃上一段的迟到包
+  uint16_t seq;       // 包序号
+  uint16_t samples;   // 本包样本数
+  uint32_t timestamp; // 第一个样本的样本序号
+};
+
+// 编码一个音频包，返回包长度 (缓冲区不足时返回0)
+size_t udp_audio_encode(uint8_t *out, size_t capacity, const UdpAudioHeader &header, const int16_t *pcm);
+// 解码一个音频包，pcm指向包内的样本数据 (可能未对齐，按字节读取)
+bool udp_audio_decode(const uint8_t *packet, size_t length, UdpAudioHeader &header, const uint8_t **pcm);
+
+// 出队结果
+enum JitterResult
+{
+  JITTER_WAITING,   // 还在预缓冲，不输出
+  JITTER_PLAYED,    // 输出了一帧收到的音频
+  JITTER_CONCEALED, // 输出了一帧丢包隐藏音频
+};
+
+// 抖动缓冲统计 (自begin()起累计，reset()不清零)
+struct JitterStats
+{
+  uint32_t received;       // 入队的包数
+  uint32_t duplicates;     // 重复包
+  uint32_t late;           // 播放位置已越过的迟到包
+  uint32_t overflow;       // 超出缓冲窗口的包
+  uint32_t played;         // 正常播放的帧数
+  uint32_t concealed;      // 丢包隐藏帧数 (含欠载)
+  uint32_t underruns;      // 其中因没有后续数据而原地等待的次数 (延迟随之增大)
+  uint32_t skipped;        // 缓冲过深时丢弃的静音帧数 (延迟随之减小)
+  uint32_t latency_us_max; // 包到达到播放的最大时间
+  uint64_t latency_us_sum; // 包到达到播放的累计时间 (除以played得平均值)
+  uint32_t jitter_us;      // 当前到达间隔抖动估计 (RFC 3550)
+  uint16_t target_frames;  // 当前目标缓冲帧数
+};
+
+// 接收端自适应抖动缓冲: 按 timestamp 重排音频包，以固定帧节拍输出
+// 目标深度随到达抖动估计调整: 欠载时原地隐藏一帧 (增大延迟)，缓冲过深时丢弃静音帧 (减小延迟)
+// 丢包用上一帧逐帧衰减重复隐藏
+class JitterBuffer
+{
+public:
+  ~JitterBuffer();
+  // frame_samples: 每包样本数; slots: 缓冲窗口帧数; min_frames/max_frames: 目标深度范围
+  bool begin(uint16_t frame_samples, uint16_t slots, uint16_t min_frames, uint16_t max_frames, uint32_t sample_rate);
+  // 开始新的一段音频 (清空缓冲，保留统计)
+  void reset();
+  // 入队一个音频包，now_us为到达时间
+  bool push(const uint8_t *packet, size_t length, int64_t now_us);
+  // 按帧节拍调用，输出frame_samples个样本
+  JitterResult pop(int16_t *out, int64_t now_us);
+
+  uint32_t position() const { return next_frame_ * frame_samples_; } // 已播放到的样本序号
+  uint16_t frameSamples() const { return frame_samples_; }
+  JitterStats stats() const { return stats_; }
+
+private:
+  static const uint32_t EMPTY = 0xffffffffu;
+  static const uint16_t SKIP_MARGIN = 2;    // 超过目标深度多少帧时开始丢弃静音帧
+  static const uint16_t SILENCE_LEVEL = 64; // 静音帧的平均幅度上限
+
+  uint32_t depth() const;
+  void updateTarget();
+  bool isSilent(const int16_t *frame) const;
+  void conceal(int16_t *out);
+
+  uint16_t frame_samples_ = 0;
+  uint16_t slots_ = 0;
+  uint16_t min_frames_ = 1;
+  uint16_t max_frames_ = 1;
+  uint32_t sample_rate_ = 16000;
+
+  int16_t *pcm_ = nullptr;       // slots * frame_samples
+  uint32_t *frame_no_ = nullptr; // 每个槽位中存放的帧号
+  int64_t *arrival_us_ = nullptr;
+  int16_t *last_ = nullptr;      // 上一帧输出，用于丢包隐藏
+  uint8_t conceal_run_ = 0;      // 连续隐藏帧数
+
+  bool have_stream_ = false;
+  bool started_ = false;
+  uint8_t stream_ = 0;
+  uint32_t next_frame_ = 0;
+  uint32_t highest_frame_ = 0;
+  int64_t first_arrival_us_ = 0;
+  bool have_transit_ = false;
+  int64_t prev_transit_us_ = 0;
+  int32_t jitter_us_ = 0;
+  JitterStats stats_ = {};
+};
+
+#endif // UDP_AUDIO_H
@@ -0,0 +1,164 @@
+#include "audio_health.h"
+
+#include <string.h>
+
+void AudioHealth::begin(uint32_t sample_rate, size_t block_samples)
+{
+  sample_rate_ = sample_rate;
+  paced_us_ = (int64_t)block_samples * 1000000 / sample_rate / 2;
+  capturing_ = false;
+  playing_ = false;
+  memset(&turn_, 0, sizeof(turn_));
+  memset(&totals_, 0, sizeof(totals_));
+  paceReset(capture_pace_);
+  paceReset(playback_pace_);
+}
+
+void AudioHealth::paceReset(PaceMeter &meter)
+{
+  memset(&meter, 0, sizeof(meter));
+}
+
+void AudioHealth::paceNote(PaceMeter &meter, size_t samples, int64_t start_us, int64_t end_us)
+{
+  if (!meter.started)
+  {
+    // 第一次等待DMA的调用结束时DMA缓冲刚好被取空 (或填满)，从这里开始计时
+    if (end_us - start_us >= paced_us_)
+    {
+      meter.started = true;
+      meter.start_us = end_us;
+      meter.last_us = end_us;
+    }
+    return;
+  }
+  meter.samples += samples;
+  meter.last_us = end_us;
+}
+
+uint32_t AudioHealth::paceHz(const PaceMeter &meter) const
+{
+  int64_t elapsed = meter.last_us - meter.start_us;
+  if (!meter.started || elapsed < MIN_RATE_WINDOW_US)
+  {
+    return 0;
+  }
+  return (uint32_t)((meter.samples * 1000000 + elapsed / 2) / elapsed);
+}
+
+void AudioHealth::beginCapture(int64_t now_us)
+{
+  capturing_ = true;
+  capture_start_us_ = now_us;
+  paceReset(capture_pace_);
+}
+
+void AudioHealth::endCapture(int64_t now_us)
+{
+  if (!capturing_)
+  {
+    return;
+  }
+  capturing_ = false;
+  turn_.capture_ms += (uint32_t)((now_us - capture_start_us_) / 1000);
+  turn_.capture_hz = paceHz(capture_pace_);
+}
+
+void AudioHealth::beginPlayback(int64_t now_us)
+{
+  playing_ = true;
+  playback_start_us_ = now_us;
+  paceReset(playback_pace_);
+}
+
+void AudioHealth::endPlayback(int64_t now_us)
+{
+  if (!playing_)
+  {
+    return;
+  }
+  playing_ = false;
+  turn_.playback_ms += (uint32_t)((now_us - playback_start_us_) / 1000);
+  turn_.playback_hz = paceHz(playback_pace_);
+}
+
+void AudioHealth::noteRead(size_t requested, size_t transferred, int64_t start_us, int64_t end_us)
+{
+  if (!capturing_)
+  {
+    return;
+  }
+  turn_.reads++;
+  if (transferred < requested)
+  {
+    turn_.short_reads++;
+  }
+  paceNote(capture_pace_, transferred / sizeof(int16_t), start_us, end_us);
+}
+
+void AudioHealth::noteWrite(size_t requested, size_t transferred, int64_t start_us, int64_t end_us)
+{
+  if (!playing_)
+  {
+    return;
+  }
+  turn_.writes++;
+  turn_.samples_played += transferred / sizeof(int16_t);
+  if (transferred < requested)
+  {
+    turn_.short_writes++;
+  }
+  paceNote(playback_pace_, transferred / sizeof(int16_t), start_us, end_us);
+}
+
+void AudioHealth::noteEvent(AudioHealthEvent event)
+{
+  switch (event)
+  {
+  case HEALTH_RX_OVERFLOW:
+    if (capturing_)
+    {
+      turn_.rx_overflow++;
+    }
+    break;
+  case HEALTH_TX_UNDERFLOW:
+    // 第一次写入之前DMA缓冲本来就是空的
+    if (playing_ && turn_.writes > 0)
+    {
+      turn_.tx_underflow++;
+    }
+    break;
+  default:
+    if (capturing_ || playing_)
+    {
+      turn_.dma_errors++;
+    }
+    break;
+  }
+}
+
+void AudioHealth::noteClipped(size_t samples)
+{
+  if (playing_)
+  {
+    turn_.clipped += samples;
+  }
+}
+
+AudioHealthTurn AudioHealth::endTurn()
+{
+  AudioHealthTurn turn = turn_;
+  totals_.turns++;
+  if (turn.short_reads + turn.short_writes + turn.rx_overflow + turn.tx_underflow + turn.dma_errors > 0)
+  {
+    totals_.glitch_turns++;
+  }
+  totals_.short_reads += turn.short_reads;
+  totals_.short_writes += turn.short_writes;
+  totals_.rx_overflow += turn.rx_overflow;
+  totals_.tx_underflow += turn.tx_underflow;
+  totals_.dma_errors += turn.dma_errors;
+  totals_.clipped += turn.clipped;
+  memset(&turn_, 0, sizeof(turn_));
+  return turn;
+}
@@ -0,0 +1,102 @@
+#ifndef AUDIO_HEALTH_H
+#define AUDIO_HEALTH_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// I2S驱动事件 (由设备端从I2S事件队列中取出后转换，主机端测试直接注入)
+enum AudioHealthEvent
+{
+  HEALTH_RX_OVERFLOW,  // 麦克风DMA缓冲溢出: 没有及时读取，最旧的音频块被覆盖
+  HEALTH_TX_UNDERFLOW, // 放大器DMA缓冲取空: 没有及时写入，播放出现空白
+  HEALTH_DMA_ERROR,    // DMA描述符错误
+};
+
+// 一轮对话 (一次录音加一次回复播放) 的音频通路统计
+struct AudioHealthTurn
+{
+  uint32_t reads;          // 录音期间的i2s_read次数
+  uint32_t short_reads;    // 读到的字节数少于请求 (含返回错误)
+  uint32_t writes;         // 播放期间的i2s_write次数
+  uint32_t short_writes;   // 写入的字节数少于请求 (含返回错误)
+  uint32_t rx_overflow;    // 录音期间的麦克风DMA溢出次数 (每次丢失一个DMA块)
+  uint32_t tx_underflow;   // 播放期间的放大器DMA取空次数
+  uint32_t dma_errors;
+  uint32_t clipped;        // 音量缩放时被削顶的样本数
+  uint32_t samples_played; // 播放的样本数 (削顶比例的分母)
+  uint32_t capture_ms;     // 录音窗口时长
+  uint32_t playback_ms;    // 播放窗口时长
+  uint32_t capture_hz;     // 实测采集采样率 (0: 可测量的时间不足)
+  uint32_t playback_hz;    // 实测播放采样率 (0: 可测量的时间不足，例如按时钟节拍写入的UDP流式播放)
+};
+
+// 累计统计 (自begin()起)
+struct AudioHealthTotals
+{
+  uint32_t turns;
+  uint32_t glitch_turns; // 出现过短读写、溢出、取空或DMA错误的轮数
+  uint32_t short_reads;
+  uint32_t short_writes;
+  uint32_t rx_overflow;
+  uint32_t tx_underflow;
+  uint32_t dma_errors;
+  uint64_t clipped;
+};
+
+// I2S音频通路健康监测: 统计短读写、DMA溢出/取空事件、削顶样本和实测采样率
+// 只在录音窗口和播放窗口内计数 (两轮对话之间麦克风不被读取，DMA溢出是预期行为)
+// 实测采样率 = 阻塞读写期间传输的样本数 / 经过的时间；从第一次真正等待DMA的调用开始计时，
+// 之前的调用只是取出 (或填满) 已有的DMA缓冲，会使速率偏高
+class AudioHealth
+{
+public:
+  // block_samples: 一个DMA块的样本数，读写耗时超过半个块时长才视为在等待DMA
+  void begin(uint32_t sample_rate, size_t block_samples);
+
+  void beginCapture(int64_t now_us);
+  void endCapture(int64_t now_us);
+  void beginPlayback(int64_t now_us);
+  void endPlayback(int64_t now_us);
+
+  // 一次读写调用: 请求和实际传输的字节数，调用前后的时间
+  void noteRead(size_t requested, size_t transferred, int64_t start_us, int64_t end_us);
+  void noteWrite(size_t requested, size_t transferred, int64_t start_us, int64_t end_us);
+  void noteEvent(AudioHealthEvent event);
+  void noteClipped(size_t samples);
+
+  // 结束一轮: 计入累计统计并返回本轮结果，然后清零
+  AudioHealthTurn endTurn();
+  const AudioHealthTurn &turn() const { return turn_; }
+  const AudioHealthTotals &totals() const { return totals_; }
+  uint32_t sampleRate() const { return sample_rate_; }
+
+private:
+  static const int64_t MIN_RATE_WINDOW_US = 500000; // 测量窗口短于此时不给出采样率
+
+  // 按阻塞调用测量传输速率
+  struct PaceMeter
+  {
+    bool started;
+    int64_t start_us;
+    int64_t last_us;
+    uint64_t samples;
+  };
+  void paceReset(PaceMeter &meter);
+  void paceNote(PaceMeter &meter, size_t samples, int64_t start_us, int64_t end_us);
+  uint32_t paceHz(const PaceMeter &meter) const;
+
+  uint32_t sample_rate_ = 0;
+  int64_t paced_us_ = 0; // 超过此耗时的调用视为在等待DMA
+
+  bool capturing_ = false;
+  bool playing_ = false;
+  int64_t capture_start_us_ = 0;
+  int64_t playback_start_us_ = 0;
+  PaceMeter capture_pace_ = {};
+  PaceMeter playback_pace_ = {};
+
+  AudioHealthTurn turn_ = {};
+  AudioHealthTotals totals_ = {};
+};
+
+#endif // AUDIO_HEALTH_H
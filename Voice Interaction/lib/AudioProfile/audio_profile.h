@@ -0,0 +1,80 @@
+#ifndef AUDIO_PROFILE_H
+#define AUDIO_PROFILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 音频管线编译期配置: 由采样率、块时长、DMA缓冲数、预读块数和VAD阈值推导所有缓冲区大小、队列深度和块时长，
+// 参数之间不一致时在编译期报错，而不是运行时悄悄出错
+template <uint32_t SampleRate, uint32_t BlockMs, uint8_t DmaBuffers, uint8_t PrerollBlocks, int32_t VadEnergy>
+struct AudioProfile
+{
+  static constexpr uint32_t sample_rate = SampleRate;
+  static constexpr uint32_t block_ms = BlockMs;                              // 一个I2S DMA缓冲区的时长
+  static constexpr size_t block_samples = SampleRate / 1000 * BlockMs;       // I2S DMA缓冲区大小 (样本数)
+  static constexpr size_t block_bytes = block_samples * sizeof(int16_t);
+  static constexpr uint8_t dma_buffers = DmaBuffers;                         // 每个I2S端口的DMA缓冲区数
+  static constexpr uint32_t dma_ms = BlockMs * DmaBuffers;                   // DMA缓冲的总时长
+  static constexpr size_t preroll_samples = block_samples * PrerollBlocks;   // 会话中首次VAD检测读取的样本数
+  static constexpr uint32_t preroll_ms = BlockMs * PrerollBlocks;
+  static constexpr int32_t vad_energy = VadEnergy;                           // VAD能量阈值 (块内样本平方的平均值)
+  static constexpr size_t udp_frame_samples = SampleRate / 1000 * 16;        // UDP音频包样本数 (16ms)
+
+  // 按时长换算为块数 (向上取整)
+  static constexpr size_t blocksFor(uint32_t ms) { return (ms + BlockMs - 1) / BlockMs; }
+
+  static_assert(SampleRate % 1000 == 0, "采样率必须是整千赫兹，块时长才能精确到毫秒");
+  static_assert(block_samples >= 64 && block_samples <= 1024, "ESP32 I2S 的 dma_buf_len 范围为 8~1024 样本");
+  static_assert(block_samples % udp_frame_samples == 0, "一个块必须能拆成整数个UDP音频包");
+  static_assert(DmaBuffers >= 2 && DmaBuffers <= 128, "ESP32 I2S 的 dma_buf_count 范围为 2~128");
+  static_assert(PrerollBlocks >= 1 && PrerollBlocks <= DmaBuffers,
+                "预读块数不能超过DMA缓冲数，否则首次读取期间麦克风数据会溢出");
+  static_assert(VadEnergy > 0, "VAD能量阈值必须为正");
+};
+
+// 16kHz: 默认配置，与服务器的语音识别和TTS采样率一致
+typedef AudioProfile<16000, 64, 8, 8, 10000> AudioProfile16k;
+// 8kHz低带宽: 上行和下行字节数减半，块时长不变 (512样本)；窄带语音能量略低，VAD阈值相应下调
+typedef AudioProfile<8000, 64, 8, 8, 8000> AudioProfile8k;
+
+// 块平均能量 (样本平方的平均值)，与VAD和端点检测使用的定义一致
+inline int32_t audio_block_energy(const int16_t *samples, size_t count)
+{
+  if (count == 0)
+  {
+    return 0;
+  }
+  int64_t energy = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    energy += (int32_t)samples[i] * samples[i];
+  }
+  return (int32_t)(energy / (int64_t)count);
+}
+
+// 音量增益 (Q15定点，32768为原始音量)；每块只换算一次，避免逐样本双精度乘法 (ESP32-S3 没有双精度FPU)
+inline int32_t audio_gain_q15(double volume)
+{
+  // 上限为2倍音量，保证 样本 x 增益 不超出int32
+  return volume <= 0 ? 0 : (volume >= 2.0 ? 65535 : (int32_t)(volume * 32768.0 + 0.5));
+}
+
+inline int16_t audio_saturate(int32_t value)
+{
+  return value > 32767 ? 32767 : (value < -32768 ? -32768 : (int16_t)value);
+}
+
+// 按增益缩放并饱和，返回被削顶的样本数
+inline size_t audio_apply_gain(int16_t *samples, size_t count, int32_t gain_q15)
+{
+  size_t clipped = 0;
+  for (size_t i = 0; i < count; i++)
+  {
+    int32_t value = (samples[i] * gain_q15) >> 15;
+    clipped += value > 32767 || value < -32768;
+    samples[i] = audio_saturate(value);
+  }
+  return clipped;
+}
+
+#endif // AUDIO_PROFILE_H
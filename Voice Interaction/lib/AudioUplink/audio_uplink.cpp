@@ -0,0 +1,416 @@
+#include "audio_uplink.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+#include "esp_timer.h"
+
+static int64_t uplink_now_us()
+{
+  return esp_timer_get_time();
+}
+#else
+#include <chrono>
+
+static int64_t uplink_now_us()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+#endif
+
+AudioUplink::~AudioUplink()
+{
+  free(pool_);
+  free(free_slots_);
+  free(ring_);
+#if defined(ARDUINO)
+  if (data_ready_ != nullptr)
+  {
+    vSemaphoreDelete(data_ready_);
+  }
+  if (space_ready_ != nullptr)
+  {
+    vSemaphoreDelete(space_ready_);
+  }
+#endif
+}
+
+bool AudioUplink::begin(size_t frames, size_t frame_bytes, UplinkPolicy policy, uint32_t block_ms)
+{
+  if (frames == 0 || frames > 0xffff || frame_bytes == 0 || frame_bytes % sizeof(int16_t) != 0)
+  {
+    return false;
+  }
+  free(pool_);
+  free(free_slots_);
+  free(ring_);
+  pool_frames_ = frames;
+  frame_bytes_ = frame_bytes;
+  ring_size_ = frames + SIGNAL_RESERVE;
+  pool_ = (int16_t *)malloc(frames * frame_bytes);
+  free_slots_ = (uint16_t *)malloc(frames * sizeof(uint16_t));
+  ring_ = (Entry *)malloc(ring_size_ * sizeof(Entry));
+  if (pool_ == nullptr || free_slots_ == nullptr || ring_ == nullptr)
+  {
+    return false;
+  }
+  for (size_t i = 0; i < frames; i++)
+  {
+    free_slots_[i] = (uint16_t)(frames - 1 - i);
+  }
+  free_count_ = frames;
+  head_ = 0;
+  count_ = 0;
+  audio_count_ = 0;
+  in_flight_ = false;
+  pending_gap_ = 0;
+  policy_ = policy;
+  block_ms_ = block_ms;
+  memset(&stats_, 0, sizeof(stats_));
+#if defined(ARDUINO)
+  if (data_ready_ == nullptr)
+  {
+    data_ready_ = xSemaphoreCreateBinary();
+    space_ready_ = xSemaphoreCreateBinary();
+  }
+  return data_ready_ != nullptr && space_ready_ != nullptr;
+#else
+  return true;
+#endif
+}
+
+void AudioUplink::setPolicy(UplinkPolicy policy, uint32_t block_ms)
+{
+  lock();
+  policy_ = policy;
+  block_ms_ = block_ms;
+  unlock();
+}
+
+bool AudioUplink::pushAudio(const int16_t *samples, size_t bytes, bool speech)
+{
+  bool ok = true;
+  for (size_t offset = 0; offset < bytes; offset += frame_bytes_)
+  {
+    size_t chunk = bytes - offset < frame_bytes_ ? bytes - offset : frame_bytes_;
+    ok &= pushFrame((const int16_t *)((const uint8_t *)samples + offset), chunk, speech);
+  }
+  return ok;
+}
+
+bool AudioUplink::pushFrame(const int16_t *samples, size_t bytes, bool speech)
+{
+  int64_t start = 0;
+  bool stalled = false;
+  bool dropped_new = false;
+
+  lock();
+  stats_.frames_in++;
+  while (free_count_ == 0)
+  {
+    if (policy_ != UPLINK_BLOCK && dropOne(policy_ == UPLINK_DROP_SILENCE))
+    {
+      continue;
+    }
+    if (policy_ != UPLINK_BLOCK)
+    {
+      dropped_new = true; // 队列中只剩正在发送的帧和控制信号
+      break;
+    }
+    if (!stalled)
+    {
+      stalled = true;
+      start = uplink_now_us();
+      stats_.stalls++;
+    }
+    int64_t waited_ms = (uplink_now_us() - start) / 1000;
+    if (waited_ms >= block_ms_)
+    {
+      dropped_new = true;
+      break;
+    }
+    waitSpace(block_ms_ - (uint32_t)waited_ms);
+  }
+  if (stalled)
+  {
+    uint32_t us = (uint32_t)(uplink_now_us() - start);
+    stats_.stall_us_total += us;
+    if (us > stats_.stall_us_max)
+    {
+      stats_.stall_us_max = us;
+    }
+  }
+  if (dropped_new)
+  {
+    stats_.dropped_new++;
+    pending_gap_ += bytes / sizeof(int16_t);
+    unlock();
+    return false;
+  }
+  uint16_t slot = free_slots_[--free_count_];
+  unlock();
+
+  // 复制在锁外进行，此时该缓冲区尚未进入队列，不会被丢弃
+  memcpy(pool_ + slot * (frame_bytes_ / sizeof(int16_t)), samples, bytes);
+
+  lock();
+  Entry &entry = ring_[(head_ + count_) % ring_size_];
+  entry.kind = UPLINK_AUDIO;
+  entry.speech = speech;
+  entry.signal = 0;
+  entry.slot = slot;
+  entry.bytes = (uint32_t)bytes;
+  entry.gap = pending_gap_;
+  pending_gap_ = 0;
+  count_++;
+  audio_count_++;
+  if (audio_count_ > stats_.high_water)
+  {
+    stats_.high_water = (uint16_t)audio_count_;
+  }
+  unlock();
+  notifyData();
+  return true;
+}
+
+bool AudioUplink::pushSignal(uint16_t signal)
+{
+  int64_t start = uplink_now_us();
+  lock();
+  // 控制信号有单独的预留位置 (音频帧最多占满缓冲池)，只有发送端长时间无响应时才会等待
+  while (count_ - audio_count_ >= SIGNAL_RESERVE)
+  {
+    int64_t waited_ms = (uplink_now_us() - start) / 1000;
+    if (waited_ms >= block_ms_)
+    {
+      stats_.dropped_signals++;
+      unlock();
+      return false;
+    }
+    waitSpace(block_ms_ - (uint32_t)waited_ms);
+  }
+  Entry &entry = ring_[(head_ + count_) % ring_size_];
+  entry.kind = UPLINK_SIGNAL;
+  entry.speech = false;
+  entry.signal = signal;
+  entry.slot = 0;
+  entry.bytes = 0;
+  entry.gap = pending_gap_;
+  pending_gap_ = 0;
+  count_++;
+  unlock();
+  notifyData();
+  return true;
+}
+
+bool AudioUplink::dropOne(bool silence_first)
+{
+  size_t first = in_flight_ ? 1 : 0;
+  size_t victim = count_;
+  for (size_t i = first; i < count_; i++)
+  {
+    Entry &e = at(i);
+    if (e.kind == UPLINK_AUDIO && (!silence_first || !e.speech))
+    {
+      victim = i;
+      break;
+    }
+  }
+  if (victim == count_ && silence_first)
+  {
+    return dropOne(false);
+  }
+  if (victim == count_)
+  {
+    return false;
+  }
+  if (silence_first && !at(victim).speech)
+  {
+    stats_.dropped_silence++;
+  }
+  else
+  {
+    stats_.dropped_oldest++;
+  }
+  removeAt(victim);
+  return true;
+}
+
+void AudioUplink::removeAt(size_t index)
+{
+  Entry removed = at(index);
+  // 被丢弃的样本数累加到后一个元素上；没有后续元素时留给下一次推入
+  uint32_t gap = removed.gap + removed.bytes / sizeof(int16_t);
+  if (index + 1 < count_)
+  {
+    at(index + 1).gap += gap;
+  }
+  else
+  {
+    pending_gap_ += gap;
+  }
+  for (size_t i = index; i + 1 < count_; i++)
+  {
+    at(i) = at(i + 1);
+  }
+  count_--;
+  if (removed.kind == UPLINK_AUDIO)
+  {
+    free_slots_[free_count_++] = removed.slot;
+    audio_count_--;
+  }
+}
+
+bool AudioUplink::acquire(UplinkItem &item, uint32_t wait_ms)
+{
+  int64_t start = uplink_now_us();
+  lock();
+  while (count_ == 0)
+  {
+    int64_t waited_ms = (uplink_now_us() - start) / 1000;
+    if (waited_ms >= wait_ms)
+    {
+      unlock();
+      return false;
+    }
+    waitData(wait_ms - (uint32_t)waited_ms);
+  }
+  const Entry &entry = at(0);
+  in_flight_ = true;
+  item.kind = (UplinkKind)entry.kind;
+  item.data = entry.kind == UPLINK_AUDIO ? pool_ + entry.slot * (frame_bytes_ / sizeof(int16_t)) : nullptr;
+  item.bytes = entry.bytes;
+  item.signal = entry.signal;
+  item.gap_samples = entry.gap;
+  if (entry.gap > 0)
+  {
+    stats_.gaps_sent++;
+    stats_.gap_samples += entry.gap;
+  }
+  if (entry.kind == UPLINK_AUDIO)
+  {
+    stats_.frames_sent++;
+  }
+  unlock();
+  return true;
+}
+
+void AudioUplink::release()
+{
+  lock();
+  if (in_flight_ && count_ > 0)
+  {
+    const Entry &entry = at(0);
+    if (entry.kind == UPLINK_AUDIO)
+    {
+      free_slots_[free_count_++] = entry.slot;
+      audio_count_--;
+    }
+    head_ = (head_ + 1) % ring_size_;
+    count_--;
+  }
+  in_flight_ = false;
+  unlock();
+  notifySpace();
+}
+
+UplinkStats AudioUplink::stats()
+{
+  lock();
+  UplinkStats copy = stats_;
+  unlock();
+  return copy;
+}
+
+void AudioUplink::resetStats()
+{
+  lock();
+  memset(&stats_, 0, sizeof(stats_));
+  unlock();
+}
+
+size_t AudioUplink::freeFrames()
+{
+  lock();
+  size_t n = free_count_;
+  unlock();
+  return n;
+}
+
+// 以下等待函数在持有锁时调用，返回时重新持有锁；可能提前返回，调用者需要重新检查条件
+#if defined(ARDUINO)
+void AudioUplink::lock()
+{
+  portENTER_CRITICAL(&mux_);
+}
+
+void AudioUplink::unlock()
+{
+  portEXIT_CRITICAL(&mux_);
+}
+
+bool AudioUplink::waitData(uint32_t ms)
+{
+  unlock();
+  bool ok = xSemaphoreTake(data_ready_, pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1) == pdTRUE;
+  lock();
+  return ok;
+}
+
+void AudioUplink::notifyData()
+{
+  xSemaphoreGive(data_ready_);
+}
+
+bool AudioUplink::waitSpace(uint32_t ms)
+{
+  unlock();
+  bool ok = xSemaphoreTake(space_ready_, pdMS_TO_TICKS(ms) > 0 ? pdMS_TO_TICKS(ms) : 1) == pdTRUE;
+  lock();
+  return ok;
+}
+
+void AudioUplink::notifySpace()
+{
+  xSemaphoreGive(space_ready_);
+}
+#else
+void AudioUplink::lock()
+{
+  mutex_.lock();
+}
+
+void AudioUplink::unlock()
+{
+  mutex_.unlock();
+}
+
+bool AudioUplink::waitData(uint32_t ms)
+{
+  std::unique_lock<std::mutex> guard(mutex_, std::adopt_lock);
+  bool ok = data_cv_.wait_for(guard, std::chrono::milliseconds(ms)) == std::cv_status::no_timeout;
+  guard.release();
+  return ok;
+}
+
+void AudioUplink::notifyData()
+{
+  data_cv_.notify_one();
+}
+
+bool AudioUplink::waitSpace(uint32_t ms)
+{
+  std::unique_lock<std::mutex> guard(mutex_, std::adopt_lock);
+  bool ok = space_cv_.wait_for(guard, std::chrono::milliseconds(ms)) == std::cv_status::no_timeout;
+  guard.release();
+  return ok;
+}
+
+void AudioUplink::notifySpace()
+{
+  space_cv_.notify_one();
+}
+#endif
@@ -0,0 +1,181 @@
+#ifndef AUDIO_UPLINK_H
+#define AUDIO_UPLINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#if defined(ARDUINO)
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+// 上行帧类型 (与 Server/server.py 的 receive_sample() 对应)
+// 帧格式: 类型(1字节) + 长度(4字节，小端) + 数据
+#define UPLINK_TYPE_SIGNAL 0x01 // 控制信号，数据为uint16_t
+#define UPLINK_TYPE_AUDIO 0x02  // 16位PCM音频
+#define UPLINK_TYPE_GAP 0x03    // 间隙通知，数据为uint32_t丢弃样本数，服务器以静音补齐
+
+// 上行队列满时的处理策略
+enum UplinkPolicy
+{
+  UPLINK_BLOCK,        // 有界阻塞: 最多等待block_ms，超时丢弃新帧
+  UPLINK_DROP_OLDEST,  // 丢弃队列中最旧的音频帧，采集端从不等待
+  UPLINK_DROP_SILENCE, // 优先丢弃最旧的非语音帧，没有时再丢最旧的音频帧
+};
+
+// 队列元素类型
+enum UplinkKind
+{
+  UPLINK_AUDIO,  // 音频帧
+  UPLINK_SIGNAL, // 控制信号 (开始/停止)，永不丢弃
+};
+
+// 发送端取出的元素 (音频数据指向内部缓冲池，release()之前有效)
+struct UplinkItem
+{
+  UplinkKind kind;
+  const int16_t *data;  // 音频样本
+  size_t bytes;         // 音频字节数
+  uint16_t signal;      // 控制信号值
+  uint32_t gap_samples; // 本元素之前被丢弃的样本数，发送前应先通知服务器
+};
+
+// 丢帧与阻塞统计 (自begin()或resetStats()起累计)
+struct UplinkStats
+{
+  uint32_t frames_in;        // 推入的音频帧数
+  uint32_t frames_sent;      // 已发送的音频帧数
+  uint32_t dropped_oldest;   // 因队列满被丢弃的旧帧数
+  uint32_t dropped_silence;  // 因队列满被丢弃的非语音帧数
+  uint32_t dropped_new;      // 阻塞超时或无可丢弃帧时丢弃的新帧数
+  uint32_t dropped_signals;  // 丢失的控制信号数 (发送端长时间无响应时)
+  uint32_t stalls;           // 采集端因队列满而等待的次数
+  uint32_t stall_us_max;     // 单次最长等待时间 (微秒)
+  uint64_t stall_us_total;   // 累计等待时间 (微秒)
+  uint32_t gaps_sent;        // 已发送的间隙通知次数
+  uint64_t gap_samples;      // 间隙通知累计的样本数
+  uint16_t high_water;       // 队列中音频帧数的最高水位
+};
+
+// 采集端与网络发送端之间的有界音频队列
+// 所有音频帧存放在begin()时一次性分配的固定缓冲池中，运行时不再分配内存；
+// 被丢弃的帧转换为下一个元素上的间隙样本数，保证服务器端的时间轴对齐
+class AudioUplink
+{
+public:
+  ~AudioUplink();
+  // frames: 缓冲池帧数; frame_bytes: 单帧最大字节数; block_ms: UPLINK_BLOCK策略的最长等待时间
+  bool begin(size_t frames, size_t frame_bytes, UplinkPolicy policy, uint32_t block_ms);
+
+  // 采集端: 推入一帧音频 (超过frame_bytes的部分按帧拆分)，speech表示该帧是否检测到语音
+  // 返回false表示有数据被丢弃 (已计入统计并转换为间隙)
+  bool pushAudio(const int16_t *samples, size_t bytes, bool speech);
+  // 采集端: 推入控制信号，不占用缓冲池
+  bool pushSignal(uint16_t signal);
+
+  // 发送端: 等待最多wait_ms取出队首元素，发送完成后必须调用release()
+  bool acquire(UplinkItem &item, uint32_t wait_ms);
+  void release();
+
+  UplinkStats stats();
+  void resetStats();
+  size_t freeFrames();                             // 缓冲池剩余帧数
+  size_t capacity() const { return pool_frames_; } // 缓冲池总帧数
+  UplinkPolicy policy() const { return policy_; }
+  void setPolicy(UplinkPolicy policy, uint32_t block_ms);
+
+private:
+  struct Entry
+  {
+    uint8_t kind;
+    bool speech;
+    uint16_t signal;
+    uint16_t slot;
+    uint32_t bytes;
+    uint32_t gap;
+  };
+
+  static const size_t SIGNAL_RESERVE = 8; // 控制信号额外占用的队列位置
+
+  bool pushFrame(const int16_t *samples, size_t bytes, bool speech);
+  bool dropOne(bool silence_first);
+  void removeAt(size_t index);
+  Entry &at(size_t index) { return ring_[(head_ + index) % ring_size_]; }
+
+  void lock();
+  void unlock();
+  bool waitData(uint32_t ms);
+  void notifyData();
+  bool waitSpace(uint32_t ms);
+  void notifySpace();
+
+  int16_t *pool_ = nullptr;
+  uint16_t *free_slots_ = nullptr;
+  size_t free_count_ = 0;
+  size_t pool_frames_ = 0;
+  size_t frame_bytes_ = 0;
+
+  Entry *ring_ = nullptr;
+  size_t ring_size_ = 0;
+  size_t head_ = 0;
+  size_t count_ = 0;
+  size_t audio_count_ = 0;
+  bool in_flight_ = false; // 队首元素正在发送，不可丢弃
+  uint32_t pending_gap_ = 0;
+
+  UplinkPolicy policy_ = UPLINK_BLOCK;
+  uint32_t block_ms_ = 100;
+  UplinkStats stats_ = {};
+
+#if defined(ARDUINO)
+  portMUX_TYPE mux_ = portMUX_INITIALIZER_UNLOCKED;
+  SemaphoreHandle_t data_ready_ = nullptr;
+  SemaphoreHandle_t space_ready_ = nullptr;
+#else
+  std::mutex mutex_;
+  std::condition_variable data_cv_;
+  std::condition_variable space_cv_;
+#endif
+};
+
+// 把一个元素按上行帧格式写入连接 (有间隙时先写间隙通知)
+// Client 需要提供 size_t write(const uint8_t *, size_t)，例如WiFiClient
+template <class Client>
+bool uplink_write_frame(Client &client, uint8_t type, const void *data, uint32_t length)
+{
+  uint8_t header[5] = {type, (uint8_t)length, (uint8_t)(length >> 8), (uint8_t)(length >> 16), (uint8_t)(length >> 24)};
+  if (client.write(header, sizeof(header)) != sizeof(header))
+  {
+    return false;
+  }
+  size_t total_written = 0;
+  while (total_written < length)
+  {
+    size_t n = client.write((const uint8_t *)data + total_written, length - total_written);
+    if (n == 0) // 发送失败或连接断开
+    {
+      return false;
+    }
+    total_written += n;
+  }
+  return true;
+}
+
+template <class Client>
+bool uplink_write_item(Client &client, const UplinkItem &item)
+{
+  if (item.gap_samples > 0 && !uplink_write_frame(client, UPLINK_TYPE_GAP, &item.gap_samples, sizeof(uint32_t)))
+  {
+    return false;
+  }
+  if (item.kind == UPLINK_SIGNAL)
+  {
+    return uplink_write_frame(client, UPLINK_TYPE_SIGNAL, &item.signal, sizeof(uint16_t));
+  }
+  return uplink_write_frame(client, UPLINK_TYPE_AUDIO, item.data, (uint32_t)item.bytes);
+}
+
+#endif // AUDIO_UPLINK_H
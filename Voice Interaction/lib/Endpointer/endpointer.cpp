@@ -0,0 +1,193 @@
+#include "endpointer.h"
+
+#include <string.h>
+
+void Endpointer::begin(const EndpointConfig &config)
+{
+  config_ = config;
+  noise_floor_ = config.speech_energy / 8;
+  memset(&stats_, 0, sizeof(stats_));
+  memset(&turn_, 0, sizeof(turn_));
+  active_ = false;
+  resetSpeaker();
+}
+
+void Endpointer::resetSpeaker()
+{
+  // 初始偏差取均值的一半，第一段语音的超时为 3 倍初始停顿
+  pause_mean_q4_ = (int32_t)config_.pause_prior_ms << 4;
+  pause_dev_q4_ = (int32_t)config_.pause_prior_ms << 3;
+}
+
+static uint32_t clamp_ms(int64_t value, uint32_t low, uint32_t high)
+{
+  if (value < (int64_t)low)
+  {
+    return low;
+  }
+  if (value > (int64_t)high)
+  {
+    return high;
+  }
+  return (uint32_t)value;
+}
+
+uint32_t Endpointer::timeoutMs() const
+{
+  // 偏差至少取均值的1/4，避免停顿很规律的说话人超时贴近均值
+  int32_t dev = pause_dev_q4_ > pause_mean_q4_ / 4 ? pause_dev_q4_ : pause_mean_q4_ / 4;
+  return clamp_ms((pause_mean_q4_ + 4 * dev) >> 4, config_.min_silence_ms, config_.max_silence_ms);
+}
+
+uint32_t Endpointer::earlyMs() const
+{
+  int32_t dev = pause_dev_q4_ > pause_mean_q4_ / 4 ? pause_dev_q4_ : pause_mean_q4_ / 4;
+  uint32_t timeout = timeoutMs();
+  // 提前阈值加上确认窗口不超过自适应超时，否则提前结束没有意义
+  uint32_t high = timeout > config_.min_silence_ms + config_.confirm_ms ? timeout - config_.confirm_ms
+                                                                         : config_.min_silence_ms;
+  return clamp_ms((pause_mean_q4_ + 2 * dev) >> 4, config_.min_silence_ms, high);
+}
+
+int32_t Endpointer::deepThreshold() const
+{
+  int32_t threshold = noise_floor_ * DEEP_FACTOR;
+  if (threshold < config_.speech_energy / 16)
+  {
+    threshold = config_.speech_energy / 16;
+  }
+  if (threshold > config_.speech_energy / 2)
+  {
+    threshold = config_.speech_energy / 2;
+  }
+  return threshold;
+}
+
+void Endpointer::startTurn()
+{
+  memset(&turn_, 0, sizeof(turn_));
+  active_ = true;
+  turn_ms_ = config_.block_ms;
+  turn_.speech_ms = turn_ms_;
+  silence_ms_ = 0;
+  deep_ = true;
+  confirming_ = false;
+  early_blocked_ = false;
+}
+
+EndpointReason Endpointer::finish(EndpointReason reason)
+{
+  active_ = false;
+  turn_.reason = reason;
+  turn_.endpoint_ms = silence_ms_;
+  turn_.timeout_ms = timeoutMs();
+  turn_.early_ms = earlyMs();
+  stats_.turns++;
+  stats_.endpoint_ms_sum += silence_ms_;
+  switch (reason)
+  {
+  case ENDPOINT_EARLY:
+    stats_.early++;
+    break;
+  case ENDPOINT_TIMEOUT:
+    stats_.timeout++;
+    break;
+  default:
+    stats_.max_length++;
+    break;
+  }
+  return reason;
+}
+
+void Endpointer::trackNoise(int32_t energy)
+{
+  // 噪声底: 快速跟随下降，缓慢跟随上升
+  if (energy < noise_floor_)
+  {
+    noise_floor_ = (noise_floor_ + energy) / 2;
+  }
+  else
+  {
+    noise_floor_ += (energy - noise_floor_) / 32;
+  }
+}
+
+EndpointReason Endpointer::push(int32_t energy)
+{
+  if (!active_)
+  {
+    // 两段语音之间只跟踪噪声底
+    if (energy <= config_.speech_energy)
+    {
+      trackNoise(energy);
+    }
+    return ENDPOINT_NONE;
+  }
+  turn_ms_ += config_.block_ms;
+
+  if (energy > config_.speech_energy)
+  {
+    // 语音恢复: 刚结束的静音是一次句内停顿，更新说话人的停顿统计 (EMA，系数1/8)
+    if (silence_ms_ >= MIN_PAUSE_BLOCKS * config_.block_ms && silence_ms_ < config_.max_silence_ms)
+    {
+      int32_t diff = ((int32_t)silence_ms_ << 4) - pause_mean_q4_;
+      pause_mean_q4_ += diff / 8;
+      pause_dev_q4_ += ((diff < 0 ? -diff : diff) - pause_dev_q4_) / 8;
+      turn_.pauses++;
+    }
+    if (confirming_)
+    {
+      turn_.cancelled++;
+      stats_.cancelled++;
+    }
+    silence_ms_ = 0;
+    deep_ = true;
+    confirming_ = false;
+    early_blocked_ = false;
+    turn_.speech_ms = turn_ms_;
+    if (turn_ms_ >= config_.max_turn_ms)
+    {
+      return finish(ENDPOINT_MAX_LENGTH);
+    }
+    return ENDPOINT_NONE;
+  }
+
+  trackNoise(energy);
+  silence_ms_ += config_.block_ms;
+  bool deep = energy < deepThreshold();
+
+  if (confirming_)
+  {
+    if (deep)
+    {
+      confirm_ms_ += config_.block_ms;
+    }
+    else
+    {
+      // 确认窗口内出现迟疑声或背景声，推翻提前结束
+      confirming_ = false;
+      early_blocked_ = true;
+      turn_.cancelled++;
+      stats_.cancelled++;
+    }
+  }
+  else if (!early_blocked_ && deep_ && deep && silence_ms_ >= earlyMs())
+  {
+    confirming_ = true;
+    confirm_ms_ = 0;
+  }
+  if (!deep)
+  {
+    deep_ = false;
+  }
+  if (confirming_ && confirm_ms_ >= config_.confirm_ms)
+  {
+    return finish(ENDPOINT_EARLY);
+  }
+  // 静音中出现过迟疑声时说话人多半还要继续，本次停顿按上限等待
+  if (silence_ms_ >= (deep_ ? timeoutMs() : config_.max_silence_ms))
+  {
+    return finish(ENDPOINT_TIMEOUT);
+  }
+  return ENDPOINT_NONE;
+}
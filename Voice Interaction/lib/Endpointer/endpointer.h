@@ -0,0 +1,98 @@
+#ifndef ENDPOINTER_H
+#define ENDPOINTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 端点检测参数 (时间均为毫秒)
+struct EndpointConfig
+{
+  uint32_t block_ms;       // 每块音频时长
+  int32_t speech_energy;   // 语音能量阈值 (块内样本平方的平均值，与VAD一致)
+  uint32_t min_silence_ms; // 自适应静音超时下限
+  uint32_t max_silence_ms; // 自适应静音超时上限 (固定超时时的等待时间)
+  uint32_t confirm_ms;     // 提前结束的确认窗口
+  uint32_t pause_prior_ms; // 新说话人的句内停顿时长初始估计
+  uint32_t max_turn_ms;    // 单段语音最长时间
+};
+
+// 结束原因
+enum EndpointReason
+{
+  ENDPOINT_NONE,       // 尚未结束
+  ENDPOINT_EARLY,      // 静音超过提前阈值，且确认窗口内保持深度静音
+  ENDPOINT_TIMEOUT,    // 静音超过自适应超时
+  ENDPOINT_MAX_LENGTH, // 达到单段语音最长时间
+};
+
+// 一段语音的端点记录
+struct EndpointTurn
+{
+  EndpointReason reason;
+  uint32_t speech_ms;   // 从开始到最后一块语音的时长
+  uint32_t endpoint_ms; // 最后一块语音到判定结束的时间 (端点延迟)
+  uint32_t timeout_ms;  // 结束时的自适应静音超时
+  uint32_t early_ms;    // 结束时的提前结束阈值 (不含确认窗口)
+  uint16_t pauses;      // 本段内的句内停顿次数
+  uint16_t cancelled;   // 本段内在确认窗口被推翻的提前结束次数
+};
+
+// 累计统计 (自begin()起)
+struct EndpointStats
+{
+  uint32_t turns;
+  uint32_t early;
+  uint32_t timeout;
+  uint32_t max_length;
+  uint32_t cancelled;       // 确认窗口内又出现声音而推翻的提前结束次数
+  uint64_t endpoint_ms_sum; // 累计端点延迟 (除以turns得平均值)
+};
+
+// 自适应语句端点检测: 每块输入一个能量值 (audio_block_energy()，与VAD相同)，按块计时 (与音频时间一致，不受任务调度影响)
+// 静音超时随当前说话人的句内停顿统计 (均值 + 平均偏差) 调整；
+// 停顿超过较短的提前阈值且为深度静音 (低于噪声底的若干倍，排除"嗯..."之类的迟疑) 时进入确认窗口，
+// 窗口内保持深度静音则提前结束，否则回退到自适应超时；静音中出现过迟疑声时回退到超时上限
+class Endpointer
+{
+public:
+  void begin(const EndpointConfig &config);
+  // 新的说话人或会话: 停顿统计恢复为初始估计
+  void resetSpeaker();
+  // 开始一段语音 (触发录音的第一块已经是语音)
+  void startTurn();
+  // 输入下一块的能量，返回结束原因 (ENDPOINT_NONE表示继续录音；两段语音之间调用只更新噪声底)
+  EndpointReason push(int32_t energy);
+
+  uint32_t timeoutMs() const;
+  uint32_t earlyMs() const;
+  uint32_t pauseMeanMs() const { return pause_mean_q4_ >> 4; }
+  uint32_t pauseDevMs() const { return pause_dev_q4_ >> 4; }
+  int32_t noiseFloor() const { return noise_floor_; }
+  EndpointTurn lastTurn() const { return turn_; }
+  EndpointStats stats() const { return stats_; }
+
+private:
+  static const uint32_t MIN_PAUSE_BLOCKS = 2; // 短于此的能量凹陷视为词内起伏，不计入停顿统计
+  static const int32_t DEEP_FACTOR = 4;       // 深度静音: 低于噪声底的倍数
+
+  int32_t deepThreshold() const;
+  void trackNoise(int32_t energy);
+  EndpointReason finish(EndpointReason reason);
+
+  EndpointConfig config_ = {};
+  int32_t pause_mean_q4_ = 0; // 句内停顿均值 (毫秒，Q4定点)
+  int32_t pause_dev_q4_ = 0;  // 句内停顿平均偏差 (毫秒，Q4定点)
+  int32_t noise_floor_ = 0;   // 非语音块能量的跟踪值
+
+  bool active_ = false;
+  uint32_t turn_ms_ = 0;    // 本段已录制时长
+  uint32_t silence_ms_ = 0; // 最后一块语音之后的静音时长
+  bool deep_ = true;        // 本次静音是否全部为深度静音
+  bool confirming_ = false; // 是否处于提前结束的确认窗口
+  bool early_blocked_ = false; // 本次静音的提前结束已被推翻
+  uint32_t confirm_ms_ = 0;
+  EndpointTurn turn_ = {};
+  EndpointStats stats_ = {};
+};
+
+#endif // ENDPOINTER_H
@@ -0,0 +1,249 @@
+#include "face_motion.h"
+
+#include <string.h>
+
+#define SG90_MIN 500  // SG90舵机最小脉冲宽度 (微秒)
+#define SG90_MAX 2500 // SG90舵机最大脉冲宽度 (微秒)
+
+#define FACE_POSE_SERVOS 19
+#define FACE_POSE_COUNT 7
+
+// 各表情的舵机目标，与 Servo Control 的表情表 (lib/FacePose/face_pose.cpp) 相同；
+// 修改时两边同步，test_face_motion 会逐项比较
+static const FaceServoTarget face_poses[FACE_POSE_COUNT][FACE_POSE_SERVOS] = {
+    // 自然
+    {{0, 4, 80}, {0, 5, 170}, {0, 6, 120}, {0, 7, 60}, {0, 8, 30}, {0, 9, 125}, {0, 12, 25}, {0, 13, 30},
+     {0, 14, 15}, {0, 15, 30}, {1, 6, 110}, {1, 7, 35}, {1, 9, 180}, {1, 10, 150}, {1, 11, 180}, {1, 12, 20},
+     {1, 13, 90}, {1, 14, 80}, {1, 15, 140}},
+    // 开心
+    {{0, 4, 80}, {0, 5, 180}, {0, 6, 150}, {0, 7, 55}, {0, 8, 20}, {0, 9, 130}, {0, 12, 0}, {0, 13, 60},
+     {0, 14, 30}, {0, 15, 0}, {1, 6, 140}, {1, 7, 0}, {1, 9, 190}, {1, 10, 150}, {1, 11, 190}, {1, 12, 0},
+     {1, 13, 60}, {1, 14, 120}, {1, 15, 180}},
+    // 伤心
+    {{0, 4, 80}, {0, 5, 160}, {0, 6, 100}, {0, 7, 90}, {0, 8, 60}, {0, 9, 95}, {0, 12, 50}, {0, 13, 10},
+     {0, 14, 0}, {0, 15, 50}, {1, 6, 70}, {1, 7, 70}, {1, 9, 150}, {1, 10, 180}, {1, 11, 150}, {1, 12, 40},
+     {1, 13, 100}, {1, 14, 90}, {1, 15, 140}},
+    // 惊讶
+    {{0, 4, 80}, {0, 5, 180}, {0, 6, 170}, {0, 7, 55}, {0, 8, 0}, {0, 9, 130}, {0, 12, 0}, {0, 13, 60},
+     {0, 14, 30}, {0, 15, 0}, {1, 6, 100}, {1, 7, 40}, {1, 9, 170}, {1, 10, 165}, {1, 11, 170}, {1, 12, 20},
+     {1, 13, 80}, {1, 14, 130}, {1, 15, 160}},
+    // 愤怒
+    {{0, 4, 80}, {0, 5, 170}, {0, 6, 110}, {0, 7, 75}, {0, 8, 50}, {0, 9, 110}, {0, 12, 50}, {0, 13, 0},
+     {0, 14, 0}, {0, 15, 60}, {1, 6, 80}, {1, 7, 60}, {1, 9, 165}, {1, 10, 170}, {1, 11, 165}, {1, 12, 35},
+     {1, 13, 95}, {1, 14, 80}, {1, 15, 145}},
+    // 害怕
+    {{0, 4, 65}, {0, 5, 175}, {0, 6, 165}, {0, 7, 55}, {0, 8, 5}, {0, 9, 128}, {0, 12, 10}, {0, 13, 45},
+     {0, 14, 25}, {0, 15, 15}, {1, 6, 85}, {1, 7, 55}, {1, 9, 165}, {1, 10, 160}, {1, 11, 165}, {1, 12, 30},
+     {1, 13, 85}, {1, 14, 95}, {1, 15, 150}},
+    // 厌恶
+    {{0, 4, 80}, {0, 5, 165}, {0, 6, 130}, {0, 7, 75}, {0, 8, 40}, {0, 9, 115}, {0, 12, 40}, {0, 13, 20},
+     {0, 14, 5}, {0, 15, 40}, {1, 6, 90}, {1, 7, 50}, {1, 9, 190}, {1, 10, 175}, {1, 11, 185}, {1, 12, 0},
+     {1, 13, 95}, {1, 14, 85}, {1, 15, 145}},
+};
+
+// 表情中四个眼皮舵机 (板0的6~9通道) 的位置，眨眼后据此恢复
+#define FACE_LID_FIRST 2
+#define FACE_LID_COUNT 4
+
+// 闭眼: 左上眼皮向下、左下眼皮向上、右上眼皮向下、右下眼皮向上
+static const FaceServoTarget face_lids_closed[FACE_LID_COUNT] = {{0, 6, 95}, {0, 7, 95}, {0, 8, 70}, {0, 9, 90}};
+
+#define FACE_JAW_BOARD 1
+#define FACE_JAW_CHANNEL 14
+#define FACE_JAW_CLOSED 80
+
+uint16_t face_angle_to_ticks(uint8_t angle)
+{
+  // 与Arduino的map()相同的整数换算，超过180度时外推
+  uint16_t pulse = (uint16_t)((int32_t)angle * (SG90_MAX - SG90_MIN) / 180 + SG90_MIN);
+  return (uint16_t)(pulse * (FACE_PWM_FREQ * 4096.0f / 1000000.0f));
+}
+
+void FaceMotion::begin(FaceServoWriter writer, void *context, uint32_t step_us, uint32_t blink_us, int64_t now_us)
+{
+  writer_ = writer;
+  context_ = context;
+  step_us_ = step_us;
+  blink_us_ = blink_us;
+  state_ = 0;
+  pose_ = NULL;
+  blink_closed_ = false;
+  next_blink_us_ = now_us + blink_us;
+  speaking_ = false;
+  resetStats();
+}
+
+void FaceMotion::resetStats()
+{
+  memset(&stats_, 0, sizeof(stats_));
+}
+
+void FaceMotion::write(uint8_t board, uint8_t channel, uint8_t angle)
+{
+  writer_(board, channel, face_angle_to_ticks(angle), context_);
+  stats_.servo_writes++;
+}
+
+void FaceMotion::finishCommand(int64_t arrival_us, int64_t start_us, int64_t done_us)
+{
+  uint32_t start = (uint32_t)(start_us - arrival_us);
+  uint32_t done = (uint32_t)(done_us - arrival_us);
+  stats_.commands++;
+  stats_.start_us_sum += start;
+  stats_.done_us_sum += done;
+  if (start > stats_.start_us_max)
+  {
+    stats_.start_us_max = start;
+  }
+  if (done > stats_.done_us_max)
+  {
+    stats_.done_us_max = done;
+  }
+}
+
+void FaceMotion::startPose(uint8_t state, int64_t arrival_us, int64_t now_us)
+{
+  if (pose_ != NULL)
+  {
+    stats_.superseded++; // 新表情取代还没做完的表情
+  }
+  state_ = state;
+  pose_ = face_poses[state];
+  pose_index_ = 0;
+  pose_next_us_ = now_us;
+  pose_arrival_us_ = arrival_us;
+  pose_start_us_ = -1;
+}
+
+void FaceMotion::restoreLids()
+{
+  for (int i = 0; i < FACE_LID_COUNT; i++)
+  {
+    const FaceServoTarget &t = face_poses[state_][FACE_LID_FIRST + i];
+    write(t.board, t.channel, t.angle);
+  }
+}
+
+bool FaceMotion::command(const uint8_t *bytes, size_t len, int64_t arrival_us, int64_t now_us)
+{
+  if (len == 0)
+  {
+    stats_.rejected++;
+    return false;
+  }
+  switch (bytes[0])
+  {
+  case FACE_CMD_GAZE:
+    if (len < 3)
+    {
+      stats_.rejected++;
+      return false;
+    }
+    write(0, 4, bytes[1]); // 眼球左右
+    write(0, 5, bytes[2]); // 眼球上下
+    finishCommand(arrival_us, now_us, now_us);
+    break;
+  case FACE_CMD_NEUTRAL:
+  case FACE_CMD_HAPPINESS:
+  case FACE_CMD_SADNESS:
+  case FACE_CMD_SURPRISE:
+  case FACE_CMD_ANGER:
+  case FACE_CMD_FEAR:
+  case FACE_CMD_DISGUST:
+    startPose(bytes[0] - FACE_CMD_NEUTRAL, arrival_us, now_us);
+    break;
+  case FACE_CMD_SPEAK_START:
+    if (!speaking_)
+    {
+      // 与原来的说话循环相同，从张嘴开始交替；第一次开合立即执行
+      speaking_ = true;
+      mouth_flag_ = 1;
+      mouth_next_us_ = now_us;
+    }
+    update(now_us);
+    finishCommand(arrival_us, now_us, now_us);
+    return true;
+  case FACE_CMD_SPEAK_STOP:
+    speaking_ = false;
+    write(FACE_JAW_BOARD, FACE_JAW_CHANNEL, FACE_JAW_CLOSED); // 说话结束，嘴巴闭合
+    startPose(0, arrival_us, now_us); // 恢复到自然表情
+    pose_start_us_ = now_us;
+    break;
+  default:
+    stats_.rejected++;
+    return false;
+  }
+  update(now_us);
+  return true;
+}
+
+void FaceMotion::update(int64_t now_us)
+{
+  // 表情: 每次设置一个舵机，间隔step_us (避免所有舵机同时启动造成电源跌落)
+  while (pose_ != NULL && now_us >= pose_next_us_)
+  {
+    const FaceServoTarget &t = pose_[pose_index_];
+    write(t.board, t.channel, t.angle);
+    if (pose_start_us_ < 0)
+    {
+      pose_start_us_ = now_us;
+    }
+    if (++pose_index_ == FACE_POSE_SERVOS)
+    {
+      finishCommand(pose_arrival_us_, pose_start_us_, now_us);
+      pose_ = NULL;
+    }
+    else
+    {
+      pose_next_us_ = now_us + step_us_;
+    }
+  }
+
+  // 说话: 嘴部在80度 (闭合) 和120度 (张开) 之间交替
+  if (speaking_ && now_us >= mouth_next_us_)
+  {
+    write(FACE_JAW_BOARD, FACE_JAW_CHANNEL, (uint8_t)(100 + mouth_flag_ * 20));
+    mouth_flag_ = -mouth_flag_;
+    mouth_next_us_ = now_us + MOUTH_INTERVAL_US;
+  }
+
+  // 定时眨眼: 表情设置过程中推迟 (原实现中两者同样不会重叠)
+  if (blink_closed_ && now_us >= blink_open_us_)
+  {
+    blink_closed_ = false;
+    restoreLids(); // 根据当前表情恢复眼皮位置
+  }
+  if (!blink_closed_ && pose_ == NULL && now_us >= next_blink_us_)
+  {
+    for (int i = 0; i < FACE_LID_COUNT; i++)
+    {
+      write(face_lids_closed[i].board, face_lids_closed[i].channel, face_lids_closed[i].angle);
+    }
+    blink_closed_ = true;
+    blink_open_us_ = now_us + BLINK_CLOSED_US;
+    next_blink_us_ = now_us + blink_us_;
+  }
+}
+
+int64_t FaceMotion::nextDueUs() const
+{
+  int64_t due;
+  if (blink_closed_)
+  {
+    due = blink_open_us_;
+  }
+  else
+  {
+    // 表情设置过程中眨眼被推迟，由表情的下一步决定
+    due = pose_ != NULL ? pose_next_us_ : next_blink_us_;
+  }
+  if (pose_ != NULL && pose_next_us_ < due)
+  {
+    due = pose_next_us_;
+  }
+  if (speaking_ && mouth_next_us_ < due)
+  {
+    due = mouth_next_us_;
+  }
+  return due;
+}
@@ -0,0 +1,105 @@
+#ifndef FACE_MOTION_H
+#define FACE_MOTION_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// 舵机指令 (与 Servo Control 的串口指令相同，服务器可以原样转发)
+#define FACE_CMD_GAZE 0x02        // 后跟2字节: 眼球左右角度、上下角度
+#define FACE_CMD_NEUTRAL 0x10     // 自然表情
+#define FACE_CMD_HAPPINESS 0x11   // 开心表情
+#define FACE_CMD_SADNESS 0x12     // 伤心表情
+#define FACE_CMD_SURPRISE 0x13    // 惊讶表情
+#define FACE_CMD_ANGER 0x14       // 愤怒表情
+#define FACE_CMD_FEAR 0x15        // 害怕表情
+#define FACE_CMD_DISGUST 0x16     // 厌恶表情
+#define FACE_CMD_SPEAK_START 0x21 // 开始说话 (嘴部开合动画)
+#define FACE_CMD_SPEAK_STOP 0x22  // 停止说话 (闭嘴并恢复自然表情)
+#define FACE_CMD_MAX_BYTES 3      // 最长指令的字节数 (GAZE)
+
+// 下行头部的特殊长度值: 后跟1字节长度和一条舵机指令，可以在回复语音头部之前出现任意次
+#define REPLY_MOTION 0xFFFFFFFCu
+
+// 舵机映射 (与 Servo Control/src/main.cpp 一致): 板0为PCA9685 0x40 (眼部和眉毛)，板1为0x41 (嘴部)
+struct FaceServoTarget
+{
+  uint8_t board;
+  uint8_t channel;
+  uint8_t angle;
+};
+
+// 舵机写入回调: 设备端写入PCA9685，主机端测试记录下来
+typedef void (*FaceServoWriter)(uint8_t board, uint8_t channel, uint16_t ticks, void *context);
+
+#define FACE_PWM_FREQ 50 // SG90舵机PWM频率 (Hz)，PCA9685需设置为此频率
+
+// 角度换算为PCA9685的tick值 (SG90: 500~2500us，50Hz)，与 Servo Control 的 setSG90Angle 结果相同
+uint16_t face_angle_to_ticks(uint8_t angle);
+
+// 指令到动作的延迟统计 (自上次resetStats()起，单位微秒)
+struct FaceMotionStats
+{
+  uint32_t commands;    // 完成的指令数
+  uint32_t superseded;  // 表情还没做完就被新表情取代的指令数
+  uint32_t rejected;    // 格式错误的指令数
+  uint32_t servo_writes;
+  uint64_t start_us_sum; // 指令到达 -> 第一个舵机写入
+  uint32_t start_us_max;
+  uint64_t done_us_sum;  // 指令到达 -> 最后一个舵机写入
+  uint32_t done_us_max;
+};
+
+// 表情动作引擎: 与 Servo Control 的 loop() 行为相同 (表情逐个舵机间隔设置、定时眨眼、说话时嘴部开合)，
+// 但不阻塞: 由调用者周期性调用update()，nextDueUs()给出下一次需要调用的时间
+class FaceMotion
+{
+public:
+  // step_us: 表情中相邻两个舵机的设置间隔 (原 DELAY_TIME)；blink_us: 自动眨眼间隔
+  void begin(FaceServoWriter writer, void *context, uint32_t step_us, uint32_t blink_us, int64_t now_us);
+  // 执行一条指令，arrival_us为指令到达设备的时间 (用于延迟统计)；格式错误时返回false
+  bool command(const uint8_t *bytes, size_t len, int64_t arrival_us, int64_t now_us);
+  // 推进表情设置、眨眼和嘴部动画
+  void update(int64_t now_us);
+  // 下一个需要update()的时间
+  int64_t nextDueUs() const;
+
+  uint8_t state() const { return state_; }
+  bool speaking() const { return speaking_; }
+  bool posing() const { return pose_ != NULL; }
+  const FaceMotionStats &stats() const { return stats_; }
+  void resetStats();
+
+  static const uint32_t BLINK_CLOSED_US = 200000; // 闭眼持续时间
+  static const uint32_t MOUTH_INTERVAL_US = 250000; // 说话时嘴部开合间隔
+
+private:
+  void write(uint8_t board, uint8_t channel, uint8_t angle);
+  void startPose(uint8_t state, int64_t arrival_us, int64_t now_us);
+  void restoreLids();
+  void finishCommand(int64_t arrival_us, int64_t start_us, int64_t done_us);
+
+  FaceServoWriter writer_ = NULL;
+  void *context_ = NULL;
+  uint32_t step_us_ = 0;
+  uint32_t blink_us_ = 0;
+  uint8_t state_ = 0; // 当前表情: 指令减去FACE_CMD_NEUTRAL (0自然 ~ 6厌恶)
+
+  // 正在逐个设置的表情
+  const FaceServoTarget *pose_ = NULL;
+  size_t pose_index_ = 0;
+  int64_t pose_next_us_ = 0;
+  int64_t pose_arrival_us_ = 0;
+  int64_t pose_start_us_ = 0;
+
+  int64_t next_blink_us_ = 0;
+  bool blink_closed_ = false;
+  int64_t blink_open_us_ = 0;
+
+  bool speaking_ = false;
+  int8_t mouth_flag_ = 1;
+  int64_t mouth_next_us_ = 0;
+
+  FaceMotionStats stats_ = {};
+};
+
+#endif // FACE_MOTION_H
@@ -0,0 +1,174 @@
+#include "kws_kernels.h"
+
+static inline int8_t kws_clamp(int32_t v, const KwsQuant &q)
+{
+  v += q.output_offset;
+  if (v < q.act_min)
+  {
+    v = q.act_min;
+  }
+  if (v > q.act_max)
+  {
+    v = q.act_max;
+  }
+  return (int8_t)v;
+}
+
+void kws_conv2d_s8(const int8_t *input, int in_h, int in_w, int in_c,
+                   const int8_t *filter, int k_h, int k_w, int out_c,
+                   const int32_t *bias, int stride_h, int stride_w, int pad_h, int pad_w,
+                   const KwsQuant &q, int8_t *output, int out_h, int out_w)
+{
+  for (int oy = 0; oy < out_h; oy++)
+  {
+    for (int ox = 0; ox < out_w; ox++)
+    {
+      int iy0 = oy * stride_h - pad_h;
+      int ix0 = ox * stride_w - pad_w;
+      for (int oc = 0; oc < out_c; oc++)
+      {
+        int32_t acc = bias ? bias[oc] : 0;
+        const int8_t *f = &filter[oc * k_h * k_w * in_c];
+        for (int ky = 0; ky < k_h; ky++)
+        {
+          int iy = iy0 + ky;
+          if (iy < 0 || iy >= in_h)
+          {
+            continue; // 越界部分按零点填充，贡献为0
+          }
+          for (int kx = 0; kx < k_w; kx++)
+          {
+            int ix = ix0 + kx;
+            if (ix < 0 || ix >= in_w)
+            {
+              continue;
+            }
+            const int8_t *x = &input[(iy * in_w + ix) * in_c];
+            const int8_t *w = &f[(ky * k_w + kx) * in_c];
+            for (int ic = 0; ic < in_c; ic++)
+            {
+              acc += (int32_t)w[ic] * (x[ic] + q.input_offset);
+            }
+          }
+        }
+        acc = kws_requantize(acc, q.multiplier[oc], q.shift[oc]);
+        *output++ = kws_clamp(acc, q);
+      }
+    }
+  }
+}
+
+void kws_depthwise_conv2d_s8(const int8_t *input, int in_h, int in_w, int channels,
+                             const int8_t *filter, int k_h, int k_w,
+                             const int32_t *bias, int stride_h, int stride_w, int pad_h, int pad_w,
+                             const KwsQuant &q, int8_t *output, int out_h, int out_w)
+{
+  int32_t acc[256]; // 每个像素按通道累加，通道数不超过256
+  for (int oy = 0; oy < out_h; oy++)
+  {
+    for (int ox = 0; ox < out_w; ox++)
+    {
+      int iy0 = oy * stride_h - pad_h;
+      int ix0 = ox * stride_w - pad_w;
+      for (int c = 0; c < channels; c++)
+      {
+        acc[c] = bias ? bias[c] : 0;
+      }
+      // 通道维度放在最内层，权重和输入都是连续访问
+      for (int ky = 0; ky < k_h; ky++)
+      {
+        int iy = iy0 + ky;
+        if (iy < 0 || iy >= in_h)
+        {
+          continue;
+        }
+        for (int kx = 0; kx < k_w; kx++)
+        {
+          int ix = ix0 + kx;
+          if (ix < 0 || ix >= in_w)
+          {
+            continue;
+          }
+          const int8_t *x = &input[(iy * in_w + ix) * channels];
+          const int8_t *w = &filter[(ky * k_w + kx) * channels];
+          for (int c = 0; c < channels; c++)
+          {
+            acc[c] += (int32_t)w[c] * (x[c] + q.input_offset);
+          }
+        }
+      }
+      for (int c = 0; c < channels; c++)
+      {
+        *output++ = kws_clamp(kws_requantize(acc[c], q.multiplier[c], q.shift[c]), q);
+      }
+    }
+  }
+}
+
+void kws_pointwise_conv_s8(const int8_t *input, int pixels, int in_c,
+                           const int8_t *filter, int out_c, const int32_t *bias,
+                           const KwsQuant &q, int8_t *output)
+{
+  for (int p = 0; p < pixels; p++)
+  {
+    const int8_t *x = &input[p * in_c];
+    int oc = 0;
+    // 一次计算4个输出通道，复用同一份输入像素
+    for (; oc + 4 <= out_c; oc += 4)
+    {
+      const int8_t *w0 = &filter[(oc + 0) * in_c];
+      const int8_t *w1 = &filter[(oc + 1) * in_c];
+      const int8_t *w2 = &filter[(oc + 2) * in_c];
+      const int8_t *w3 = &filter[(oc + 3) * in_c];
+      int32_t a0 = bias ? bias[oc + 0] : 0;
+      int32_t a1 = bias ? bias[oc + 1] : 0;
+      int32_t a2 = bias ? bias[oc + 2] : 0;
+      int32_t a3 = bias ? bias[oc + 3] : 0;
+      for (int ic = 0; ic < in_c; ic++)
+      {
+        int32_t v = x[ic] + q.input_offset;
+        a0 += w0[ic] * v;
+        a1 += w1[ic] * v;
+        a2 += w2[ic] * v;
+        a3 += w3[ic] * v;
+      }
+      output[oc + 0] = kws_clamp(kws_requantize(a0, q.multiplier[oc + 0], q.shift[oc + 0]), q);
+      output[oc + 1] = kws_clamp(kws_requantize(a1, q.multiplier[oc + 1], q.shift[oc + 1]), q);
+      output[oc + 2] = kws_clamp(kws_requantize(a2, q.multiplier[oc + 2], q.shift[oc + 2]), q);
+      output[oc + 3] = kws_clamp(kws_requantize(a3, q.multiplier[oc + 3], q.shift[oc + 3]), q);
+    }
+    for (; oc < out_c; oc++)
+    {
+      const int8_t *w = &filter[oc * in_c];
+      int32_t a = bias ? bias[oc] : 0;
+      for (int ic = 0; ic < in_c; ic++)
+      {
+        a += w[ic] * (x[ic] + q.input_offset);
+      }
+      output[oc] = kws_clamp(kws_requantize(a, q.multiplier[oc], q.shift[oc]), q);
+    }
+    output += out_c;
+  }
+}
+
+void kws_global_avgpool_s8(const int8_t *input, int pixels, int channels, int8_t *output)
+{
+  for (int c = 0; c < channels; c++)
+  {
+    int32_t sum = 0;
+    for (int p = 0; p < pixels; p++)
+    {
+      sum += input[p * channels + c];
+    }
+    // 四舍五入到最近整数
+    int32_t avg = sum >= 0 ? (sum + pixels / 2) / pixels : (sum - pixels / 2) / pixels;
+    output[c] = (int8_t)avg;
+  }
+}
+
+void kws_fully_connected_s8(const int8_t *input, int in_n,
+                            const int8_t *weights, int out_n, const int32_t *bias,
+                            const KwsQuant &q, int8_t *output)
+{
+  kws_pointwise_conv_s8(input, 1, in_n, weights, out_n, bias, q, output);
+}
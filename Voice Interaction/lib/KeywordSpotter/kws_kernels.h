@@ -0,0 +1,56 @@
+#ifndef KWS_KERNELS_H
+#define KWS_KERNELS_H
+
+#include <stdint.h>
+
+// int8量化推理内核 (TFLite风格的对称权重 + 非对称激活量化)
+// 张量布局统一为HWC，卷积权重布局为 [out_c][k_h][k_w][in_c]，
+// 深度卷积权重布局为 [k_h][k_w][c]，全连接/逐点卷积权重布局为 [out][in]
+// 这些内核只依赖标准C++，可以在主机上编译做正确性测试和性能基准
+
+// 重量化参数: real_multiplier = multiplier * 2^(shift - 31)，逐输出通道
+struct KwsQuant
+{
+  const int32_t *multiplier; // 每个输出通道的定点乘数 (Q31)
+  const int8_t *shift;       // 每个输出通道的移位量 (正数左移，负数右移)
+  int32_t input_offset;      // 输入零点的相反数 (-input_zero_point)
+  int32_t output_offset;     // 输出零点
+  int32_t act_min;           // 输出下限 (ReLU时等于输出零点)
+  int32_t act_max;           // 输出上限
+};
+
+// 把int32累加值按定点乘数缩放到输出量化域 (带舍入)
+static inline int32_t kws_requantize(int32_t acc, int32_t multiplier, int shift)
+{
+  int total_shift = 31 - shift;
+  int64_t prod = (int64_t)acc * multiplier;
+  int64_t round = (int64_t)1 << (total_shift - 1);
+  return (int32_t)((prod + round) >> total_shift);
+}
+
+// 标准二维卷积 (SAME/VALID由pad_h/pad_w决定)
+void kws_conv2d_s8(const int8_t *input, int in_h, int in_w, int in_c,
+                   const int8_t *filter, int k_h, int k_w, int out_c,
+                   const int32_t *bias, int stride_h, int stride_w, int pad_h, int pad_w,
+                   const KwsQuant &q, int8_t *output, int out_h, int out_w);
+
+// 深度可分离卷积的逐通道部分 (depth multiplier = 1)
+void kws_depthwise_conv2d_s8(const int8_t *input, int in_h, int in_w, int channels,
+                             const int8_t *filter, int k_h, int k_w,
+                             const int32_t *bias, int stride_h, int stride_w, int pad_h, int pad_w,
+                             const KwsQuant &q, int8_t *output, int out_h, int out_w);
+
+// 1x1逐点卷积，等价于对每个像素做一次全连接
+void kws_pointwise_conv_s8(const int8_t *input, int pixels, int in_c,
+                           const int8_t *filter, int out_c, const int32_t *bias,
+                           const KwsQuant &q, int8_t *output);
+
+// 全局平均池化 (输入输出使用相同的量化参数)
+void kws_global_avgpool_s8(const int8_t *input, int pixels, int channels, int8_t *output);
+
+// 全连接层
+void kws_fully_connected_s8(const int8_t *input, int in_n,
+                            const int8_t *weights, int out_n, const int32_t *bias,
+                            const KwsQuant &q, int8_t *output);
+
+#endif // KWS_KERNELS_H
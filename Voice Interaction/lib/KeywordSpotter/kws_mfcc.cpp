@@ -0,0 +1,238 @@
+#include "kws_mfcc.h"
+
+#include <math.h>
+#include <string.h>
+
+#define KWS_MEL_LOW_HZ 20.0f   // Mel滤波器组下限频率
+#define KWS_MEL_HIGH_HZ 4000.0f // Mel滤波器组上限频率 (语音关键词能量主要集中在4kHz以下)
+
+static float hz_to_mel(float hz)
+{
+  return 2595.0f * log10f(1.0f + hz / 700.0f);
+}
+
+static float mel_to_hz(float mel)
+{
+  return 700.0f * (powf(10.0f, mel / 2595.0f) - 1.0f);
+}
+
+void KwsMfcc::begin()
+{
+  const float pi = 3.14159265358979f;
+
+  // Hann窗
+  for (int i = 0; i < KWS_FRAME_LEN; i++)
+  {
+    window_[i] = 0.5f - 0.5f * cosf(2.0f * pi * i / KWS_FRAME_LEN);
+  }
+
+  // FFT旋转因子和位反转索引
+  for (int i = 0; i < KWS_FFT_SIZE / 2; i++)
+  {
+    twiddle_re_[i] = cosf(2.0f * pi * i / KWS_FFT_SIZE);
+    twiddle_im_[i] = -sinf(2.0f * pi * i / KWS_FFT_SIZE);
+  }
+  int bits = 0;
+  while ((1 << bits) < KWS_FFT_SIZE)
+  {
+    bits++;
+  }
+  for (int i = 0; i < KWS_FFT_SIZE; i++)
+  {
+    int r = 0;
+    for (int b = 0; b < bits; b++)
+    {
+      r |= ((i >> b) & 1) << (bits - 1 - b);
+    }
+    bitrev_[i] = (uint16_t)r;
+  }
+
+  // Mel滤波器组: KWS_MEL_BANDS + 2 个在Mel刻度上等间距的边界频率
+  float edges[KWS_MEL_BANDS + 2];
+  float mel_low = hz_to_mel(KWS_MEL_LOW_HZ);
+  float mel_high = hz_to_mel(KWS_MEL_HIGH_HZ);
+  for (int i = 0; i < KWS_MEL_BANDS + 2; i++)
+  {
+    edges[i] = mel_to_hz(mel_low + (mel_high - mel_low) * i / (KWS_MEL_BANDS + 1));
+  }
+  // 相邻三角滤波器互相重叠，每个频点最多落在两个滤波器上，只需记录上升沿所属滤波器和权重
+  for (int k = 0; k < KWS_FFT_BINS; k++)
+  {
+    float hz = (float)k * KWS_SAMPLE_RATE / KWS_FFT_SIZE;
+    bin_band_[k] = -1;
+    bin_weight_[k] = 0.0f;
+    for (int j = 0; j < KWS_MEL_BANDS + 1; j++)
+    {
+      if (hz >= edges[j] && hz < edges[j + 1])
+      {
+        bin_band_[k] = (int8_t)j;
+        bin_weight_[k] = (hz - edges[j]) / (edges[j + 1] - edges[j]);
+        break;
+      }
+    }
+  }
+
+  // 正交DCT-II
+  for (int n = 0; n < KWS_MFCC_COEFFS; n++)
+  {
+    float scale = sqrtf((n == 0 ? 1.0f : 2.0f) / KWS_MEL_BANDS);
+    for (int b = 0; b < KWS_MEL_BANDS; b++)
+    {
+      dct_[n * KWS_MEL_BANDS + b] = scale * cosf(pi * n * (b + 0.5f) / KWS_MEL_BANDS);
+    }
+  }
+}
+
+// 原地基2 DIT复数FFT
+void KwsMfcc::fft(float *re, float *im)
+{
+  for (int i = 0; i < KWS_FFT_SIZE; i++)
+  {
+    int j = bitrev_[i];
+    if (j > i)
+    {
+      float t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+  for (int len = 2; len <= KWS_FFT_SIZE; len <<= 1)
+  {
+    int half = len >> 1;
+    int step = KWS_FFT_SIZE / len;
+    for (int i = 0; i < KWS_FFT_SIZE; i += len)
+    {
+      for (int j = 0; j < half; j++)
+      {
+        float wr = twiddle_re_[j * step];
+        float wi = twiddle_im_[j * step];
+        int a = i + j;
+        int b = a + half;
+        float tr = re[b] * wr - im[b] * wi;
+        float ti = re[b] * wi + im[b] * wr;
+        re[b] = re[a] - tr;
+        im[b] = im[a] - ti;
+        re[a] += tr;
+        im[a] += ti;
+      }
+    }
+  }
+}
+
+void KwsMfcc::compute(const int16_t *frame, float *out)
+{
+  for (int i = 0; i < KWS_FRAME_LEN; i++)
+  {
+    re_[i] = frame[i] * (1.0f / 32768.0f) * window_[i];
+    im_[i] = 0.0f;
+  }
+  for (int i = KWS_FRAME_LEN; i < KWS_FFT_SIZE; i++)
+  {
+    re_[i] = 0.0f;
+    im_[i] = 0.0f;
+  }
+  fft(re_, im_);
+
+  float mel[KWS_MEL_BANDS] = {0};
+  for (int k = 0; k < KWS_FFT_BINS; k++)
+  {
+    int j = bin_band_[k];
+    if (j < 0)
+    {
+      continue;
+    }
+    float power = re_[k] * re_[k] + im_[k] * im_[k];
+    float w = bin_weight_[k];
+    if (j < KWS_MEL_BANDS)
+    {
+      mel[j] += w * power;
+    }
+    if (j > 0)
+    {
+      mel[j - 1] += (1.0f - w) * power;
+    }
+  }
+  for (int b = 0; b < KWS_MEL_BANDS; b++)
+  {
+    mel[b] = logf(mel[b] + 1e-6f);
+  }
+  for (int n = 0; n < KWS_MFCC_COEFFS; n++)
+  {
+    const float *row = &dct_[n * KWS_MEL_BANDS];
+    float acc = 0.0f;
+    for (int b = 0; b < KWS_MEL_BANDS; b++)
+    {
+      acc += row[b] * mel[b];
+    }
+    out[n] = acc;
+  }
+}
+
+void KwsFeatureRing::begin(float in_scale, int8_t in_zero_point)
+{
+  mfcc_.begin();
+  inv_scale_ = 1.0f / in_scale;
+  zero_point_ = in_zero_point;
+  reset();
+}
+
+void KwsFeatureRing::reset()
+{
+  pcm_fill_ = 0;
+  head_ = 0;
+  filled_ = 0;
+  memset(features_, zero_point_, sizeof(features_));
+}
+
+size_t KwsFeatureRing::push(const int16_t *samples, size_t count)
+{
+  size_t produced = 0;
+  while (count > 0)
+  {
+    size_t n = KWS_FRAME_LEN - pcm_fill_;
+    if (n > count)
+    {
+      n = count;
+    }
+    memcpy(&pcm_[pcm_fill_], samples, n * sizeof(int16_t));
+    pcm_fill_ += n;
+    samples += n;
+    count -= n;
+    if (pcm_fill_ < KWS_FRAME_LEN)
+    {
+      break;
+    }
+
+    // 分析窗已满：计算一帧MFCC并量化写入环形缓冲区
+    float coeffs[KWS_MFCC_COEFFS];
+    mfcc_.compute(pcm_, coeffs);
+    int8_t *dst = &features_[head_ * KWS_MFCC_COEFFS];
+    for (int i = 0; i < KWS_MFCC_COEFFS; i++)
+    {
+      long q = lrintf(coeffs[i] * inv_scale_) + zero_point_;
+      dst[i] = (int8_t)(q < -128 ? -128 : (q > 127 ? 127 : q));
+    }
+    head_ = (head_ + 1) % KWS_NUM_FRAMES;
+    if (filled_ < KWS_NUM_FRAMES)
+    {
+      filled_++;
+    }
+    produced++;
+
+    // 保留窗口重叠部分 (KWS_FRAME_LEN - KWS_FRAME_HOP 个样本)
+    memmove(pcm_, &pcm_[KWS_FRAME_HOP], (KWS_FRAME_LEN - KWS_FRAME_HOP) * sizeof(int16_t));
+    pcm_fill_ = KWS_FRAME_LEN - KWS_FRAME_HOP;
+  }
+  return produced;
+}
+
+void KwsFeatureRing::snapshot(int8_t *dst) const
+{
+  // head_指向最旧的一帧
+  size_t first = KWS_NUM_FRAMES - head_;
+  memcpy(dst, &features_[head_ * KWS_MFCC_COEFFS], first * KWS_MFCC_COEFFS);
+  memcpy(dst + first * KWS_MFCC_COEFFS, features_, head_ * KWS_MFCC_COEFFS);
+}
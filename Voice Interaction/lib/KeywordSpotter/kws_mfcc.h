@@ -0,0 +1,65 @@
+#ifndef KWS_MFCC_H
+#define KWS_MFCC_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// MFCC前端参数 (与训练端特征提取保持一致)
+#define KWS_SAMPLE_RATE 16000 // 输入采样率 (Hz)
+#define KWS_FRAME_LEN 480     // 分析窗长 (样本数, 30ms)
+#define KWS_FRAME_HOP 320     // 帧移 (样本数, 20ms)
+#define KWS_FFT_SIZE 512      // FFT点数
+#define KWS_MEL_BANDS 40      // Mel滤波器组数量
+#define KWS_MFCC_COEFFS 10    // 每帧输出的MFCC系数个数
+#define KWS_NUM_FRAMES 49     // 模型输入帧数 (约1秒)
+
+#define KWS_FFT_BINS (KWS_FFT_SIZE / 2 + 1)
+
+// MFCC特征提取器
+// 所有查找表在begin()中一次性生成，compute()本身不做任何动态内存分配
+class KwsMfcc
+{
+public:
+  void begin();
+  // frame: KWS_FRAME_LEN个PCM样本; out: KWS_MFCC_COEFFS个MFCC系数
+  void compute(const int16_t *frame, float *out);
+
+private:
+  void fft(float *re, float *im);
+
+  float window_[KWS_FRAME_LEN];                   // Hann窗
+  float twiddle_re_[KWS_FFT_SIZE / 2];            // FFT旋转因子 (实部)
+  float twiddle_im_[KWS_FFT_SIZE / 2];            // FFT旋转因子 (虚部)
+  uint16_t bitrev_[KWS_FFT_SIZE];                 // 位反转索引
+  int8_t bin_band_[KWS_FFT_BINS];                 // 频点位于第j个Mel带的上升沿、第j-1个Mel带的下降沿 (-1表示不参与)
+  float bin_weight_[KWS_FFT_BINS];                // 频点在上升沿一侧的权重w (下降沿一侧为 1 - w)
+  float dct_[KWS_MFCC_COEFFS * KWS_MEL_BANDS];    // DCT-II系数表
+  float re_[KWS_FFT_SIZE];                        // FFT工作缓冲区 (实部)
+  float im_[KWS_FFT_SIZE];                        // FFT工作缓冲区 (虚部)
+};
+
+// 流式特征缓冲：把任意长度的PCM块切成帧，计算MFCC并量化后保存在环形缓冲区中
+class KwsFeatureRing
+{
+public:
+  void begin(float in_scale, int8_t in_zero_point);
+  // 推入PCM样本，返回本次新产生的特征帧数量
+  size_t push(const int16_t *samples, size_t count);
+  // 按时间顺序 (旧->新) 把KWS_NUM_FRAMES帧特征拷贝到dst
+  void snapshot(int8_t *dst) const;
+  // 已累计的有效帧数 (最大KWS_NUM_FRAMES)
+  size_t frames() const { return filled_; }
+  void reset();
+
+private:
+  KwsMfcc mfcc_;
+  int16_t pcm_[KWS_FRAME_LEN];                       // 当前分析窗内的PCM样本
+  size_t pcm_fill_ = 0;                              // pcm_中已填充的样本数
+  int8_t features_[KWS_NUM_FRAMES * KWS_MFCC_COEFFS]; // 量化后的特征环形缓冲区
+  size_t head_ = 0;                                  // 下一帧写入位置
+  size_t filled_ = 0;
+  float inv_scale_ = 1.0f;
+  int8_t zero_point_ = 0;
+};
+
+#endif // KWS_MFCC_H
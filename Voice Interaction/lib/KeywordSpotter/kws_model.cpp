@@ -0,0 +1,258 @@
+#include "kws_model.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+// pad为0时按VALID计算输出尺寸，否则按SAME计算
+static int kws_out_dim(int in, int k, int stride, int pad)
+{
+  if (pad == 0)
+  {
+    return (in - k) / stride + 1;
+  }
+  return (in + stride - 1) / stride;
+}
+
+static KwsQuant kws_layer_quant(const KwsLayer &layer)
+{
+  KwsQuant q;
+  q.multiplier = layer.multiplier;
+  q.shift = layer.shift;
+  q.input_offset = -layer.input_zero_point;
+  q.output_offset = layer.output_zero_point;
+  q.act_min = layer.relu ? layer.output_zero_point : -128;
+  q.act_max = 127;
+  return q;
+}
+
+KwsEngine::~KwsEngine()
+{
+  free(buffers_[0]);
+  free(buffers_[1]);
+}
+
+bool KwsEngine::begin(const KwsModel *model)
+{
+  if (model == nullptr || model->in_h != KWS_NUM_FRAMES || model->in_w != KWS_MFCC_COEFFS)
+  {
+    return false;
+  }
+  model_ = model;
+
+  // 逐层推导张量形状，统计最大激活尺寸、权重字节数和乘加次数
+  int h = model->in_h, w = model->in_w, c = 1;
+  size_t max_bytes = (size_t)h * w * c;
+  weight_bytes_ = 0;
+  macs_ = 0;
+  for (int i = 0; i < model->num_layers; i++)
+  {
+    const KwsLayer &layer = model->layers[i];
+    int oh = h, ow = w, oc = c;
+    switch (layer.type)
+    {
+    case KWS_LAYER_CONV:
+      oh = kws_out_dim(h, layer.k_h, layer.stride_h, layer.pad_h);
+      ow = kws_out_dim(w, layer.k_w, layer.stride_w, layer.pad_w);
+      oc = layer.out_c;
+      weight_bytes_ += (size_t)oc * layer.k_h * layer.k_w * c;
+      macs_ += (uint32_t)oh * ow * oc * layer.k_h * layer.k_w * c;
+      break;
+    case KWS_LAYER_DEPTHWISE:
+      if (c > 256)
+      {
+        return false; // 深度卷积内核的通道累加缓冲区上限
+      }
+      oh = kws_out_dim(h, layer.k_h, layer.stride_h, layer.pad_h);
+      ow = kws_out_dim(w, layer.k_w, layer.stride_w, layer.pad_w);
+      weight_bytes_ += (size_t)layer.k_h * layer.k_w * c;
+      macs_ += (uint32_t)oh * ow * c * layer.k_h * layer.k_w;
+      break;
+    case KWS_LAYER_POINTWISE:
+      oc = layer.out_c;
+      weight_bytes_ += (size_t)oc * c;
+      macs_ += (uint32_t)h * w * c * oc;
+      break;
+    case KWS_LAYER_AVGPOOL:
+      oh = 1;
+      ow = 1;
+      break;
+    case KWS_LAYER_FC:
+      oc = layer.out_c;
+      weight_bytes_ += (size_t)oc * h * w * c;
+      macs_ += (uint32_t)h * w * c * oc;
+      oh = 1;
+      ow = 1;
+      break;
+    }
+    if (layer.type != KWS_LAYER_AVGPOOL)
+    {
+      // 偏置 + 逐通道乘数 + 移位
+      weight_bytes_ += (size_t)oc * (sizeof(int32_t) * 2 + sizeof(int8_t));
+    }
+    if (oh <= 0 || ow <= 0)
+    {
+      return false;
+    }
+    h = oh;
+    w = ow;
+    c = oc;
+    if ((size_t)h * w * c > max_bytes)
+    {
+      max_bytes = (size_t)h * w * c;
+    }
+  }
+  if (h * w * c != model->num_labels || model->wake_label >= model->num_labels)
+  {
+    return false;
+  }
+
+  free(buffers_[0]);
+  free(buffers_[1]);
+  buffer_bytes_ = max_bytes;
+  buffers_[0] = (int8_t *)malloc(buffer_bytes_);
+  buffers_[1] = (int8_t *)malloc(buffer_bytes_);
+  return buffers_[0] != nullptr && buffers_[1] != nullptr;
+}
+
+const int8_t *KwsEngine::invoke(const int8_t *features)
+{
+  int h = model_->in_h, w = model_->in_w, c = 1;
+  int8_t *in = buffers_[0];
+  int8_t *out = buffers_[1];
+  memcpy(in, features, (size_t)h * w);
+
+  for (int i = 0; i < model_->num_layers; i++)
+  {
+    const KwsLayer &layer = model_->layers[i];
+    KwsQuant q = kws_layer_quant(layer);
+    int oh = h, ow = w, oc = c;
+    switch (layer.type)
+    {
+    case KWS_LAYER_CONV:
+      oh = kws_out_dim(h, layer.k_h, layer.stride_h, layer.pad_h);
+      ow = kws_out_dim(w, layer.k_w, layer.stride_w, layer.pad_w);
+      oc = layer.out_c;
+      kws_conv2d_s8(in, h, w, c, layer.weights, layer.k_h, layer.k_w, oc, layer.bias,
+                    layer.stride_h, layer.stride_w, layer.pad_h, layer.pad_w, q, out, oh, ow);
+      break;
+    case KWS_LAYER_DEPTHWISE:
+      oh = kws_out_dim(h, layer.k_h, layer.stride_h, layer.pad_h);
+      ow = kws_out_dim(w, layer.k_w, layer.stride_w, layer.pad_w);
+      kws_depthwise_conv2d_s8(in, h, w, c, layer.weights, layer.k_h, layer.k_w, layer.bias,
+                              layer.stride_h, layer.stride_w, layer.pad_h, layer.pad_w, q, out, oh, ow);
+      break;
+    case KWS_LAYER_POINTWISE:
+      oc = layer.out_c;
+      kws_pointwise_conv_s8(in, h * w, c, layer.weights, oc, layer.bias, q, out);
+      break;
+    case KWS_LAYER_AVGPOOL:
+      kws_global_avgpool_s8(in, h * w, c, out);
+      oh = 1;
+      ow = 1;
+      break;
+    case KWS_LAYER_FC:
+      oc = layer.out_c;
+      kws_fully_connected_s8(in, h * w * c, layer.weights, oc, layer.bias, q, out);
+      oh = 1;
+      ow = 1;
+      break;
+    }
+    h = oh;
+    w = ow;
+    c = oc;
+    int8_t *t = in;
+    in = out;
+    out = t;
+  }
+  return in;
+}
+
+bool KwsDetector::begin(const KwsModel *model, uint8_t infer_stride, uint8_t smooth_window,
+                        float threshold, uint8_t refractory)
+{
+  model_ = model;
+  infer_stride_ = infer_stride > 0 ? infer_stride : 1;
+  smooth_window_ = smooth_window == 0 ? 1 : (smooth_window > MAX_SMOOTH ? MAX_SMOOTH : smooth_window);
+  threshold_ = threshold;
+  refractory_ = refractory;
+  if (!engine_.begin(model))
+  {
+    return false;
+  }
+  ring_.begin(model->input_scale, model->input_zero_point);
+  reset();
+  return true;
+}
+
+void KwsDetector::reset()
+{
+  ring_.reset();
+  pending_frames_ = 0;
+  memset(history_, 0, sizeof(history_));
+  history_pos_ = 0;
+  cooldown_ = 0;
+  last_score_ = 0.0f;
+}
+
+float KwsDetector::wakeProbability(const int8_t *logits) const
+{
+  // 反量化后做softmax，只需唤醒词类别的概率
+  float max_logit = -1e30f;
+  for (int i = 0; i < model_->num_labels; i++)
+  {
+    float v = (logits[i] - model_->output_zero_point) * model_->output_scale;
+    if (v > max_logit)
+    {
+      max_logit = v;
+    }
+  }
+  float sum = 0.0f, wake = 0.0f;
+  for (int i = 0; i < model_->num_labels; i++)
+  {
+    float e = expf((logits[i] - model_->output_zero_point) * model_->output_scale - max_logit);
+    sum += e;
+    if (i == model_->wake_label)
+    {
+      wake = e;
+    }
+  }
+  return wake / sum;
+}
+
+bool KwsDetector::push(const int16_t *samples, size_t count)
+{
+  pending_frames_ += ring_.push(samples, count);
+  // 特征窗口未填满之前不推理，避免用零点填充的特征误触发
+  if (ring_.frames() < KWS_NUM_FRAMES || pending_frames_ < infer_stride_)
+  {
+    return false;
+  }
+  pending_frames_ = 0;
+
+  ring_.snapshot(features_);
+  const int8_t *logits = engine_.invoke(features_);
+  inferences_++;
+
+  history_[history_pos_] = wakeProbability(logits);
+  history_pos_ = (history_pos_ + 1) % smooth_window_;
+  float sum = 0.0f;
+  for (int i = 0; i < smooth_window_; i++)
+  {
+    sum += history_[i];
+  }
+  last_score_ = sum / smooth_window_;
+
+  if (cooldown_ > 0)
+  {
+    cooldown_--;
+    return false;
+  }
+  if (last_score_ >= threshold_)
+  {
+    cooldown_ = refractory_;
+    memset(history_, 0, sizeof(history_));
+    return true;
+  }
+  return false;
+}
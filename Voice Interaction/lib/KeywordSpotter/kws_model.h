@@ -0,0 +1,112 @@
+#ifndef KWS_MODEL_H
+#define KWS_MODEL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "kws_kernels.h"
+#include "kws_mfcc.h"
+
+// 支持的层类型 (DS-CNN: CONV -> N x (DEPTHWISE + POINTWISE) -> AVGPOOL -> FC)
+enum KwsLayerType
+{
+  KWS_LAYER_CONV,      // 标准卷积
+  KWS_LAYER_DEPTHWISE, // 深度卷积
+  KWS_LAYER_POINTWISE, // 1x1逐点卷积
+  KWS_LAYER_AVGPOOL,   // 全局平均池化
+  KWS_LAYER_FC,        // 全连接
+};
+
+// 单层描述 (权重数据位于Flash，由 tools/kws_export.py 生成)
+struct KwsLayer
+{
+  KwsLayerType type;
+  uint8_t k_h, k_w;           // 卷积核尺寸
+  uint8_t stride_h, stride_w; // 步长
+  uint8_t pad_h, pad_w;       // 顶部/左侧填充 (SAME填充时为 (k-1)/2)
+  uint16_t out_c;             // 输出通道数
+  const int8_t *weights;
+  const int32_t *bias;
+  const int32_t *multiplier;
+  const int8_t *shift;
+  int8_t input_zero_point;
+  int8_t output_zero_point;
+  bool relu;                  // 是否在输出端做ReLU
+};
+
+// 完整模型描述
+struct KwsModel
+{
+  uint8_t in_h;               // 输入帧数 (必须等于KWS_NUM_FRAMES)
+  uint8_t in_w;               // 每帧系数个数 (必须等于KWS_MFCC_COEFFS)
+  float input_scale;          // 输入MFCC量化尺度
+  int8_t input_zero_point;    // 输入MFCC量化零点
+  float output_scale;         // 输出logits量化尺度
+  int8_t output_zero_point;   // 输出logits量化零点
+  uint8_t num_layers;
+  const KwsLayer *layers;
+  uint8_t num_labels;
+  uint8_t wake_label;         // 唤醒词对应的类别下标
+};
+
+// int8推理引擎: 两块乒乓激活缓冲区，大小在begin()时按模型结构计算
+class KwsEngine
+{
+public:
+  ~KwsEngine();
+  bool begin(const KwsModel *model);
+  // features: in_h * in_w 个量化特征; 返回 num_labels 个量化logits
+  const int8_t *invoke(const int8_t *features);
+
+  size_t arenaBytes() const { return 2 * buffer_bytes_; } // 激活缓冲区总字节数
+  size_t weightBytes() const { return weight_bytes_; }    // 权重/偏置/量化参数总字节数
+  uint32_t macs() const { return macs_; }                  // 单次推理的乘加次数
+
+private:
+  const KwsModel *model_ = nullptr;
+  int8_t *buffers_[2] = {nullptr, nullptr};
+  size_t buffer_bytes_ = 0;
+  size_t weight_bytes_ = 0;
+  uint32_t macs_ = 0;
+};
+
+// 流式关键词检测器: MFCC环形特征 + 定期推理 + 后验概率平滑
+class KwsDetector
+{
+public:
+  // infer_stride: 每产生多少个新特征帧推理一次
+  // smooth_window: 唤醒词后验概率滑动平均窗口 (次推理)
+  // threshold: 平滑后验概率的触发阈值 (0~1)
+  // refractory: 触发后忽略的推理次数，防止同一次唤醒重复触发
+  bool begin(const KwsModel *model, uint8_t infer_stride, uint8_t smooth_window,
+             float threshold, uint8_t refractory);
+  // 推入PCM样本，检测到唤醒词时返回true
+  bool push(const int16_t *samples, size_t count);
+  void reset();
+
+  float lastScore() const { return last_score_; }      // 最近一次平滑后的唤醒词后验概率
+  uint32_t inferences() const { return inferences_; }   // 累计推理次数
+  const KwsEngine &engine() const { return engine_; }
+
+private:
+  float wakeProbability(const int8_t *logits) const;
+
+  static const uint8_t MAX_SMOOTH = 8;
+
+  const KwsModel *model_ = nullptr;
+  KwsEngine engine_;
+  KwsFeatureRing ring_;
+  int8_t features_[KWS_NUM_FRAMES * KWS_MFCC_COEFFS];
+  uint8_t infer_stride_ = 1;
+  uint8_t pending_frames_ = 0;
+  float history_[MAX_SMOOTH] = {0};
+  uint8_t smooth_window_ = 1;
+  uint8_t history_pos_ = 0;
+  float threshold_ = 0.8f;
+  uint8_t refractory_ = 0;
+  uint8_t cooldown_ = 0;
+  float last_score_ = 0.0f;
+  uint32_t inferences_ = 0;
+};
+
+#endif // KWS_MODEL_H
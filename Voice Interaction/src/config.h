@@ -9,10 +9,50 @@
 #define SERVER_HOST "YOUR_SERVER_IP_ADDRESS" // 服务器IP地址或域名
 #define SERVER_PORT 5000                     // 服务器端口号
 
+// 音频管线参数
+#define AUDIO_PROFILE 16000         // 音频配置 (16000: 16kHz, 8000: 8kHz低带宽) - 块大小、DMA缓冲数、VAD阈值见 lib/AudioProfile/audio_profile.h，需与服务器 config.json 的 audio.sample_rate 一致
+
 // VAD (Voice Activity Detection) 参数
-#define MAX_VAD_INTERVAL 2000       // 静音检测最大间隔 (ms) - 超过此时间未检测到语音活动，则认为是一段静默
+#define ENDPOINT_MIN_SILENCE_MS 384 // 自适应静音超时下限 (ms) - 超时随当前说话人的句内停顿统计在上下限之间调整
+#define ENDPOINT_MAX_SILENCE_MS 2000 // 自适应静音超时上限 (ms) - 静音中出现迟疑声时按此等待
+#define ENDPOINT_CONFIRM_MS 192     // 提前结束确认窗口 (ms) - 停顿超过提前阈值后，还需保持这么久的深度静音才结束
+#define ENDPOINT_PAUSE_PRIOR_MS 500 // 新说话人的句内停顿初始估计 (ms) - 会话结束后恢复为此值
 #define MAX_ACTIVATE_INTERVAL 30000 // 单次语音激活最大持续时间 (ms) - 语音活动超过此时间，则强制结束本次激活
 #define MAX_REST_LIMIT 30000        // 无语音激活进入休眠的最大等待时间 (ms) - 在此时间内无任何语音激活，设备可能进入休眠模式
-#define VAD_ENERGY_THRESHOLD 10000  // VAD 能量阈值 - 用于判断是否检测到语音活动的能量界限
+
+// 关键词唤醒 (KWS) 参数
+#define KWS_ENABLE 0                // 是否启用唤醒词开启会话 (1: 启用) - 需要先用 tools/kws_export.py 生成 src/kws_model_data.h
+#define KWS_THRESHOLD 0.85f         // 唤醒阈值 - 平滑后的唤醒词后验概率超过此值即触发 (0~1)
+#define KWS_INFER_STRIDE 5          // 推理间隔 - 每产生多少个新特征帧 (每帧20ms) 推理一次
+#define KWS_SMOOTH_WINDOW 3         // 后验概率平滑窗口 - 对最近多少次推理结果取平均
+#define KWS_REFRACTORY 10           // 触发后的冷却推理次数 - 防止同一次唤醒重复触发
+#define KWS_STANDBY_CPU_MHZ 160     // 待机监听唤醒词时的CPU频率 (MHz) - WiFi要求不低于80
+
+// 任务性能分析与调度参数
+#define PROFILER_REPORT_MS 5000     // 任务性能报告周期 (ms) - 以JSON行输出到串口，0表示不输出 (串口调度命令仍然有效)
+#define SCHED_PROFILE 0             // 启动时的调度配置 (0: 默认, 1: 网络任务移到核心1, 2: 网络任务在核心1低优先级) - 可用串口命令 "sched <序号>" 切换
+
+// 上行音频队列参数
+#define UPLINK_BUFFER_MS 6400       // 上行缓冲池时长 (ms) - 按块时长换算为帧数 (每帧一个I2S DMA缓冲区)，启动时一次性分配
+#define UPLINK_POLICY 2             // 队列满时的策略 (0: 有界阻塞, 1: 丢弃最旧帧, 2: 优先丢弃非语音帧) - 丢弃的音频以间隙通知服务器补齐静音
+#define UPLINK_BLOCK_MS 100         // 有界阻塞策略下采集端的最长等待时间 (ms) - 超时丢弃新帧
+
+// 回复语音缓存参数
+#define REPLY_CACHE_ENABLE 1                   // 是否启用Flash回复语音缓存 (1: 启用) - 服务器可要求直接播放缓存中的常用回复
+#define REPLY_CACHE_MAX_BYTES (3 * 1024 * 1024) // 缓存总字节上限 - 同时受LittleFS分区剩余空间限制，超出时淘汰最久未使用的语音
+
+// UDP音频传输参数 (需与服务器 config.json 中的 udp_audio 一致)
+#define UDP_AUDIO_ENABLE 0          // 是否通过UDP传输语音数据 (1: 启用) - 控制信号和文本仍走TCP，丢包由接收端隐藏
+#define UDP_AUDIO_PORT 5001         // UDP端口 - 服务器在此端口接收上行语音，设备在此端口接收下行语音
+#define JITTER_MIN_FRAMES 2         // 抖动缓冲最小目标深度 (帧，每帧256样本即16ms)
+#define JITTER_MAX_FRAMES 16        // 抖动缓冲最大目标深度 (帧) - 目标深度在此范围内随到达抖动自动调整
+#define JITTER_SLOTS 64             // 抖动缓冲窗口帧数 - 超出窗口的包被丢弃
+#define UDP_REPLY_TIMEOUT_MS 1000   // 下行语音超过此时间没有新包时结束播放 (ms)
+
+// 表情舵机参数
+#define MOTION_DIRECT 0             // 是否由ESP32直接驱动PCA9685舵机驱动板 (1: 启用) - 动作指令随回复通过TCP下发，需与服务器 config.json 的 motion.direct 一致
+#define MOTION_I2C_HZ 400000        // PCA9685的I2C时钟频率 (Hz)
+#define MOTION_STEP_MS 50           // 表情中相邻两个舵机的设置间隔 (ms) - 避免所有舵机同时启动造成电源跌落
+#define MOTION_BLINK_MS 3000        // 自动眨眼间隔 (ms)
 
 #endif // CONFIG_H
\ No newline at end of file
@@ -15,6 +15,31 @@
 #include "freertos/semphr.h" // FreeRTOS信号量管理
 
 #include "config.h" // 项目配置文件
+#include "task_profiler.h" // 任务性能分析与调度配置
+#include "audio_uplink.h"  // 带背压策略的上行音频队列
+#include "reply_cache.h"   // Flash上的回复语音缓存
+#include "endpointer.h"    // 自适应语句端点检测
+#include "audio_profile.h" // 编译期音频管线配置
+#include "audio_health.h"  // I2S音频通路健康监测
+#include "face_motion.h"   // 表情舵机动作引擎和下行动作指令格式
+#include <esp_timer.h>     // 微秒时钟，用于I2S读写计时和下行语音的帧节拍
+#if UDP_AUDIO_ENABLE
+#include <WiFiUdp.h>       // UDP收发
+#include "udp_audio.h"     // UDP音频包格式和抖动缓冲
+#endif
+
+#if MOTION_DIRECT
+#include <Wire.h>                    // 硬件I2C
+#include <Adafruit_PWMServoDriver.h> // PCA9685舵机驱动板
+#endif
+
+#if KWS_ENABLE
+#if !__has_include("kws_model_data.h")
+#error "KWS_ENABLE 需要先用 tools/kws_export.py 生成 src/kws_model_data.h"
+#endif
+#include "kws_model.h"      // 关键词唤醒推理引擎
+#include "kws_model_data.h" // 导出的int8唤醒词模型
+#endif
 
 // I2S引脚定义 - INMP441麦克风
 #define I2S_WS_INMP441 4    // I2S Word Select (LRCL) 引脚
@@ -31,12 +56,28 @@
 #define buttonUp 9      // 音量加按键
 #define buttonStart 13  // 开始/停止按键
 
+// I2C引脚定义 - PCA9685舵机驱动板 (MOTION_DIRECT启用时)
+#define MOTION_SDA_PIN 1    // I2C SDA 引脚
+#define MOTION_SCL_PIN 2    // I2C SCL 引脚
+
 // I2S配置参数
 #define I2S_PORT_INMP441 I2S_NUM_0 // INMP441麦克风使用的I2S端口号
 #define I2S_PORT_98357A I2S_NUM_1  // MAX98357A放大器使用的I2S端口号
-#define SAMPLE_RATE 16000          // 音频采样率 (16kHz)
-#define SAMPLE_BITS 16             // 音频采样位数 (16-bit)
-#define BUFFER_SIZE 1024           // I2S DMA缓冲区大小 (样本数)
+
+// 音频管线配置 (采样率、块大小、DMA缓冲数、VAD阈值)，由config.h中的AUDIO_PROFILE选择
+#if AUDIO_PROFILE == 16000
+typedef AudioProfile16k Pipeline;
+#elif AUDIO_PROFILE == 8000
+typedef AudioProfile8k Pipeline;
+#else
+#error "AUDIO_PROFILE 只支持 16000 或 8000"
+#endif
+#if UDP_AUDIO_ENABLE
+static_assert(Pipeline::udp_frame_samples <= UDP_AUDIO_FRAME_SAMPLES, "UDP音频包超过包格式允许的最大样本数");
+#endif
+#if KWS_ENABLE
+static_assert(Pipeline::sample_rate == KWS_SAMPLE_RATE, "唤醒词模型按16kHz特征训练，需使用16kHz音频配置");
+#endif
 
 // 网络通信信号定义
 #define START_VOICE_RECEIVE 0x01 // 开始接收语音信号
@@ -47,11 +88,16 @@
 #define LED_COUNT 1   // NeoPixel LED数量
 
 WiFiClient client; // TCP客户端对象
+#if UDP_AUDIO_ENABLE
+WiFiUDP udp_tx;          // 上行语音发送 (网络任务)
+WiFiUDP udp_rx;          // 下行语音接收 (loop)
+JitterBuffer udp_jitter; // 下行语音抖动缓冲
+#endif
 
 double volume = 0.3;  // 音频播放音量 (0.0 ~ 1.0)
 
 // FreeRTOS任务和队列句柄 - 运行在核心0
-QueueHandle_t networkQueue;     // 网络任务队列句柄
+AudioUplink uplink;             // 网络任务上行队列 (音频帧和控制信号)
 QueueHandle_t ledControlQueue;  // LED控制任务队列句柄
 QueueHandle_t u8g2Queue;        // OLED显示任务队列句柄
 TaskHandle_t networkTask;       // 网络任务句柄
@@ -99,7 +145,7 @@ void u8g2_oled(void *parameter)
   {
     u8g2Message msg;
     // 尝试从队列接收新的显示消息，超时时间10ms
-    if (xQueueReceive(u8g2Queue, &msg, pdMS_TO_TICKS(10)) == pdPASS)
+    if (prof_queue_receive(PROF_OLED, u8g2Queue, &msg, pdMS_TO_TICKS(10)) == pdPASS)
     {
       type = msg.type; // 更新显示类型
       // 复制新的文本内容，并释放旧消息中的内存
@@ -138,7 +184,7 @@ void u8g2_oled(void *parameter)
     }
     u8g2.sendBuffer(); // 将缓冲区内容发送到OLED显示
     
-    vTaskDelay(50 / portTICK_PERIOD_MS); // 任务延时50ms
+    prof_delay(PROF_OLED, 50); // 任务延时50ms
   }
 }
 
@@ -155,7 +201,7 @@ void updateText(const char* upper, const char* lower, u8g2_msg_type type)
   memcpy(msg.lower, lower, strlen(lower));
   msg.lower[strlen(lower)] = '\0'; // 添加字符串结束符
   // 将消息发送到OLED任务队列，超时时间100ms
-  xQueueSend(u8g2Queue, &msg, pdMS_TO_TICKS(100));
+  prof_queue_send(PROF_LOOP, u8g2Queue, &msg, pdMS_TO_TICKS(100));
 }
 
 // RGB LED状态枚举
@@ -224,120 +270,135 @@ void RGB_LED(void *parameter)
       // 根据标志设置蓝色或熄灭
       strip.setPixelColor(0, strip.Color(flickerBrightness * 0, flickerBrightness * 0, flickerBrightness * 255));
       strip.show();
-      vTaskDelay(500 / portTICK_PERIOD_MS); // 闪烁间隔500ms
+      prof_delay(PROF_LED, 500); // 闪烁间隔500ms
       continue; // 继续下一次闪烁循环，不执行下面的延时
     }
-    vTaskDelay(100 / portTICK_PERIOD_MS); // 非闪烁状态下任务延时100ms
+    prof_delay(PROF_LED, 100); // 非闪烁状态下任务延时100ms
   }
 }
 
 // 更新LED状态的函数
 void updateLedState(RGB_LED_STATE newState)
 {
+  // 只发送变化的状态: 待机时每个唤醒词检测步长都会调用，重复发送会填满队列，每次都阻塞到10ms超时
+  static int lastState = -1; // 最近一次成功发送的状态 (-1表示尚未发送)
+  if (newState == lastState)
+  {
+    return;
+  }
   // 将新的LED状态发送到LED控制任务队列，超时时间10ms
-  xQueueSend(ledControlQueue, &newState, pdMS_TO_TICKS(10));
+  if (prof_queue_send(PROF_LOOP, ledControlQueue, &newState, pdMS_TO_TICKS(10)) == pdPASS)
+  {
+    lastState = newState;
+  }
 }
 
-// 网络消息类型枚举
-enum NetMsgType
-{
-  NET_SEND_AUDIO,  // 发送音频数据
-  NET_SEND_SIGNAL, // 发送控制信号
-};
-
-// 网络消息结构体
-struct NetMessage
+// 网络任务函数 (处理数据发送)
+#if UDP_AUDIO_ENABLE
+uint8_t udp_stream = 0;     // 上行语音段编号，每次START_VOICE_RECEIVE递增
+uint16_t udp_seq = 0;       // 上行包序号
+uint32_t udp_timestamp = 0; // 下一个上行样本在本段语音中的样本序号
+uint32_t udp_tx_packets = 0; // 已发送的上行包数
+uint32_t udp_tx_errors = 0;  // 发送失败的上行包数
+
+// 通过UDP发送一个上行元素: 音频按包拆分并打上时间戳，丢帧间隙只推进时间戳 (服务器按时间戳补齐)
+// 控制信号仍走TCP，作为语音段的边界
+bool udp_write_item(UplinkItem &item)
 {
-  NetMsgType type; // 消息类型
-  union // 联合体，根据消息类型存储不同数据
+  static uint8_t packet[UDP_AUDIO_HEADER_BYTES + UDP_AUDIO_FRAME_SAMPLES * sizeof(int16_t)];
+  udp_timestamp += item.gap_samples;
+  if (item.kind == UPLINK_SIGNAL)
+  {
+    if (item.signal == START_VOICE_RECEIVE)
+    {
+      udp_stream++;
+      udp_seq = 0;
+      udp_timestamp = 0;
+    }
+    item.gap_samples = 0;
+    return uplink_write_item(client, item);
+  }
+  size_t samples = item.bytes / sizeof(int16_t);
+  for (size_t i = 0; i < samples; i += Pipeline::udp_frame_samples)
   {
-    struct // 音频数据结构
+    UdpAudioHeader header;
+    header.stream = udp_stream;
+    header.seq = udp_seq++;
+    header.samples = samples - i < Pipeline::udp_frame_samples ? samples - i : Pipeline::udp_frame_samples;
+    header.timestamp = udp_timestamp;
+    size_t length = udp_audio_encode(packet, sizeof(packet), header, item.data + i);
+    udp_tx.beginPacket(SERVER_HOST, UDP_AUDIO_PORT);
+    udp_tx.write(packet, length);
+    if (udp_tx.endPacket())
     {
-      int16_t *data; // 音频样本数据指针
-      size_t bytes;  // 音频数据字节数
-    } audioData;
-    struct // 控制信号数据结构
+      udp_tx_packets++;
+    }
+    else
     {
-      uint16_t signal; // 控制信号值
-    } signalData;
-  };
-};
+      udp_tx_errors++; // 不重传，由服务器隐藏
+    }
+    udp_timestamp += header.samples;
+  }
+  return true;
+}
+#endif
 
-// 网络任务函数 (处理数据发送)
 void NetworkTaskFunction(void *parameter)
 {
-  NetMessage msg; // 网络消息
+  UplinkItem item; // 上行队列元素
 
   while (true) // 任务主循环
   {
-    // 尝试从网络队列接收消息，超时时间200ms
-    if (xQueueReceive(networkQueue, &msg, pdMS_TO_TICKS(200)) == pdPASS)
+    sched_checkpoint(PROF_NET); // 调度配置变化时在此迁移到新核心
+    // 尝试从上行队列取出音频帧或控制信号，超时时间200ms
+    int64_t blocked = prof_block_begin();
+    bool ready = uplink.acquire(item, 200);
+    prof_block_end(PROF_NET, blocked);
+    if (ready)
     {
-      switch (msg.type) // 根据消息类型处理
+      // 按 类型(1字节) + 长度(4字节) + 数据 的格式发送；之前有丢帧时先发送间隙通知
+#if UDP_AUDIO_ENABLE
+      if (!udp_write_item(item))
+#else
+      if (!uplink_write_item(client, item))
+#endif
       {
-      case NET_SEND_AUDIO: // 发送音频数据
-      {
-        uint8_t signal_type = 0x02; // 定义数据类型为音频 (0x02)
-        uint32_t datalength = static_cast<uint32_t>(msg.audioData.bytes); // 音频数据长度
-        // 发送数据类型头部
-        client.write((const uint8_t *)&signal_type, sizeof(signal_type));
-        // 发送数据长度头部
-        client.write((const uint8_t *)&datalength, sizeof(datalength));
-        size_t total_written = 0;
-        //循环发送音频数据，直到全部发送完毕
-        while (total_written < datalength)
-        {
-          int n = client.write(((uint8_t *)msg.audioData.data) + total_written,
-                               datalength - total_written);
-          if (n <= 0) // 如果发送失败或连接断开
-            break;
-          total_written += n; // 更新已发送字节数
-        }
-        free(msg.audioData.data); // 释放音频数据内存
-        client.flush(); // 确保所有数据都已发送
-        break;
-      }
-      case NET_SEND_SIGNAL: // 发送控制信号
-      {
-        uint8_t signal_type = 0x01; // 定义数据类型为信号 (0x01)
-        uint32_t datalength = sizeof(uint16_t); // 信号数据长度 (固定为2字节)
-        uint16_t signal = msg.signalData.signal; // 获取信号值
-        // 发送数据类型头部
-        client.write((const uint8_t *)&signal_type, sizeof(signal_type));
-        // 发送数据长度头部
-        client.write((const uint8_t *)&datalength, sizeof(datalength));
-        // 发送信号数据
-        client.write((const uint8_t *)&signal, datalength);
-        client.flush(); // 确保所有数据都已发送
-        break;
-      }
+        Serial.println("Uplink write failed"); // 发送失败或连接断开
       }
+      client.flush(); // 确保所有数据都已发送
+      uplink.release(); // 归还缓冲区 (发送期间该帧不会被丢弃)
     }
-    vTaskDelay(10 / portTICK_PERIOD_MS); // 任务延时10ms
   }
 }
 
-// 发送音频数据到网络任务队列
-void sendAudioToNetwork(int16_t *samples, size_t bytes_size)
+// 发送音频数据到上行队列，speech为该段音频的VAD结果 (队列满时优先丢弃非语音帧)
+void sendAudioToNetwork(int16_t *samples, size_t bytes_size, bool speech)
 {
-  NetMessage msg;
-  msg.type = NET_SEND_AUDIO;
-  // 为音频数据动态分配内存并复制内容
-  msg.audioData.data = (int16_t *)malloc(bytes_size);
-  memcpy(msg.audioData.data, samples, bytes_size);
-  msg.audioData.bytes = bytes_size;
-  // 将消息发送到网络任务队列，超时时间100ms
-  xQueueSend(networkQueue, &msg, pdMS_TO_TICKS(100));
+  // 音频复制到预分配的缓冲池，队列满时按UPLINK_POLICY阻塞或丢帧，不会泄漏内存
+  int64_t blocked = prof_block_begin();
+  uplink.pushAudio(samples, bytes_size, speech);
+  prof_block_end(PROF_LOOP, blocked);
 }
 
-// 发送控制信号到网络任务队列
+// 发送控制信号到上行队列 (控制信号不会因队列满被丢弃)
 void sendSignalToNetwork(uint16_t signal)
 {
-  NetMessage msg;
-  msg.type = NET_SEND_SIGNAL;
-  msg.signalData.signal = signal;
-  // 将消息发送到网络任务队列，超时时间100ms
-  xQueueSend(networkQueue, &msg, pdMS_TO_TICKS(100));
+  int64_t blocked = prof_block_begin();
+  uplink.pushSignal(signal);
+  prof_block_end(PROF_LOOP, blocked);
+}
+
+// 以JSON行输出上行队列的累计丢帧和阻塞统计
+void report_uplink()
+{
+  UplinkStats st = uplink.stats();
+  Serial.printf("{\"type\":\"uplink\",\"policy\":%d,\"frames_in\":%u,\"sent\":%u,\"dropped_oldest\":%u,"
+                "\"dropped_silence\":%u,\"dropped_new\":%u,\"dropped_signals\":%u,\"stalls\":%u,"
+                "\"stall_ms_max\":%.1f,\"stall_ms_total\":%.1f,\"gaps\":%u,\"gap_ms\":%.1f,\"high_water\":%u}\n",
+                (int)uplink.policy(), (unsigned)st.frames_in, (unsigned)st.frames_sent, (unsigned)st.dropped_oldest,
+                (unsigned)st.dropped_silence, (unsigned)st.dropped_new, (unsigned)st.dropped_signals,
+                (unsigned)st.stalls, st.stall_us_max / 1000.0, st.stall_us_total / 1000.0, (unsigned)st.gaps_sent,
+                st.gap_samples * 1000.0 / Pipeline::sample_rate, (unsigned)st.high_water);
 }
 
 // 按键处理任务函数
@@ -377,7 +438,7 @@ void buttom(void *parameter)
         xSemaphoreGive(buttonMutex); // 释放互斥锁
       }
     }
-    vTaskDelay(100 / portTICK_PERIOD_MS); // 任务延时100ms，进行按键消抖和降低CPU占用
+    prof_delay(PROF_BUTTON, 100); // 任务延时100ms，进行按键消抖和降低CPU占用
   }
 }
 
@@ -386,17 +447,165 @@ size_t voice_size = 1024 * 1024; // 预分配用于接收语音的缓冲区大
 // 在SPIRAM中为接收的语音样本分配内存
 int16_t *voice_samples = (int16_t *)heap_caps_malloc(voice_size * sizeof(int16_t), MALLOC_CAP_SPIRAM);
 
-// 从TCP客户端接收语音数据
-size_t receive_client_voice()
+ReplyCache reply_cache;          // 回复语音缓存 (LittleFS)
+File cached_clip;                // 缓存命中时待播放的语音文件
+bool clip_store_pending = false; // 播放后是否需要把voice_samples存入缓存
+uint64_t clip_store_hash = 0;    // 存入缓存时使用的哈希
+bool udp_reply_pending = false;  // 语音是否随后通过UDP流式到达
+
+// 等待服务器数据可用
+void wait_client_data()
 {
-  size_t datalength = 0; // 期望接收的数据长度
-  // 等待客户端数据可用
   while (!client.available())
   {
-    delay(100); // 等待100ms
+    prof_delay(PROF_LOOP, 10); // 等待10ms (动作指令在等待回复期间到达，轮询间隔计入指令到动作的延迟)
+  }
+}
+
+// 舵机动作相关: 动作指令随回复通过TCP下发，MOTION_DIRECT启用时由核心0上的动作任务直接驱动PCA9685
+struct MotionCommand
+{
+  uint8_t bytes[FACE_CMD_MAX_BYTES]; // 指令字节 (与 Servo Control 的串口指令相同)
+  uint8_t len;
+  int64_t arrival_us; // 指令从TCP读出的时间，用于指令到动作的延迟统计
+};
+bool motion_speak_pending = false; // 开始说话指令推迟到回复开始播放时执行
+
+#if MOTION_DIRECT
+Adafruit_PWMServoDriver pwm1 = Adafruit_PWMServoDriver(0x40, Wire); // PCA9685板1 (眼部和眉毛)
+Adafruit_PWMServoDriver pwm2 = Adafruit_PWMServoDriver(0x41, Wire); // PCA9685板2 (嘴部)
+QueueHandle_t motionQueue;    // 舵机动作任务队列句柄
+TaskHandle_t motionTask;      // 舵机动作任务句柄
+SemaphoreHandle_t motionMutex; // 保护face (动作任务推进，loop读取统计)
+FaceMotion face;              // 表情动作引擎
+
+// 舵机写入回调: 板0为0x40，板1为0x41
+void motion_write(uint8_t board, uint8_t channel, uint16_t ticks, void *context)
+{
+  (board == 0 ? pwm1 : pwm2).setPWM(channel, 0, ticks);
+}
+
+// 舵机动作任务函数: 等待新指令，最多等到下一个表情步骤、眨眼或嘴部开合的时间
+void motion_task(void *parameter)
+{
+  MotionCommand cmd;
+  while (true)
+  {
+    int64_t wait_us = face.nextDueUs() - esp_timer_get_time();
+    TickType_t ticks = 0;
+    if (wait_us > 0)
+    {
+      ticks = pdMS_TO_TICKS(wait_us < 100000 ? (wait_us + 999) / 1000 : 100);
+    }
+    bool received = prof_queue_receive(PROF_MOTION, motionQueue, &cmd, ticks) == pdPASS;
+    if (xSemaphoreTake(motionMutex, portMAX_DELAY) == pdTRUE)
+    {
+      if (received)
+      {
+        face.command(cmd.bytes, cmd.len, cmd.arrival_us, esp_timer_get_time());
+      }
+      face.update(esp_timer_get_time());
+      xSemaphoreGive(motionMutex);
+    }
+  }
+}
+
+// 以JSON行输出自上次报告以来的指令到动作延迟 (指令从TCP读出 -> 第一个/最后一个舵机写入)
+void report_motion()
+{
+  FaceMotionStats st = {};
+  if (xSemaphoreTake(motionMutex, portMAX_DELAY) == pdTRUE)
+  {
+    st = face.stats();
+    face.resetStats();
+    xSemaphoreGive(motionMutex);
+  }
+  Serial.printf("{\"type\":\"motion\",\"t\":%lu,\"commands\":%u,\"start_us_mean\":%u,\"start_us_max\":%u,"
+                "\"done_us_mean\":%u,\"done_us_max\":%u,\"superseded\":%u,\"rejected\":%u,\"servo_writes\":%u}\n",
+                (unsigned long)millis(), (unsigned)st.commands,
+                st.commands > 0 ? (unsigned)(st.start_us_sum / st.commands) : 0u, (unsigned)st.start_us_max,
+                st.commands > 0 ? (unsigned)(st.done_us_sum / st.commands) : 0u, (unsigned)st.done_us_max,
+                (unsigned)st.superseded, (unsigned)st.rejected, (unsigned)st.servo_writes);
+}
+#endif
+
+// 把一条动作指令交给动作任务 (未启用MOTION_DIRECT时丢弃)
+void motion_send(const uint8_t *bytes, uint8_t len, int64_t arrival_us)
+{
+#if MOTION_DIRECT
+  MotionCommand cmd;
+  memcpy(cmd.bytes, bytes, len);
+  cmd.len = len;
+  cmd.arrival_us = arrival_us;
+  prof_queue_send(PROF_LOOP, motionQueue, &cmd, pdMS_TO_TICKS(10));
+#endif
+}
+
+// 读取REPLY_MOTION之后的一条动作指令: 开始说话推迟到回复开始播放，其余立即交给动作任务
+void receive_motion_command()
+{
+  int64_t arrival = esp_timer_get_time();
+  uint8_t len = 0;
+  uint8_t bytes[255];
+  client.readBytes(&len, sizeof(len));
+  client.readBytes(bytes, len);
+  if (len == 0 || len > FACE_CMD_MAX_BYTES)
+  {
+    return; // 未知指令，已从数据流中跳过
+  }
+  if (bytes[0] == FACE_CMD_SPEAK_START)
+  {
+    motion_speak_pending = true;
+    return;
   }
+  motion_send(bytes, len, arrival);
+}
+
+// 从TCP客户端接收语音数据
+// 服务器可以先发送"播放缓存语音"请求，命中时语音从Flash流式播放，不再接收PCM数据
+size_t receive_client_voice()
+{
+  uint32_t datalength = 0; // 期望接收的数据长度
+  wait_client_data();
   // 读取数据长度头部 (4字节)
   client.readBytes((uint8_t *)&datalength, sizeof(datalength));
+  // 回复之前的动作指令 (注视、表情、开始说话)
+  while (datalength == REPLY_MOTION)
+  {
+    receive_motion_command();
+    wait_client_data();
+    client.readBytes((uint8_t *)&datalength, sizeof(datalength));
+  }
+  udp_reply_pending = false;
+#if UDP_AUDIO_ENABLE
+  if (datalength == REPLY_UDP_STREAM)
+  {
+    // 语音在文本之后通过UDP发送，这里只取总长度
+    client.readBytes((uint8_t *)&datalength, sizeof(datalength));
+    udp_reply_pending = true;
+    return datalength / sizeof(int16_t);
+  }
+#endif
+  if (datalength == REPLY_PLAY_CACHED)
+  {
+    uint64_t hash = 0;
+    client.readBytes((uint8_t *)&hash, sizeof(hash));
+    if (reply_cache.open(hash, cached_clip))
+    {
+      sendSignalToNetwork(CACHE_HIT); // 通知服务器直接发送文本
+      return cached_clip.size() / sizeof(int16_t);
+    }
+    sendSignalToNetwork(CACHE_MISS); // 服务器随后会重新发送语音
+    wait_client_data();
+    client.readBytes((uint8_t *)&datalength, sizeof(datalength));
+  }
+  clip_store_pending = false;
+  if (datalength == REPLY_STORE_CLIP)
+  {
+    client.readBytes((uint8_t *)&clip_store_hash, sizeof(clip_store_hash));
+    clip_store_pending = true;
+    client.readBytes((uint8_t *)&datalength, sizeof(datalength));
+  }
   size_t samples_count = datalength / sizeof(int16_t); // 计算样本数量
   size_t total_read = 0;
   // 循环读取数据，直到接收完指定长度的数据
@@ -405,7 +614,93 @@ size_t receive_client_voice()
     int n = client.read(((uint8_t *)voice_samples) + total_read, datalength - total_read);
     total_read += n;
   }
+  return samples_count; // 返回接收到的样本数量 (原始PCM，播放时再调整音量)
+}
+
+QueueHandle_t i2s_rx_events = NULL; // 麦克风I2S驱动事件队列 (DMA块完成、溢出)
+QueueHandle_t i2s_tx_events = NULL; // 放大器I2S驱动事件队列 (DMA块完成、取空)
+AudioHealth audio_health;           // I2S音频通路健康监测 (只在loop中使用)
 
+// 取出两个I2S事件队列中的所有事件: 每个DMA块都会产生一个完成事件，需要在每次读写前取出，
+// 否则队列满后驱动会丢弃最旧的事件
+void audio_health_poll()
+{
+  i2s_event_t event;
+  while (i2s_rx_events != NULL && xQueueReceive(i2s_rx_events, &event, 0) == pdTRUE)
+  {
+    if (event.type == I2S_EVENT_RX_Q_OVF)
+    {
+      audio_health.noteEvent(HEALTH_RX_OVERFLOW);
+    }
+    else if (event.type == I2S_EVENT_DMA_ERROR)
+    {
+      audio_health.noteEvent(HEALTH_DMA_ERROR);
+    }
+  }
+  while (i2s_tx_events != NULL && xQueueReceive(i2s_tx_events, &event, 0) == pdTRUE)
+  {
+    // 发送队列溢出: 所有DMA缓冲都已播放完而没有新数据写入
+    if (event.type == I2S_EVENT_TX_Q_OVF)
+    {
+      audio_health.noteEvent(HEALTH_TX_UNDERFLOW);
+    }
+    else if (event.type == I2S_EVENT_DMA_ERROR)
+    {
+      audio_health.noteEvent(HEALTH_DMA_ERROR);
+    }
+  }
+}
+
+// 从麦克风读取音频，返回读到的字节数 (短读和错误计入健康统计)
+size_t mic_read(void *dest, size_t bytes)
+{
+  audio_health_poll();
+  size_t bytes_read = 0;
+  int64_t blocked = prof_block_begin();
+  if (i2s_read(I2S_PORT_INMP441, dest, bytes, &bytes_read, portMAX_DELAY) != ESP_OK)
+  {
+    bytes_read = 0;
+  }
+  prof_block_end(PROF_LOOP, blocked);
+  audio_health.noteRead(bytes, bytes_read, blocked, esp_timer_get_time());
+  return bytes_read;
+}
+
+// 向放大器写入音频，返回写入的字节数 (短写和错误计入健康统计)
+size_t speaker_write(const void *src, size_t bytes)
+{
+  audio_health_poll();
+  size_t bytes_written = 0;
+  int64_t blocked = prof_block_begin();
+  if (i2s_write(I2S_PORT_98357A, src, bytes, &bytes_written, portMAX_DELAY) != ESP_OK)
+  {
+    bytes_written = 0;
+  }
+  prof_block_end(PROF_LOOP, blocked);
+  audio_health.noteWrite(bytes, bytes_written, blocked, esp_timer_get_time());
+  return bytes_written;
+}
+
+// 以JSON行输出本轮的I2S通路统计；t与任务性能报告 ("prof") 的t对应，可以把音频故障和当时的负载对应起来
+void report_audio_health()
+{
+  AudioHealthTurn turn = audio_health.endTurn();
+  const AudioHealthTotals &tot = audio_health.totals();
+  Serial.printf("{\"type\":\"audio_health\",\"t\":%lu,\"nominal_hz\":%u,\"capture_hz\":%u,\"playback_hz\":%u,"
+                "\"capture_ms\":%u,\"playback_ms\":%u,\"reads\":%u,\"short_reads\":%u,\"rx_overflow\":%u,"
+                "\"writes\":%u,\"short_writes\":%u,\"tx_underflow\":%u,\"dma_errors\":%u,\"clipped\":%u,"
+                "\"clipped_pct\":%.2f,\"turns\":%u,\"glitch_turns\":%u}\n",
+                (unsigned long)millis(), (unsigned)audio_health.sampleRate(), (unsigned)turn.capture_hz,
+                (unsigned)turn.playback_hz, (unsigned)turn.capture_ms, (unsigned)turn.playback_ms,
+                (unsigned)turn.reads, (unsigned)turn.short_reads, (unsigned)turn.rx_overflow, (unsigned)turn.writes,
+                (unsigned)turn.short_writes, (unsigned)turn.tx_underflow, (unsigned)turn.dma_errors,
+                (unsigned)turn.clipped, turn.samples_played > 0 ? 100.0 * turn.clipped / turn.samples_played : 0.0,
+                (unsigned)tot.turns, (unsigned)tot.glitch_turns);
+}
+
+// 播放回复语音: 缓存命中时从Flash逐块读取，否则播放voice_samples；每块按当前音量缩放后写入I2S
+void play_reply_voice(size_t tot_length)
+{
   double current_volume = 0.5; // 默认音量
   // 获取当前音量设置 (受互斥锁保护)
   if (xSemaphoreTake(buttonMutex, portMAX_DELAY) == pdTRUE)
@@ -413,12 +708,107 @@ size_t receive_client_voice()
     current_volume = volume;
     xSemaphoreGive(buttonMutex);
   }
-  // 根据当前音量调整接收到的语音样本的幅度
-  for (size_t i = 0; i < samples_count; i++)
+  int32_t gain = audio_gain_q15(current_volume);
+  static int16_t play_samples[Pipeline::block_samples]; // 音量调整后的播放缓冲区
+  for (size_t i = 0; i < tot_length; i += Pipeline::block_samples)
   {
-    voice_samples[i] = (int16_t)(voice_samples[i] * current_volume);
+    size_t count = tot_length - i < Pipeline::block_samples ? tot_length - i : Pipeline::block_samples;
+    if (cached_clip)
+    {
+      count = cached_clip.read((uint8_t *)play_samples, count * sizeof(int16_t)) / sizeof(int16_t);
+      if (count == 0)
+      {
+        break; // 文件提前结束
+      }
+    }
+    else
+    {
+      memcpy(play_samples, &voice_samples[i], count * sizeof(int16_t));
+    }
+    // 根据当前音量调整语音样本的幅度 (超出范围时饱和，而不是溢出回绕)
+    audio_health.noteClipped(audio_apply_gain(play_samples, count, gain));
+    speaker_write(play_samples, count * sizeof(int16_t));
+  }
+  if (cached_clip)
+  {
+    cached_clip.close();
+  }
+}
+
+#if UDP_AUDIO_ENABLE
+// 播放UDP流式下行语音: 收到的包进入抖动缓冲，按帧节拍出队写入I2S
+// 帧节拍由微秒时钟决定而不是I2S阻塞，否则DMA缓冲区会在开头一次性抽空抖动缓冲
+void play_udp_reply(size_t tot_length)
+{
+  double current_volume = 0.5; // 默认音量
+  if (xSemaphoreTake(buttonMutex, portMAX_DELAY) == pdTRUE)
+  {
+    current_volume = volume;
+    xSemaphoreGive(buttonMutex);
+  }
+  static uint8_t packet[UDP_AUDIO_HEADER_BYTES + UDP_AUDIO_FRAME_SAMPLES * sizeof(int16_t)];
+  static int16_t frame[Pipeline::udp_frame_samples];
+  const int64_t frame_us = (int64_t)Pipeline::udp_frame_samples * 1000000 / Pipeline::sample_rate;
+  int32_t gain = audio_gain_q15(current_volume);
+  int64_t last_packet = esp_timer_get_time();
+  int64_t next_tick = last_packet;
+  while (udp_jitter.position() < tot_length)
+  {
+    int64_t now = esp_timer_get_time();
+    // 取出所有已到达的包 (lwIP的UDP接收队列很短，需要持续读取)
+    while (udp_rx.parsePacket() > 0)
+    {
+      int n = udp_rx.read(packet, sizeof(packet));
+      if (n > 0)
+      {
+        udp_jitter.push(packet, n, now);
+        last_packet = now;
+      }
+    }
+    if (now - last_packet > (int64_t)UDP_REPLY_TIMEOUT_MS * 1000)
+    {
+      Serial.println("UDP reply timed out");
+      break;
+    }
+    if (now < next_tick)
+    {
+      prof_delay(PROF_LOOP, 1);
+      continue;
+    }
+    next_tick += frame_us;
+    if (udp_jitter.pop(frame, now) == JITTER_WAITING)
+    {
+      continue;
+    }
+    audio_health.noteClipped(audio_apply_gain(frame, Pipeline::udp_frame_samples, gain));
+    speaker_write(frame, sizeof(frame));
   }
-  return samples_count; // 返回接收到的样本数量
+  udp_jitter.reset();
+}
+
+// 以JSON行输出UDP收发和抖动缓冲统计 (丢包隐藏、迟到包、缓冲延迟)
+void report_udp()
+{
+  JitterStats st = udp_jitter.stats();
+  Serial.printf("{\"type\":\"udp_audio\",\"tx_packets\":%u,\"tx_errors\":%u,\"rx_packets\":%u,\"played\":%u,"
+                "\"concealed\":%u,\"underruns\":%u,\"late\":%u,\"duplicates\":%u,\"overflow\":%u,\"skipped\":%u,"
+                "\"jitter_ms\":%.1f,\"target_frames\":%u,\"buffer_ms_mean\":%.1f,\"buffer_ms_max\":%.1f}\n",
+                (unsigned)udp_tx_packets, (unsigned)udp_tx_errors, (unsigned)st.received, (unsigned)st.played,
+                (unsigned)st.concealed, (unsigned)st.underruns, (unsigned)st.late, (unsigned)st.duplicates,
+                (unsigned)st.overflow, (unsigned)st.skipped, st.jitter_us / 1000.0, (unsigned)st.target_frames,
+                st.played > 0 ? st.latency_us_sum / 1000.0 / st.played : 0.0, st.latency_us_max / 1000.0);
+}
+#endif
+
+// 以JSON行输出回复缓存的命中率和节省的下行字节数
+void report_reply_cache()
+{
+  ReplyCacheStats st = reply_cache.stats();
+  Serial.printf("{\"type\":\"reply_cache\",\"lookups\":%u,\"hits\":%u,\"hit_rate\":%.2f,\"bytes_saved\":%llu,"
+                "\"stores\":%u,\"evictions\":%u,\"store_failures\":%u,\"clips\":%u,\"used_bytes\":%u}\n",
+                (unsigned)st.lookups, (unsigned)st.hits, st.lookups > 0 ? (double)st.hits / st.lookups : 0.0,
+                (unsigned long long)st.bytes_saved, (unsigned)st.stores, (unsigned)st.evictions,
+                (unsigned)st.store_failures, (unsigned)reply_cache.entries(), (unsigned)reply_cache.usedBytes());
 }
 
 // 从TCP客户端接收文本数据
@@ -426,10 +816,7 @@ char *receive_client_text()
 {
   size_t textlength = 0; // 期望接收的文本长度
   // 等待客户端数据可用
-  while (!client.available())
-  {
-    delay(100);
-  }
+  wait_client_data();
   // 读取文本长度头部 (4字节)
   client.readBytes((uint8_t *)&textlength, sizeof(textlength));
   // 为文本缓冲区动态分配内存 (+1用于字符串结束符)
@@ -449,63 +836,71 @@ char *receive_client_text()
 }
 
 // 能量法语音活动检测 (VAD)
-bool energe_vad(int16_t *samples, size_t size)
+bool energe_vad(int32_t energy)
 {
-  int64_t tot_energy = 0; // 总能量
-  // 计算音频帧的总能量 (平方和)
-  for (size_t i = 0; i < size; i++)
-  {
-    tot_energy += (int32_t)samples[i] * samples[i];
-  }
-  int32_t energy = tot_energy / size; // 平均能量
-  return energy > VAD_ENERGY_THRESHOLD; // 如果平均能量大于阈值，则认为有语音活动
+  return energy > Pipeline::vad_energy; // 如果平均能量大于阈值，则认为有语音活动
+}
+
+Endpointer endpointer; // 自适应语句端点检测 (只在loop中使用)
+
+// 以JSON行输出本段语音的端点延迟 (与原固定2秒超时相比节省的时间) 和说话人停顿统计
+void report_endpoint()
+{
+  static const char *reasons[] = {"none", "early", "timeout", "max_length"};
+  EndpointTurn turn = endpointer.lastTurn();
+  EndpointStats st = endpointer.stats();
+  Serial.printf("{\"type\":\"endpoint\",\"reason\":\"%s\",\"speech_ms\":%u,\"endpoint_ms\":%u,\"saved_ms\":%d,"
+                "\"timeout_ms\":%u,\"early_ms\":%u,\"pause_mean_ms\":%u,\"pause_dev_ms\":%u,\"pauses\":%u,"
+                "\"cancelled\":%u,\"endpoint_ms_mean\":%u}\n",
+                reasons[turn.reason], (unsigned)turn.speech_ms, (unsigned)turn.endpoint_ms,
+                (int)ENDPOINT_MAX_SILENCE_MS - (int)turn.endpoint_ms, (unsigned)turn.timeout_ms, (unsigned)turn.early_ms,
+                (unsigned)endpointer.pauseMeanMs(), (unsigned)endpointer.pauseDevMs(), (unsigned)turn.pauses,
+                (unsigned)turn.cancelled, st.turns > 0 ? (unsigned)(st.endpoint_ms_sum / st.turns) : 0u);
 }
 
 // 核心0任务初始化函数
 void core0_begin()
 {
   // 创建各个任务所需的队列
-  networkQueue = xQueueCreate(100, sizeof(NetMessage));       // 网络任务队列，容量100
+  // 上行队列: 缓冲池一次性分配，每帧为一个I2S DMA缓冲区
+  if (!uplink.begin(Pipeline::blocksFor(UPLINK_BUFFER_MS), Pipeline::block_bytes, (UplinkPolicy)UPLINK_POLICY, UPLINK_BLOCK_MS))
+  {
+    Serial.println("Uplink buffer allocation failed");
+  }
   ledControlQueue = xQueueCreate(10, sizeof(RGB_LED_STATE)); // LED控制队列，容量10
   u8g2Queue = xQueueCreate(10, sizeof(u8g2Message));         // OLED显示队列，容量10
 
-  // 创建并启动固定在核心0上的任务
-  xTaskCreatePinnedToCore(
+  // 登记任务，核心和优先级由调度配置 (task_profiler.cpp 中的 sched_profiles) 决定
+  prof_register_task(
+      PROF_NET,            // 分析槽位
       NetworkTaskFunction, // 任务函数
       "NetTask",           // 任务名称
       8192,                // 任务堆栈大小 (字节)
-      NULL,                // 传递给任务的参数
-      3,                   // 任务优先级 (0-configMAX_PRIORITIES-1)
       &networkTask,        // 任务句柄
-      0);                  // 核心ID (0)
-
-  xTaskCreatePinnedToCore(
-      RGB_LED,
-      "RGB_LED_Task",
-      4096,
-      NULL,
-      1,
-      &rgbLedTask,
-      0);
-
-  xTaskCreatePinnedToCore(
-      u8g2_oled,
-      "u8g2_oled",
-      16384, // OLED任务需要较大堆栈，特别是使用中文字库时
-      NULL,
-      2,
-      &u8g2Task,
-      0);
-
-  xTaskCreatePinnedToCore(
-      buttom,
-      "buttom",
-      4096,
-      NULL,
-      1,
-      &buttomTask,
-      0);
+      true);               // 无状态，允许运行时迁移核心
+
+  prof_register_task(PROF_LED, RGB_LED, "RGB_LED_Task", 4096, &rgbLedTask, false);
+  // OLED任务需要较大堆栈，特别是使用中文字库时
+  prof_register_task(PROF_OLED, u8g2_oled, "u8g2_oled", 16384, &u8g2Task, false);
+  prof_register_task(PROF_BUTTON, buttom, "buttom", 4096, &buttomTask, false);
+#if MOTION_DIRECT
+  // 舵机驱动板挂在硬件I2C上 (OLED使用另外两个引脚上的软件I2C)
+  motionQueue = xQueueCreate(8, sizeof(MotionCommand)); // 动作指令队列，容量8
+  motionMutex = xSemaphoreCreateMutex();
+  Wire.begin(MOTION_SDA_PIN, MOTION_SCL_PIN, MOTION_I2C_HZ);
+  pwm1.begin();
+  pwm2.begin();
+  pwm1.setPWMFreq(FACE_PWM_FREQ);
+  pwm2.setPWMFreq(FACE_PWM_FREQ);
+  face.begin(motion_write, NULL, MOTION_STEP_MS * 1000, MOTION_BLINK_MS * 1000, esp_timer_get_time());
+  prof_register_task(PROF_MOTION, motion_task, "motion", 4096, &motionTask, false);
+#endif
+
+  // 创建并启动任务 (默认配置下全部固定在核心0)
+  sched_apply(SCHED_PROFILE);
   Serial.println("Core0 tasks created"); // 串口打印核心0任务创建完成信息
+  uint8_t neutral = FACE_CMD_NEUTRAL;
+  motion_send(&neutral, 1, esp_timer_get_time()); // 启动时设置为自然表情
 }
 
 // 网络初始化函数 (WiFi连接和TCP服务器连接)
@@ -527,6 +922,9 @@ void network_begin()
     delay(1000); // 每1000ms尝试一次
   }
   Serial.println("TCP connection established"); // 串口提示TCP连接已建立
+#if UDP_AUDIO_ENABLE
+  udp_rx.begin(UDP_AUDIO_PORT); // 服务器向TCP连接的对端地址的该端口发送下行语音
+#endif
 }
 
 // I2S驱动初始化函数
@@ -535,13 +933,13 @@ void i2s_begin()
   // INMP441麦克风的I2S配置
   i2s_config_t i2s_config_INMP441 = {
       .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_RX), // 主模式，接收
-      .sample_rate = SAMPLE_RATE,                         // 采样率
+      .sample_rate = Pipeline::sample_rate,               // 采样率
       .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,       // 16位采样
       .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT,        // 单声道 (左声道)
       .communication_format = I2S_COMM_FORMAT_STAND_I2S,  // 标准I2S格式
       .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,           // 中断分配标志
-      .dma_buf_count = 8,                                 // DMA缓冲区数量
-      .dma_buf_len = BUFFER_SIZE,                         // 单个DMA缓冲区大小 (样本数)
+      .dma_buf_count = Pipeline::dma_buffers,             // DMA缓冲区数量
+      .dma_buf_len = Pipeline::block_samples,             // 单个DMA缓冲区大小 (样本数)
       .use_apll = false,                                  // 不使用APLL时钟
       .tx_desc_auto_clear = false,                        // 发送描述符自动清除 (RX模式下无效)
       .fixed_mclk = 0                                     // 固定MCLK频率 (0表示自动)
@@ -559,13 +957,13 @@ void i2s_begin()
   // MAX98357A音频放大器的I2S配置
   i2s_config_t i2s_config_98357A = {
       .mode = (i2s_mode_t)(I2S_MODE_MASTER | I2S_MODE_TX), // 主模式，发送
-      .sample_rate = SAMPLE_RATE,
+      .sample_rate = Pipeline::sample_rate,
       .bits_per_sample = I2S_BITS_PER_SAMPLE_16BIT,
       .channel_format = I2S_CHANNEL_FMT_ONLY_LEFT, // 虽然是单声道放大器，但通常配置为左声道
       .communication_format = I2S_COMM_FORMAT_STAND_I2S,
       .intr_alloc_flags = ESP_INTR_FLAG_LEVEL1,
-      .dma_buf_count = 8,
-      .dma_buf_len = BUFFER_SIZE,
+      .dma_buf_count = Pipeline::dma_buffers,
+      .dma_buf_len = Pipeline::block_samples,
       .use_apll = false,
       .tx_desc_auto_clear = true, // 发送模式下，发送完一个缓冲区后自动清除描述符
       .fixed_mclk = 0
@@ -581,15 +979,43 @@ void i2s_begin()
   };
 
   // 安装并启动I2S驱动 (INMP441 - I2S0)
-  i2s_driver_install(I2S_NUM_0, &i2s_config_INMP441, 0, NULL);
+  // 事件队列用于健康监测 (溢出/取空事件)，深度按每个DMA块一个完成事件留出余量
+  i2s_driver_install(I2S_NUM_0, &i2s_config_INMP441, Pipeline::dma_buffers * 2, &i2s_rx_events);
   i2s_set_pin(I2S_NUM_0, &pin_config_INMP441);
 
   // 安装并启动I2S驱动 (MAX98357A - I2S1)
-  i2s_driver_install(I2S_NUM_1, &i2s_config_98357A, 0, NULL);
+  i2s_driver_install(I2S_NUM_1, &i2s_config_98357A, Pipeline::dma_buffers * 2, &i2s_tx_events);
   i2s_set_pin(I2S_NUM_1, &pin_config_98357A);
   Serial.println("I2S driver installed"); // 串口提示I2S驱动已安装
 }
 
+#if KWS_ENABLE
+KwsDetector kws;                    // 唤醒词检测器
+bool kws_ready = false;             // 唤醒词检测器初始化成功 (模型匹配且缓冲区分配成功)
+int16_t kws_samples[KWS_FRAME_HOP]; // 待机时每次读取一个帧移 (20ms) 的音频
+uint32_t kws_infer_us_max = 0;      // 单次检测 (含MFCC和推理) 的最大耗时 (微秒)
+
+// 待机监听唤醒词: 读取一帧音频送入检测器，检测到唤醒词时返回true
+// 只在核心1上运行，不影响核心0上的网络任务；唤醒前不向服务器发送任何音频
+bool kws_listen()
+{
+  size_t bytes_read = mic_read(kws_samples, sizeof(kws_samples));
+  uint32_t t0 = micros();
+  bool detected = kws.push(kws_samples, bytes_read / sizeof(int16_t));
+  uint32_t elapsed = micros() - t0;
+  if (elapsed > kws_infer_us_max)
+  {
+    kws_infer_us_max = elapsed;
+  }
+  if (detected)
+  {
+    Serial.printf("Wake word detected: score=%.2f, inferences=%u, max %u us\n",
+                  kws.lastScore(), (unsigned)kws.inferences(), (unsigned)kws_infer_us_max);
+  }
+  return detected;
+}
+#endif
+
 // Arduino setup()函数，在程序启动时执行一次
 void setup()
 {
@@ -603,84 +1029,125 @@ void setup()
   buttonMutex = xSemaphoreCreateMutex(); // 创建按键互斥锁
   pinMode(buttonStart, INPUT_PULLUP);    // 设置开始按键为上拉输入
 
+  prof_attach_current(PROF_LOOP, "loopTask"); // setup()和loop()运行在同一个任务中
   core0_begin();   // 初始化核心0上的任务
+  prof_begin(PROFILER_REPORT_MS); // 处理串口调度命令，并周期性输出任务性能报告
   network_begin(); // 初始化网络连接
   i2s_begin();     // 初始化I2S驱动
+#if REPLY_CACHE_ENABLE
+  reply_cache.begin(REPLY_CACHE_MAX_BYTES); // 挂载LittleFS并加载缓存索引
+#endif
+  EndpointConfig endpoint_config = {
+      Pipeline::block_ms, // 每块时长
+      Pipeline::vad_energy,
+      ENDPOINT_MIN_SILENCE_MS,
+      ENDPOINT_MAX_SILENCE_MS,
+      ENDPOINT_CONFIRM_MS,
+      ENDPOINT_PAUSE_PRIOR_MS,
+      MAX_ACTIVATE_INTERVAL};
+  endpointer.begin(endpoint_config);
+  audio_health.begin(Pipeline::sample_rate, Pipeline::block_samples);
+#if UDP_AUDIO_ENABLE
+  if (!udp_jitter.begin(Pipeline::udp_frame_samples, JITTER_SLOTS, JITTER_MIN_FRAMES, JITTER_MAX_FRAMES, Pipeline::sample_rate))
+  {
+    Serial.println("Jitter buffer allocation failed");
+  }
+#endif
+#if KWS_ENABLE
+  kws_ready = kws.begin(&kws_model, KWS_INFER_STRIDE, KWS_SMOOTH_WINDOW, KWS_THRESHOLD, KWS_REFRACTORY);
+  if (kws_ready)
+  {
+    Serial.printf("KWS ready: %u MACs, weights %u B, arena %u B\n", (unsigned)kws.engine().macs(),
+                  (unsigned)kws.engine().weightBytes(), (unsigned)kws.engine().arenaBytes());
+  }
+  else
+  {
+    Serial.println("KWS init failed"); // 模型与前端参数不匹配或内存不足，只能使用按键开启会话
+  }
+#endif
   delay(2000);     // 等待系统稳定
+#if KWS_ENABLE
+  setCpuFrequencyMhz(KWS_STANDBY_CPU_MHZ); // 进入待机监听，降低CPU频率
+#endif
 }
 
 // 用于VAD和初始音频数据读取的缓冲区，大小为8个I2S DMA缓冲区
-int16_t vad_samples[BUFFER_SIZE * 8];
+int16_t vad_samples[Pipeline::preroll_samples];
 
 // Arduino loop()函数，在setup()执行完毕后循环执行 (核心1)
 void loop()
 {
   // 检测开始按键是否被按下 (低电平有效)
   int open = digitalRead(buttonStart) == LOW;
+  bool woken = false; // 是否由唤醒词开启会话
+#if KWS_ENABLE
+  if (!open && kws_ready)
+  {
+    woken = kws_listen(); // 待机时监听唤醒词
+    open = woken;
+  }
+#endif
   updateLedState(ORANGE); // 将LED设置为橙色 (待机状态)
 
-  if (open) // 如果开始按键被按下
+  if (open) // 如果开始按键被按下或检测到唤醒词
   {
-    delay(2500); // 按键消抖或延时，等待用户释放
+#if KWS_ENABLE
+    setCpuFrequencyMhz(240); // 会话期间恢复全速
+#endif
+    if (!woken)
+    {
+      delay(2500); // 按键消抖或延时，等待用户释放
+    }
     updateLedState(RED); // LED变为红色 (准备录音)
     uint32_t last_activate = millis(); // 记录上次有语音活动的时间
 
     while (open) // 保持在激活状态，直到再次按下开始键或超时
     {
-      size_t bytes_read = 0; // I2S读取到的字节数
       // 从麦克风读取一批音频数据用于VAD检测
-      i2s_read(I2S_PORT_INMP441, vad_samples, BUFFER_SIZE * 8 * sizeof(int16_t), &bytes_read, portMAX_DELAY);
+      size_t bytes_read = mic_read(vad_samples, sizeof(vad_samples)); // I2S读取到的字节数
       // 进行VAD检测
-      bool loud = energe_vad(vad_samples, bytes_read / sizeof(int16_t));
+      int32_t energy = audio_block_energy(vad_samples, bytes_read / sizeof(int16_t));
+      bool loud = energe_vad(energy);
 
       if (loud) // 如果检测到语音活动
       {
         sendSignalToNetwork(START_VOICE_RECEIVE); // 发送开始接收语音信号给服务器
-        sendAudioToNetwork(vad_samples, bytes_read); // 发送第一批检测到的音频数据
+        sendAudioToNetwork(vad_samples, bytes_read, true); // 发送第一批检测到的音频数据
         updateText("正在聆听您的声音", "Hearing Voice", TEXT_STATIC); // OLED提示正在聆听
         updateLedState(GREEN); // LED变为绿色 (正在录音)
 
-        int16_t samples[BUFFER_SIZE]; // 用于后续连续录音的缓冲区
+        int16_t samples[Pipeline::block_samples]; // 用于后续连续录音的缓冲区
         size_t total_send = 0;        // 已发送的总字节数
         total_send += bytes_read;     // 加上第一批数据
 
-        uint32_t start_time = millis();     // 本次语音段开始时间
-        uint32_t last_loud_time = start_time; // 上次检测到语音的时间
-
-        // 持续录音和发送，直到静音超时或总时长超时
+        // 持续录音和发送，直到端点检测判定语音结束 (自适应静音超时、提前结束或总时长超时)
+        // 按读取的音频块计时，与音频时间一致
+        endpointer.startTurn();
+        audio_health_poll(); // 丢弃录音开始前的事件
+        audio_health.beginCapture(esp_timer_get_time());
         while (true)
         {
           // 从麦克风读取音频数据
-          i2s_read(I2S_PORT_INMP441, samples, BUFFER_SIZE * sizeof(int16_t), &bytes_read, portMAX_DELAY);
-          sendAudioToNetwork(samples, bytes_read); // 发送音频数据
-          loud = energe_vad(samples, bytes_read / sizeof(int16_t)); // VAD检测
+          bytes_read = mic_read(samples, Pipeline::block_bytes);
+          energy = audio_block_energy(samples, bytes_read / sizeof(int16_t));
+          loud = energe_vad(energy); // VAD检测
+          sendAudioToNetwork(samples, bytes_read, loud); // 发送音频数据
           total_send += bytes_read; //累加发送字节数
 
-          uint32_t current_time = millis(); // 当前时间
-          if (loud) // 如果有语音
-          {
-            last_loud_time = current_time; // 更新上次有语音的时间
-            // 检查是否超过单次语音激活最大持续时间
-            if (current_time - start_time >= MAX_ACTIVATE_INTERVAL)
-            {
-              break; // 停止录音
-            }
-          }
-          else // 如果没有语音 (静音)
+          if (endpointer.push(energy) != ENDPOINT_NONE)
           {
-            // 检查是否超过静音检测最大间隔
-            if (current_time - last_loud_time > MAX_VAD_INTERVAL)
-            {
-              break; // 停止录音
-            }
+            break; // 停止录音
           }
         }
+        audio_health.endCapture(esp_timer_get_time());
+        report_endpoint(); // 输出本段语音的端点延迟
         Serial.print("Total sent bytes: "); // 串口打印总发送字节数
         Serial.println(total_send);
         char ch[20];
         sprintf(ch, "%d", total_send); // 将发送字节数转为字符串
         updateText("TOTAL SEND", ch, TEXT_STATIC); // OLED显示发送字节数
         sendSignalToNetwork(STOP_VOICE_RECEIVE); // 发送停止接收语音信号给服务器
+        report_uplink(); // 输出上行丢帧和阻塞统计
 
         updateText("少女祈祷中...", "Now Processing", TEXT_STATIC); // OLED提示正在处理
         updateLedState(BLUE_FLICKER); // LED变为蓝色闪烁 (等待服务器响应)
@@ -698,32 +1165,55 @@ void loop()
         free(reply_text); // 释放接收文本的内存
 
         updateLedState(PURPLE); // LED变为紫色 (正在播放回复语音)
-        // 播放接收到的语音数据
-        for (size_t i = 0; i < tot_length; i += BUFFER_SIZE)
+        // 播放接收到的语音数据 (或缓存中的语音，或UDP流式到达的语音)
+        audio_health_poll(); // 丢弃等待回复期间的事件
+        audio_health.beginPlayback(esp_timer_get_time());
+        if (motion_speak_pending)
         {
-          size_t bytes_written = 0;
-          if (i + BUFFER_SIZE < tot_length) // 如果剩余数据大于一个缓冲区
-          {
-            i2s_write(I2S_PORT_98357A, &voice_samples[i], BUFFER_SIZE * sizeof(int16_t), &bytes_written, portMAX_DELAY);
-          }
-          else // 播放剩余不足一个缓冲区的数据
-          {
-            i2s_write(I2S_PORT_98357A, &voice_samples[i], (tot_length - i) * sizeof(int16_t), &bytes_written, portMAX_DELAY);
-          }
+          // 嘴部动画与播放同时开始，延迟从此刻计算
+          uint8_t speak_start = FACE_CMD_SPEAK_START;
+          motion_send(&speak_start, 1, esp_timer_get_time());
+          motion_speak_pending = false;
+        }
+#if UDP_AUDIO_ENABLE
+        if (udp_reply_pending)
+        {
+          play_udp_reply(tot_length);
         }
+        else
+#endif
+        play_reply_voice(tot_length);
         // 播放结束后，发送一些静音数据以确保DMA缓冲区被清空，避免残留声音
-        int16_t silence[BUFFER_SIZE] = {0}; // 静音样本缓冲区
-        for (int i = 0; i < 8; i++)
+        int16_t silence[Pipeline::block_samples] = {0}; // 静音样本缓冲区
+        for (int i = 0; i < Pipeline::dma_buffers; i++)
+        {
+          speaker_write(silence, Pipeline::block_bytes);
+        }
+        audio_health.endPlayback(esp_timer_get_time());
+        // 在实际播放结束时闭嘴并恢复自然表情，不再由服务器按估计的语音时长发送
+        uint8_t speak_stop = FACE_CMD_SPEAK_STOP;
+        motion_send(&speak_stop, 1, esp_timer_get_time());
+        // 服务器要求缓存的语音在播放结束后写入Flash，不增加回复延迟
+        if (clip_store_pending)
         {
-          size_t bytes_written = 0;
-          i2s_write(I2S_PORT_98357A, silence, BUFFER_SIZE * sizeof(int16_t), &bytes_written, portMAX_DELAY);
+          reply_cache.store(clip_store_hash, voice_samples, tot_length * sizeof(int16_t));
+          clip_store_pending = false;
         }
+        report_reply_cache(); // 输出缓存命中率统计
+        report_audio_health(); // 输出本轮I2S短读写、溢出/取空和削顶统计
+#if UDP_AUDIO_ENABLE
+        report_udp(); // 输出UDP丢包隐藏和缓冲延迟统计
+#endif
+#if MOTION_DIRECT
+        report_motion(); // 输出指令到舵机动作的延迟统计
+#endif
 
         updateLedState(RED); // LED变回红色 (准备下一次录音)
         last_activate = millis(); // 更新上次活动时间
       }
       else // 如果没有检测到语音活动 (初始VAD为静音)
       {
+        endpointer.push(energy); // 更新噪声底
         // 检查是否超过无语音激活进入休眠的最大等待时间
         if (millis() - last_activate > MAX_REST_LIMIT)
         {
@@ -742,9 +1232,17 @@ void loop()
           }
       }
     }
+    endpointer.resetSpeaker(); // 会话结束，下一次会话可能换了说话人
+#if KWS_ENABLE
+    kws.reset(); // 丢弃会话前的旧特征，避免回到待机后立即误触发
+    setCpuFrequencyMhz(KWS_STANDBY_CPU_MHZ);
+#endif
   }
+#if !KWS_ENABLE
   // loop()本身会不断循环，这里的延时可以降低CPU占用率
   // 但由于内部有 vTaskDelay 和 i2s_read 的阻塞，此处的延时可能不是必须的
   // 或者可以设置一个较小的值
+  // 启用唤醒词时由kws_listen()中的i2s_read阻塞控制节奏，不能再额外延时，否则会积压麦克风数据
   delay(10);
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,239 @@
+#include "reply_cache.h"
+
+#define REPLY_CACHE_DIR "/rc"
+#define REPLY_CACHE_INDEX "/rc/index.bin"
+#define REPLY_CACHE_MAGIC 0x31435252u // "RRC1"
+
+// 索引文件头
+struct ReplyCacheHeader
+{
+  uint32_t magic;
+  uint32_t clock;
+  uint8_t count;
+};
+
+void ReplyCache::clipPath(uint64_t hash, char *path, size_t size)
+{
+  snprintf(path, size, REPLY_CACHE_DIR "/%08lx%08lx.pcm", (unsigned long)(hash >> 32), (unsigned long)(hash & 0xffffffffu));
+}
+
+bool ReplyCache::begin(uint32_t max_bytes)
+{
+  // 第一次使用时格式化分区
+  if (!LittleFS.begin(true))
+  {
+    Serial.println("LittleFS mount failed, reply cache disabled");
+    return false;
+  }
+  if (!LittleFS.exists(REPLY_CACHE_DIR))
+  {
+    LittleFS.mkdir(REPLY_CACHE_DIR);
+  }
+
+  // 读取索引，只保留文件仍然存在且大小一致的条目
+  count_ = 0;
+  used_bytes_ = 0;
+  clock_ = 0;
+  File index = LittleFS.open(REPLY_CACHE_INDEX, "r");
+  ReplyCacheHeader header;
+  if (index && index.read((uint8_t *)&header, sizeof(header)) == sizeof(header) && header.magic == REPLY_CACHE_MAGIC)
+  {
+    clock_ = header.clock;
+    Entry entry;
+    for (uint8_t i = 0; i < header.count && i < MAX_ENTRIES; i++)
+    {
+      if (index.read((uint8_t *)&entry, sizeof(entry)) != sizeof(entry))
+      {
+        break;
+      }
+      char path[32];
+      clipPath(entry.hash, path, sizeof(path));
+      File clip = LittleFS.open(path, "r");
+      if (clip && clip.size() == entry.bytes)
+      {
+        entries_[count_++] = entry;
+        used_bytes_ += entry.bytes;
+      }
+    }
+  }
+  if (index)
+  {
+    index.close();
+  }
+
+  // 删除不在索引中的残留文件 (例如写入过程中掉电)
+  File dir = LittleFS.open(REPLY_CACHE_DIR);
+  File file = dir.openNextFile();
+  while (file)
+  {
+    char path[48];
+    snprintf(path, sizeof(path), "%s", file.path());
+    file.close();
+    bool known = false;
+    for (uint8_t i = 0; i < count_ && !known; i++)
+    {
+      char clip[32];
+      clipPath(entries_[i].hash, clip, sizeof(clip));
+      known = strcmp(path, clip) == 0;
+    }
+    if (!known && strcmp(path, REPLY_CACHE_INDEX) != 0)
+    {
+      LittleFS.remove(path);
+    }
+    file = dir.openNextFile();
+  }
+
+  // 容量不超过分区剩余空间 (保留64KB给文件系统元数据)
+  uint32_t fs_free = LittleFS.totalBytes() - LittleFS.usedBytes() + used_bytes_;
+  max_bytes_ = fs_free > 65536 ? fs_free - 65536 : 0;
+  if (max_bytes < max_bytes_)
+  {
+    max_bytes_ = max_bytes;
+  }
+  while (used_bytes_ > max_bytes_ && count_ > 0)
+  {
+    remove(leastRecent());
+    stats_.evictions++;
+  }
+  saveIndex();
+  ready_ = true;
+  Serial.printf("Reply cache ready: %u clips, %u / %u bytes\n", (unsigned)count_, (unsigned)used_bytes_,
+                (unsigned)max_bytes_);
+  return true;
+}
+
+int ReplyCache::find(uint64_t hash) const
+{
+  for (uint8_t i = 0; i < count_; i++)
+  {
+    if (entries_[i].hash == hash)
+    {
+      return i;
+    }
+  }
+  return -1;
+}
+
+uint8_t ReplyCache::leastRecent() const
+{
+  uint8_t oldest = 0;
+  for (uint8_t i = 1; i < count_; i++)
+  {
+    if (entries_[i].last_used < entries_[oldest].last_used)
+    {
+      oldest = i;
+    }
+  }
+  return oldest;
+}
+
+void ReplyCache::remove(uint8_t index)
+{
+  char path[32];
+  clipPath(entries_[index].hash, path, sizeof(path));
+  LittleFS.remove(path);
+  used_bytes_ -= entries_[index].bytes;
+  entries_[index] = entries_[--count_];
+}
+
+void ReplyCache::saveIndex()
+{
+  File index = LittleFS.open(REPLY_CACHE_INDEX, "w");
+  if (!index)
+  {
+    return;
+  }
+  ReplyCacheHeader header = {REPLY_CACHE_MAGIC, clock_, count_};
+  index.write((const uint8_t *)&header, sizeof(header));
+  index.write((const uint8_t *)entries_, count_ * sizeof(Entry));
+  index.close();
+}
+
+bool ReplyCache::open(uint64_t hash, File &file)
+{
+  if (!ready_)
+  {
+    return false;
+  }
+  stats_.lookups++;
+  int i = find(hash);
+  if (i < 0)
+  {
+    return false;
+  }
+  char path[32];
+  clipPath(hash, path, sizeof(path));
+  file = LittleFS.open(path, "r");
+  if (!file || file.size() != entries_[i].bytes)
+  {
+    // 文件损坏或丢失，从索引中移除
+    if (file)
+    {
+      file.close();
+    }
+    remove(i);
+    saveIndex();
+    return false;
+  }
+  entries_[i].last_used = ++clock_;
+  stats_.hits++;
+  stats_.bytes_saved += entries_[i].bytes;
+  saveIndex();
+  return true;
+}
+
+bool ReplyCache::store(uint64_t hash, const int16_t *samples, size_t bytes)
+{
+  if (!ready_ || bytes == 0 || bytes > max_bytes_)
+  {
+    return false;
+  }
+  int existing = find(hash);
+  if (existing >= 0)
+  {
+    remove(existing); // 同一哈希重新写入，覆盖旧文件
+  }
+  // 淘汰最久未使用的语音，直到容量和条目数都满足
+  while (count_ > 0 && (used_bytes_ + bytes > max_bytes_ || count_ >= MAX_ENTRIES))
+  {
+    remove(leastRecent());
+    stats_.evictions++;
+  }
+
+  char path[32];
+  clipPath(hash, path, sizeof(path));
+  File clip = LittleFS.open(path, "w");
+  size_t written = 0;
+  if (clip)
+  {
+    // 分块写入，避免一次占用过多的Flash写缓冲
+    const uint8_t *data = (const uint8_t *)samples;
+    while (written < bytes)
+    {
+      size_t chunk = bytes - written < 4096 ? bytes - written : 4096;
+      size_t n = clip.write(data + written, chunk);
+      if (n == 0)
+      {
+        break;
+      }
+      written += n;
+    }
+    clip.close();
+  }
+  if (written != bytes)
+  {
+    LittleFS.remove(path);
+    stats_.store_failures++;
+    saveIndex();
+    return false;
+  }
+
+  Entry &entry = entries_[count_++];
+  entry.hash = hash;
+  entry.bytes = (uint32_t)bytes;
+  entry.last_used = ++clock_;
+  used_bytes_ += entry.bytes;
+  stats_.stores++;
+  saveIndex();
+  return true;
+}
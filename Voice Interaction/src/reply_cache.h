@@ -0,0 +1,69 @@
+#ifndef REPLY_CACHE_H
+#define REPLY_CACHE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+
+// 下行语音头部的特殊长度值 (正常情况下为PCM字节数)
+#define REPLY_PLAY_CACHED 0xFFFFFFFFu // 后跟8字节哈希: 播放缓存中的语音，设备以CACHE_HIT/CACHE_MISS信号应答
+#define REPLY_STORE_CLIP 0xFFFFFFFEu  // 后跟8字节哈希 + 正常语音帧: 播放后以该哈希存入缓存
+
+// 上行应答信号 (与 START_VOICE_RECEIVE / STOP_VOICE_RECEIVE 共用信号帧)
+#define CACHE_HIT 0x03  // 缓存命中，设备直接从Flash播放
+#define CACHE_MISS 0x04 // 缓存未命中，服务器需要重新发送语音
+
+// 缓存统计 (自启动起累计)
+struct ReplyCacheStats
+{
+  uint32_t lookups;       // 查询次数
+  uint32_t hits;          // 命中次数
+  uint32_t stores;        // 写入次数
+  uint32_t evictions;     // 因容量淘汰的语音数
+  uint32_t store_failures; // 写入失败次数 (Flash空间不足等)
+  uint64_t bytes_saved;   // 命中时省去的下行字节数
+};
+
+// LittleFS上的回复语音缓存: 每段语音一个文件 (/rc/<哈希>.pcm)，索引常驻内存并持久化到 /rc/index.bin
+// 按总字节数和条目数限制容量，超出时淘汰最久未使用的语音
+class ReplyCache
+{
+public:
+  // max_bytes: 缓存总字节上限 (同时不超过文件系统剩余空间)
+  bool begin(uint32_t max_bytes);
+  // 查找并打开缓存语音，命中时file指向PCM数据开头
+  bool open(uint64_t hash, File &file);
+  // 写入一段语音 (原始PCM，未经音量调整)
+  bool store(uint64_t hash, const int16_t *samples, size_t bytes);
+
+  ReplyCacheStats stats() const { return stats_; }
+  uint32_t usedBytes() const { return used_bytes_; }
+  uint32_t maxBytes() const { return max_bytes_; }
+  uint8_t entries() const { return count_; }
+  bool ready() const { return ready_; }
+
+private:
+  struct Entry
+  {
+    uint64_t hash;
+    uint32_t bytes;
+    uint32_t last_used; // LRU时钟，数值越小越久未使用
+  };
+
+  static const uint8_t MAX_ENTRIES = 64;
+
+  int find(uint64_t hash) const;
+  uint8_t leastRecent() const;
+  void remove(uint8_t index); // 删除文件并从索引中移除
+  void saveIndex();
+  static void clipPath(uint64_t hash, char *path, size_t size);
+
+  Entry entries_[MAX_ENTRIES];
+  uint8_t count_ = 0;
+  uint32_t clock_ = 0;
+  uint32_t used_bytes_ = 0;
+  uint32_t max_bytes_ = 0;
+  bool ready_ = false;
+  ReplyCacheStats stats_ = {};
+};
+
+#endif // REPLY_CACHE_H
@@ -0,0 +1,359 @@
+#include "task_profiler.h"
+
+#include <esp_timer.h>
+
+// 预设调度配置，可在运行时通过串口命令 "sched <序号>" 切换
+// 槽位顺序: NET, LED, OLED, BUTTON, LOOP, REPORT, MOTION
+static const SchedProfile sched_profiles[] = {
+    // 默认布局: 外设和网络任务全部在核心0，loop()独占核心1
+    {"default", {{0, 3}, {0, 1}, {0, 2}, {0, 1}, {1, 1}, {0, 1}, {0, 2}}},
+    // 网络任务移到核心1，与采集/播放共享核心，用于对比核心0的余量
+    {"net_core1", {{1, 3}, {0, 1}, {0, 2}, {0, 1}, {1, 1}, {0, 1}, {0, 2}}},
+    // 网络任务在核心1上以低于loop()的优先级运行，采集不会被网络发送抢占
+    {"net_core1_low", {{1, 1}, {0, 1}, {0, 2}, {0, 1}, {1, 2}, {0, 1}, {0, 2}}},
+};
+#define SCHED_PROFILE_COUNT (sizeof(sched_profiles) / sizeof(sched_profiles[0]))
+
+// 每个槽位的登记信息和累计统计
+struct ProfTask
+{
+  const char *name;
+  TaskFunction_t fn;    // 为NULL时表示不由分析器创建
+  uint32_t stack;
+  bool migratable;      // 是否允许运行时迁移核心
+  TaskHandle_t *handle;
+  uint8_t core;
+  uint8_t priority;
+  bool created;
+  volatile bool migrate; // 等待在检查点迁移到 core
+
+  uint32_t wakeups;     // 从阻塞调用返回的次数 (自愿上下文切换)
+  uint64_t blocked_us;  // 阻塞总时间 (队列、延时、I2S)
+  uint64_t queue_us;    // 其中在队列上阻塞的时间
+
+  // 上一次报告时的快照，用于输出区间增量
+  uint32_t last_wakeups;
+  uint64_t last_blocked_us;
+  uint64_t last_queue_us;
+  uint32_t last_runtime;
+};
+
+static ProfTask prof_tasks[PROF_SLOT_COUNT];
+static TaskHandle_t prof_loop_handle = NULL;   // 通过prof_attach_current登记的任务句柄
+static TaskHandle_t prof_report_handle = NULL;
+static portMUX_TYPE prof_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t prof_report_ms = 5000;
+static uint8_t prof_active_profile = 0;
+static bool prof_primed = false; // 第一次报告只建立运行时间基准，不输出占比
+
+void prof_register_task(ProfSlot slot, TaskFunction_t fn, const char *name, uint32_t stack, TaskHandle_t *handle,
+                        bool migratable)
+{
+  ProfTask &t = prof_tasks[slot];
+  t.name = name;
+  t.fn = fn;
+  t.stack = stack;
+  t.handle = handle;
+  t.migratable = migratable;
+}
+
+void prof_attach_current(ProfSlot slot, const char *name)
+{
+  prof_loop_handle = xTaskGetCurrentTaskHandle();
+  ProfTask &t = prof_tasks[slot];
+  t.name = name;
+  t.fn = NULL;
+  t.migratable = false;
+  t.handle = &prof_loop_handle;
+  t.core = xPortGetCoreID();
+  t.priority = uxTaskPriorityGet(prof_loop_handle);
+  t.created = true;
+}
+
+bool sched_set(ProfSlot slot, uint8_t core, uint8_t priority)
+{
+  ProfTask &t = prof_tasks[slot];
+  if (t.handle == NULL || core > 1 || priority >= configMAX_PRIORITIES)
+  {
+    return false;
+  }
+  if (!t.created)
+  {
+    // 首次创建
+    t.core = core;
+    t.priority = priority;
+    t.created = xTaskCreatePinnedToCore(t.fn, t.name, t.stack, NULL, priority, t.handle, core) == pdPASS;
+    return t.created;
+  }
+  t.priority = priority;
+  vTaskPrioritySet(*t.handle, priority);
+  if (core != t.core)
+  {
+    if (!t.migratable)
+    {
+      return false; // loop和持有外设对象的任务只能调整优先级，核心在重启后生效
+    }
+    t.core = core;
+    t.migrate = true; // 由任务自己在检查点完成迁移，避免在发送途中被删除
+  }
+  return true;
+}
+
+bool sched_apply(uint8_t profile)
+{
+  if (profile >= SCHED_PROFILE_COUNT)
+  {
+    return false;
+  }
+  bool ok = true;
+  const SchedProfile &p = sched_profiles[profile];
+  for (int i = 0; i < PROF_SLOT_COUNT; i++)
+  {
+    if (prof_tasks[i].handle == NULL)
+    {
+      continue; // 未登记的槽位
+    }
+    if (!sched_set((ProfSlot)i, p.entries[i].core, p.entries[i].priority))
+    {
+      ok = false;
+    }
+  }
+  prof_active_profile = profile;
+  Serial.printf("Sched profile: %s\n", p.name);
+  return ok;
+}
+
+void sched_checkpoint(ProfSlot slot)
+{
+  ProfTask &t = prof_tasks[slot];
+  if (!t.migrate)
+  {
+    return;
+  }
+  t.migrate = false;
+  t.last_runtime = 0; // 新任务的运行时间计数从0开始
+  xTaskCreatePinnedToCore(t.fn, t.name, t.stack, NULL, t.priority, t.handle, t.core);
+  vTaskDelete(NULL);
+}
+
+static void prof_account(ProfSlot slot, int64_t start, bool queue)
+{
+  uint64_t waited = esp_timer_get_time() - start;
+  ProfTask &t = prof_tasks[slot];
+  portENTER_CRITICAL(&prof_mux);
+  t.wakeups++;
+  t.blocked_us += waited;
+  if (queue)
+  {
+    t.queue_us += waited;
+  }
+  portEXIT_CRITICAL(&prof_mux);
+}
+
+BaseType_t prof_queue_receive(ProfSlot slot, QueueHandle_t queue, void *item, TickType_t ticks)
+{
+  int64_t start = esp_timer_get_time();
+  BaseType_t ret = xQueueReceive(queue, item, ticks);
+  prof_account(slot, start, true);
+  return ret;
+}
+
+BaseType_t prof_queue_send(ProfSlot slot, QueueHandle_t queue, const void *item, TickType_t ticks)
+{
+  int64_t start = esp_timer_get_time();
+  BaseType_t ret = xQueueSend(queue, item, ticks);
+  prof_account(slot, start, true);
+  return ret;
+}
+
+void prof_delay(ProfSlot slot, uint32_t ms)
+{
+  int64_t start = esp_timer_get_time();
+  vTaskDelay(ms / portTICK_PERIOD_MS);
+  prof_account(slot, start, false);
+}
+
+int64_t prof_block_begin()
+{
+  return esp_timer_get_time();
+}
+
+void prof_block_end(ProfSlot slot, int64_t start)
+{
+  prof_account(slot, start, false);
+}
+
+// 输出一行JSON: 每个核心的负载和每个任务在本区间内的CPU占比、唤醒次数和阻塞时间
+static void prof_report(uint32_t elapsed_us)
+{
+  static char line[1536];
+  int len = snprintf(line, sizeof(line), "{\"type\":\"prof\",\"t\":%lu,\"sched\":\"%s\",\"interval_ms\":%lu",
+                     (unsigned long)millis(), sched_profiles[prof_active_profile].name,
+                     (unsigned long)(elapsed_us / 1000));
+
+  uint32_t runtime[PROF_SLOT_COUNT] = {0};
+  bool have_runtime = false;
+#if configGENERATE_RUN_TIME_STATS
+  // 运行时间计数器以微秒为单位 (esp_timer)，按区间增量除以区间长度得到每核心的占比
+  float idle_pct[2] = {0, 0};
+  UBaseType_t count = uxTaskGetNumberOfTasks();
+  TaskStatus_t *status = (TaskStatus_t *)malloc(count * sizeof(TaskStatus_t));
+  if (status != NULL)
+  {
+    uint32_t total = 0;
+    count = uxTaskGetSystemState(status, count, &total);
+    static uint32_t last_idle[2] = {0, 0};
+    for (UBaseType_t i = 0; i < count; i++)
+    {
+      for (int core = 0; core < 2; core++)
+      {
+        if (status[i].xHandle == xTaskGetIdleTaskHandleForCPU(core))
+        {
+          idle_pct[core] = 100.0f * (status[i].ulRunTimeCounter - last_idle[core]) / elapsed_us;
+          last_idle[core] = status[i].ulRunTimeCounter;
+        }
+      }
+      for (int s = 0; s < PROF_SLOT_COUNT; s++)
+      {
+        if (prof_tasks[s].handle != NULL && status[i].xHandle == *prof_tasks[s].handle)
+        {
+          runtime[s] = status[i].ulRunTimeCounter;
+        }
+      }
+    }
+    free(status);
+    have_runtime = prof_primed;
+    prof_primed = true;
+  }
+  if (have_runtime)
+  {
+    len += snprintf(line + len, sizeof(line) - len, ",\"cores\":[{\"id\":0,\"load\":%.1f},{\"id\":1,\"load\":%.1f}]",
+                    100.0f - idle_pct[0], 100.0f - idle_pct[1]);
+  }
+#endif
+
+  len += snprintf(line + len, sizeof(line) - len, ",\"tasks\":[");
+  bool first = true;
+  for (int s = 0; s < PROF_SLOT_COUNT && len < (int)sizeof(line); s++)
+  {
+    ProfTask &t = prof_tasks[s];
+    if (t.handle == NULL || *t.handle == NULL)
+    {
+      continue;
+    }
+    portENTER_CRITICAL(&prof_mux);
+    uint32_t wakeups = t.wakeups - t.last_wakeups;
+    uint64_t blocked = t.blocked_us - t.last_blocked_us;
+    uint64_t queued = t.queue_us - t.last_queue_us;
+    t.last_wakeups = t.wakeups;
+    t.last_blocked_us = t.blocked_us;
+    t.last_queue_us = t.queue_us;
+    portEXIT_CRITICAL(&prof_mux);
+
+    len += snprintf(line + len, sizeof(line) - len,
+                    "%s{\"name\":\"%s\",\"core\":%u,\"prio\":%u,\"wakeups\":%lu,\"blocked_ms\":%lu,\"queue_ms\":%lu,\"stack_free\":%u",
+                    first ? "" : ",", t.name, t.core, t.priority, (unsigned long)wakeups,
+                    (unsigned long)(blocked / 1000), (unsigned long)(queued / 1000),
+                    (unsigned)uxTaskGetStackHighWaterMark(*t.handle));
+    if (have_runtime && len < (int)sizeof(line))
+    {
+      len += snprintf(line + len, sizeof(line) - len, ",\"cpu\":%.1f",
+                      100.0f * (runtime[s] - t.last_runtime) / elapsed_us);
+    }
+    t.last_runtime = runtime[s];
+    if (len < (int)sizeof(line))
+    {
+      len += snprintf(line + len, sizeof(line) - len, "}");
+    }
+    first = false;
+  }
+  if (len < (int)sizeof(line))
+  {
+    snprintf(line + len, sizeof(line) - len, "]}");
+  }
+  Serial.println(line);
+}
+
+static ProfSlot prof_slot_by_name(const char *name)
+{
+  for (int s = 0; s < PROF_SLOT_COUNT; s++)
+  {
+    if (prof_tasks[s].name != NULL && strcmp(prof_tasks[s].name, name) == 0)
+    {
+      return (ProfSlot)s;
+    }
+  }
+  return PROF_SLOT_COUNT;
+}
+
+// 串口调度命令:
+//   sched <序号>                 切换预设调度配置
+//   task <任务名> <核心> <优先级>  调整单个任务
+static void prof_handle_command(char *cmd)
+{
+  char name[24];
+  unsigned a = 0, b = 0;
+  if (sscanf(cmd, "sched %u", &a) == 1)
+  {
+    if (!sched_apply(a))
+    {
+      Serial.println("sched: invalid profile");
+    }
+  }
+  else if (sscanf(cmd, "task %23s %u %u", name, &a, &b) == 3)
+  {
+    ProfSlot slot = prof_slot_by_name(name);
+    if (slot == PROF_SLOT_COUNT || !sched_set(slot, a, b))
+    {
+      Serial.println("task: invalid arguments");
+    }
+  }
+}
+
+static void prof_poll_serial()
+{
+  static char cmd[48];
+  static size_t cmd_len = 0;
+  while (Serial.available())
+  {
+    char c = Serial.read();
+    if (c == '\n' || c == '\r')
+    {
+      if (cmd_len > 0)
+      {
+        cmd[cmd_len] = '\0';
+        prof_handle_command(cmd);
+        cmd_len = 0;
+      }
+    }
+    else if (cmd_len < sizeof(cmd) - 1)
+    {
+      cmd[cmd_len++] = c;
+    }
+  }
+}
+
+static void prof_report_task(void *parameter)
+{
+  int64_t last = esp_timer_get_time();
+  while (true)
+  {
+    sched_checkpoint(PROF_REPORT);
+    prof_poll_serial();
+    int64_t now = esp_timer_get_time();
+    if (prof_report_ms > 0 && now - last >= (int64_t)prof_report_ms * 1000)
+    {
+      prof_report((uint32_t)(now - last));
+      last = now;
+    }
+    prof_delay(PROF_REPORT, 50);
+  }
+}
+
+void prof_begin(uint32_t report_ms)
+{
+  prof_report_ms = report_ms;
+  prof_register_task(PROF_REPORT, prof_report_task, "ProfTask", 4096, &prof_report_handle, true);
+  const SchedEntry &e = sched_profiles[prof_active_profile].entries[PROF_REPORT];
+  sched_set(PROF_REPORT, e.core, e.priority);
+}
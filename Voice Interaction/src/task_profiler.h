@@ -0,0 +1,61 @@
+#ifndef TASK_PROFILER_H
+#define TASK_PROFILER_H
+
+#include <Arduino.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+// 被分析的任务槽位
+enum ProfSlot
+{
+  PROF_NET,    // 网络发送任务
+  PROF_LED,    // RGB LED任务
+  PROF_OLED,   // OLED显示任务
+  PROF_BUTTON, // 按键任务
+  PROF_LOOP,   // Arduino loop() (采集、VAD、接收和播放)
+  PROF_REPORT, // 分析报告任务本身
+  PROF_MOTION, // 舵机动作任务 (MOTION_DIRECT启用时)
+  PROF_SLOT_COUNT,
+};
+
+// 单个任务的调度参数
+struct SchedEntry
+{
+  uint8_t core;     // 绑定的核心 (0或1)
+  uint8_t priority; // 任务优先级
+};
+
+// 调度配置: 每个槽位的核心和优先级
+struct SchedProfile
+{
+  const char *name;
+  SchedEntry entries[PROF_SLOT_COUNT];
+};
+
+// 登记一个由分析器创建的任务 (创建和迁移时使用)
+// migratable: 任务不持有堆资源、并在主循环顶部调用sched_checkpoint()时才允许运行时迁移核心
+void prof_register_task(ProfSlot slot, TaskFunction_t fn, const char *name, uint32_t stack, TaskHandle_t *handle,
+                        bool migratable);
+// 登记当前正在运行、不由分析器创建的任务 (例如Arduino的loopTask)
+void prof_attach_current(ProfSlot slot, const char *name);
+// 应用调度配置: 首次调用时创建任务；之后修改优先级，核心变化的任务在下一个检查点迁移
+bool sched_apply(uint8_t profile);
+// 修改单个任务的核心和优先级
+bool sched_set(ProfSlot slot, uint8_t core, uint8_t priority);
+// 任务主循环顶部的检查点: 需要迁移时在新核心上重建任务并删除当前任务
+void sched_checkpoint(ProfSlot slot);
+
+// 带阻塞时间统计的FreeRTOS调用封装
+BaseType_t prof_queue_receive(ProfSlot slot, QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t prof_queue_send(ProfSlot slot, QueueHandle_t queue, const void *item, TickType_t ticks);
+void prof_delay(ProfSlot slot, uint32_t ms);
+// 统计其他阻塞调用 (例如i2s_read)，在调用前后分别调用
+int64_t prof_block_begin();
+void prof_block_end(ProfSlot slot, int64_t start);
+
+// 启动报告任务: 处理串口调度命令，report_ms大于0时周期性以JSON行格式输出到串口
+void prof_begin(uint32_t report_ms);
+
+#endif // TASK_PROFILER_H
@@ -0,0 +1,276 @@
+// I2S健康监测的主机端测试: 虚拟时钟下模拟麦克风和放大器的DMA环形缓冲 (按实际采样率产生/消耗DMA块，
+// 满时溢出、空时取空并产生事件)，检查短读写、溢出/取空计数和实测采样率
+// 运行: pio test -e native -f test_audio_health -v
+
+#include <unity.h>
+
+#include <stdio.h>
+
+#include "audio_health.h"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t SAMPLE_RATE = 16000;
+static const size_t BLOCK_SAMPLES = 1024; // 与AudioProfile16k一致
+static const size_t BLOCK_BYTES = BLOCK_SAMPLES * sizeof(int16_t);
+static const int DMA_BUFFERS = 8;
+
+// 麦克风DMA: 每个块时长产生一个块，环满时覆盖最旧的块并产生溢出事件
+struct VirtualRx
+{
+  double block_us;
+  double next_done_us; // 下一个块完成的时间
+  int filled;
+  uint32_t overflows;
+
+  VirtualRx(uint32_t actual_rate, int prefilled)
+  {
+    block_us = BLOCK_SAMPLES * 1e6 / actual_rate;
+    next_done_us = block_us;
+    filled = prefilled;
+    overflows = 0;
+  }
+
+  void advance(double now_us, AudioHealth &health)
+  {
+    while (next_done_us <= now_us)
+    {
+      if (filled == DMA_BUFFERS)
+      {
+        overflows++;
+        health.noteEvent(HEALTH_RX_OVERFLOW);
+      }
+      else
+      {
+        filled++;
+      }
+      next_done_us += block_us;
+    }
+  }
+
+  // 读一个块: 没有完成的块时等到下一个块完成，返回结束时间
+  double read(double now_us, AudioHealth &health)
+  {
+    advance(now_us, health);
+    double end_us = now_us + 20; // 拷贝耗时
+    if (filled == 0)
+    {
+      end_us = next_done_us + 20;
+      advance(next_done_us, health);
+    }
+    filled--;
+    health.noteRead(BLOCK_BYTES, BLOCK_BYTES, (int64_t)now_us, (int64_t)end_us);
+    return end_us;
+  }
+};
+
+// 放大器DMA: 每个块时长消耗一个块，环空时在块边界产生取空事件
+struct VirtualTx
+{
+  double block_us;
+  double next_done_us;
+  int filled;
+  bool running;
+  uint32_t underflows;
+
+  explicit VirtualTx(uint32_t actual_rate)
+  {
+    block_us = BLOCK_SAMPLES * 1e6 / actual_rate;
+    filled = 0;
+    running = false;
+    underflows = 0;
+  }
+
+  void advance(double now_us, AudioHealth &health)
+  {
+    while (running && next_done_us <= now_us)
+    {
+      if (filled > 0)
+      {
+        filled--;
+      }
+      else
+      {
+        underflows++;
+        health.noteEvent(HEALTH_TX_UNDERFLOW);
+      }
+      next_done_us += block_us;
+    }
+  }
+
+  // 写一个块: 环满时等到一个块播放完
+  double write(double now_us, AudioHealth &health)
+  {
+    advance(now_us, health);
+    double end_us = now_us + 20;
+    if (filled == DMA_BUFFERS)
+    {
+      end_us = next_done_us + 20;
+      advance(next_done_us, health);
+    }
+    filled++;
+    if (!running)
+    {
+      running = true;
+      next_done_us = end_us + block_us;
+    }
+    health.noteWrite(BLOCK_BYTES, BLOCK_BYTES, (int64_t)now_us, (int64_t)end_us);
+    return end_us;
+  }
+};
+
+// 连续录音: 开始时DMA环已满 (两轮之间没有读取)，中途可选一次读取停顿
+static AudioHealthTurn run_capture(uint32_t actual_rate, int blocks, int stall_at, double stall_us, VirtualRx *out = NULL)
+{
+  AudioHealth health;
+  health.begin(SAMPLE_RATE, BLOCK_SAMPLES);
+  VirtualRx rx(actual_rate, DMA_BUFFERS);
+  double now = 5000;
+  health.beginCapture((int64_t)now);
+  for (int i = 0; i < blocks; i++)
+  {
+    if (i == stall_at)
+    {
+      now += stall_us;
+    }
+    now = rx.read(now, health) + 200; // 能量计算和入队
+  }
+  health.endCapture((int64_t)now);
+  if (out != NULL)
+  {
+    *out = rx;
+  }
+  return health.endTurn();
+}
+
+void test_capture_rate_clean()
+{
+  AudioHealthTurn turn = run_capture(SAMPLE_RATE, 200, -1, 0);
+  printf("[audio_health] clean capture: reads=%u hz=%u capture_ms=%u\n", turn.reads, turn.capture_hz, turn.capture_ms);
+  TEST_ASSERT_EQUAL(200, turn.reads);
+  TEST_ASSERT_EQUAL(0, turn.short_reads);
+  TEST_ASSERT_EQUAL(0, turn.rx_overflow);
+  // 开头8个已缓冲的块不参与计时，否则速率会偏高约7%
+  TEST_ASSERT_INT_WITHIN(2, SAMPLE_RATE, turn.capture_hz);
+}
+
+void test_capture_rate_drift()
+{
+  // I2S时钟分频不精确时的实际采样率
+  AudioHealthTurn turn = run_capture(15950, 200, -1, 0);
+  printf("[audio_health] drifted capture: hz=%u (actual 15950)\n", turn.capture_hz);
+  TEST_ASSERT_INT_WITHIN(2, 15950, turn.capture_hz);
+}
+
+void test_capture_overflow()
+{
+  // loop停顿700ms (超过512ms的DMA环)，期间的溢出全部被计数
+  VirtualRx rx(SAMPLE_RATE, 0);
+  AudioHealthTurn turn = run_capture(SAMPLE_RATE, 200, 100, 700000, &rx);
+  printf("[audio_health] stalled capture: rx_overflow=%u hz=%u\n", turn.rx_overflow, turn.capture_hz);
+  TEST_ASSERT_GREATER_THAN(0, turn.rx_overflow);
+  TEST_ASSERT_EQUAL(rx.overflows, turn.rx_overflow);
+  // 丢失的块使有效采样率低于标称值
+  TEST_ASSERT_LESS_THAN(SAMPLE_RATE - 100, turn.capture_hz);
+}
+
+void test_short_read_write()
+{
+  AudioHealth health;
+  health.begin(SAMPLE_RATE, BLOCK_SAMPLES);
+  health.noteRead(BLOCK_BYTES, 100, 0, 10); // 窗口外不计数
+  health.beginCapture(0);
+  health.noteRead(BLOCK_BYTES, BLOCK_BYTES, 0, 10);
+  health.noteRead(BLOCK_BYTES, BLOCK_BYTES / 2, 10, 20);
+  health.endCapture(100);
+  health.beginPlayback(200);
+  health.noteWrite(BLOCK_BYTES, 0, 200, 210);
+  health.noteWrite(BLOCK_BYTES, BLOCK_BYTES, 210, 220);
+  health.endPlayback(300);
+  AudioHealthTurn turn = health.endTurn();
+  TEST_ASSERT_EQUAL(2, turn.reads);
+  TEST_ASSERT_EQUAL(1, turn.short_reads);
+  TEST_ASSERT_EQUAL(2, turn.writes);
+  TEST_ASSERT_EQUAL(1, turn.short_writes);
+  TEST_ASSERT_EQUAL(BLOCK_SAMPLES, turn.samples_played);
+  TEST_ASSERT_EQUAL(0, turn.capture_hz); // 时间太短，不给出采样率
+  TEST_ASSERT_EQUAL(1, health.totals().glitch_turns);
+  // 下一轮从零开始
+  TEST_ASSERT_EQUAL(0, health.turn().reads);
+}
+
+void test_events_outside_window_ignored()
+{
+  AudioHealth health;
+  health.begin(SAMPLE_RATE, BLOCK_SAMPLES);
+  // 两轮之间麦克风不被读取、放大器没有数据，这些事件是预期的
+  health.noteEvent(HEALTH_RX_OVERFLOW);
+  health.noteEvent(HEALTH_TX_UNDERFLOW);
+  health.noteEvent(HEALTH_DMA_ERROR);
+  health.beginPlayback(0);
+  health.noteEvent(HEALTH_TX_UNDERFLOW); // 第一次写入之前
+  health.noteEvent(HEALTH_RX_OVERFLOW);  // 播放期间的麦克风溢出不计入
+  health.endPlayback(10);
+  AudioHealthTurn turn = health.endTurn();
+  TEST_ASSERT_EQUAL(0, turn.rx_overflow);
+  TEST_ASSERT_EQUAL(0, turn.tx_underflow);
+  TEST_ASSERT_EQUAL(0, turn.dma_errors);
+  TEST_ASSERT_EQUAL(0, health.totals().glitch_turns);
+}
+
+// 回复播放: 写满DMA环后按播放速率阻塞；writer_stall_us > 0 时中途停顿一次 (例如从Flash读取缓存变慢)
+static AudioHealthTurn run_playback(int blocks, int stall_at, double stall_us, VirtualTx &tx)
+{
+  AudioHealth health;
+  health.begin(SAMPLE_RATE, BLOCK_SAMPLES);
+  double now = 1000;
+  health.beginPlayback((int64_t)now);
+  for (int i = 0; i < blocks; i++)
+  {
+    if (i == stall_at)
+    {
+      now += stall_us;
+    }
+    health.noteClipped(i % 10 == 0 ? 3 : 0);
+    now = tx.write(now, health) + 100;
+  }
+  health.endPlayback((int64_t)now);
+  return health.endTurn();
+}
+
+void test_playback_clean()
+{
+  VirtualTx tx(SAMPLE_RATE);
+  AudioHealthTurn turn = run_playback(100, -1, 0, tx);
+  printf("[audio_health] clean playback: writes=%u hz=%u clipped=%u/%u\n", turn.writes, turn.playback_hz, turn.clipped,
+         turn.samples_played);
+  TEST_ASSERT_EQUAL(100, turn.writes);
+  TEST_ASSERT_EQUAL(0, turn.tx_underflow);
+  TEST_ASSERT_EQUAL(30, turn.clipped);
+  TEST_ASSERT_EQUAL(100 * BLOCK_SAMPLES, turn.samples_played);
+  // 开头填满DMA环的写入不参与计时
+  TEST_ASSERT_INT_WITHIN(2, SAMPLE_RATE, turn.playback_hz);
+}
+
+void test_playback_underflow()
+{
+  VirtualTx tx(SAMPLE_RATE);
+  AudioHealthTurn turn = run_playback(100, 50, 800000, tx);
+  printf("[audio_health] stalled playback: tx_underflow=%u\n", turn.tx_underflow);
+  TEST_ASSERT_GREATER_THAN(0, turn.tx_underflow);
+  TEST_ASSERT_EQUAL(tx.underflows, turn.tx_underflow);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_capture_rate_clean);
+  RUN_TEST(test_capture_rate_drift);
+  RUN_TEST(test_capture_overflow);
+  RUN_TEST(test_short_read_write);
+  RUN_TEST(test_events_outside_window_ignored);
+  RUN_TEST(test_playback_clean);
+  RUN_TEST(test_playback_underflow);
+  return UNITY_END();
+}
@@ -0,0 +1,143 @@
+// 编译期音频配置的主机端测试和基准: 检查推导出的缓冲区大小和能量、音量缩放的结果，
+// 并对16kHz和8kHz两个配置分别测量每块的能量计算和音量缩放耗时
+// 运行: pio test -e native -f test_audio_profile -v
+
+#include <unity.h>
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "audio_profile.h"
+
+void setUp() {}
+void tearDown() {}
+
+static std::vector<int16_t> random_block(size_t count, int amplitude, uint32_t seed)
+{
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<int> dist(-amplitude, amplitude);
+  std::vector<int16_t> samples(count);
+  for (size_t i = 0; i < count; i++)
+  {
+    samples[i] = (int16_t)dist(rng);
+  }
+  return samples;
+}
+
+void test_derived_sizes()
+{
+  TEST_ASSERT_EQUAL(1024, AudioProfile16k::block_samples);
+  TEST_ASSERT_EQUAL(2048, AudioProfile16k::block_bytes);
+  TEST_ASSERT_EQUAL(256, AudioProfile16k::udp_frame_samples);
+  TEST_ASSERT_EQUAL(8192, AudioProfile16k::preroll_samples);
+  TEST_ASSERT_EQUAL(512, AudioProfile16k::dma_ms);
+  TEST_ASSERT_EQUAL(100, AudioProfile16k::blocksFor(6400));
+  TEST_ASSERT_EQUAL(2, AudioProfile16k::blocksFor(65));
+
+  TEST_ASSERT_EQUAL(512, AudioProfile8k::block_samples);
+  TEST_ASSERT_EQUAL(1024, AudioProfile8k::block_bytes);
+  TEST_ASSERT_EQUAL(128, AudioProfile8k::udp_frame_samples);
+  TEST_ASSERT_EQUAL(64, AudioProfile8k::block_ms);
+  TEST_ASSERT_EQUAL(100, AudioProfile8k::blocksFor(6400));
+}
+
+// 块能量为样本平方的平均值 (与64位累加的参考值一致，不溢出)，空块为0
+template <class Profile>
+static void check_energy(uint32_t seed)
+{
+  const size_t n = Profile::block_samples;
+  const int amplitudes[] = {0, 100, 3000, 32767};
+  for (int amplitude : amplitudes)
+  {
+    std::vector<int16_t> block = random_block(n, amplitude, seed++);
+    for (size_t count : {n, n / 2})
+    {
+      int64_t sum = 0;
+      for (size_t i = 0; i < count; i++)
+      {
+        sum += (int64_t)block[i] * block[i];
+      }
+      TEST_ASSERT_EQUAL((int32_t)(sum / (int64_t)count), audio_block_energy(block.data(), count));
+    }
+  }
+  TEST_ASSERT_EQUAL(0, audio_block_energy(nullptr, 0));
+  std::vector<int16_t> full(n, -32768);
+  TEST_ASSERT_EQUAL(1073741824, audio_block_energy(full.data(), n));
+}
+
+void test_energy_16k() { check_energy<AudioProfile16k>(1); }
+void test_energy_8k() { check_energy<AudioProfile8k>(100); }
+
+void test_gain_saturates()
+{
+  int16_t samples[8] = {0, 1000, -1000, 20000, -20000, 32767, -32768, 16384};
+  TEST_ASSERT_EQUAL(32768, audio_gain_q15(1.0));
+  // 单位增益不改变样本
+  int16_t copy[8];
+  memcpy(copy, samples, sizeof(samples));
+  size_t clipped = audio_apply_gain(copy, 8, audio_gain_q15(1.0));
+  TEST_ASSERT_EQUAL(0, clipped);
+  TEST_ASSERT_EQUAL_INT16_ARRAY(samples, copy, 8);
+  // 1.5倍: 超出范围的样本饱和而不是回绕
+  clipped = audio_apply_gain(samples, 8, audio_gain_q15(1.5));
+  TEST_ASSERT_EQUAL(2, clipped);
+  TEST_ASSERT_EQUAL(1500, samples[1]);
+  TEST_ASSERT_EQUAL(-1500, samples[2]);
+  TEST_ASSERT_EQUAL(30000, samples[3]);
+  TEST_ASSERT_EQUAL(-30000, samples[4]);
+  TEST_ASSERT_EQUAL(32767, samples[5]);
+  TEST_ASSERT_EQUAL(-32768, samples[6]);
+  TEST_ASSERT_EQUAL(24576, samples[7]);
+  TEST_ASSERT_EQUAL(65535, audio_gain_q15(3.0));
+  TEST_ASSERT_EQUAL(0, audio_gain_q15(-1.0));
+}
+
+static volatile int64_t bench_sink;
+
+// 每块的能量计算 + 音量缩放耗时，以及相对块时长的实时倍数
+template <class Profile>
+static void bench_profile(const char *name)
+{
+  const size_t n = Profile::block_samples;
+  const int blocks = 20000;
+  std::vector<int16_t> source = random_block(n, 12000, 7);
+  std::vector<int16_t> block(n);
+  int32_t gain = audio_gain_q15(0.5);
+
+  int64_t sink = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (int b = 0; b < blocks; b++)
+  {
+    memcpy(block.data(), source.data(), Profile::block_bytes);
+    sink += audio_block_energy(block.data(), n);
+    sink += audio_apply_gain(block.data(), n, gain);
+    sink += block[b % n];
+  }
+  double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / blocks;
+  bench_sink = sink;
+  printf("[audio_profile] %s: block=%zu samples (%u ms, %zu B) dma=%u x %zu B (%u ms) preroll=%u ms udp_frame=%zu "
+         "uplink=%u B/s\n",
+         name, n, (unsigned)Profile::block_ms, Profile::block_bytes, (unsigned)Profile::dma_buffers,
+         Profile::block_bytes, (unsigned)Profile::dma_ms, (unsigned)Profile::preroll_ms, Profile::udp_frame_samples,
+         (unsigned)(Profile::sample_rate * sizeof(int16_t)));
+  printf("[audio_profile] %s: energy+gain %.0f ns/block realtime=x%.0f (host)\n", name, ns,
+         Profile::block_ms * 1e6 / ns);
+}
+
+void test_benchmark_16k() { bench_profile<AudioProfile16k>("16k"); }
+void test_benchmark_8k() { bench_profile<AudioProfile8k>("8k"); }
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_derived_sizes);
+  RUN_TEST(test_energy_16k);
+  RUN_TEST(test_energy_8k);
+  RUN_TEST(test_gain_saturates);
+  RUN_TEST(test_benchmark_16k);
+  RUN_TEST(test_benchmark_8k);
+  return UNITY_END();
+}
@@ -0,0 +1,406 @@
+// 自适应端点检测的主机端回放测试: 与固定2秒静音超时对比，统计节省的端点延迟和过早截断率
+// 运行: pio test -e native -f test_endpoint -v
+// 录音回放: 设置环境变量 ENDPOINT_CORPUS 为一个目录，其中的 16kHz 单声道 16位 WAV 按文件名顺序视为同一说话人的连续对话
+// (服务器 config.json 中 general.utterance_dir 非空时会保存每轮上行录音)
+
+#include <unity.h>
+
+#include <algorithm>
+#include <dirent.h>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "audio_profile.h"
+#include "endpointer.h"
+
+static const uint32_t SAMPLE_RATE = 16000;
+static const size_t BLOCK_SAMPLES = 1024; // 与设备端 AudioProfile16k::block_samples 一致
+static const uint32_t BLOCK_MS = BLOCK_SAMPLES * 1000 / SAMPLE_RATE;
+static const int32_t SPEECH_ENERGY = 10000; // AudioProfile16k::vad_energy
+static const uint32_t FIXED_SILENCE_MS = 2000; // 原来的 MAX_VAD_INTERVAL
+
+static EndpointConfig default_config()
+{
+  // 与 config.h 中的默认值一致
+  EndpointConfig config = {BLOCK_MS, SPEECH_ENERGY, 384, 2000, 192, 500, 30000};
+  return config;
+}
+
+// 合成说话人: 词长、句内停顿分布、带"嗯..."的长迟疑和背景噪声
+struct Speaker
+{
+  const char *name;
+  int pause_min_ms, pause_max_ms;
+  double hesitation;  // 句内出现长迟疑 (800~1300ms，其中一段为低能量迟疑声) 的概率
+  double noise_rms;
+};
+
+struct ReplayResult
+{
+  uint32_t turns = 0;
+  uint32_t premature = 0;  // 在最后一块语音之前结束
+  uint32_t early = 0;
+  uint32_t cancelled = 0;
+  double saved_ms_sum = 0; // 相对固定超时节省的端点延迟 (不含过早截断的语音段)
+  double endpoint_ms_sum = 0;
+  uint32_t final_timeout_ms = 0;
+};
+
+static std::mt19937 rng(2024);
+
+static double uniform(double a, double b)
+{
+  return std::uniform_real_distribution<double>(a, b)(rng);
+}
+
+static void add_noise(std::vector<int16_t> &pcm, size_t count, double rms)
+{
+  std::normal_distribution<double> noise(0.0, rms);
+  for (size_t i = 0; i < count; i++)
+  {
+    pcm.push_back((int16_t)noise(rng));
+  }
+}
+
+static void add_word(std::vector<int16_t> &pcm, double ms, double rms, double noise_rms)
+{
+  size_t count = (size_t)(ms * SAMPLE_RATE / 1000);
+  double f0 = uniform(110, 260);
+  std::normal_distribution<double> noise(0.0, noise_rms);
+  for (size_t i = 0; i < count; i++)
+  {
+    double t = (double)i / SAMPLE_RATE;
+    double envelope = sin(M_PI * i / count); // 音节起止处能量较低
+    double voiced = sin(2 * M_PI * f0 * t) + 0.5 * sin(4 * M_PI * f0 * t) + 0.25 * sin(6 * M_PI * f0 * t);
+    pcm.push_back((int16_t)(rms * 1.6 * envelope * voiced + noise(rng)));
+  }
+}
+
+// 一段语音: 1~0.5秒前导噪声 + 若干词 + 2.5秒尾部噪声
+static std::vector<int16_t> synth_utterance(const Speaker &speaker)
+{
+  std::vector<int16_t> pcm;
+  add_noise(pcm, (size_t)(uniform(0.5, 1.0) * SAMPLE_RATE), speaker.noise_rms);
+  int words = (int)uniform(3, 13);
+  for (int w = 0; w < words; w++)
+  {
+    add_word(pcm, uniform(200, 700), uniform(600, 3000), speaker.noise_rms);
+    if (w == words - 1)
+    {
+      break;
+    }
+    if (uniform(0, 1) < speaker.hesitation)
+    {
+      double ms = uniform(800, 1300);
+      add_noise(pcm, (size_t)(ms * 0.3 * SAMPLE_RATE / 1000), speaker.noise_rms);
+      add_word(pcm, ms * 0.4, 70, speaker.noise_rms); // 低于VAD阈值的迟疑声
+      add_noise(pcm, (size_t)(ms * 0.3 * SAMPLE_RATE / 1000), speaker.noise_rms);
+    }
+    else
+    {
+      add_noise(pcm, (size_t)(uniform(speaker.pause_min_ms, speaker.pause_max_ms) * SAMPLE_RATE / 1000),
+                speaker.noise_rms);
+    }
+  }
+  add_noise(pcm, (size_t)(2.5 * SAMPLE_RATE), speaker.noise_rms);
+  return pcm;
+}
+
+// 按设备端的方式回放一段录音: 第一块语音开始录音，之后逐块输入端点检测
+// 真实结束位置取最后一块语音，固定超时的结束位置为其后第一个静音超过2秒的块
+static void replay(Endpointer &endpointer, const std::vector<int16_t> &pcm, ReplayResult &result)
+{
+  std::vector<int32_t> energy;
+  for (size_t i = 0; i + BLOCK_SAMPLES <= pcm.size(); i += BLOCK_SAMPLES)
+  {
+    energy.push_back(audio_block_energy(&pcm[i], BLOCK_SAMPLES));
+  }
+  int first = -1, last = -1;
+  for (size_t b = 0; b < energy.size(); b++)
+  {
+    if (energy[b] > SPEECH_ENERGY)
+    {
+      if (first < 0)
+      {
+        first = (int)b;
+      }
+      last = (int)b;
+    }
+  }
+  if (first < 0)
+  {
+    return;
+  }
+  // 前导噪声也输入检测器 (设备在待机时同样在读取麦克风)，只用于跟踪噪声底
+  for (int b = 0; b < first; b++)
+  {
+    endpointer.push(energy[b]);
+  }
+  endpointer.startTurn();
+  int end = -1;
+  for (size_t b = first + 1; b < energy.size() && end < 0; b++)
+  {
+    if (endpointer.push(energy[b]) != ENDPOINT_NONE)
+    {
+      end = (int)b;
+    }
+  }
+  if (end < 0)
+  {
+    return; // 录音在判定结束之前已截止 (录音本身不完整)
+  }
+  int fixed_end = last + (int)(FIXED_SILENCE_MS / BLOCK_MS) + 1;
+  EndpointTurn turn = endpointer.lastTurn();
+  result.turns++;
+  result.cancelled += turn.cancelled;
+  result.early += turn.reason == ENDPOINT_EARLY;
+  result.endpoint_ms_sum += turn.endpoint_ms;
+  if (end < last)
+  {
+    result.premature++;
+  }
+  else
+  {
+    result.saved_ms_sum += (double)(fixed_end - end) * BLOCK_MS;
+  }
+  result.final_timeout_ms = endpointer.timeoutMs();
+}
+
+static void report(const char *name, const ReplayResult &r)
+{
+  uint32_t kept = r.turns - r.premature;
+  printf("%-10s turns=%u early=%u cancelled=%u premature=%u (%.1f%%) endpoint mean=%.0fms saved mean=%.0fms "
+         "final timeout=%ums\n",
+         name, r.turns, r.early, r.cancelled, r.premature, r.turns ? 100.0 * r.premature / r.turns : 0.0,
+         r.turns ? r.endpoint_ms_sum / r.turns : 0.0, kept ? r.saved_ms_sum / kept : 0.0, r.final_timeout_ms);
+}
+
+static void run_speaker(const Speaker &speaker, int turns, ReplayResult &result)
+{
+  Endpointer endpointer;
+  endpointer.begin(default_config());
+  for (int t = 0; t < turns; t++)
+  {
+    replay(endpointer, synth_utterance(speaker), result);
+  }
+  report(speaker.name, result);
+}
+
+// 读取16位单声道WAV (只解析fmt和data块)
+static bool read_wav(const std::string &path, std::vector<int16_t> &pcm)
+{
+  FILE *file = fopen(path.c_str(), "rb");
+  if (file == nullptr)
+  {
+    return false;
+  }
+  uint8_t riff[12];
+  bool ok = fread(riff, 1, 12, file) == 12 && memcmp(riff, "RIFF", 4) == 0 && memcmp(riff + 8, "WAVE", 4) == 0;
+  bool format_ok = false;
+  while (ok)
+  {
+    uint8_t chunk[8];
+    if (fread(chunk, 1, 8, file) != 8)
+    {
+      ok = false;
+      break;
+    }
+    uint32_t size = chunk[4] | (chunk[5] << 8) | (chunk[6] << 16) | ((uint32_t)chunk[7] << 24);
+    if (memcmp(chunk, "fmt ", 4) == 0)
+    {
+      uint8_t fmt[16];
+      ok = size >= 16 && fread(fmt, 1, 16, file) == 16;
+      uint16_t channels = fmt[2] | (fmt[3] << 8);
+      uint32_t rate = fmt[4] | (fmt[5] << 8) | (fmt[6] << 16) | ((uint32_t)fmt[7] << 24);
+      uint16_t bits = fmt[14] | (fmt[15] << 8);
+      format_ok = channels == 1 && rate == SAMPLE_RATE && bits == 16;
+      fseek(file, size - 16 + (size & 1), SEEK_CUR);
+    }
+    else if (memcmp(chunk, "data", 4) == 0)
+    {
+      pcm.resize(size / 2);
+      ok = format_ok && fread(pcm.data(), 2, pcm.size(), file) == pcm.size();
+      break;
+    }
+    else
+    {
+      fseek(file, size + (size & 1), SEEK_CUR);
+    }
+  }
+  fclose(file);
+  return ok;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_timeout_adapts_to_speaker_pauses()
+{
+  Endpointer endpointer;
+  EndpointConfig config = default_config();
+  endpointer.begin(config);
+  uint32_t initial = endpointer.timeoutMs();
+  TEST_ASSERT_EQUAL_UINT32(3 * config.pause_prior_ms, initial);
+  // 快语速: 每次停顿 4 块 (256ms)
+  endpointer.startTurn();
+  for (int pause = 0; pause < 30; pause++)
+  {
+    for (int b = 0; b < 4; b++)
+    {
+      endpointer.push(100);
+    }
+    endpointer.push(SPEECH_ENERGY * 4);
+  }
+  TEST_ASSERT_EQUAL_UINT16(30, endpointer.lastTurn().pauses);
+  TEST_ASSERT_TRUE(endpointer.timeoutMs() < initial);
+  TEST_ASSERT_TRUE(endpointer.timeoutMs() >= config.min_silence_ms);
+  TEST_ASSERT_TRUE(endpointer.pauseMeanMs() > 256 - 40 && endpointer.pauseMeanMs() < 256 + 40);
+  TEST_ASSERT_TRUE(endpointer.earlyMs() <= endpointer.timeoutMs());
+  endpointer.resetSpeaker();
+  TEST_ASSERT_EQUAL_UINT32(initial, endpointer.timeoutMs());
+}
+
+void test_deep_silence_finalizes_early()
+{
+  Endpointer endpointer;
+  EndpointConfig config = default_config();
+  endpointer.begin(config);
+  endpointer.startTurn();
+  uint32_t elapsed = 0;
+  EndpointReason reason = ENDPOINT_NONE;
+  while (reason == ENDPOINT_NONE && elapsed < 5000)
+  {
+    reason = endpointer.push(50);
+    elapsed += BLOCK_MS;
+  }
+  TEST_ASSERT_EQUAL(ENDPOINT_EARLY, reason);
+  EndpointTurn turn = endpointer.lastTurn();
+  TEST_ASSERT_EQUAL_UINT32(elapsed, turn.endpoint_ms);
+  TEST_ASSERT_TRUE(turn.endpoint_ms >= turn.early_ms + config.confirm_ms);
+  TEST_ASSERT_TRUE(turn.endpoint_ms < turn.timeout_ms);
+}
+
+void test_hesitation_in_confirm_window_falls_back_to_timeout()
+{
+  Endpointer endpointer;
+  EndpointConfig config = default_config();
+  endpointer.begin(config);
+  endpointer.startTurn();
+  uint32_t early = endpointer.earlyMs();
+  uint32_t elapsed = 0;
+  EndpointReason reason = ENDPOINT_NONE;
+  while (reason == ENDPOINT_NONE && elapsed < 5000)
+  {
+    elapsed += BLOCK_MS;
+    // 进入确认窗口后出现低于VAD阈值的迟疑声
+    bool hesitation = elapsed >= early + 2 * BLOCK_MS && elapsed < early + 4 * BLOCK_MS;
+    reason = endpointer.push(hesitation ? SPEECH_ENERGY / 2 : 50);
+  }
+  TEST_ASSERT_EQUAL(ENDPOINT_TIMEOUT, reason);
+  TEST_ASSERT_EQUAL_UINT16(1, endpointer.lastTurn().cancelled);
+  TEST_ASSERT_TRUE(endpointer.lastTurn().endpoint_ms >= config.max_silence_ms);
+}
+
+void test_max_turn_length()
+{
+  Endpointer endpointer;
+  EndpointConfig config = default_config();
+  config.max_turn_ms = 1000;
+  endpointer.begin(config);
+  endpointer.startTurn();
+  EndpointReason reason = ENDPOINT_NONE;
+  int blocks = 1;
+  while (reason == ENDPOINT_NONE)
+  {
+    reason = endpointer.push(SPEECH_ENERGY * 2);
+    blocks++;
+  }
+  TEST_ASSERT_EQUAL(ENDPOINT_MAX_LENGTH, reason);
+  TEST_ASSERT_EQUAL_INT((1000 + BLOCK_MS - 1) / BLOCK_MS, blocks);
+  TEST_ASSERT_EQUAL_UINT32(0, endpointer.lastTurn().endpoint_ms);
+}
+
+void test_replay_synthetic_speakers()
+{
+  const Speaker speakers[] = {
+      {"fast", 120, 380, 0.0, 25},
+      {"slow", 300, 800, 0.15, 25},
+      {"noisy", 200, 600, 0.05, 60},
+  };
+  ReplayResult total;
+  ReplayResult results[3];
+  for (int s = 0; s < 3; s++)
+  {
+    run_speaker(speakers[s], 40, results[s]);
+    total.turns += results[s].turns;
+    total.premature += results[s].premature;
+    total.early += results[s].early;
+    total.cancelled += results[s].cancelled;
+    total.saved_ms_sum += results[s].saved_ms_sum;
+    total.endpoint_ms_sum += results[s].endpoint_ms_sum;
+  }
+  report("total", total);
+  TEST_ASSERT_EQUAL_UINT32(120, total.turns);
+  // 过早截断率不超过5%，平均节省至少0.8秒
+  TEST_ASSERT_TRUE(total.premature * 20 <= total.turns);
+  TEST_ASSERT_TRUE(total.saved_ms_sum / (total.turns - total.premature) >= 800);
+  // 停顿短的说话人得到更短的超时
+  TEST_ASSERT_TRUE(results[0].final_timeout_ms < results[1].final_timeout_ms);
+}
+
+void test_replay_recorded_corpus()
+{
+  const char *dir_path = getenv("ENDPOINT_CORPUS");
+  if (dir_path == nullptr)
+  {
+    printf("ENDPOINT_CORPUS not set, skipping recorded replay\n");
+    return;
+  }
+  std::vector<std::string> files;
+  DIR *dir = opendir(dir_path);
+  TEST_ASSERT_NOT_NULL(dir);
+  while (dirent *entry = readdir(dir))
+  {
+    std::string name = entry->d_name;
+    if (name.size() > 4 && name.compare(name.size() - 4, 4, ".wav") == 0)
+    {
+      files.push_back(std::string(dir_path) + "/" + name);
+    }
+  }
+  closedir(dir);
+  std::sort(files.begin(), files.end());
+
+  Endpointer endpointer;
+  endpointer.begin(default_config());
+  ReplayResult result;
+  for (const std::string &path : files)
+  {
+    std::vector<int16_t> pcm;
+    if (read_wav(path, pcm))
+    {
+      replay(endpointer, pcm, result);
+    }
+    else
+    {
+      printf("skip %s (not 16kHz mono 16-bit)\n", path.c_str());
+    }
+  }
+  report("recorded", result);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_timeout_adapts_to_speaker_pauses);
+  RUN_TEST(test_deep_silence_finalizes_early);
+  RUN_TEST(test_hesitation_in_confirm_window_falls_back_to_timeout);
+  RUN_TEST(test_max_turn_length);
+  RUN_TEST(test_replay_synthetic_speakers);
+  RUN_TEST(test_replay_recorded_corpus);
+  return UNITY_END();
+}
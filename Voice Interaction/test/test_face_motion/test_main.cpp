@@ -0,0 +1,271 @@
+// 表情动作引擎的主机端测试: 虚拟时钟下记录每次舵机写入，检查与 Servo Control 相同的舵机映射、
+// 表情设置顺序和间隔、眨眼、说话动画，以及指令到动作的延迟统计；
+// 并直接编译 Servo Control 的表情表，逐项检查两份表情表和闭眼位置一致
+// 运行: pio test -e native -f test_face_motion -v
+
+#include <unity.h>
+
+#include <stdio.h>
+#include <vector>
+
+#include "face_motion.h"
+// Servo Control 的表情表 (主机端编译时数据不放在PROGMEM中)
+#include "../../../Servo Control/lib/FacePose/face_pose.cpp"
+
+void setUp() {}
+void tearDown() {}
+
+static const uint32_t STEP_US = 50000;    // Servo Control 的 DELAY_TIME
+static const uint32_t BLINK_US = 3000000; // Servo Control 的 BLINK_INTERVAL
+
+struct ServoWrite
+{
+  int64_t t_us;
+  uint8_t board;
+  uint8_t channel;
+  uint16_t ticks;
+};
+
+struct Recorder
+{
+  std::vector<ServoWrite> writes;
+  int64_t now_us = 0;
+};
+
+static void record_write(uint8_t board, uint8_t channel, uint16_t ticks, void *context)
+{
+  Recorder *r = (Recorder *)context;
+  r->writes.push_back({r->now_us, board, channel, ticks});
+}
+
+// 按nextDueUs()推进虚拟时钟，与设备端动作任务的等待方式相同
+static void run_until(FaceMotion &face, Recorder &r, int64_t end_us)
+{
+  while (true)
+  {
+    int64_t due = face.nextDueUs();
+    if (due > end_us)
+    {
+      r.now_us = end_us;
+      return;
+    }
+    r.now_us = due > r.now_us ? due : r.now_us;
+    face.update(r.now_us);
+  }
+}
+
+// Servo Control 中 setSG90Angle 的换算 (AVR上double即float)
+static uint16_t arduino_ticks(long angle)
+{
+  uint16_t pulse = (angle - 0) * (2500 - 500) / (180 - 0) + 500;
+  return pulse * (50 * 4096.0f / 1000000.0f);
+}
+
+static const uint8_t CMD_HAPPINESS[] = {FACE_CMD_HAPPINESS};
+
+void test_ticks_match_servo_control()
+{
+  for (int angle = 0; angle <= 190; angle++)
+  {
+    TEST_ASSERT_EQUAL(arduino_ticks(angle), face_angle_to_ticks((uint8_t)angle));
+  }
+  TEST_ASSERT_EQUAL(102, face_angle_to_ticks(0));
+  TEST_ASSERT_EQUAL(512, face_angle_to_ticks(180));
+}
+
+void test_pose_order_and_spacing()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  r.now_us = 1000;
+  TEST_ASSERT_TRUE(face.command(CMD_HAPPINESS, 1, 0, r.now_us));
+  run_until(face, r, 1000 + 18 * STEP_US);
+
+  // happiness(): PCA1的眼部和眉毛，然后PCA2的嘴部
+  const ServoWrite expected[] = {
+      {0, 0, 4, arduino_ticks(80)},  {0, 0, 5, arduino_ticks(180)}, {0, 0, 6, arduino_ticks(150)},
+      {0, 0, 7, arduino_ticks(55)},  {0, 0, 8, arduino_ticks(20)},  {0, 0, 9, arduino_ticks(130)},
+      {0, 0, 12, arduino_ticks(0)},  {0, 0, 13, arduino_ticks(60)}, {0, 0, 14, arduino_ticks(30)},
+      {0, 0, 15, arduino_ticks(0)},  {0, 1, 6, arduino_ticks(140)}, {0, 1, 7, arduino_ticks(0)},
+      {0, 1, 9, arduino_ticks(190)}, {0, 1, 10, arduino_ticks(150)}, {0, 1, 11, arduino_ticks(190)},
+      {0, 1, 12, arduino_ticks(0)},  {0, 1, 13, arduino_ticks(60)}, {0, 1, 14, arduino_ticks(120)},
+      {0, 1, 15, arduino_ticks(180)},
+  };
+  TEST_ASSERT_EQUAL(19, r.writes.size());
+  for (size_t i = 0; i < r.writes.size(); i++)
+  {
+    TEST_ASSERT_EQUAL(expected[i].board, r.writes[i].board);
+    TEST_ASSERT_EQUAL(expected[i].channel, r.writes[i].channel);
+    TEST_ASSERT_EQUAL(expected[i].ticks, r.writes[i].ticks);
+    TEST_ASSERT_EQUAL(1000 + (int64_t)i * STEP_US, r.writes[i].t_us);
+  }
+  TEST_ASSERT_EQUAL(1, face.state());
+  TEST_ASSERT_FALSE(face.posing());
+  FaceMotionStats st = face.stats();
+  TEST_ASSERT_EQUAL(1, st.commands);
+  TEST_ASSERT_EQUAL(1000, st.start_us_max);
+  TEST_ASSERT_EQUAL(1000 + 18 * STEP_US, st.done_us_max);
+}
+
+// 每个表情的舵机顺序、板号、通道和角度都与 Servo Control 的表情表一致
+void test_poses_match_servo_control()
+{
+  TEST_ASSERT_EQUAL(POSE_COUNT, FACE_CMD_DISGUST - FACE_CMD_NEUTRAL + 1);
+  for (uint8_t pose = 0; pose < POSE_COUNT; pose++)
+  {
+    Recorder r;
+    FaceMotion face;
+    face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+    const uint8_t cmd[] = {(uint8_t)(FACE_CMD_NEUTRAL + pose)};
+    TEST_ASSERT_TRUE(face.command(cmd, 1, 0, 0));
+    run_until(face, r, (SERVO_COUNT - 1) * STEP_US);
+    TEST_ASSERT_EQUAL(SERVO_COUNT, r.writes.size());
+    for (uint8_t servo = 0; servo < SERVO_COUNT; servo++)
+    {
+      ServoConfig config = servo_config(servo);
+      char message[32];
+      snprintf(message, sizeof(message), "pose %u servo %u", pose, servo);
+      TEST_ASSERT_EQUAL_MESSAGE(config.board, r.writes[servo].board, message);
+      TEST_ASSERT_EQUAL_MESSAGE(config.channel, r.writes[servo].channel, message);
+      TEST_ASSERT_EQUAL_MESSAGE(face_angle_to_ticks(pose_angle(pose, servo)), r.writes[servo].ticks, message);
+    }
+  }
+
+  // 闭眼时的眼皮位置
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  run_until(face, r, BLINK_US);
+  TEST_ASSERT_EQUAL(SERVO_LID_COUNT, r.writes.size());
+  for (uint8_t lid = 0; lid < SERVO_LID_COUNT; lid++)
+  {
+    ServoConfig config = servo_config(SERVO_LID_FIRST + lid);
+    TEST_ASSERT_EQUAL(config.board, r.writes[lid].board);
+    TEST_ASSERT_EQUAL(config.channel, r.writes[lid].channel);
+    TEST_ASSERT_EQUAL(face_angle_to_ticks(lid_closed_angle(lid)), r.writes[lid].ticks);
+  }
+}
+
+void test_gaze_is_immediate()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  const uint8_t gaze[] = {FACE_CMD_GAZE, 100, 160};
+  r.now_us = 500;
+  TEST_ASSERT_TRUE(face.command(gaze, 3, 200, r.now_us));
+  TEST_ASSERT_EQUAL(2, r.writes.size());
+  TEST_ASSERT_EQUAL(4, r.writes[0].channel);
+  TEST_ASSERT_EQUAL(arduino_ticks(100), r.writes[0].ticks);
+  TEST_ASSERT_EQUAL(5, r.writes[1].channel);
+  TEST_ASSERT_EQUAL(arduino_ticks(160), r.writes[1].ticks);
+  TEST_ASSERT_EQUAL(300, face.stats().done_us_max);
+  // 不完整或未知的指令被拒绝
+  TEST_ASSERT_FALSE(face.command(gaze, 2, 0, r.now_us));
+  const uint8_t unknown[] = {0x7F};
+  TEST_ASSERT_FALSE(face.command(unknown, 1, 0, r.now_us));
+  TEST_ASSERT_EQUAL(2, face.stats().rejected);
+}
+
+void test_speaking_animation()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, 100000000, 0); // 关闭眨眼
+  const uint8_t start[] = {FACE_CMD_SPEAK_START};
+  const uint8_t stop[] = {FACE_CMD_SPEAK_STOP};
+  r.now_us = 0;
+  face.command(start, 1, 0, 0);
+  run_until(face, r, 1000000);
+  // 0, 250, 500, 750, 1000ms: 张开和闭合交替
+  TEST_ASSERT_EQUAL(5, r.writes.size());
+  for (size_t i = 0; i < r.writes.size(); i++)
+  {
+    TEST_ASSERT_EQUAL(1, r.writes[i].board);
+    TEST_ASSERT_EQUAL(14, r.writes[i].channel);
+    TEST_ASSERT_EQUAL(arduino_ticks(i % 2 == 0 ? 120 : 80), r.writes[i].ticks);
+    TEST_ASSERT_EQUAL((int64_t)i * FaceMotion::MOUTH_INTERVAL_US, r.writes[i].t_us);
+  }
+  r.writes.clear();
+  face.command(stop, 1, r.now_us, r.now_us);
+  run_until(face, r, r.now_us + 2000000);
+  TEST_ASSERT_FALSE(face.speaking());
+  // 闭嘴，然后逐个设置自然表情
+  TEST_ASSERT_EQUAL(20, r.writes.size());
+  TEST_ASSERT_EQUAL(14, r.writes[0].channel);
+  TEST_ASSERT_EQUAL(arduino_ticks(80), r.writes[0].ticks);
+  TEST_ASSERT_EQUAL(0, face.state());
+}
+
+void test_blink_restores_current_pose()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  const uint8_t sad[] = {FACE_CMD_SADNESS};
+  face.command(sad, 1, 0, 0);
+  run_until(face, r, BLINK_US - 1);
+  r.writes.clear();
+  run_until(face, r, BLINK_US + FaceMotion::BLINK_CLOSED_US);
+  TEST_ASSERT_EQUAL(8, r.writes.size());
+  // 闭眼
+  TEST_ASSERT_EQUAL(arduino_ticks(95), r.writes[0].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(95), r.writes[1].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(70), r.writes[2].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(90), r.writes[3].ticks);
+  TEST_ASSERT_EQUAL(BLINK_US, r.writes[0].t_us);
+  // 200ms后恢复到伤心表情的眼皮位置
+  TEST_ASSERT_EQUAL(BLINK_US + FaceMotion::BLINK_CLOSED_US, r.writes[4].t_us);
+  TEST_ASSERT_EQUAL(arduino_ticks(100), r.writes[4].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(90), r.writes[5].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(60), r.writes[6].ticks);
+  TEST_ASSERT_EQUAL(arduino_ticks(95), r.writes[7].ticks);
+}
+
+void test_blink_waits_for_pose()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  // 表情在眨眼时刻之前开始，眨眼推迟到表情设置完
+  r.now_us = BLINK_US - 100000;
+  face.command(CMD_HAPPINESS, 1, r.now_us, r.now_us);
+  run_until(face, r, BLINK_US + 2000000);
+  int64_t pose_done = BLINK_US - 100000 + 18 * STEP_US;
+  TEST_ASSERT_EQUAL(19 + 8, r.writes.size());
+  TEST_ASSERT_EQUAL(pose_done, r.writes[18].t_us);
+  TEST_ASSERT_EQUAL(pose_done, r.writes[19].t_us);
+}
+
+void test_new_pose_supersedes()
+{
+  Recorder r;
+  FaceMotion face;
+  face.begin(record_write, &r, STEP_US, BLINK_US, 0);
+  const uint8_t surprise[] = {FACE_CMD_SURPRISE};
+  face.command(CMD_HAPPINESS, 1, 0, 0);
+  run_until(face, r, 5 * STEP_US);
+  r.now_us = 5 * STEP_US + 10;
+  face.command(surprise, 1, r.now_us, r.now_us);
+  run_until(face, r, 2000000);
+  TEST_ASSERT_EQUAL(3, face.state());
+  TEST_ASSERT_EQUAL(1, face.stats().superseded);
+  TEST_ASSERT_EQUAL(1, face.stats().commands);
+  TEST_ASSERT_EQUAL(6 + 19, r.writes.size());
+  TEST_ASSERT_EQUAL(arduino_ticks(160), r.writes.back().ticks); // surprise的最后一个舵机
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_ticks_match_servo_control);
+  RUN_TEST(test_pose_order_and_spacing);
+  RUN_TEST(test_poses_match_servo_control);
+  RUN_TEST(test_gaze_is_immediate);
+  RUN_TEST(test_speaking_animation);
+  RUN_TEST(test_blink_restores_current_pose);
+  RUN_TEST(test_blink_waits_for_pose);
+  RUN_TEST(test_new_pose_supersedes);
+  return UNITY_END();
+}
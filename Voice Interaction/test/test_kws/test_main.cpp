@@ -0,0 +1,255 @@
+// 关键词唤醒内核的主机端正确性测试与性能基准
+// 运行: pio test -e native -f test_kws -v
+
+#include <unity.h>
+
+#include <chrono>
+#include <math.h>
+#include <random>
+#include <stdio.h>
+#include <vector>
+
+#include "kws_kernels.h"
+#include "kws_mfcc.h"
+#include "kws_model.h"
+
+static std::mt19937 rng(1234);
+
+static std::vector<int8_t> random_s8(size_t n)
+{
+  std::uniform_int_distribution<int> dist(-127, 127);
+  std::vector<int8_t> v(n);
+  for (auto &x : v)
+  {
+    x = (int8_t)dist(rng);
+  }
+  return v;
+}
+
+static std::vector<int32_t> random_bias(size_t n)
+{
+  std::uniform_int_distribution<int> dist(-2000, 2000);
+  std::vector<int32_t> v(n);
+  for (auto &x : v)
+  {
+    x = dist(rng);
+  }
+  return v;
+}
+
+// 逐通道重量化参数: 缩放约 1/256 ~ 1/64
+struct QuantStore
+{
+  std::vector<int32_t> mult;
+  std::vector<int8_t> shift;
+  KwsQuant q;
+
+  QuantStore(size_t channels, int in_zp, int out_zp, bool relu)
+  {
+    std::uniform_int_distribution<int> dist(1 << 30, 0x7fffffff);
+    for (size_t i = 0; i < channels; i++)
+    {
+      mult.push_back(dist(rng));
+      shift.push_back((int8_t)(-6 - (int)(i % 3)));
+    }
+    q.multiplier = mult.data();
+    q.shift = shift.data();
+    q.input_offset = -in_zp;
+    q.output_offset = out_zp;
+    q.act_min = relu ? out_zp : -128;
+    q.act_max = 127;
+  }
+};
+
+static int8_t ref_out(int64_t acc, const KwsQuant &q, int c)
+{
+  double real = (double)acc * q.multiplier[c] * pow(2.0, q.shift[c] - 31);
+  long v = lround(real) + q.output_offset;
+  if (v < q.act_min)
+    v = q.act_min;
+  if (v > q.act_max)
+    v = q.act_max;
+  return (int8_t)v;
+}
+
+// 朴素参考实现: 显式零点填充后的直接卷积 (depthwise=true 时逐通道)
+static std::vector<int8_t> ref_conv(const std::vector<int8_t> &in, int h, int w, int c,
+                                    const std::vector<int8_t> &f, int kh, int kw, int oc, bool depthwise,
+                                    const std::vector<int32_t> &bias, int sh, int sw, int ph, int pw,
+                                    const KwsQuant &q, int oh, int ow)
+{
+  std::vector<int8_t> out;
+  for (int y = 0; y < oh; y++)
+    for (int x = 0; x < ow; x++)
+      for (int o = 0; o < oc; o++)
+      {
+        int64_t acc = bias[o];
+        for (int ky = 0; ky < kh; ky++)
+          for (int kx = 0; kx < kw; kx++)
+          {
+            int iy = y * sh - ph + ky, ix = x * sw - pw + kx;
+            for (int i = 0; i < (depthwise ? 1 : c); i++)
+            {
+              int ch = depthwise ? o : i;
+              int v = (iy < 0 || iy >= h || ix < 0 || ix >= w) ? -q.input_offset : in[(iy * w + ix) * c + ch];
+              int wt = depthwise ? f[(ky * kw + kx) * c + o] : f[((o * kh + ky) * kw + kx) * c + i];
+              acc += (int64_t)wt * (v + q.input_offset);
+            }
+          }
+        out.push_back(ref_out(acc, q, o));
+      }
+  return out;
+}
+
+static void assert_close(const std::vector<int8_t> &expected, const int8_t *actual)
+{
+  // 定点舍入与double参考之间最多相差1个量化步长
+  for (size_t i = 0; i < expected.size(); i++)
+  {
+    int diff = expected[i] - actual[i];
+    if (diff < -1 || diff > 1)
+    {
+      char msg[64];
+      snprintf(msg, sizeof(msg), "index %zu: expected %d got %d", i, expected[i], actual[i]);
+      TEST_FAIL_MESSAGE(msg);
+    }
+  }
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_requantize()
+{
+  TEST_ASSERT_EQUAL_INT32(50, kws_requantize(100, 1 << 30, 0));
+  TEST_ASSERT_EQUAL_INT32(-50, kws_requantize(-100, 1 << 30, 0));
+  TEST_ASSERT_EQUAL_INT32(13, kws_requantize(100, 1 << 30, -2)); // 12.5 -> 13
+}
+
+void test_conv2d_matches_reference()
+{
+  const int h = 49, w = 10, c = 1, kh = 10, kw = 4, oc = 16, sh = 2, sw = 2, ph = 4, pw = 1;
+  const int oh = 25, ow = 5;
+  auto in = random_s8(h * w * c);
+  auto f = random_s8(oc * kh * kw * c);
+  auto bias = random_bias(oc);
+  QuantStore qs(oc, 3, -5, true);
+  std::vector<int8_t> out(oh * ow * oc);
+  kws_conv2d_s8(in.data(), h, w, c, f.data(), kh, kw, oc, bias.data(), sh, sw, ph, pw, qs.q, out.data(), oh, ow);
+  assert_close(ref_conv(in, h, w, c, f, kh, kw, oc, false, bias, sh, sw, ph, pw, qs.q, oh, ow), out.data());
+}
+
+void test_depthwise_matches_reference()
+{
+  const int h = 25, w = 5, c = 64;
+  auto in = random_s8(h * w * c);
+  auto f = random_s8(3 * 3 * c);
+  auto bias = random_bias(c);
+  QuantStore qs(c, -7, 2, true);
+  std::vector<int8_t> out(h * w * c);
+  kws_depthwise_conv2d_s8(in.data(), h, w, c, f.data(), 3, 3, bias.data(), 1, 1, 1, 1, qs.q, out.data(), h, w);
+  assert_close(ref_conv(in, h, w, c, f, 3, 3, c, true, bias, 1, 1, 1, 1, qs.q, h, w), out.data());
+}
+
+void test_pointwise_matches_reference()
+{
+  const int pixels = 125, in_c = 64, out_c = 67; // 非4的倍数，覆盖尾部通道
+  auto in = random_s8(pixels * in_c);
+  auto f = random_s8(out_c * in_c);
+  auto bias = random_bias(out_c);
+  QuantStore qs(out_c, 0, -128, false);
+  std::vector<int8_t> out(pixels * out_c);
+  kws_pointwise_conv_s8(in.data(), pixels, in_c, f.data(), out_c, bias.data(), qs.q, out.data());
+  assert_close(ref_conv(in, pixels, 1, in_c, f, 1, 1, out_c, false, bias, 1, 1, 0, 0, qs.q, pixels, 1), out.data());
+}
+
+// DS-CNN S 结构 (随机权重，只用于测量时间和内存)
+struct BenchModel
+{
+  std::vector<std::vector<int8_t>> weights;
+  std::vector<std::vector<int32_t>> biases;
+  std::vector<QuantStore> quants;
+  std::vector<KwsLayer> layers;
+  KwsModel model;
+
+  void add(int out_c, size_t w_count)
+  {
+    weights.push_back(random_s8(w_count));
+    biases.push_back(random_bias(out_c));
+    quants.emplace_back(out_c, 0, -128, true);
+  }
+
+  BenchModel()
+  {
+    const int ch = 64;
+    struct Spec { KwsLayerType type; int kh, kw, s, ph, pw, oc; size_t wc; };
+    std::vector<Spec> specs = {{KWS_LAYER_CONV, 10, 4, 2, 4, 1, ch, (size_t)ch * 40}};
+    for (int i = 0; i < 4; i++)
+    {
+      specs.push_back({KWS_LAYER_DEPTHWISE, 3, 3, 1, 1, 1, ch, 9 * ch});
+      specs.push_back({KWS_LAYER_POINTWISE, 1, 1, 1, 0, 0, ch, (size_t)ch * ch});
+    }
+    specs.push_back({KWS_LAYER_AVGPOOL, 1, 1, 1, 0, 0, ch, 0});
+    specs.push_back({KWS_LAYER_FC, 1, 1, 1, 0, 0, 3, (size_t)3 * ch});
+    quants.reserve(specs.size());
+    for (auto &s : specs)
+    {
+      add(s.oc, s.wc);
+      KwsLayer l = {s.type, (uint8_t)s.kh, (uint8_t)s.kw, (uint8_t)s.s, (uint8_t)s.s, (uint8_t)s.ph, (uint8_t)s.pw,
+                    (uint16_t)s.oc, weights.back().data(), biases.back().data(), quants.back().mult.data(),
+                    quants.back().shift.data(), -128, -128, s.type != KWS_LAYER_FC};
+      layers.push_back(l);
+    }
+    model = {KWS_NUM_FRAMES, KWS_MFCC_COEFFS, 0.5f, 0, 0.1f, 0, (uint8_t)layers.size(), layers.data(), 3, 2};
+  }
+};
+
+void test_engine_benchmark()
+{
+  BenchModel bm;
+  KwsEngine engine;
+  TEST_ASSERT_TRUE(engine.begin(&bm.model));
+
+  auto features = random_s8(KWS_NUM_FRAMES * KWS_MFCC_COEFFS);
+  const int runs = 200;
+  double total_us = 0, max_us = 0;
+  for (int i = 0; i < runs; i++)
+  {
+    auto t0 = std::chrono::steady_clock::now();
+    engine.invoke(features.data());
+    double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+    total_us += us;
+    max_us = us > max_us ? us : max_us;
+  }
+  printf("[kws] DS-CNN S: macs=%u weights=%zu B arena=%zu B\n",
+         engine.macs(), engine.weightBytes(), engine.arenaBytes());
+  printf("[kws] inference: mean=%.1f us max=%.1f us (%d runs, host)\n", total_us / runs, max_us, runs);
+}
+
+void test_mfcc_benchmark()
+{
+  static KwsFeatureRing ring; // MFCC查找表较大，避免占用栈
+  ring.begin(0.5f, 0);
+  std::vector<int16_t> pcm(KWS_SAMPLE_RATE);
+  for (size_t i = 0; i < pcm.size(); i++)
+  {
+    pcm[i] = (int16_t)(8000 * sin(2 * 3.14159265 * 440 * i / KWS_SAMPLE_RATE));
+  }
+  auto t0 = std::chrono::steady_clock::now();
+  size_t frames = ring.push(pcm.data(), pcm.size());
+  double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count();
+  TEST_ASSERT_EQUAL(KWS_NUM_FRAMES, frames);
+  printf("[kws] mfcc: %.1f us/frame, state=%zu B\n", us / frames, sizeof(KwsFeatureRing));
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_requantize);
+  RUN_TEST(test_conv2d_matches_reference);
+  RUN_TEST(test_depthwise_matches_reference);
+  RUN_TEST(test_pointwise_matches_reference);
+  RUN_TEST(test_engine_benchmark);
+  RUN_TEST(test_mfcc_benchmark);
+  return UNITY_END();
+}
@@ -0,0 +1,254 @@
+// UDP音频传输的主机端回环测试: 虚拟时钟下按帧节拍发送，信道可配置丢包/抖动/乱序，接收端用抖动缓冲播放
+// 运行: pio test -e native -f test_udp_audio -v
+
+#include <unity.h>
+
+#include <algorithm>
+#include <random>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "udp_audio.h"
+
+static const uint16_t FRAME_SAMPLES = UDP_AUDIO_FRAME_SAMPLES;
+static const uint32_t SAMPLE_RATE = 16000;
+static const int64_t FRAME_US = (int64_t)FRAME_SAMPLES * 1000000 / SAMPLE_RATE;
+static const uint32_t TOTAL_FRAMES = 1000; // 16秒音频
+
+// 与设备端 config.h 默认值一致
+static const uint16_t JITTER_SLOTS = 64;
+static const uint16_t JITTER_MIN_FRAMES = 2;
+static const uint16_t JITTER_MAX_FRAMES = 16;
+
+// 信道参数: 每个包的单向时延 = base + U(0, jitter)，乱序的包额外延迟1~3帧
+// stall_ms > 0 时，第4秒起的 stall_ms 内发出的包全部滞留到断流结束时一起到达 (模拟WiFi重连)
+struct Channel
+{
+  int base_ms;
+  int jitter_ms;
+  double loss;
+  double reorder;
+  int stall_ms;
+};
+
+struct LoopResult
+{
+  JitterStats stats;
+  uint32_t lost;        // 信道丢弃的包数
+  uint32_t reordered;   // 信道乱序的包数
+  uint32_t mismatched;  // 播放内容与发送内容不一致的帧数
+  double e2e_ms_mean;   // 发送到播放的端到端时延
+  double e2e_ms_max;
+};
+
+// 语音帧按帧号和位置生成 (便于逐样本核对)，每10帧中有2帧静音
+static void make_frame(uint32_t frame, int16_t *out)
+{
+  bool silent = frame % 10 >= 8;
+  for (uint16_t i = 0; i < FRAME_SAMPLES; i++)
+  {
+    out[i] = silent ? 0 : (int16_t)(((frame * 131 + i * 17) % 4000) + 500);
+  }
+}
+
+struct Arrival
+{
+  int64_t at_us;
+  uint32_t frame;
+  std::vector<uint8_t> packet;
+};
+
+static void run_loopback(const Channel &channel, uint32_t seed, LoopResult &result)
+{
+  memset(&result, 0, sizeof(result));
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+  // 发送端: 第k帧在 k*FRAME_US 时刻发出
+  std::vector<Arrival> arrivals;
+  int16_t pcm[FRAME_SAMPLES];
+  uint8_t packet[UDP_AUDIO_HEADER_BYTES + FRAME_SAMPLES * sizeof(int16_t)];
+  for (uint32_t k = 0; k < TOTAL_FRAMES; k++)
+  {
+    make_frame(k, pcm);
+    UdpAudioHeader header = {7, (uint16_t)k, FRAME_SAMPLES, k * FRAME_SAMPLES};
+    size_t length = udp_audio_encode(packet, sizeof(packet), header, pcm);
+    if (uniform(rng) < channel.loss)
+    {
+      result.lost++;
+      continue;
+    }
+    int64_t delay = channel.base_ms * 1000 + (int64_t)(uniform(rng) * channel.jitter_ms * 1000);
+    if (uniform(rng) < channel.reorder)
+    {
+      delay += FRAME_US * (1 + (int64_t)(uniform(rng) * 3));
+      result.reordered++;
+    }
+    int64_t sent = (int64_t)k * FRAME_US;
+    if (channel.stall_ms > 0 && sent >= 4000000 && sent < 4000000 + channel.stall_ms * 1000)
+    {
+      delay = 4000000 + channel.stall_ms * 1000 - sent + channel.base_ms * 1000;
+    }
+    arrivals.push_back({(int64_t)k * FRAME_US + delay, k, std::vector<uint8_t>(packet, packet + length)});
+  }
+  std::stable_sort(arrivals.begin(), arrivals.end(),
+                   [](const Arrival &a, const Arrival &b) { return a.at_us < b.at_us; });
+
+  // 接收端: 到达的包立即入队，播放以固定帧节拍出队 (相位与发送端无关)
+  JitterBuffer jitter;
+  TEST_ASSERT_TRUE(jitter.begin(FRAME_SAMPLES, JITTER_SLOTS, JITTER_MIN_FRAMES, JITTER_MAX_FRAMES, SAMPLE_RATE));
+  size_t next = 0;
+  double e2e_sum = 0;
+  int16_t out[FRAME_SAMPLES], expected[FRAME_SAMPLES];
+  int64_t end_us = (int64_t)TOTAL_FRAMES * FRAME_US + 2000000;
+  for (int64_t now = 3000; now < end_us && jitter.position() < TOTAL_FRAMES * FRAME_SAMPLES; now += FRAME_US)
+  {
+    while (next < arrivals.size() && arrivals[next].at_us <= now)
+    {
+      jitter.push(arrivals[next].packet.data(), arrivals[next].packet.size(), arrivals[next].at_us);
+      next++;
+    }
+    if (jitter.pop(out, now) == JITTER_PLAYED)
+    {
+      uint32_t frame = jitter.position() / FRAME_SAMPLES - 1;
+      make_frame(frame, expected);
+      if (memcmp(out, expected, sizeof(out)) != 0)
+      {
+        result.mismatched++;
+      }
+      double e2e_ms = (now - (int64_t)frame * FRAME_US) / 1000.0;
+      e2e_sum += e2e_ms;
+      result.e2e_ms_max = std::max(result.e2e_ms_max, e2e_ms);
+    }
+  }
+  result.stats = jitter.stats();
+  result.e2e_ms_mean = result.stats.played > 0 ? e2e_sum / result.stats.played : 0;
+}
+
+static void report(const char *name, const Channel &channel, const LoopResult &r)
+{
+  printf("%-12s loss=%.0f%% reorder=%.0f%% jitter=%dms: played=%u concealed=%u (underruns=%u) lost=%u late=%u "
+         "skipped=%u target=%u jitter_est=%.1fms e2e mean=%.1fms max=%.1fms buffer mean=%.1fms\n",
+         name, channel.loss * 100, channel.reorder * 100, channel.jitter_ms, r.stats.played, r.stats.concealed,
+         r.stats.underruns, r.lost, r.stats.late, r.stats.skipped, r.stats.target_frames, r.stats.jitter_us / 1000.0,
+         r.e2e_ms_mean, r.e2e_ms_max,
+         r.stats.played > 0 ? r.stats.latency_us_sum / 1000.0 / r.stats.played : 0.0);
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_codec_round_trip()
+{
+  int16_t pcm[FRAME_SAMPLES];
+  make_frame(3, pcm);
+  UdpAudioHeader header = {5, 0xfffe, FRAME_SAMPLES, 0x12345678u};
+  uint8_t packet[UDP_AUDIO_HEADER_BYTES + sizeof(pcm)];
+  TEST_ASSERT_EQUAL(0, udp_audio_encode(packet, sizeof(packet) - 1, header, pcm));
+  TEST_ASSERT_EQUAL(sizeof(packet), udp_audio_encode(packet, sizeof(packet), header, pcm));
+
+  UdpAudioHeader decoded;
+  const uint8_t *data;
+  TEST_ASSERT_TRUE(udp_audio_decode(packet, sizeof(packet), decoded, &data));
+  TEST_ASSERT_EQUAL_UINT8(5, decoded.stream);
+  TEST_ASSERT_EQUAL_UINT16(0xfffe, decoded.seq);
+  TEST_ASSERT_EQUAL_UINT16(FRAME_SAMPLES, decoded.samples);
+  TEST_ASSERT_EQUAL_UINT32(0x12345678u, decoded.timestamp);
+  TEST_ASSERT_EQUAL_MEMORY(pcm, data, sizeof(pcm));
+
+  TEST_ASSERT_FALSE(udp_audio_decode(packet, sizeof(packet) - 2, decoded, &data)); // 截断
+  packet[0] ^= 1;
+  TEST_ASSERT_FALSE(udp_audio_decode(packet, sizeof(packet), decoded, &data)); // 魔数错误
+}
+
+void test_clean_channel_is_bit_exact()
+{
+  Channel channel = {20, 3, 0.0, 0.0, 0};
+  LoopResult r;
+  run_loopback(channel, 1, r);
+  report("clean", channel, r);
+  TEST_ASSERT_EQUAL_UINT32(0, r.mismatched);
+  TEST_ASSERT_EQUAL_UINT32(0, r.stats.concealed);
+  TEST_ASSERT_EQUAL_UINT32(0, r.stats.late);
+  TEST_ASSERT_EQUAL_UINT32(TOTAL_FRAMES, r.stats.played + r.stats.skipped);
+  TEST_ASSERT_EQUAL_UINT16(JITTER_MIN_FRAMES, r.stats.target_frames);
+}
+
+void test_loss_and_reorder_are_concealed()
+{
+  Channel channel = {20, 20, 0.05, 0.05, 0};
+  LoopResult r;
+  run_loopback(channel, 2, r);
+  report("lossy", channel, r);
+  TEST_ASSERT_EQUAL_UINT32(0, r.mismatched);
+  TEST_ASSERT_TRUE(r.lost > 0 && r.reordered > 0);
+  // 每一帧要么正常播放，要么被丢弃 (静音)，要么被隐藏
+  TEST_ASSERT_EQUAL_UINT32(TOTAL_FRAMES, r.stats.played + r.stats.skipped + r.stats.concealed - r.stats.underruns);
+  TEST_ASSERT_TRUE(r.stats.concealed >= r.lost);
+  // 乱序的包大多仍能赶上播放
+  TEST_ASSERT_TRUE(r.stats.late < r.reordered / 2 + 1);
+  TEST_ASSERT_TRUE(r.e2e_ms_mean < channel.base_ms + JITTER_MAX_FRAMES * FRAME_US / 1000.0);
+}
+
+void test_target_depth_follows_jitter()
+{
+  Channel calm = {20, 3, 0.0, 0.0, 0}, rough = {20, 80, 0.02, 0.1, 0};
+  LoopResult a, b;
+  run_loopback(calm, 3, a);
+  run_loopback(rough, 3, b);
+  report("calm", calm, a);
+  report("rough", rough, b);
+  TEST_ASSERT_EQUAL_UINT32(0, b.mismatched);
+  TEST_ASSERT_TRUE(b.stats.target_frames > a.stats.target_frames);
+  TEST_ASSERT_TRUE(b.e2e_ms_mean > a.e2e_ms_mean);
+  TEST_ASSERT_TRUE(b.stats.late < b.reordered / 2 + 1);
+}
+
+void test_burst_after_stall_drains_through_silence()
+{
+  Channel channel = {20, 3, 0.0, 0.0, 300};
+  LoopResult r;
+  run_loopback(channel, 4, r);
+  report("stall", channel, r);
+  TEST_ASSERT_EQUAL_UINT32(0, r.mismatched);
+  TEST_ASSERT_TRUE(r.stats.underruns > 0);
+  // 断流结束后缓冲过深，只丢弃静音帧追回延迟，语音帧全部播放
+  TEST_ASSERT_TRUE(r.stats.skipped > 0);
+  TEST_ASSERT_EQUAL_UINT32(TOTAL_FRAMES, r.stats.played + r.stats.skipped);
+  TEST_ASSERT_TRUE(r.e2e_ms_max - r.e2e_ms_mean > 100);
+}
+
+void test_new_stream_discards_stale_packets()
+{
+  JitterBuffer jitter;
+  TEST_ASSERT_TRUE(jitter.begin(FRAME_SAMPLES, 8, 1, 4, SAMPLE_RATE));
+  int16_t pcm[FRAME_SAMPLES], out[FRAME_SAMPLES];
+  uint8_t packet[UDP_AUDIO_HEADER_BYTES + sizeof(pcm)];
+  make_frame(0, pcm);
+  UdpAudioHeader old_header = {1, 0, FRAME_SAMPLES, 5 * FRAME_SAMPLES};
+  size_t length = udp_audio_encode(packet, sizeof(packet), old_header, pcm);
+  TEST_ASSERT_TRUE(jitter.push(packet, length, 0));
+
+  UdpAudioHeader new_header = {2, 0, FRAME_SAMPLES, 0};
+  length = udp_audio_encode(packet, sizeof(packet), new_header, pcm);
+  TEST_ASSERT_TRUE(jitter.push(packet, length, 1000));
+  TEST_ASSERT_EQUAL(JITTER_PLAYED, jitter.pop(out, 20000));
+  TEST_ASSERT_EQUAL_UINT32(FRAME_SAMPLES, jitter.position());
+  TEST_ASSERT_EQUAL_MEMORY(pcm, out, sizeof(pcm));
+  // 上一段的帧5已被清除，下一帧是欠载隐藏
+  TEST_ASSERT_EQUAL(JITTER_CONCEALED, jitter.pop(out, 36000));
+  TEST_ASSERT_EQUAL_UINT32(1, jitter.stats().underruns);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_codec_round_trip);
+  RUN_TEST(test_clean_channel_is_bit_exact);
+  RUN_TEST(test_loss_and_reorder_are_concealed);
+  RUN_TEST(test_target_depth_follows_jitter);
+  RUN_TEST(test_burst_after_stall_drains_through_silence);
+  RUN_TEST(test_new_stream_discards_stale_packets);
+  return UNITY_END();
+}
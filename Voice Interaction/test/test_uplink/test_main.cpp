@@ -0,0 +1,297 @@
+// 上行背压策略的主机端测试: 固定速率采集线程 + 限速并带断流的假socket
+// 运行: pio test -e native -f test_uplink -v
+
+#include <unity.h>
+
+#include <chrono>
+#include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+#include "audio_uplink.h"
+
+typedef std::chrono::steady_clock Clock;
+
+static const size_t FRAME_SAMPLES = 1024;
+static const size_t FRAME_BYTES = FRAME_SAMPLES * sizeof(int16_t);
+
+// 限速的假socket: 按固定带宽写入，在断流时间窗内完全阻塞 (模拟WiFi抖动时TCP发送缓冲区满)
+class FakeSocket
+{
+public:
+  FakeSocket(double bytes_per_ms, int outage_start_ms, int outage_ms)
+      : bytes_per_ms_(bytes_per_ms), outage_start_ms_(outage_start_ms), outage_ms_(outage_ms), start_(Clock::now())
+  {
+  }
+
+  size_t write(const uint8_t *data, size_t size)
+  {
+    double now = elapsedMs();
+    if (now >= outage_start_ms_ && now < outage_start_ms_ + outage_ms_)
+    {
+      std::this_thread::sleep_for(std::chrono::microseconds((int64_t)((outage_start_ms_ + outage_ms_ - now) * 1000)));
+      now = elapsedMs();
+    }
+    // 令牌桶: 写入时间不早于上一次写入结束时间
+    busy_until_ms_ = (busy_until_ms_ > now ? busy_until_ms_ : now) + size / bytes_per_ms_;
+    std::this_thread::sleep_for(std::chrono::microseconds((int64_t)((busy_until_ms_ - now) * 1000)));
+    stream.insert(stream.end(), data, data + size);
+    return size;
+  }
+
+  std::vector<uint8_t> stream;
+
+private:
+  double elapsedMs() const
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start_).count();
+  }
+
+  double bytes_per_ms_;
+  int outage_start_ms_;
+  int outage_ms_;
+  Clock::time_point start_;
+  double busy_until_ms_ = 0;
+};
+
+// 按 server.py receive_sample() 的方式解析上行字节流，间隙以静音补齐
+struct ServerView
+{
+  std::vector<int16_t> samples;
+  int signals = 0;
+  int gaps = 0;
+  bool stopped = false;
+};
+
+static uint32_t read_u32(const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static ServerView parse_stream(const std::vector<uint8_t> &stream)
+{
+  ServerView view;
+  size_t pos = 0;
+  while (pos + 5 <= stream.size())
+  {
+    uint8_t type = stream[pos];
+    uint32_t length = read_u32(&stream[pos + 1]);
+    const uint8_t *payload = &stream[pos + 5];
+    pos += 5 + length;
+    if (type == UPLINK_TYPE_SIGNAL)
+    {
+      view.signals++;
+      view.stopped = payload[0] == 0x02;
+    }
+    else if (type == UPLINK_TYPE_GAP)
+    {
+      view.gaps++;
+      view.samples.insert(view.samples.end(), read_u32(payload), 0);
+    }
+    else if (type == UPLINK_TYPE_AUDIO)
+    {
+      const int16_t *pcm = (const int16_t *)payload;
+      view.samples.insert(view.samples.end(), pcm, pcm + length / sizeof(int16_t));
+    }
+  }
+  return view;
+}
+
+// 第k帧全部填充为k+1 (0留给间隙)；每20帧交替语音/静音
+static bool frame_is_speech(size_t k)
+{
+  return (k / 20) % 2 == 0;
+}
+
+struct RunResult
+{
+  UplinkStats stats;
+  ServerView view;
+  double push_us_max;
+  size_t speech_received;
+  size_t free_frames;
+};
+
+static void run_policy(UplinkPolicy policy, uint32_t block_ms, size_t total_frames, RunResult &result)
+{
+  const int frame_period_us = 2000; // 1024样本帧在16kHz下为64ms，这里按32倍加速
+  static AudioUplink uplink;
+  TEST_ASSERT_TRUE(uplink.begin(16, FRAME_BYTES, policy, block_ms));
+
+  // 带宽为采集速率的1.5倍，在第300ms处断流150ms
+  FakeSocket socket(1.5 * FRAME_BYTES / (frame_period_us / 1000.0), 300, 150);
+  std::thread sender([&]() {
+    UplinkItem item;
+    while (true)
+    {
+      if (!uplink.acquire(item, 20))
+      {
+        continue;
+      }
+      uplink_write_item(socket, item);
+      bool done = item.kind == UPLINK_SIGNAL && item.signal == 0x02;
+      uplink.release();
+      if (done)
+      {
+        break;
+      }
+    }
+  });
+
+  std::vector<int16_t> frame(FRAME_SAMPLES);
+  uplink.pushSignal(0x01);
+  Clock::time_point start = Clock::now();
+  for (size_t k = 0; k < total_frames; k++)
+  {
+    // 固定速率采集: 落后时立即补读 (对应I2S DMA中积压的数据)
+    std::this_thread::sleep_until(start + std::chrono::microseconds(k * frame_period_us));
+    std::fill(frame.begin(), frame.end(), (int16_t)(k + 1));
+    Clock::time_point t0 = Clock::now();
+    uplink.pushAudio(frame.data(), FRAME_BYTES, frame_is_speech(k));
+    double us = std::chrono::duration<double, std::micro>(Clock::now() - t0).count();
+    result.push_us_max = us > result.push_us_max ? us : result.push_us_max;
+  }
+  uplink.pushSignal(0x02);
+  sender.join();
+
+  result.stats = uplink.stats();
+  result.view = parse_stream(socket.stream);
+  result.free_frames = uplink.freeFrames();
+  for (size_t k = 0; k < total_frames; k++)
+  {
+    if (frame_is_speech(k) && result.view.samples[k * FRAME_SAMPLES] == (int16_t)(k + 1))
+    {
+      result.speech_received++;
+    }
+  }
+}
+
+static void check_run(const char *name, const RunResult &r, size_t total_frames, size_t total_speech)
+{
+  const UplinkStats &s = r.stats;
+  uint32_t dropped = s.dropped_oldest + s.dropped_silence + s.dropped_new;
+  printf("[uplink] %-13s sent=%u dropped=%u (oldest=%u silence=%u new=%u) stalls=%u stall_max=%.1f ms "
+         "gaps=%u high_water=%u push_max=%.2f ms speech_kept=%zu/%zu\n",
+         name, s.frames_sent, dropped, s.dropped_oldest, s.dropped_silence, s.dropped_new, s.stalls,
+         s.stall_us_max / 1000.0, s.gaps_sent, s.high_water, r.push_us_max / 1000.0, r.speech_received, total_speech);
+
+  // 没有泄漏: 缓冲池全部归还，每一帧要么发送要么计入丢弃
+  TEST_ASSERT_EQUAL(16, r.free_frames);
+  TEST_ASSERT_EQUAL_UINT32(total_frames, s.frames_in);
+  TEST_ASSERT_EQUAL_UINT32(s.frames_in, s.frames_sent + dropped);
+  TEST_ASSERT_EQUAL_UINT32(0, s.dropped_signals);
+  TEST_ASSERT_TRUE(dropped > 0); // 断流时间长于缓冲池容量，必然丢帧
+  TEST_ASSERT_TRUE(r.view.stopped);
+  TEST_ASSERT_EQUAL(2, r.view.signals);
+
+  // 时间轴对齐: 间隙补齐后总长度不变，收到的每一帧都在原来的位置上
+  TEST_ASSERT_EQUAL(total_frames * FRAME_SAMPLES, r.view.samples.size());
+  TEST_ASSERT_EQUAL_UINT64(dropped * FRAME_SAMPLES, s.gap_samples);
+  for (size_t k = 0; k < total_frames; k++)
+  {
+    int16_t v = r.view.samples[k * FRAME_SAMPLES];
+    TEST_ASSERT_TRUE(v == 0 || v == (int16_t)(k + 1));
+    TEST_ASSERT_EQUAL_INT16(v, r.view.samples[(k + 1) * FRAME_SAMPLES - 1]);
+  }
+}
+
+static const size_t TOTAL_FRAMES = 400;
+
+static size_t total_speech()
+{
+  size_t n = 0;
+  for (size_t k = 0; k < TOTAL_FRAMES; k++)
+  {
+    n += frame_is_speech(k);
+  }
+  return n;
+}
+
+void setUp() {}
+void tearDown() {}
+
+void test_drop_silence_moves_gap_to_next_frame()
+{
+  AudioUplink uplink;
+  TEST_ASSERT_TRUE(uplink.begin(3, 8, UPLINK_DROP_SILENCE, 0));
+  int16_t a[4] = {1, 1, 1, 1}, b[4] = {2, 2, 2, 2}, c[4] = {3, 3, 3, 3}, d[4] = {4, 4, 4, 4};
+  TEST_ASSERT_TRUE(uplink.pushSignal(0x01));
+  TEST_ASSERT_TRUE(uplink.pushAudio(a, sizeof(a), true));
+  TEST_ASSERT_TRUE(uplink.pushAudio(b, sizeof(b), false));
+  TEST_ASSERT_TRUE(uplink.pushAudio(c, sizeof(c), true));
+  TEST_ASSERT_TRUE(uplink.pushAudio(d, sizeof(d), true)); // 丢弃b而不是更旧的a
+
+  UplinkItem item;
+  TEST_ASSERT_TRUE(uplink.acquire(item, 0));
+  TEST_ASSERT_EQUAL(UPLINK_SIGNAL, item.kind);
+  uplink.release();
+  TEST_ASSERT_TRUE(uplink.acquire(item, 0));
+  TEST_ASSERT_EQUAL_INT16(1, item.data[0]);
+  TEST_ASSERT_EQUAL_UINT32(0, item.gap_samples);
+  uplink.release();
+  TEST_ASSERT_TRUE(uplink.acquire(item, 0));
+  TEST_ASSERT_EQUAL_INT16(3, item.data[0]);
+  TEST_ASSERT_EQUAL_UINT32(4, item.gap_samples);
+  uplink.release();
+  TEST_ASSERT_EQUAL_UINT32(1, uplink.stats().dropped_silence);
+}
+
+void test_in_flight_frame_is_never_dropped()
+{
+  AudioUplink uplink;
+  TEST_ASSERT_TRUE(uplink.begin(2, 8, UPLINK_DROP_OLDEST, 0));
+  int16_t a[4] = {1}, b[4] = {2}, c[4] = {3};
+  uplink.pushAudio(a, sizeof(a), true);
+  uplink.pushAudio(b, sizeof(b), true);
+  UplinkItem item;
+  TEST_ASSERT_TRUE(uplink.acquire(item, 0)); // a正在发送
+  uplink.pushAudio(c, sizeof(c), true);      // 只能丢弃b
+  TEST_ASSERT_EQUAL_INT16(1, item.data[0]);
+  uplink.release();
+  TEST_ASSERT_TRUE(uplink.acquire(item, 0));
+  TEST_ASSERT_EQUAL_INT16(3, item.data[0]);
+  TEST_ASSERT_EQUAL_UINT32(4, item.gap_samples);
+  uplink.release();
+}
+
+void test_block_policy_bounds_capture_stall()
+{
+  RunResult r = {};
+  run_policy(UPLINK_BLOCK, 10, TOTAL_FRAMES, r);
+  check_run("block(10ms)", r, TOTAL_FRAMES, total_speech());
+  TEST_ASSERT_TRUE(r.stats.stalls > 0);
+  TEST_ASSERT_TRUE(r.push_us_max < 10000 + 5000); // 等待上限 + 调度余量
+}
+
+void test_drop_oldest_never_blocks_capture()
+{
+  RunResult r = {};
+  run_policy(UPLINK_DROP_OLDEST, 10, TOTAL_FRAMES, r);
+  check_run("drop_oldest", r, TOTAL_FRAMES, total_speech());
+  TEST_ASSERT_EQUAL_UINT32(0, r.stats.stalls);
+  TEST_ASSERT_TRUE(r.push_us_max < 2000);
+}
+
+void test_drop_silence_keeps_more_speech()
+{
+  RunResult oldest = {}, r = {};
+  run_policy(UPLINK_DROP_OLDEST, 10, TOTAL_FRAMES, oldest);
+  run_policy(UPLINK_DROP_SILENCE, 10, TOTAL_FRAMES, r);
+  check_run("drop_silence", r, TOTAL_FRAMES, total_speech());
+  TEST_ASSERT_EQUAL_UINT32(0, r.stats.stalls);
+  TEST_ASSERT_TRUE(r.push_us_max < 2000);
+  TEST_ASSERT_TRUE(r.stats.dropped_silence > 0);
+  TEST_ASSERT_TRUE(r.speech_received >= oldest.speech_received);
+}
+
+int main()
+{
+  UNITY_BEGIN();
+  RUN_TEST(test_drop_silence_moves_gap_to_next_frame);
+  RUN_TEST(test_in_flight_frame_is_never_dropped);
+  RUN_TEST(test_block_policy_bounds_capture_stall);
+  RUN_TEST(test_drop_oldest_never_blocks_capture);
+  RUN_TEST(test_drop_silence_keeps_more_speech);
+  return UNITY_END();
+}
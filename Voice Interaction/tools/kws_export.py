@@ -0,0 +1,170 @@
+"""
+把训练好的DS-CNN关键词唤醒模型导出为固件可用的int8 C头文件 (src/kws_model_data.h)。
+
+输入为一个 .npz 文件，按层顺序包含以下键 (i 从 0 开始):
+    layer{i}_type    : 'conv' | 'dw' | 'pw' | 'avgpool' | 'fc'
+    layer{i}_w       : float 权重，布局与固件一致
+                       conv [out_c, k_h, k_w, in_c], dw [k_h, k_w, c], pw/fc [out, in]
+    layer{i}_b       : float 偏置 (avgpool 不需要)
+    layer{i}_stride  : (stride_h, stride_w)，仅 conv/dw
+    layer{i}_same    : 是否使用SAME填充，仅 conv/dw
+    layer{i}_relu    : 输出是否经过ReLU
+    layer{i}_range   : 该层输出激活在校准集上的 (min, max)
+    input_range      : 输入MFCC在校准集上的 (min, max)
+    labels           : 类别名称列表
+    wake_label       : 唤醒词类别名称
+
+用法:
+    python kws_export.py model.npz ../src/kws_model_data.h
+"""
+
+import sys
+
+import numpy as np
+
+NUM_FRAMES = 49  # 与 kws_mfcc.h 中 KWS_NUM_FRAMES 保持一致
+MFCC_COEFFS = 10  # 与 kws_mfcc.h 中 KWS_MFCC_COEFFS 保持一致
+
+LAYER_TYPES = {
+    "conv": "KWS_LAYER_CONV",
+    "dw": "KWS_LAYER_DEPTHWISE",
+    "pw": "KWS_LAYER_POINTWISE",
+    "avgpool": "KWS_LAYER_AVGPOOL",
+    "fc": "KWS_LAYER_FC",
+}
+
+
+def activation_quant(value_range):
+    """
+    按 (min, max) 计算非对称int8量化参数。
+
+    Returns:
+        tuple: (scale, zero_point)
+    """
+    lo = min(float(value_range[0]), 0.0)
+    hi = max(float(value_range[1]), 0.0)
+    scale = max((hi - lo) / 255.0, 1e-8)
+    zero_point = int(np.clip(round(-128 - lo / scale), -128, 127))
+    return scale, zero_point
+
+
+def quantize_multiplier(real):
+    """
+    把实数缩放因子拆成 Q31 定点乘数和移位量: real = multiplier * 2^(shift - 31)。
+    """
+    if real == 0.0:
+        return 0, 0
+    mantissa, exponent = np.frexp(real)
+    multiplier = int(round(mantissa * (1 << 31)))
+    if multiplier == (1 << 31):
+        multiplier //= 2
+        exponent += 1
+    return multiplier, int(exponent)
+
+
+def c_array(ctype, name, values):
+    body = ", ".join(str(int(v)) for v in np.asarray(values).reshape(-1))
+    return f"static const {ctype} {name}[] = {{{body}}};\n"
+
+
+def out_dim(size, kernel, stride, same):
+    if same:
+        return (size + stride - 1) // stride, max(((size + stride - 1) // stride - 1) * stride + kernel - size, 0) // 2
+    return (size - kernel) // stride + 1, 0
+
+
+def export(npz_path, header_path):
+    data = np.load(npz_path, allow_pickle=True)
+    labels = [str(x) for x in data["labels"]]
+    wake_label = labels.index(str(data["wake_label"]))
+    in_scale, in_zp = activation_quant(data["input_range"])
+
+    arrays = []
+    layers = []
+    h, w, c = NUM_FRAMES, MFCC_COEFFS, 1
+    cur_scale, cur_zp = in_scale, in_zp
+    i = 0
+    while f"layer{i}_type" in data:
+        kind = str(data[f"layer{i}_type"])
+        relu = bool(data[f"layer{i}_relu"]) if f"layer{i}_relu" in data else False
+        k_h = k_w = s_h = s_w = 1
+        pad_h = pad_w = 0
+
+        if kind == "avgpool":
+            # 平均池化沿用输入的量化参数
+            layers.append(
+                f"    {{{LAYER_TYPES[kind]}, 1, 1, 1, 1, 0, 0, {c}, nullptr, nullptr, nullptr, nullptr, "
+                f"{cur_zp}, {cur_zp}, false}},\n"
+            )
+            h = w = 1
+            i += 1
+            continue
+
+        weights = np.asarray(data[f"layer{i}_w"], dtype=np.float64)
+        bias = np.asarray(data[f"layer{i}_b"], dtype=np.float64)
+        out_scale, out_zp = activation_quant(data[f"layer{i}_range"])
+
+        if kind == "conv":
+            out_c, k_h, k_w, _ = weights.shape
+            s_h, s_w = (int(x) for x in data[f"layer{i}_stride"])
+            same = bool(data[f"layer{i}_same"])
+            oh, pad_h = out_dim(h, k_h, s_h, same)
+            ow, pad_w = out_dim(w, k_w, s_w, same)
+            per_channel = weights.reshape(out_c, -1)
+        elif kind == "dw":
+            k_h, k_w, out_c = weights.shape
+            s_h, s_w = (int(x) for x in data[f"layer{i}_stride"])
+            same = bool(data[f"layer{i}_same"])
+            oh, pad_h = out_dim(h, k_h, s_h, same)
+            ow, pad_w = out_dim(w, k_w, s_w, same)
+            per_channel = weights.reshape(-1, out_c).T
+        else:  # pw / fc
+            out_c = weights.shape[0]
+            oh, ow = (h, w) if kind == "pw" else (1, 1)
+            per_channel = weights
+
+        # 逐输出通道对称量化权重
+        w_scale = np.maximum(np.abs(per_channel).max(axis=1), 1e-8) / 127.0
+        if kind == "dw":
+            q_weights = np.clip(np.round(weights / w_scale), -127, 127)
+        else:
+            q_weights = np.clip(np.round(per_channel / w_scale[:, None]), -127, 127).reshape(weights.shape)
+        q_bias = np.round(bias / (cur_scale * w_scale))
+        multipliers, shifts = zip(*(quantize_multiplier(cur_scale * s / out_scale) for s in w_scale))
+
+        arrays.append(c_array("int8_t", f"kws_layer{i}_weights", q_weights))
+        arrays.append(c_array("int32_t", f"kws_layer{i}_bias", q_bias))
+        arrays.append(c_array("int32_t", f"kws_layer{i}_multiplier", multipliers))
+        arrays.append(c_array("int8_t", f"kws_layer{i}_shift", shifts))
+        layers.append(
+            f"    {{{LAYER_TYPES[kind]}, {k_h}, {k_w}, {s_h}, {s_w}, {pad_h}, {pad_w}, {out_c}, "
+            f"kws_layer{i}_weights, kws_layer{i}_bias, kws_layer{i}_multiplier, kws_layer{i}_shift, "
+            f"{cur_zp}, {out_zp}, {'true' if relu else 'false'}}},\n"
+        )
+        h, w, c = oh, ow, out_c
+        cur_scale, cur_zp = out_scale, out_zp
+        i += 1
+
+    with open(header_path, "w", encoding="utf-8") as f:
+        f.write("// 由 tools/kws_export.py 自动生成，请勿手动修改\n")
+        f.write("#ifndef KWS_MODEL_DATA_H\n#define KWS_MODEL_DATA_H\n\n")
+        f.write('#include "kws_model.h"\n\n')
+        f.write(f"// 类别: {', '.join(labels)}\n")
+        f.writelines(arrays)
+        f.write("\nstatic const KwsLayer kws_layers[] = {\n")
+        f.writelines(layers)
+        f.write("};\n\n")
+        f.write(
+            "static const KwsModel kws_model = {\n"
+            f"    {NUM_FRAMES}, {MFCC_COEFFS}, {in_scale:.9g}f, {in_zp}, {cur_scale:.9g}f, {cur_zp},\n"
+            f"    {len(layers)}, kws_layers, {len(labels)}, {wake_label}}};\n\n"
+        )
+        f.write("#endif // KWS_MODEL_DATA_H\n")
+    print(f"导出 {len(layers)} 层到 {header_path}")
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        print(__doc__)
+        sys.exit(1)
+    export(sys.argv[1], sys.argv[2])